@@ -0,0 +1,125 @@
+#ifndef FF_CHANNEL_PUBLIC_H
+#define FF_CHANNEL_PUBLIC_H
+
+#include "ff/ff_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @public
+ * the opaque channel structure.
+ * The channel transfers fixed-size values between fibers of the scheduler, which created it,
+ * so it should be used only by fibers of this scheduler.
+ */
+struct ff_channel;
+
+/**
+ * @public
+ * operations, which can be selected by the ff_channel_select()
+ */
+enum ff_channel_operation
+{
+	FF_CHANNEL_SEND,
+	FF_CHANNEL_RECEIVE
+};
+
+/**
+ * @public
+ * the case of the ff_channel_select()
+ */
+struct ff_channel_select_case
+{
+	struct ff_channel *channel;
+	enum ff_channel_operation operation;
+
+	/* the value to send or the buffer for the received value. Its size must be equal
+	 * to the element_size of the channel.
+	 */
+	void *value;
+
+	/* is set by the ff_channel_select() for the selected case. It is FF_FAILURE
+	 * if the channel has been closed, i.e. the value cannot be sent to the channel
+	 * or the closed channel has no more values to receive.
+	 */
+	enum ff_result result;
+};
+
+/**
+ * @public
+ * creates the channel for values of the given element_size in bytes, which can hold
+ * up to the capacity values. The unbuffered channel with zero capacity transfers values
+ * only when both the sender and the receiver are ready.
+ * Always returns correct result.
+ */
+FF_API struct ff_channel *ff_channel_create(int element_size, int capacity);
+
+/**
+ * @public
+ * deletes the channel. There must be no fibers blocked on the channel.
+ */
+FF_API void ff_channel_delete(struct ff_channel *channel);
+
+/**
+ * @public
+ * sends the value to the channel. The value is handed directly to the waiting receiver if any.
+ * Otherwise it is put into the channel's buffer. Blocks while the buffer is full.
+ * Returns FF_FAILURE if the channel has been closed.
+ */
+FF_API enum ff_result ff_channel_send(struct ff_channel *channel, const void *value);
+
+/**
+ * @public
+ * the same as the ff_channel_send(), but returns FF_FAILURE if the value cannot be sent
+ * during the timeout in milliseconds or the current fiber has been cancelled.
+ */
+FF_API enum ff_result ff_channel_send_with_timeout(struct ff_channel *channel, const void *value, int timeout);
+
+/**
+ * @public
+ * receives the value from the channel. Blocks while the channel is empty.
+ * Returns FF_FAILURE if the channel has been closed and has no more values.
+ */
+FF_API enum ff_result ff_channel_receive(struct ff_channel *channel, void *value);
+
+/**
+ * @public
+ * the same as the ff_channel_receive(), but returns FF_FAILURE if the value cannot be received
+ * during the timeout in milliseconds or the current fiber has been cancelled.
+ */
+FF_API enum ff_result ff_channel_receive_with_timeout(struct ff_channel *channel, void *value, int timeout);
+
+/**
+ * @public
+ * closes the channel. Blocked senders fail, while receivers get remaining values
+ * from the channel's buffer and then fail.
+ */
+FF_API void ff_channel_close(struct ff_channel *channel);
+
+/**
+ * @public
+ * Returns the number of values in the channel's buffer.
+ */
+FF_API int ff_channel_get_size(struct ff_channel *channel);
+
+/**
+ * @public
+ * waits until one of the given cases can be completed, completes it and returns its index.
+ * Ready cases are selected in the round-robin order, so they don't starve.
+ * The current fiber is woken up only once regardless of the number of cases.
+ */
+FF_API int ff_channel_select(struct ff_channel_select_case *cases, int cases_cnt);
+
+/**
+ * @public
+ * the same as the ff_channel_select(), but returns -1 if none of the cases can be completed
+ * during the timeout in milliseconds or the current fiber has been cancelled.
+ */
+FF_API int ff_channel_select_with_timeout(struct ff_channel_select_case *cases, int cases_cnt, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,6 +2,7 @@
 #define FF_CORE_PUBLIC_H
 
 #include "ff/ff_common.h"
+#include "ff/ff_fiber.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -9,22 +10,177 @@ extern "C" {
 
 /**
  * @public
- * Initializes the fiber framework
+ * Initializes the fiber framework.
+ * On Linux, I/O operations are submitted to io_uring if the FF_IO_BACKEND environment variable
+ * is set to "io_uring" and the kernel supports it. Otherwise readiness of file descriptors
+ * is waited for via epoll.
+ * Latency-critical applications on Linux can set the FF_BUSY_POLL environment variable
+ * to the maximum time in microseconds, during which schedulers poll for events without blocking.
+ * The actual spin time adapts to the arrival rate of events, so idle schedulers don't burn the CPU.
+ * The FF_SO_BUSY_POLL environment variable sets the SO_BUSY_POLL option in microseconds
+ * for TCP sockets.
  */
 FF_API void ff_core_initialize(const wchar_t *log_filename);
 
 /**
  * @public
- * Shutdowns the fiber framework
+ * Modes of schedulers started by the ff_core_initialize_schedulers()
+ */
+enum ff_core_scheduler_mode
+{
+	/**
+	 * each scheduler executes only fiberpool functions, which were passed to it.
+	 */
+	FF_CORE_SCHEDULER_ISOLATED,
+
+	/**
+	 * functions passed to ff_core_fiberpool_execute_async(), which weren't started yet,
+	 * can be stolen and executed by idle schedulers. These functions shouldn't use objects,
+	 * which belong to the scheduler, which called ff_core_fiberpool_execute_async().
+	 */
+	FF_CORE_SCHEDULER_WORK_STEALING
+};
+
+/**
+ * @public
+ * Initializes the fiber framework with the given number of schedulers working in the given mode.
+ * The current thread becomes the scheduler with zero id, while the rest of schedulers
+ * are started in separate threads, which are pinned to distinct cpus.
+ * Schedulers share nothing: each scheduler has its own completion port, pending fibers,
+ * threadpool, fiberpool and timeouts. Fibers never migrate between schedulers,
+ * so objects created in the given scheduler should be used only by fibers of this scheduler.
+ * Use ff_core_post_to_scheduler() for passing work to other schedulers.
+ * ff_core_initialize(log_filename) is equivalent to
+ * ff_core_initialize_schedulers(log_filename, 1, FF_CORE_SCHEDULER_ISOLATED).
+ */
+FF_API void ff_core_initialize_schedulers(const wchar_t *log_filename, int schedulers_cnt, enum ff_core_scheduler_mode mode);
+
+/**
+ * @public
+ * Shutdowns the fiber framework.
+ * This function must be called from the thread, which called ff_core_initialize().
  */
 FF_API void ff_core_shutdown();
 
 /**
  * @public
- * sleeps the current fiber for the given interval milliseconds
+ * Returns the number of schedulers started by the ff_core_initialize_schedulers()
+ */
+FF_API int ff_core_get_schedulers_cnt();
+
+/**
+ * @public
+ * Returns the id of the scheduler, which runs the current fiber.
+ * Scheduler ids are in the range [0 ... ff_core_get_schedulers_cnt() - 1].
+ */
+FF_API int ff_core_get_current_scheduler_id();
+
+/**
+ * @public
+ * Returns the monotonic time in nanoseconds since an unspecified point in the past.
+ * The time isn't affected by system clock adjustments. The scheduler reads the clock at most once
+ * per fiber switch and caches it, so this function is cheap enough for hot paths.
+ * The returned time doesn't advance while the current fiber runs without switching.
+ */
+FF_API int64_t ff_core_now_ns();
+
+/**
+ * @public
+ * sleeps the current fiber for the given interval milliseconds.
+ * The sleep is interrupted if the fiber is cancelled via the ff_fiber_cancel().
  */
 FF_API void ff_core_sleep(int interval);
 
+/**
+ * @public
+ * Yields the current fiber to other ready fibers if it runs without switching
+ * for longer than its time slice. CPU-heavy loops should call this function periodically,
+ * so they don't stall other fibers. The function is cheap when the time slice isn't spent.
+ */
+FF_API void ff_core_yield_if_needed();
+
+/**
+ * @public
+ * Starts the watchdog, which logs the fiber_func and the stack trace of fibers running
+ * for longer than the given budget in milliseconds without switching to other fibers.
+ * The budget equal to 0 stops the watchdog.
+ * The watchdog can be also started by setting the FF_WATCHDOG_BUDGET environment variable
+ * to the budget before the ff_core_initialize() call.
+ * This function must be called from the thread, which called the ff_core_initialize().
+ */
+FF_API void ff_core_set_watchdog_budget(int budget);
+
+/**
+ * @public
+ * Sets how often schedulers check the completion port for ready I/O operations
+ * while there are other fibers ready to run. Without these checks the I/O can be starved
+ * by fibers, which continuously wake up each other.
+ * The check is performed after switches_interval fiber switches or after time_interval
+ * microseconds since the previous check, whichever comes first.
+ * Zero value disables the corresponding condition.
+ * The time_interval condition reads the clock on every fiber switch, so it is disabled by default.
+ * By default the check is performed every 64 switches.
+ */
+FF_API void ff_core_set_io_poll_policy(int switches_interval, int time_interval);
+
+/**
+ * @public
+ * statistics of I/O events, which were obtained by checks of the completion port
+ * while there were other fibers ready to run.
+ */
+struct ff_core_io_poll_stats
+{
+	/* the number of checks, which were performed */
+	int64_t polls_cnt;
+	/* the number of I/O events obtained by these checks */
+	int64_t events_cnt;
+	/* the sum of delays for all the events in microseconds. The delay of the event
+	 * is the time since the previous check of the completion port, i.e. the upper bound
+	 * of the time the event waited before it was dispatched.
+	 */
+	int64_t total_delay;
+	/* the maximum delay of the event in microseconds */
+	int64_t max_delay;
+};
+
+/**
+ * @public
+ * Returns the io poll statistics accumulated by all the schedulers.
+ * The statistics is updated concurrently by schedulers, so it is approximate.
+ */
+FF_API void ff_core_get_io_poll_stats(struct ff_core_io_poll_stats *stats);
+
+/**
+ * @public
+ * statistics of fiber runs per priority class. Arrays are indexed by enum ff_fiber_priority.
+ */
+struct ff_core_priority_stats
+{
+	/* the number of switches to fibers of the given priority class */
+	int64_t runs_cnt[FF_FIBER_PRIORITIES_CNT];
+	/* the number of runs of fibers, which were selected before fibers with higher priority
+	 * in order to avoid their starvation
+	 */
+	int64_t starvation_runs_cnt[FF_FIBER_PRIORITIES_CNT];
+	/* the total run time of fibers in nanoseconds. It is collected only
+	 * after the ff_core_enable_run_time_stats() call.
+	 */
+	int64_t run_time[FF_FIBER_PRIORITIES_CNT];
+};
+
+/**
+ * @public
+ * Fills the stats with the sum of priority statistics of all the schedulers.
+ */
+FF_API void ff_core_get_priority_stats(struct ff_core_priority_stats *stats);
+
+/**
+ * @public
+ * Enables or disables collecting the run time of fibers per priority class.
+ * It is disabled by default, because it requires reading the clock on every fiber switch.
+ */
+FF_API void ff_core_enable_run_time_stats(int is_enabled);
+
 
 typedef void (*ff_core_threadpool_func)(void *ctx);
 
@@ -38,10 +194,18 @@ typedef void (*ff_core_fiberpool_func)(void *ctx);
 
 /**
  * @public
- * Schedules the func for execution in the fiberpool
+ * Schedules the func for execution in the fiberpool.
+ * In the FF_CORE_SCHEDULER_WORK_STEALING mode the func can be executed by other scheduler.
  */
 FF_API void ff_core_fiberpool_execute_async(ff_core_fiberpool_func func, void *ctx);
 
+/**
+ * @public
+ * Schedules the func for execution in the fiberpool by a fiber with the given priority class.
+ * Use FF_FIBER_PRIORITY_LOW for background tasks, which shouldn't delay latency-sensitive fibers.
+ */
+FF_API void ff_core_fiberpool_execute_async_with_priority(ff_core_fiberpool_func func, void *ctx, enum ff_fiber_priority priority);
+
 /**
  * @public
  * Schedules the func for execution in the fiberpool after the given interval in milliseconds.
@@ -51,6 +215,14 @@ FF_API void ff_core_fiberpool_execute_async(ff_core_fiberpool_func func, void *c
  */
 FF_API void ff_core_fiberpool_execute_deferred(ff_core_fiberpool_func func, void *ctx, int interval);
 
+/**
+ * @public
+ * Schedules the func for execution in the fiberpool of the scheduler with the given scheduler_id.
+ * The func is passed to the scheduler via lock-free mailbox, so this function never blocks
+ * and can be called from any thread including threadpool threads.
+ */
+FF_API void ff_core_post_to_scheduler(int scheduler_id, ff_core_fiberpool_func func, void *ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -46,6 +46,14 @@ FF_API void ff_event_delete(struct ff_event *event);
  */
 FF_API void ff_event_set(struct ff_event *event);
 
+/**
+ * @public
+ * sets the given event and immediately switches to the fiber woken up by the event
+ * via the ff_fiber_switch_to(). It should be used for synchronous hand-offs, when the current fiber
+ * has nothing to do until the woken fiber processes the event.
+ */
+FF_API void ff_event_set_and_switch(struct ff_event *event);
+
 /**
  * @public
  * resets the given event
@@ -61,7 +69,8 @@ FF_API void ff_event_wait(struct ff_event *event);
 /**
  * @public
  * waits while the given event will be set during the timeout;
- * Returns FF_FAILURE if the event wasn't set. Otherwise returns FF_SUCCESS.
+ * Returns FF_FAILURE if the event wasn't set or if the current fiber has been cancelled
+ * via the ff_fiber_cancel(). Otherwise returns FF_SUCCESS.
  */
 FF_API enum ff_result ff_event_wait_with_timeout(struct ff_event *event, int timeout);
 
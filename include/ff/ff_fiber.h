@@ -19,12 +19,65 @@ struct ff_fiber;
  */
 typedef void (*ff_fiber_func)(void *ctx);
 
+/**
+ * @public
+ * stack usage statistics for fibers executing the same fiber_func.
+ * It is collected by the stack profiler, which can be enabled via the ff_fiber_enable_stack_profiler().
+ */
+struct ff_fiber_stack_usage
+{
+	/* the fiber_func, which was passed to the ff_fiber_create() */
+	ff_fiber_func fiber_func;
+
+	/* the number of finished fibers */
+	int fibers_cnt;
+
+	/* the peak stack usage in bytes among finished fibers */
+	int max_stack_usage;
+
+	/* the maximum stack size among finished fibers */
+	int max_stack_size;
+};
+
+/**
+ * @public
+ * priority classes of fibers. Schedulers run fibers of higher priority classes first,
+ * but fibers of lower priority classes are run from time to time even under the constant flow
+ * of higher priority fibers, so they don't starve.
+ */
+enum ff_fiber_priority
+{
+	FF_FIBER_PRIORITY_HIGH,
+	FF_FIBER_PRIORITY_NORMAL,
+	FF_FIBER_PRIORITY_LOW
+};
+
+/**
+ * @public
+ * the number of fiber priority classes
+ */
+#define FF_FIBER_PRIORITIES_CNT 3
+
+/**
+ * @public
+ * the stack_size for the ff_fiber_create(), which creates the fiber running on the stack
+ * shared among such fibers of the current thread.
+ */
+#define FF_FIBER_SHARED_STACK (-1)
+
 /**
  * @public
  * creates the new fiber, which will execute the given fiber_func
  * after calling the ff_fiber_start().
  * stack_size is the size of the stack for the given fiber. If it is set to 0,
  * then the stack size will be set automatically.
+ * Stack memory is committed on demand, so large stack sizes are cheap.
+ * Stack overflow terminates the process with the diagnostic message.
+ * If stack_size is set to FF_FIBER_SHARED_STACK, then the used part of the fiber's stack
+ * is moved to the heap while the fiber is suspended, so mostly idle fibers occupy
+ * only the memory they actually use. Such fibers must not pass pointers
+ * to their local variables to other fibers and threads, since the local variables
+ * are moved while the fiber is suspended.
  * This function always returns correct result.
  */
 FF_API struct ff_fiber *ff_fiber_create(ff_fiber_func fiber_func, int stack_size);
@@ -58,6 +111,73 @@ FF_API void ff_fiber_join(struct ff_fiber *fiber);
  */
 FF_API struct ff_fiber *ff_fiber_get_current();
 
+/**
+ * @public
+ * yields the current fiber to the given fiber, which has been just woken up by the current fiber,
+ * e.g. via the ff_event_set(). The woken fiber runs immediately instead of waiting in the run queue,
+ * while the current fiber continues after other fibers, which are ready to run.
+ * This function returns without yielding if the given fiber isn't the most recently woken fiber
+ * or if it has lower priority than the current fiber or other fibers, which are ready to run.
+ */
+FF_API void ff_fiber_switch_to(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * sets the priority class of the given fiber. Fibers are created with the FF_FIBER_PRIORITY_NORMAL.
+ * The new priority is taken into account the next time the fiber is scheduled for execution.
+ */
+FF_API void ff_fiber_set_priority(struct ff_fiber *fiber, enum ff_fiber_priority priority);
+
+/**
+ * @public
+ * Returns the priority class of the given fiber
+ */
+FF_API enum ff_fiber_priority ff_fiber_get_priority(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * requests the cancellation of the given fiber, which belongs to the current thread.
+ * The cancellable operation, which blocks the fiber, is aborted with an error, while
+ * the object the operation was waiting on stays usable, i.e. the socket isn't disconnected.
+ * Subsequent cancellable operations of the fiber are aborted too until the fiber is started again.
+ * Cancellable operations are socket I/O, the ff_core_sleep()
+ * and *_with_timeout() waits on events and channels. Other operations aren't affected,
+ * so long-running fibers should check the ff_fiber_is_cancelled() periodically.
+ */
+FF_API void ff_fiber_cancel(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Returns non-zero if the ff_fiber_cancel() was called for the given fiber.
+ */
+FF_API int ff_fiber_is_cancelled(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * enables or disables the stack profiler. The profiler records the peak stack usage
+ * of each fiber started while it is enabled and aggregates it per fiber_func.
+ * Unused stack is filled with the canary pattern at the ff_fiber_start(),
+ * so the profiler slows down fibers start.
+ * The profiler can be also enabled by setting the FF_STACK_PROFILER environment variable
+ * to "1" before the ff_core_initialize() call. Collected statistics are written to the log
+ * at the ff_core_shutdown().
+ * Fibers with shared stacks aren't profiled. The profiler isn't supported on Windows.
+ */
+FF_API void ff_fiber_enable_stack_profiler(int is_enabled);
+
+/**
+ * @public
+ * copies up to max_stack_usages_cnt entries of the statistics collected by the stack profiler
+ * to the stack_usages. Returns the total number of entries.
+ */
+FF_API int ff_fiber_get_stack_usages(struct ff_fiber_stack_usage *stack_usages, int max_stack_usages_cnt);
+
+/**
+ * @public
+ * writes the statistics collected by the stack profiler to the log.
+ */
+FF_API void ff_fiber_log_stack_usages();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,86 @@
+#ifndef FF_FIBER_GROUP_PUBLIC_H
+#define FF_FIBER_GROUP_PUBLIC_H
+
+#include "ff/ff_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @public
+ * the opaque structure of the group of child fibers, which are joined and cancelled together.
+ * The group belongs to the scheduler, which created it, so it should be used only
+ * by fibers of this scheduler. Only one fiber can wait for the group at a time.
+ */
+struct ff_fiber_group;
+
+/**
+ * @public
+ * the function, which is executed by the child of the group
+ */
+typedef void (*ff_fiber_group_func)(void *ctx);
+
+/**
+ * @public
+ * creates the empty group.
+ * Always returns correct result.
+ */
+FF_API struct ff_fiber_group *ff_fiber_group_create();
+
+/**
+ * @public
+ * deletes the group. All the children of the group must be completed,
+ * so the ff_fiber_group_wait() should be called before this function.
+ */
+FF_API void ff_fiber_group_delete(struct ff_fiber_group *group);
+
+/**
+ * @public
+ * spawns the child, which executes the func with the given ctx in a fiber from the fiberpool.
+ * The child inherits the priority class of the current fiber.
+ * The child of the cancelled group is started in the cancelled state,
+ * so the func should check the ff_fiber_is_cancelled().
+ */
+FF_API void ff_fiber_group_spawn(struct ff_fiber_group *group, ff_fiber_group_func func, void *ctx);
+
+/**
+ * @public
+ * waits until all the spawned children of the group complete.
+ */
+FF_API void ff_fiber_group_wait(struct ff_fiber_group *group);
+
+/**
+ * @public
+ * waits until at least completed_cnt children of the group complete.
+ * The completed_cnt mustn't exceed the number of spawned children.
+ */
+FF_API void ff_fiber_group_wait_first(struct ff_fiber_group *group, int completed_cnt);
+
+/**
+ * @public
+ * waits until at least completed_cnt children of the group complete during the timeout in milliseconds.
+ * Returns FF_FAILURE if the timeout expired or the current fiber has been cancelled.
+ * Otherwise returns FF_SUCCESS.
+ */
+FF_API enum ff_result ff_fiber_group_wait_first_with_timeout(struct ff_fiber_group *group, int completed_cnt, int timeout);
+
+/**
+ * @public
+ * cancels all the running children of the group via the ff_fiber_cancel()
+ * and marks the group as cancelled, so children spawned later are cancelled too.
+ * Doesn't wait for the children completion - use the ff_fiber_group_wait() for this.
+ */
+FF_API void ff_fiber_group_cancel(struct ff_fiber_group *group);
+
+/**
+ * @public
+ * Returns the number of completed children of the group.
+ */
+FF_API int ff_fiber_group_get_completed_cnt(struct ff_fiber_group *group);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
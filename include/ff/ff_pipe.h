@@ -31,6 +31,13 @@ FF_API enum ff_result ff_pipe_read(struct ff_pipe *pipe, void *buf, int len);
  */
 FF_API enum ff_result ff_pipe_write(struct ff_pipe *pipe, const void *buf, int len);
 
+/**
+ * Switches to the fiber blocked in the ff_pipe_read() on the paired pipe, so it processes
+ * the written data without delay. The ff_pipe_write() only wakes up the reader,
+ * so subsequent writes can be batched before the reader runs.
+ */
+FF_API void ff_pipe_flush(struct ff_pipe *pipe);
+
 /**
  * Disconnects the given pipe.
  * All subsequent calls to the ff_pipe_read() and ff_pipe_write() for the given pipe
@@ -0,0 +1,90 @@
+#ifndef FF_TIMER_PUBLIC_H
+#define FF_TIMER_PUBLIC_H
+
+#include "ff/ff_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @public
+ * the opaque timer structure.
+ * The timer belongs to the scheduler, which created it, so it should be used only
+ * by fibers of this scheduler.
+ */
+struct ff_timer;
+
+/**
+ * @public
+ * the function, which is called when the timer fires
+ */
+typedef void (*ff_timer_func)(void *ctx);
+
+/**
+ * @public
+ * modes of calling the ff_timer_func
+ */
+enum ff_timer_mode
+{
+	/**
+	 * the func is called directly by the scheduler. It must be short and it mustn't block.
+	 */
+	FF_TIMER_INLINE,
+
+	/**
+	 * the func is called by a fiber from the fiberpool, so it can block.
+	 * The func of the periodic timer never overlaps with itself: firings, which occur
+	 * while the previous call is still in progress, are skipped.
+	 */
+	FF_TIMER_FIBERPOOL
+};
+
+/**
+ * @public
+ * creates the stopped timer, which will call the func with the given ctx in the given mode.
+ * Firings of the timer don't allocate memory.
+ * Always returns correct result.
+ */
+FF_API struct ff_timer *ff_timer_create(enum ff_timer_mode mode, ff_timer_func func, void *ctx);
+
+/**
+ * @public
+ * stops and deletes the timer. Waits until the func of the FF_TIMER_FIBERPOOL timer completes,
+ * so this function shouldn't be called from the timer's func.
+ */
+FF_API void ff_timer_delete(struct ff_timer *timer);
+
+/**
+ * @public
+ * arms the timer, so it fires once after the given interval in milliseconds.
+ * The active timer is re-armed.
+ */
+FF_API void ff_timer_start(struct ff_timer *timer, int interval);
+
+/**
+ * @public
+ * arms the timer, so it fires every period milliseconds until it is stopped.
+ * The active timer is re-armed.
+ */
+FF_API void ff_timer_start_periodic(struct ff_timer *timer, int period);
+
+/**
+ * @public
+ * stops the timer. The func won't be called by the stopped timer,
+ * but the func of the FF_TIMER_FIBERPOOL timer can still be in progress.
+ * This function is O(1).
+ */
+FF_API void ff_timer_stop(struct ff_timer *timer);
+
+/**
+ * @public
+ * Returns 0 if the timer is stopped, otherwise returns non-zero.
+ */
+FF_API int ff_timer_is_active(struct ff_timer *timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
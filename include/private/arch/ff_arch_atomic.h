@@ -0,0 +1,50 @@
+#ifndef FF_ARCH_ATOMIC_PRIVATE_H
+#define FF_ARCH_ATOMIC_PRIVATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Atomically replaces the *dst by the new_value if the *dst is equal to the old_value.
+ * Returns the previous value of the *dst.
+ * This function is a full memory barrier.
+ */
+void *ff_arch_atomic_cmpxchg_ptr(void **dst, void *old_value, void *new_value);
+
+/**
+ * Atomically replaces the *dst by the value and returns the previous value of the *dst.
+ * This function is a full memory barrier.
+ */
+void *ff_arch_atomic_xchg_ptr(void **dst, void *value);
+
+/**
+ * Atomically replaces the *dst by the new_value if the *dst is equal to the old_value.
+ * Returns the previous value of the *dst.
+ * This function is a full memory barrier.
+ */
+int ff_arch_atomic_cmpxchg_int(int *dst, int old_value, int new_value);
+
+/**
+ * Atomically adds the value to the *dst and returns the previous value of the *dst.
+ * This function is a full memory barrier.
+ */
+int ff_arch_atomic_add_int(int *dst, int value);
+
+/**
+ * Returns the value of the *src.
+ * This function is an acquire memory barrier.
+ */
+int ff_arch_atomic_load_int(int *src);
+
+/**
+ * Stores the value to the *dst.
+ * This function is a release memory barrier.
+ */
+void ff_arch_atomic_store_int(int *dst, int value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
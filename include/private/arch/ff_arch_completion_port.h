@@ -7,14 +7,37 @@ extern "C" {
 
 struct ff_arch_completion_port;
 
+/**
+ * Creates the completion port. concurrency is the maximum number of threads,
+ * which can simultaneously call the ff_arch_completion_port_get().
+ */
 struct ff_arch_completion_port *ff_arch_completion_port_create(int concurrency);
 
 void ff_arch_completion_port_delete(struct ff_arch_completion_port *completion_port);
 
 void ff_arch_completion_port_get(struct ff_arch_completion_port *completion_port, const void **data);
 
+/**
+ * Obtains the data of the ready event without blocking.
+ * Returns 0 if there are no ready events.
+ */
+int ff_arch_completion_port_try_get(struct ff_arch_completion_port *completion_port, const void **data);
+
 void ff_arch_completion_port_put(struct ff_arch_completion_port *completion_port, const void *data);
 
+/**
+ * Arms the timer of the completion port, so the ff_arch_completion_port_get() will return the given data
+ * when the monotonic time in milliseconds returned by the ff_arch_misc_get_monotonic_time_ns() / 1000000
+ * reaches the expiration_time.
+ * The completion port has only one timer, so subsequent calls re-arm it.
+ */
+void ff_arch_completion_port_set_timer(struct ff_arch_completion_port *completion_port, int64_t expiration_time, const void *data);
+
+/**
+ * Disarms the timer, which was armed by the ff_arch_completion_port_set_timer().
+ */
+void ff_arch_completion_port_cancel_timer(struct ff_arch_completion_port *completion_port);
+
 #ifdef __cplusplus
 }
 #endif
@@ -38,12 +38,74 @@ void ff_arch_fiber_shutdown(struct ff_arch_fiber *fiber);
  */
 struct ff_arch_fiber *ff_arch_fiber_create(ff_arch_fiber_func arch_fiber_func, void *ctx, int stack_size);
 
+/**
+ * @public
+ * creates the platform-specific fiber, which runs on the stack shared among all such fibers
+ * of the current thread. The used part of the stack is copied to the heap when
+ * other fiber needs the shared stack, so suspended fibers occupy only the memory they actually use.
+ * Falls back to the ff_arch_fiber_create() with the default stack size
+ * on platforms without shared stacks support.
+ * Always returns correct result.
+ */
+struct ff_arch_fiber *ff_arch_fiber_create_with_shared_stack(ff_arch_fiber_func arch_fiber_func, void *ctx);
+
+/**
+ * @public
+ * Returns 1 if the fiber has been created by the ff_arch_fiber_create_with_shared_stack()
+ * and runs on the shared stack.
+ */
+int ff_arch_fiber_has_shared_stack(struct ff_arch_fiber *fiber);
+
+/**
+ * @public
+ * Prevents moving contents of the shared stack of the given fiber to the heap.
+ * This is required while other threads or the OS can access the fiber's stack.
+ * Each ff_arch_fiber_pin_stack() call must be paired with the ff_arch_fiber_unpin_stack() call.
+ */
+void ff_arch_fiber_pin_stack(struct ff_arch_fiber *fiber);
+
+/**
+ * @public
+ * Allows moving contents of the shared stack of the given fiber to the heap.
+ */
+void ff_arch_fiber_unpin_stack(struct ff_arch_fiber *fiber);
+
+/**
+ * @public
+ * Returns 0 if the ff_arch_fiber_switch() cannot switch to the given fiber at the moment,
+ * because its shared stack is occupied by the pinned fiber.
+ */
+int ff_arch_fiber_is_stack_available(struct ff_arch_fiber *fiber);
+
 /**
  * @public
  * deletes the platform-specific fiber
  */
 void ff_arch_fiber_delete(struct ff_arch_fiber *fiber);
 
+/**
+ * @public
+ * Returns unused pages of the fiber's stack to the OS.
+ * The fiber must be suspended. Pages, which are in use by the fiber, are preserved.
+ * This function may be no-op on some platforms.
+ */
+void ff_arch_fiber_trim_stack(struct ff_arch_fiber *fiber);
+
+/**
+ * @public
+ * Fills the unused part of the suspended fiber's stack with the canary pattern,
+ * so the ff_arch_fiber_get_stack_usage() can determine the peak stack usage later.
+ * Returns 0 if stack painting isn't supported for the given fiber.
+ */
+int ff_arch_fiber_paint_stack(struct ff_arch_fiber *fiber);
+
+/**
+ * @public
+ * Returns the peak number of stack bytes used by the fiber since the last
+ * successful ff_arch_fiber_paint_stack() call.
+ */
+int ff_arch_fiber_get_stack_usage(struct ff_arch_fiber *fiber);
+
 /**
  * @public
  * Switches to the given fiber
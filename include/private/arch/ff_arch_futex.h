@@ -0,0 +1,40 @@
+#ifndef FF_ARCH_FUTEX_PRIVATE_H
+#define FF_ARCH_FUTEX_PRIVATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * the futex is the integer value, which can be awaited by threads.
+ * It allows blocking the thread without races until the value is changed by another thread.
+ */
+struct ff_arch_futex;
+
+struct ff_arch_futex *ff_arch_futex_create();
+
+void ff_arch_futex_delete(struct ff_arch_futex *futex);
+
+/**
+ * Returns the current value of the futex.
+ * This function is an acquire memory barrier.
+ */
+int ff_arch_futex_get_value(struct ff_arch_futex *futex);
+
+/**
+ * Blocks the current thread while the value of the futex is equal to the value.
+ * Can return spuriously, so callers must re-check the awaited condition.
+ */
+void ff_arch_futex_wait(struct ff_arch_futex *futex, int value);
+
+/**
+ * Changes the value of the futex and wakes up to waiters_cnt threads blocked in the ff_arch_futex_wait().
+ * This function is a full memory barrier.
+ */
+void ff_arch_futex_wake(struct ff_arch_futex *futex, int waiters_cnt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,9 +22,11 @@ void ff_arch_misc_shutdown();
 
 /**
  * @public
- * Returns the current time in milliseconds
+ * Returns the time in nanoseconds since an unspecified point in the past.
+ * The returned time isn't affected by system clock adjustments, so it is suitable
+ * for measuring intervals and for deadlines.
  */
-int64_t ff_arch_misc_get_current_time();
+int64_t ff_arch_misc_get_monotonic_time_ns();
 
 /**
  * @public
@@ -32,6 +34,24 @@ int64_t ff_arch_misc_get_current_time();
  */
 void ff_arch_misc_sleep(int interval);
 
+/**
+ * @public
+ * Returns the identifier of the current thread, which can be passed
+ * to the ff_arch_misc_log_thread_stack_trace().
+ */
+int64_t ff_arch_misc_get_current_thread_id();
+
+/**
+ * @public
+ * Writes the stack trace of the thread with the given thread_id to the log.
+ * The thread is interrupted for a moment in order to obtain its stack trace.
+ * On Linux the thread is interrupted by SIGURG. The first call takes over the process-wide
+ * SIGURG handler until the ff_arch_misc_shutdown(). Meanwhile SIGURG signals, which aren't
+ * stack trace requests, are forwarded to the previously installed handler.
+ * This function cannot be called concurrently from multiple threads.
+ */
+void ff_arch_misc_log_thread_stack_trace(int64_t thread_id);
+
 /**
  * @public
  * Returns the number of CPUs in the system
@@ -13,6 +13,12 @@ struct ff_arch_thread *ff_arch_thread_create(ff_arch_thread_func func, int stack
 
 void ff_arch_thread_delete(struct ff_arch_thread *thread);
 
+/**
+ * Binds the thread to the cpu with the given cpu_index.
+ * This function must be called before the ff_arch_thread_start().
+ */
+void ff_arch_thread_set_cpu_affinity(struct ff_arch_thread *thread, int cpu_index);
+
 void ff_arch_thread_start(struct ff_arch_thread *thread, void *ctx);
 
 void ff_arch_thread_join(struct ff_arch_thread *thread);
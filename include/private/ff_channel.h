@@ -0,0 +1,15 @@
+#ifndef FF_CHANNEL_PRIVATE_H
+#define FF_CHANNEL_PRIVATE_H
+
+#include "ff/ff_channel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,4 +8,14 @@
 #include <string.h>
 #include <stdio.h>
 
+/**
+ * marks variables, which are local to the current thread.
+ * Each scheduler thread has its own copy of such variables.
+ */
+#if defined(WIN32)
+	#define FF_THREAD_LOCAL __declspec(thread)
+#else
+	#define FF_THREAD_LOCAL __thread
+#endif
+
 #endif
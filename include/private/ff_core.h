@@ -3,6 +3,8 @@
 
 #include "ff/ff_core.h"
 #include "private/ff_fiber.h"
+#include "private/ff_fiberpool.h"
+#include "private/ff_timing_wheel.h"
 #include "private/arch/ff_arch_completion_port.h"
 
 #ifdef __cplusplus
@@ -23,6 +25,16 @@ void ff_core_schedule_fiber(struct ff_fiber *fiber);
  */
 void ff_core_yield_fiber();
 
+/**
+ * @public
+ * Switches directly to the given fiber, which has been just scheduled by the current fiber
+ * via the ff_core_schedule_fiber(), bypassing the queue of pending fibers.
+ * The current fiber is put to the tail of pending fibers, so it continues after other ready fibers.
+ * This function returns immediately without switching if the given fiber isn't the most recently
+ * scheduled fiber or if it has lower priority than the current fiber or other pending fibers.
+ */
+void ff_core_switch_to_fiber(struct ff_fiber *fiber);
+
 /**
  * @public
  * the function, which is called when cancelling the timed out operation.
@@ -55,6 +67,55 @@ struct ff_core_timeout_operation_data *ff_core_register_timeout_operation(int ti
  */
 enum ff_result ff_core_deregister_timeout_operation(struct ff_core_timeout_operation_data *timeout_operation_data);
 
+/**
+ * @public
+ * the function, which is called by the scheduler when the timer entry expires.
+ * It is called from the scheduler's timeout checker fiber, so it shouldn't block.
+ */
+typedef void (*ff_core_timer_func)(void *ctx);
+
+/**
+ * @public
+ * the timer entry, which is embedded into the caller's structure, so timers
+ * are added to the scheduler's timeouts without memory allocations.
+ */
+struct ff_core_timer_entry
+{
+	struct ff_timing_wheel_entry timing_wheel_entry;
+	ff_core_timer_func expire_func;
+	void *ctx;
+};
+
+/**
+ * @public
+ * Returns the current time in milliseconds, which is used for expiration times of timer entries.
+ * This is the ff_core_now_ns() converted to milliseconds.
+ */
+int64_t ff_core_get_timer_time();
+
+/**
+ * @public
+ * Adds the timer entry, which will expire at the given expiration_time in milliseconds,
+ * to the current scheduler. The expire_func and ctx fields of the entry must be initialized.
+ * The timer entry must be removed or expired before the ff_core_shutdown().
+ * This function is O(1).
+ */
+void ff_core_add_timer_entry(struct ff_core_timer_entry *timer_entry, int64_t expiration_time);
+
+/**
+ * @public
+ * Removes the timer entry, which was added by the ff_core_add_timer_entry() and isn't expired yet.
+ * This function is O(1).
+ */
+void ff_core_remove_timer_entry(struct ff_core_timer_entry *timer_entry);
+
+/**
+ * @public
+ * Executes the task, which is owned by the caller, in the fiberpool of the current scheduler.
+ * See the ff_fiberpool_execute_task() for details.
+ */
+void ff_core_fiberpool_execute_task(struct ff_fiberpool_task *task);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,10 +21,143 @@ void ff_fiber_shutdown();
 
 /**
  * @public
- * Switches to the given fiber
+ * Initializes the stack profiler. It must be called once per process before fibers creation.
+ */
+void ff_fiber_initialize_stack_profiler();
+
+/**
+ * @public
+ * Logs the statistics collected by the stack profiler and frees the profiler's resources.
+ */
+void ff_fiber_shutdown_stack_profiler();
+
+/**
+ * @public
+ * Switches to the given fiber. The fiber's stack must be available,
+ * i.e. the ff_fiber_park_if_stack_unavailable() must return 0 for it.
  */
 void ff_fiber_switch(struct ff_fiber *fiber);
 
+/**
+ * @public
+ * Parks the given fiber and returns 1 if it cannot run at the moment, because its shared stack
+ * is occupied by the pinned fiber. The parked fiber is rescheduled when the ff_fiber_unpin_stack()
+ * releases the shared stack. Returns 0 if the fiber can be switched to.
+ */
+int ff_fiber_park_if_stack_unavailable(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Returns 1 if the given fiber runs on the shared stack, which can be occupied by other fibers
+ * while the given fiber is suspended.
+ */
+int ff_fiber_has_shared_stack(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Prevents moving the stack contents of the given fiber while other threads
+ * or the OS can access local variables of the fiber.
+ * This is no-op for fibers with their own stacks.
+ * Each ff_fiber_pin_stack() call must be paired with the ff_fiber_unpin_stack() call.
+ */
+void ff_fiber_pin_stack(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Allows moving the stack contents of the given fiber.
+ */
+void ff_fiber_unpin_stack(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * the function, which aborts the cancellable operation of the fiber.
+ * It is called by the ff_fiber_cancel() from other fiber, so it mustn't block.
+ * It must wake up the given fiber unless the fiber has been already woken up by the operation.
+ */
+typedef void (*ff_fiber_cancel_func)(struct ff_fiber *fiber, void *ctx);
+
+/**
+ * @public
+ * Marks the beginning of the blocking operation of the current fiber, which can be aborted
+ * by the ff_fiber_cancel(). The cancel_func is called with the ctx if the fiber is cancelled
+ * before the ff_fiber_end_cancellable_operation().
+ * Returns FF_FAILURE if the current fiber has been already cancelled. In this case
+ * the operation shouldn't be started.
+ */
+enum ff_result ff_fiber_begin_cancellable_operation(ff_fiber_cancel_func cancel_func, void *ctx);
+
+/**
+ * @public
+ * Marks the end of the cancellable operation, which has been started by the ff_fiber_begin_cancellable_operation().
+ */
+void ff_fiber_end_cancellable_operation();
+
+/**
+ * @public
+ * Clears the cancellation state of the given fiber, so it can execute cancellable operations again.
+ * This is used by fibers from the fiberpool, which are reused for different tasks.
+ */
+void ff_fiber_reset_cancellation(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Returns the fiber_func of the given fiber or NULL for the main fiber of the thread.
+ */
+ff_fiber_func ff_fiber_get_func(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Returns the pointer to the link, which is used by the scheduler
+ * for chaining the fiber into the run queue without memory allocations.
+ */
+struct ff_fiber **ff_fiber_get_run_queue_link(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * the FIFO queue of fibers blocked on a synchronization primitive.
+ * Fibers are chained via links embedded into the fiber, since the blocked fiber can wait
+ * only in a single queue at a time. So waiting never allocates memory and the waiting fiber
+ * can be removed from the queue in O(1) on timeout or cancellation. The links cannot be placed
+ * on the fiber's stack, because the stack of the blocked fiber can be moved.
+ */
+struct ff_fiber_wait_queue
+{
+	struct ff_fiber *head;
+	struct ff_fiber *tail;
+};
+
+/**
+ * @public
+ * Initializes the empty wait queue.
+ */
+void ff_fiber_wait_queue_initialize(struct ff_fiber_wait_queue *queue);
+
+/**
+ * @public
+ * Returns non-zero if there are no fibers in the queue.
+ */
+int ff_fiber_wait_queue_is_empty(struct ff_fiber_wait_queue *queue);
+
+/**
+ * @public
+ * Puts the given fiber to the tail of the queue. The fiber mustn't be in any wait queue.
+ */
+void ff_fiber_wait_queue_push(struct ff_fiber_wait_queue *queue, struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Removes the fiber from the head of the queue and returns it.
+ * Returns NULL if the queue is empty.
+ */
+struct ff_fiber *ff_fiber_wait_queue_pop(struct ff_fiber_wait_queue *queue);
+
+/**
+ * @public
+ * Removes the given fiber from the queue.
+ * Returns FF_FAILURE if the fiber isn't in the queue, i.e. it has been already woken up.
+ */
+enum ff_result ff_fiber_wait_queue_remove(struct ff_fiber_wait_queue *queue, struct ff_fiber *fiber);
+
 #ifdef __cplusplus
 }
 #endif
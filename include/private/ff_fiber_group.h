@@ -0,0 +1,15 @@
+#ifndef FF_FIBER_GROUP_PRIVATE_H
+#define FF_FIBER_GROUP_PRIVATE_H
+
+#include "ff/ff_fiber_group.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
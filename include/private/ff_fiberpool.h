@@ -1,6 +1,8 @@
 #ifndef FF_FIBERPOOL_PRIVATE_H
 #define FF_FIBERPOOL_PRIVATE_H
 
+#include "ff/ff_fiber.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,8 +15,36 @@ void ff_fiberpool_delete(struct ff_fiberpool *fiberpool);
 
 typedef void (*ff_fiberpool_func)(void *ctx);
 
+/**
+ * the task, which is executed by a fiber from the fiberpool.
+ * Tasks passed to the ff_fiberpool_execute_task() are owned by the caller,
+ * so the fiberpool doesn't allocate memory for them.
+ */
+struct ff_fiberpool_task
+{
+	/* the link in the fiberpool's stack of pending tasks */
+	struct ff_fiberpool_task *next;
+	ff_fiberpool_func func;
+	void *ctx;
+	enum ff_fiber_priority priority;
+	/* is set for tasks allocated by the fiberpool, which must be freed after the execution */
+	int is_allocated;
+};
+
 void ff_fiberpool_execute_async(struct ff_fiberpool *fiberpool, ff_fiberpool_func func, void *ctx);
 
+/**
+ * Executes the func in a fiber with the given priority class.
+ */
+void ff_fiberpool_execute_async_with_priority(struct ff_fiberpool *fiberpool, ff_fiberpool_func func, void *ctx, enum ff_fiber_priority priority);
+
+/**
+ * Executes the task, which is owned by the caller, in the fiberpool.
+ * The task mustn't be passed to the fiberpool again until its func is called.
+ * The fiberpool doesn't access the task after the func is called, so the func can free the task.
+ */
+void ff_fiberpool_execute_task(struct ff_fiberpool *fiberpool, struct ff_fiberpool_task *task);
+
 #ifdef __cplusplus
 }
 #endif
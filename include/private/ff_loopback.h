@@ -16,6 +16,11 @@ enum ff_result ff_loopback_read(struct ff_loopback *loopback, void *buf, int len
 
 enum ff_result ff_loopback_write(struct ff_loopback *loopback, const void *buf, int len);
 
+/**
+ * hands off the written data to the reader blocked on the loopback, so it is processed without delay.
+ */
+void ff_loopback_flush(struct ff_loopback *loopback);
+
 void ff_loopback_disconnect(struct ff_loopback *loopback);
 
 #ifdef __cplusplus
@@ -7,13 +7,30 @@ extern "C" {
 
 struct ff_threadpool;
 
+typedef void (*ff_threadpool_func)(void *ctx);
+
+/**
+ * the task for the ff_threadpool_execute_task().
+ * The task is owned by the caller, so the threadpool doesn't allocate memory per task.
+ */
+struct ff_threadpool_task
+{
+	ff_threadpool_func func;
+	void *ctx;
+	/* the link in the overflow list of the threadpool. It is used only by the threadpool */
+	struct ff_threadpool_task *next;
+};
+
 struct ff_threadpool *ff_threadpool_create(int max_threads_cnt);
 
 void ff_threadpool_delete(struct ff_threadpool *threadpool);
 
-typedef void (*ff_threadpool_func)(void *ctx);
-
-void ff_threadpool_execute_async(struct ff_threadpool *threadpool, ff_threadpool_func func, void *ctx);
+/**
+ * executes the task->func(task->ctx) in one of threadpool's threads.
+ * The task must remain valid until the task->func is called. The threadpool doesn't access
+ * the task after that, so the task->func can free it.
+ */
+void ff_threadpool_execute_task(struct ff_threadpool *threadpool, struct ff_threadpool_task *task);
 
 #ifdef __cplusplus
 }
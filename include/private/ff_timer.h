@@ -0,0 +1,15 @@
+#ifndef FF_TIMER_PRIVATE_H
+#define FF_TIMER_PRIVATE_H
+
+#include "ff/ff_timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef FF_TIMING_WHEEL_PRIVATE_H
+#define FF_TIMING_WHEEL_PRIVATE_H
+
+#include "private/ff_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The entry of the timing wheel.
+ * The entry is embedded into the caller's structure, so the timing wheel
+ * never allocates memory for its entries. Fields of the entry are private
+ * and shouldn't be accessed by the caller except the data field.
+ */
+struct ff_timing_wheel_entry
+{
+	struct ff_timing_wheel_entry *next;
+	struct ff_timing_wheel_entry **prev_ptr;
+	int64_t expiration_time;
+	const void *data;
+	int level;
+};
+
+struct ff_timing_wheel;
+
+/**
+ * the function, which is called for each expired entry from the ff_timing_wheel_advance().
+ * The entry is already removed from the timing wheel when this function is called,
+ * so it can be added to the timing wheel again or freed.
+ */
+typedef void (*ff_timing_wheel_expire_func)(struct ff_timing_wheel_entry *entry, void *ctx);
+
+/**
+ * Creates the hierarchical timing wheel. current_time is the time in ticks,
+ * from which the timing wheel starts counting.
+ */
+struct ff_timing_wheel *ff_timing_wheel_create(int64_t current_time);
+
+/**
+ * Deletes the timing wheel. The timing wheel must be empty.
+ */
+void ff_timing_wheel_delete(struct ff_timing_wheel *timing_wheel);
+
+/**
+ * Adds the entry, which will expire at the given expiration_time, to the timing wheel.
+ * The data is stored in the entry->data.
+ * This function is O(1).
+ */
+void ff_timing_wheel_add_entry(struct ff_timing_wheel *timing_wheel, struct ff_timing_wheel_entry *entry, int64_t expiration_time, const void *data);
+
+/**
+ * Removes the entry, which was added by ff_timing_wheel_add_entry() and wasn't expired yet.
+ * This function is O(1).
+ */
+void ff_timing_wheel_remove_entry(struct ff_timing_wheel *timing_wheel, struct ff_timing_wheel_entry *entry);
+
+/**
+ * Advances the timing wheel to the current_time and calls the expire_func
+ * for each entry with expiration_time <= current_time.
+ * Only the slots, which are due, are visited.
+ */
+void ff_timing_wheel_advance(struct ff_timing_wheel *timing_wheel, int64_t current_time, ff_timing_wheel_expire_func expire_func, void *ctx);
+
+/**
+ * Returns the time, when the ff_timing_wheel_advance() should be called next time.
+ * The returned time can be earlier than the expiration_time of the nearest entry,
+ * because entries from upper levels of the timing wheel are cascaded to lower levels
+ * at fixed points of time. The timing wheel must be non-empty.
+ */
+int64_t ff_timing_wheel_get_next_expiration_time(struct ff_timing_wheel *timing_wheel);
+
+int ff_timing_wheel_is_empty(struct ff_timing_wheel *timing_wheel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
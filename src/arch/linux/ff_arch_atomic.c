@@ -0,0 +1,50 @@
+#include "private/ff_common.h"
+
+#include "private/arch/ff_arch_atomic.h"
+
+void *ff_arch_atomic_cmpxchg_ptr(void **dst, void *old_value, void *new_value)
+{
+	void *prev_value;
+
+	prev_value = __sync_val_compare_and_swap(dst, old_value, new_value);
+	return prev_value;
+}
+
+void *ff_arch_atomic_xchg_ptr(void **dst, void *value)
+{
+	void *prev_value;
+
+	/* the __sync_lock_test_and_set() is only an acquire barrier, so issue the full barrier before it */
+	__sync_synchronize();
+	prev_value = __sync_lock_test_and_set(dst, value);
+	return prev_value;
+}
+
+int ff_arch_atomic_cmpxchg_int(int *dst, int old_value, int new_value)
+{
+	int prev_value;
+
+	prev_value = __sync_val_compare_and_swap(dst, old_value, new_value);
+	return prev_value;
+}
+
+int ff_arch_atomic_add_int(int *dst, int value)
+{
+	int prev_value;
+
+	prev_value = __sync_fetch_and_add(dst, value);
+	return prev_value;
+}
+
+int ff_arch_atomic_load_int(int *src)
+{
+	int value;
+
+	value = __atomic_load_n(src, __ATOMIC_ACQUIRE);
+	return value;
+}
+
+void ff_arch_atomic_store_int(int *dst, int value)
+{
+	__atomic_store_n(dst, value, __ATOMIC_RELEASE);
+}
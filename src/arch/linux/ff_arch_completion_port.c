@@ -1,66 +1,536 @@
 #include "private/ff_common.h"
 
 #include "private/arch/ff_arch_completion_port.h"
-#include "private/ff_stack.h"
+#include "private/arch/ff_arch_atomic.h"
 #include "private/arch/ff_arch_mutex.h"
+#include "private/arch/ff_arch_misc.h"
 #include "ff_linux_completion_port.h"
 #include "ff_linux_error_check.h"
+#include "ff_linux_io_uring.h"
 
+#include <poll.h>
+#include <stdlib.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 
-/* workaround of debian bug #261541 (missing EPOLLONESHOT declaration in sys/epoll.h) */
-#ifndef EPOLLONESHOT
-#	define EPOLLONESHOT (1 << 30)
+/* EPOLLRDHUP is missing in sys/epoll.h of old glibc versions */
+#ifndef EPOLLRDHUP
+#	define EPOLLRDHUP 0x2000
 #endif
 
 static const int EPOLL_CAPACITY = 10;
 
+/**
+ * the size of the submission queue of the io_uring
+ */
+static const int IO_URING_ENTRIES_CNT = 256;
+
+/**
+ * the spin time in nanoseconds, which is set when the busy poll mode is resumed
+ * after it has been switched off due to infrequent events.
+ */
+static const int64_t MIN_SPIN_TIME = 1000;
+
+struct pending_event
+{
+	struct pending_event *next;
+	const void *data;
+};
+
 struct ff_arch_completion_port
 {
 	int epoll_fd;
-	int rd_pipe;
-	int wr_pipe;
-	struct ff_stack *pending_events;
+	int event_fd;
+	int timer_fd;
+	const void *timer_data;
+	/* the lock-free LIFO list of events posted by the ff_arch_completion_port_put().
+	 * The event_fd is signalled only when this list becomes non-empty.
+	 */
+	struct pending_event *posted_events;
+	/* the FIFO list of events, which are ready to be returned by the ff_arch_completion_port_get() */
+	struct pending_event *pending_events_head;
+	struct pending_event *pending_events_tail;
+	/* protects pending events from concurrent access. It is NULL if only one thread
+	 * can call the ff_arch_completion_port_get() (i.e. concurrency is 1).
+	 */
 	struct ff_arch_mutex *pending_events_mutex;
+	/* the io_uring, which is used for I/O operations instead of the epoll_fd.
+	 * It is NULL if I/O operations are performed via the epoll_fd.
+	 */
+	struct ff_linux_io_uring *io_uring;
+	/* the maximum time in nanoseconds for polling events without blocking before
+	 * waiting for them in the kernel. It is 0 if the busy poll mode is disabled.
+	 */
+	int64_t max_spin_time;
+	/* the current time for polling events without blocking. It adapts to the recent
+	 * arrival rate of events, so idle completion ports don't burn the CPU.
+	 */
+	int64_t spin_time;
 };
 
+static void lock_pending_events(struct ff_arch_completion_port *completion_port)
+{
+	if (completion_port->pending_events_mutex != NULL)
+	{
+		ff_arch_mutex_lock(completion_port->pending_events_mutex);
+	}
+}
+
+static void unlock_pending_events(struct ff_arch_completion_port *completion_port)
+{
+	if (completion_port->pending_events_mutex != NULL)
+	{
+		ff_arch_mutex_unlock(completion_port->pending_events_mutex);
+	}
+}
+
+static void push_pending_event(struct ff_arch_completion_port *completion_port, struct pending_event *event)
+{
+	event->next = NULL;
+	if (completion_port->pending_events_tail == NULL)
+	{
+		completion_port->pending_events_head = event;
+	}
+	else
+	{
+		completion_port->pending_events_tail->next = event;
+	}
+	completion_port->pending_events_tail = event;
+}
+
+static void add_pending_event(struct ff_arch_completion_port *completion_port, const void *data)
+{
+	struct pending_event *event;
+
+	event = (struct pending_event *) ff_malloc(sizeof(*event));
+	event->data = data;
+	push_pending_event(completion_port, event);
+}
+
+/**
+ * Moves all the events posted by the ff_arch_completion_port_put() to pending events
+ * in the order they were posted.
+ */
+static void harvest_posted_events(struct ff_arch_completion_port *completion_port)
+{
+	struct pending_event *event;
+	struct pending_event *reversed_events = NULL;
+
+	event = (struct pending_event *) ff_arch_atomic_xchg_ptr((void **) &completion_port->posted_events, NULL);
+	while (event != NULL)
+	{
+		struct pending_event *next_event;
+
+		next_event = event->next;
+		event->next = reversed_events;
+		reversed_events = event;
+		event = next_event;
+	}
+	while (reversed_events != NULL)
+	{
+		event = reversed_events;
+		reversed_events = event->next;
+		push_pending_event(completion_port, event);
+	}
+}
+
+/**
+ * Returns the maximum spin time in nanoseconds for the busy poll mode,
+ * which is set in microseconds via the FF_BUSY_POLL environment variable.
+ * Returns 0 if the busy poll mode isn't requested.
+ */
+static int64_t get_requested_max_spin_time()
+{
+	const char *busy_poll;
+	int64_t max_spin_time = 0;
+
+	busy_poll = getenv("FF_BUSY_POLL");
+	if (busy_poll != NULL && ff_arch_misc_get_cpus_cnt() == 1)
+	{
+		/* spinning on a single CPU only delays threads, which produce events */
+		ff_log_debug(L"the busy poll mode is disabled, because the system has only one CPU");
+		busy_poll = NULL;
+	}
+	if (busy_poll != NULL)
+	{
+		max_spin_time = ((int64_t) atoi(busy_poll)) * 1000;
+		if (max_spin_time < 0)
+		{
+			max_spin_time = 0;
+		}
+	}
+	return max_spin_time;
+}
+
+/**
+ * Returns 1 if the io_uring backend has been requested via the FF_IO_BACKEND environment variable.
+ */
+static int is_io_uring_requested()
+{
+	const char *backend;
+	int is_requested = 0;
+
+	backend = getenv("FF_IO_BACKEND");
+	if (backend != NULL && strcmp(backend, "io_uring") == 0)
+	{
+		is_requested = 1;
+	}
+	return is_requested;
+}
+
+static void signal_event_fd(struct ff_arch_completion_port *completion_port)
+{
+	ssize_t bytes_written;
+	uint64_t signals_cnt = 1;
+
+	for (;;)
+	{
+		bytes_written = write(completion_port->event_fd, &signals_cnt, sizeof(signals_cnt));
+		if (bytes_written != -1)
+		{
+			break;
+		}
+		ff_linux_fatal_error_check(errno == EINTR, L"write(event_fd) failed");
+	}
+	ff_linux_fatal_error_check(bytes_written == sizeof(signals_cnt), L"error when writing to the event_fd");
+}
+
+/**
+ * Removes the first pending event and returns its data.
+ * Pending events must be locked and non-empty.
+ */
+static void pop_pending_event(struct ff_arch_completion_port *completion_port, const void **data)
+{
+	struct pending_event *event;
+
+	event = completion_port->pending_events_head;
+	ff_assert(event != NULL);
+	completion_port->pending_events_head = event->next;
+	if (completion_port->pending_events_head == NULL)
+	{
+		completion_port->pending_events_tail = NULL;
+	}
+	else if (completion_port->pending_events_mutex != NULL)
+	{
+		/* other threads can wait in the epoll_wait() while there are pending events,
+		 * because the event_fd has been already reset. Wake up one of them.
+		 */
+		signal_event_fd(completion_port);
+	}
+
+	*data = event->data;
+	ff_free(event);
+}
+
+/**
+ * Waits for epoll events during the given timeout in milliseconds and converts them to pending events.
+ * Returns the number of obtained epoll events.
+ */
+static int process_epoll_events(struct ff_arch_completion_port *completion_port, int timeout)
+{
+	int events_cnt;
+	int i;
+	struct epoll_event events[EPOLL_CAPACITY];
+
+	for (;;)
+	{
+		events_cnt = epoll_wait(completion_port->epoll_fd, events, EPOLL_CAPACITY, timeout);
+		if (events_cnt != -1)
+		{
+			break;
+		}
+		ff_linux_fatal_error_check(errno == EINTR, L"epoll_wait() failed");
+	}
+	ff_linux_fatal_error_check(events_cnt > 0 || timeout != -1, L"epoll_wait() unexpectedly returned 0");
+
+	lock_pending_events(completion_port);
+	for (i = 0; i < events_cnt; i++)
+	{
+		const void *tmp;
+
+		tmp = events[i].data.ptr;
+		if (tmp == completion_port)
+		{
+			/* reset the event_fd counter before harvesting posted events,
+			 * so events posted after harvesting will signal the event_fd again.
+			 */
+			ssize_t bytes_read;
+			uint64_t signals_cnt;
+
+			for (;;)
+			{
+				bytes_read = read(completion_port->event_fd, &signals_cnt, sizeof(signals_cnt));
+				if (bytes_read != -1 || errno != EINTR)
+				{
+					break;
+				}
+			}
+			if (bytes_read == -1)
+			{
+				/* the event_fd has been already reset by another thread */
+				ff_linux_fatal_error_check(errno == EAGAIN, L"read(event_fd) failed");
+			}
+			else
+			{
+				ff_linux_fatal_error_check(bytes_read == sizeof(signals_cnt), L"error when reading from the event_fd");
+			}
+			harvest_posted_events(completion_port);
+		}
+		else if (tmp == &completion_port->timer_fd)
+		{
+			/* read expirations count from the timer_fd */
+			ssize_t bytes_read;
+			uint64_t expirations_cnt;
+
+			for (;;)
+			{
+				bytes_read = read(completion_port->timer_fd, &expirations_cnt, sizeof(expirations_cnt));
+				if (bytes_read != -1 || errno != EINTR)
+				{
+					break;
+				}
+			}
+			if (bytes_read == -1)
+			{
+				/* the timer was re-armed or cancelled after it has been expired */
+				ff_linux_fatal_error_check(errno == EAGAIN, L"read(timer_fd) failed");
+				continue;
+			}
+			ff_linux_fatal_error_check(bytes_read == sizeof(expirations_cnt), L"error when reading from the timer_fd");
+			add_pending_event(completion_port, completion_port->timer_data);
+		}
+		else
+		{
+			struct ff_linux_completion_port_fd_state *fd_state;
+			uint32_t ready_events;
+
+			/* wake up only fibers waiting for the fd. Readiness of the fd without waiters
+			 * can be ignored, because waiters always try the operation before waiting.
+			 */
+			fd_state = (struct ff_linux_completion_port_fd_state *) tmp;
+			ready_events = events[i].events;
+			if ((ready_events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && fd_state->reader_data != NULL)
+			{
+				add_pending_event(completion_port, fd_state->reader_data);
+				fd_state->reader_data = NULL;
+			}
+			if ((ready_events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && fd_state->writer_data != NULL)
+			{
+				add_pending_event(completion_port, fd_state->writer_data);
+				fd_state->writer_data = NULL;
+			}
+		}
+	}
+	unlock_pending_events(completion_port);
+
+	return events_cnt;
+}
+
+/**
+ * Asks the io_uring to notify when the epoll_fd has events, which should be processed
+ * by the process_epoll_events().
+ */
+static void poll_epoll_fd(struct ff_arch_completion_port *completion_port)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = ff_linux_io_uring_get_sqe(completion_port->io_uring, (uint64_t) (uintptr_t) &completion_port->epoll_fd);
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = completion_port->epoll_fd;
+	sqe->poll_events = POLLIN;
+}
+
+/**
+ * Submits pending io_uring operations, waits for at least min_completions_cnt completions
+ * and converts completions to pending events.
+ * Returns the number of obtained completions.
+ */
+static int process_io_uring_completions(struct ff_arch_completion_port *completion_port, int min_completions_cnt)
+{
+	uint64_t user_data;
+	int result;
+	int completions_cnt = 0;
+
+	ff_linux_io_uring_submit(completion_port->io_uring, min_completions_cnt);
+	while (ff_linux_io_uring_get_completion(completion_port->io_uring, &user_data, &result))
+	{
+		struct ff_linux_completion_port_io_operation *operation;
+
+		completions_cnt++;
+		if (user_data == 0)
+		{
+			/* completion of the cancel request */
+			continue;
+		}
+		if (user_data == (uint64_t) (uintptr_t) &completion_port->epoll_fd)
+		{
+			process_epoll_events(completion_port, 0);
+			poll_epoll_fd(completion_port);
+			continue;
+		}
+		operation = (struct ff_linux_completion_port_io_operation *) (uintptr_t) user_data;
+		operation->result = result;
+		add_pending_event(completion_port, operation->data);
+	}
+	return completions_cnt;
+}
+
+/**
+ * Obtains events from the kernel and converts them to pending events.
+ * Blocks until at least one event arrives if is_blocking is 1.
+ * Returns the number of obtained events.
+ */
+static int process_events(struct ff_arch_completion_port *completion_port, int is_blocking)
+{
+	int events_cnt;
+
+	if (completion_port->io_uring != NULL)
+	{
+		events_cnt = process_io_uring_completions(completion_port, is_blocking ? 1 : 0);
+	}
+	else
+	{
+		events_cnt = process_epoll_events(completion_port, is_blocking ? -1 : 0);
+	}
+	return events_cnt;
+}
+
+/**
+ * Polls events without blocking during the spin time and then waits for them in the kernel.
+ * The spin time grows when events arrive during spinning or shortly after it,
+ * and shrinks when the completion port waits for events for a long time.
+ */
+static void wait_for_events(struct ff_arch_completion_port *completion_port)
+{
+	int64_t start_time;
+	int64_t wait_time;
+	int events_cnt;
+
+	if (completion_port->spin_time > 0)
+	{
+		start_time = ff_arch_misc_get_monotonic_time_ns();
+		do
+		{
+			events_cnt = process_events(completion_port, 0);
+			if (events_cnt > 0)
+			{
+				completion_port->spin_time *= 2;
+				if (completion_port->spin_time > completion_port->max_spin_time)
+				{
+					completion_port->spin_time = completion_port->max_spin_time;
+				}
+				return;
+			}
+		}
+		while (ff_arch_misc_get_monotonic_time_ns() - start_time < completion_port->spin_time);
+	}
+
+	start_time = ff_arch_misc_get_monotonic_time_ns();
+	process_events(completion_port, 1);
+	if (completion_port->max_spin_time > 0)
+	{
+		wait_time = ff_arch_misc_get_monotonic_time_ns() - start_time;
+		if (wait_time <= completion_port->max_spin_time)
+		{
+			/* longer spinning would catch the event without blocking */
+			completion_port->spin_time *= 2;
+			if (completion_port->spin_time < MIN_SPIN_TIME)
+			{
+				completion_port->spin_time = MIN_SPIN_TIME;
+			}
+			if (completion_port->spin_time > completion_port->max_spin_time)
+			{
+				completion_port->spin_time = completion_port->max_spin_time;
+			}
+		}
+		else
+		{
+			completion_port->spin_time /= 2;
+			if (completion_port->spin_time < MIN_SPIN_TIME)
+			{
+				completion_port->spin_time = 0;
+			}
+		}
+	}
+}
+
 struct ff_arch_completion_port *ff_arch_completion_port_create(int concurrency)
 {
 	struct ff_arch_completion_port *completion_port;
-	int pipe_fds[2];
 	int rv;
 	struct epoll_event event;
 
-	(void)concurrency;
-	rv = pipe(pipe_fds);
-	ff_linux_fatal_error_check(rv != -1, L"cannot create pipe");
+	ff_assert(concurrency > 0);
 
 	completion_port = (struct ff_arch_completion_port *) ff_malloc(sizeof(*completion_port));
 	completion_port->epoll_fd = epoll_create(EPOLL_CAPACITY);
 	ff_linux_fatal_error_check(completion_port->epoll_fd != -1, L"cannot create epoll file descriptor");
-	completion_port->rd_pipe = pipe_fds[0];
-	completion_port->wr_pipe = pipe_fds[1];
-	completion_port->pending_events = ff_stack_create();
-	completion_port->pending_events_mutex = ff_arch_mutex_create();
+	completion_port->event_fd = eventfd(0, EFD_NONBLOCK);
+	ff_linux_fatal_error_check(completion_port->event_fd != -1, L"cannot create event file descriptor");
+	completion_port->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	ff_linux_fatal_error_check(completion_port->timer_fd != -1, L"cannot create timer file descriptor");
+	completion_port->timer_data = NULL;
+	completion_port->posted_events = NULL;
+	completion_port->pending_events_head = NULL;
+	completion_port->pending_events_tail = NULL;
+	completion_port->pending_events_mutex = (concurrency > 1) ? ff_arch_mutex_create() : NULL;
+	completion_port->io_uring = NULL;
+	completion_port->max_spin_time = get_requested_max_spin_time();
+	completion_port->spin_time = completion_port->max_spin_time;
 
 	event.data.ptr = completion_port;
 	event.events = EPOLLIN;
-	rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_ADD, completion_port->rd_pipe, &event);
-	ff_linux_fatal_error_check(rv != -1, L"epoll_ctl(rd_pipe) failed");
+	rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_ADD, completion_port->event_fd, &event);
+	ff_linux_fatal_error_check(rv != -1, L"epoll_ctl(event_fd) failed");
+
+	event.data.ptr = &completion_port->timer_fd;
+	event.events = EPOLLIN;
+	rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_ADD, completion_port->timer_fd, &event);
+	ff_linux_fatal_error_check(rv != -1, L"epoll_ctl(timer_fd) failed");
+
+	/* the io_uring can be used only by a single thread */
+	if (concurrency == 1 && is_io_uring_requested())
+	{
+		completion_port->io_uring = ff_linux_io_uring_create(IO_URING_ENTRIES_CNT);
+		if (completion_port->io_uring != NULL)
+		{
+			poll_epoll_fd(completion_port);
+		}
+		else
+		{
+			ff_log_debug(L"cannot create the io_uring. Fall back to the epoll");
+		}
+	}
 
 	return completion_port;
 }
 
 void ff_arch_completion_port_delete(struct ff_arch_completion_port *completion_port)
 {
+	struct pending_event *event;
 	int rv;
 
-	ff_arch_mutex_delete(completion_port->pending_events_mutex);
-	ff_stack_delete(completion_port->pending_events);
-	rv = close(completion_port->wr_pipe);
+	/* events, which weren't obtained by the ff_arch_completion_port_get(), are dropped */
+	harvest_posted_events(completion_port);
+	while (completion_port->pending_events_head != NULL)
+	{
+		event = completion_port->pending_events_head;
+		completion_port->pending_events_head = event->next;
+		ff_free(event);
+	}
+	if (completion_port->pending_events_mutex != NULL)
+	{
+		ff_arch_mutex_delete(completion_port->pending_events_mutex);
+	}
+	if (completion_port->io_uring != NULL)
+	{
+		ff_linux_io_uring_delete(completion_port->io_uring);
+	}
+	rv = close(completion_port->timer_fd);
 	ff_assert(rv == 0);
-	rv = close(completion_port->rd_pipe);
+	rv = close(completion_port->event_fd);
 	ff_assert(rv == 0);
 	rv = close(completion_port->epoll_fd);
 	ff_assert(rv == 0);
@@ -69,91 +539,186 @@ void ff_arch_completion_port_delete(struct ff_arch_completion_port *completion_p
 
 void ff_arch_completion_port_get(struct ff_arch_completion_port *completion_port, const void **data)
 {
-	int is_empty;
-
-	ff_arch_mutex_lock(completion_port->pending_events_mutex);
-	is_empty = ff_stack_is_empty(completion_port->pending_events);
-	if (is_empty)
+	lock_pending_events(completion_port);
+	if (completion_port->pending_events_head == NULL)
+	{
+		harvest_posted_events(completion_port);
+	}
+	while (completion_port->pending_events_head == NULL)
 	{
-		int events_cnt;
-		int i;
-		struct epoll_event events[EPOLL_CAPACITY];
+		unlock_pending_events(completion_port);
+		wait_for_events(completion_port);
+		lock_pending_events(completion_port);
+	}
+	pop_pending_event(completion_port, data);
+	unlock_pending_events(completion_port);
+}
 
-		ff_arch_mutex_unlock(completion_port->pending_events_mutex);
-		for (;;)
-		{
-	    	events_cnt = epoll_wait(completion_port->epoll_fd, events, EPOLL_CAPACITY, -1);
-	    	if (events_cnt != -1)
-	    	{
-	    		break;
-	    	}
-    		ff_linux_fatal_error_check(errno == EINTR, L"epoll_wait() failed");
-    	}
-    	ff_linux_fatal_error_check(events_cnt > 0, L"epoll_wait() unexpectedly returned 0");
-
-    	ff_arch_mutex_lock(completion_port->pending_events_mutex);
-    	for (i = 0; i < events_cnt; i++)
-    	{
-    		const void *tmp;
-
-    		tmp = events[i].data.ptr;
-    		if (tmp == completion_port)
-    		{
-    			/* read data from pipe */
-				ssize_t bytes_read;
-
-				for (;;)
-				{
-					bytes_read = read(completion_port->rd_pipe, &tmp, sizeof(tmp));
-					if (bytes_read != -1)
-					{
-						break;
-					}
-					ff_linux_fatal_error_check(errno == EINTR, L"read(rd_pipe) failed");
-				}
-				ff_linux_fatal_error_check(bytes_read == sizeof(tmp), L"error when reading from the pipe");
-    		}
-    		ff_stack_push(completion_port->pending_events, tmp);
-    	}
-    }
+int ff_arch_completion_port_try_get(struct ff_arch_completion_port *completion_port, const void **data)
+{
+	int is_success = 0;
+
+	lock_pending_events(completion_port);
+	if (completion_port->pending_events_head == NULL)
+	{
+		harvest_posted_events(completion_port);
+	}
+	if (completion_port->pending_events_head == NULL)
+	{
+		unlock_pending_events(completion_port);
+		process_events(completion_port, 0);
+		lock_pending_events(completion_port);
+	}
+	if (completion_port->pending_events_head != NULL)
+	{
+		pop_pending_event(completion_port, data);
+		is_success = 1;
+	}
+	unlock_pending_events(completion_port);
 
-	ff_stack_top(completion_port->pending_events, data);
-	ff_stack_pop(completion_port->pending_events);
-	ff_arch_mutex_unlock(completion_port->pending_events_mutex);
+	return is_success;
 }
 
 void ff_arch_completion_port_put(struct ff_arch_completion_port *completion_port, const void *data)
 {
-	ssize_t bytes_written;
+	struct pending_event *event;
+	struct pending_event *prev_event;
 
+	event = (struct pending_event *) ff_malloc(sizeof(*event));
+	event->data = data;
 	for (;;)
 	{
-		bytes_written = write(completion_port->wr_pipe, &data, sizeof(data));
-		if (bytes_written != -1)
+		prev_event = completion_port->posted_events;
+		event->next = prev_event;
+		if (ff_arch_atomic_cmpxchg_ptr((void **) &completion_port->posted_events, prev_event, event) == prev_event)
 		{
 			break;
 		}
-		ff_linux_fatal_error_check(errno == EINTR, L"write(wr_pipe) failed");
 	}
-	ff_linux_fatal_error_check(bytes_written == sizeof(data), L"error when writing to wr_pipe");
+
+	if (prev_event == NULL)
+	{
+		/* the list of posted events became non-empty, so wake up the ff_arch_completion_port_get() */
+		signal_event_fd(completion_port);
+	}
 }
 
-void ff_linux_completion_port_register_operation(struct ff_arch_completion_port *completion_port, int fd, enum ff_linux_completion_port_operation_type operation_type, const void *data)
+void ff_arch_completion_port_set_timer(struct ff_arch_completion_port *completion_port, int64_t expiration_time, const void *data)
 {
+	struct itimerspec timer_value;
 	int rv;
-	struct epoll_event event;
-	__uint32_t epoll_operation;
 
-	epoll_operation = (operation_type == FF_COMPLETION_PORT_OPERATION_READ) ? EPOLLIN : EPOLLOUT;
-	event.events = EPOLLET | EPOLLONESHOT | epoll_operation;
-	event.data.ptr = (void *) data;
+	ff_assert(expiration_time > 0);
 
-	rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_MOD, fd, &event);
-	if (rv == -1)
+	completion_port->timer_data = data;
+	timer_value.it_interval.tv_sec = 0;
+	timer_value.it_interval.tv_nsec = 0;
+	timer_value.it_value.tv_sec = expiration_time / 1000;
+	timer_value.it_value.tv_nsec = (expiration_time % 1000) * 1000000;
+	rv = timerfd_settime(completion_port->timer_fd, TFD_TIMER_ABSTIME, &timer_value, NULL);
+	ff_linux_fatal_error_check(rv != -1, L"cannot arm the timer_fd");
+}
+
+void ff_arch_completion_port_cancel_timer(struct ff_arch_completion_port *completion_port)
+{
+	struct itimerspec timer_value;
+	int rv;
+
+	memset(&timer_value, 0, sizeof(timer_value));
+	rv = timerfd_settime(completion_port->timer_fd, 0, &timer_value, NULL);
+	ff_linux_fatal_error_check(rv != -1, L"cannot disarm the timer_fd");
+	completion_port->timer_data = NULL;
+}
+
+void ff_linux_completion_port_initialize_fd_state(struct ff_linux_completion_port_fd_state *fd_state, int fd)
+{
+	fd_state->completion_port = NULL;
+	fd_state->reader_data = NULL;
+	fd_state->writer_data = NULL;
+	fd_state->fd = fd;
+}
+
+void ff_linux_completion_port_register_operation(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_fd_state *fd_state, enum ff_linux_completion_port_operation_type operation_type, const void *data)
+{
+	if (fd_state->completion_port == NULL)
 	{
-		ff_linux_fatal_error_check(errno == ENOENT, L"epoll_ctl(EPOLL_CTL_MOD) failed");
-		/* the file descriptor isn't in the epoll_fd. Try to add it */
-		rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+		int rv;
+		struct epoll_event event;
+
+		/* edge-triggered notifications are delivered only when the fd becomes ready,
+		 * so there is no need in re-arming the fd before each wait.
+		 */
+		event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		event.data.ptr = fd_state;
+		rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_ADD, fd_state->fd, &event);
 		ff_linux_fatal_error_check(rv != -1, L"epoll_ctl(EPOLL_CTL_ADD) failed");
+		fd_state->completion_port = completion_port;
+	}
+	ff_assert(fd_state->completion_port == completion_port);
+
+	if (operation_type == FF_COMPLETION_PORT_OPERATION_READ)
+	{
+		ff_assert(fd_state->reader_data == NULL);
+		fd_state->reader_data = data;
+	}
+	else
+	{
+		ff_assert(fd_state->writer_data == NULL);
+		fd_state->writer_data = data;
+	}
+}
+
+int ff_linux_completion_port_deregister_operation(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_fd_state *fd_state, enum ff_linux_completion_port_operation_type operation_type, const void *data)
+{
+	const void **registered_data;
+	int is_registered = 0;
+
+	ff_assert(fd_state->completion_port == completion_port);
+
+	registered_data = (operation_type == FF_COMPLETION_PORT_OPERATION_READ) ? &fd_state->reader_data : &fd_state->writer_data;
+	/* the process_epoll_events() clears the registered data under the lock when the fd becomes ready */
+	lock_pending_events(completion_port);
+	if (*registered_data == data)
+	{
+		*registered_data = NULL;
+		is_registered = 1;
 	}
+	unlock_pending_events(completion_port);
+
+	return is_registered;
+}
+
+int ff_linux_completion_port_is_io_uring(struct ff_arch_completion_port *completion_port)
+{
+	int is_io_uring;
+
+	is_io_uring = (completion_port->io_uring != NULL) ? 1 : 0;
+	return is_io_uring;
+}
+
+struct io_uring_sqe *ff_linux_completion_port_prepare_io_operation(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_io_operation *operation, int opcode, int fd, const void *data)
+{
+	struct io_uring_sqe *sqe;
+
+	ff_assert(completion_port->io_uring != NULL);
+
+	operation->data = data;
+	operation->result = 0;
+	sqe = ff_linux_io_uring_get_sqe(completion_port->io_uring, (uint64_t) (uintptr_t) operation);
+	sqe->opcode = (uint8_t) opcode;
+	sqe->fd = fd;
+
+	return sqe;
+}
+
+void ff_linux_completion_port_cancel_io_operation(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_io_operation *operation)
+{
+	struct io_uring_sqe *sqe;
+
+	ff_assert(completion_port->io_uring != NULL);
+
+	/* completions of cancel requests have zero user_data, so they are ignored */
+	sqe = ff_linux_io_uring_get_sqe(completion_port->io_uring, 0);
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->addr = (uint64_t) (uintptr_t) operation;
 }
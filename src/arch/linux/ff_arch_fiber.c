@@ -1,21 +1,373 @@
 #include "private/ff_common.h"
 
 #include "private/arch/ff_arch_fiber.h"
+#include "ff_linux_error_check.h"
 
-#include <ucontext.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * swapcontext() saves and restores the signal mask on each call, which requires
+ * a syscall. Fibers never change the signal mask, so the context switch
+ * is implemented in assembler for the most popular architectures.
+ * Define FF_ARCH_FIBER_UCONTEXT in order to use ucontext on these architectures.
+ */
+#if !defined(FF_ARCH_FIBER_UCONTEXT) && !defined(__x86_64__) && !defined(__aarch64__)
+#	define FF_ARCH_FIBER_UCONTEXT
+#endif
+
+#ifdef FF_ARCH_FIBER_UCONTEXT
+#	include <ucontext.h>
+#endif
 
 struct ff_arch_fiber
 {
+#ifdef FF_ARCH_FIBER_UCONTEXT
 	ucontext_t context;
-	void *stack;
+#else
+	/* the stack pointer of the suspended fiber. Callee-saved registers are stored on the stack */
+	void *stack_pointer;
+
+	/* the copy of the used part of the shared stack, while the shared stack is occupied by other fiber */
+	char *saved_stack;
+	size_t saved_stack_size;
+	size_t saved_stack_capacity;
+
+	/* the number of ff_arch_fiber_pin_stack() calls without the corresponding ff_arch_fiber_unpin_stack() calls */
+	int pins_cnt;
+
+	int has_shared_stack;
+#endif
+	/* the lowest address of the stack mapping. The first page of the mapping is the guard page */
+	char *stack;
+	size_t stack_mapping_size;
 };
 
-static struct ff_arch_fiber *current_fiber = NULL;
-static struct ff_arch_fiber main_fiber;
+#ifndef FF_ARCH_FIBER_UCONTEXT
+
+/**
+ * the stack, which is shared among fibers created by the ff_arch_fiber_create_with_shared_stack().
+ * The stack is occupied by the owner fiber. Other fibers keep copies of their stacks in the heap.
+ * The switcher fiber moves stack contents between the shared stack and the heap,
+ * since this cannot be done while running on the shared stack.
+ */
+struct shared_stack
+{
+	char *stack;
+	size_t stack_mapping_size;
+	struct ff_arch_fiber *owner;
+	struct ff_arch_fiber *next_fiber;
+	struct ff_arch_fiber *switcher_fiber;
+	int fibers_cnt;
+};
+
+#endif
+
+/**
+ * the stack size of fibers, which are created instead of fibers with the shared stack
+ * when shared stacks aren't supported.
+ */
+#define DEFAULT_STACK_SIZE 0x10000
+
+/**
+ * the size of the shared stack. Memory for the stack is committed on demand.
+ */
+#define SHARED_STACK_SIZE 0x100000
+
+/**
+ * the stack size of the fiber, which moves contents of the shared stack.
+ */
+#define SWITCHER_STACK_SIZE 0x4000
+
+/**
+ * the size of the alternate signal stack, which is used by the SIGSEGV handler,
+ * since the overflowed fiber stack cannot be used for handling the signal.
+ */
+#define SIGNAL_STACK_SIZE 0x10000
+
+/**
+ * the size of the area below the stack pointer, which may be used by leaf functions
+ * without adjusting the stack pointer.
+ */
+#define STACK_RED_ZONE_SIZE 128
+
+/**
+ * the pattern, which is written into unused stack words by the ff_arch_fiber_paint_stack().
+ */
+#define STACK_CANARY ((uintptr_t) 0x5aa5c33cf00f5aa5ULL)
+
+static FF_THREAD_LOCAL struct ff_arch_fiber *current_fiber = NULL;
+static FF_THREAD_LOCAL struct ff_arch_fiber main_fiber;
+static FF_THREAD_LOCAL void *signal_stack = NULL;
+#ifndef FF_ARCH_FIBER_UCONTEXT
+static FF_THREAD_LOCAL struct shared_stack shared_stack;
+#endif
+
+static pthread_once_t segv_handler_once = PTHREAD_ONCE_INIT;
+static struct sigaction prev_segv_action;
+static size_t page_size;
+
+#ifndef FF_ARCH_FIBER_UCONTEXT
+
+/**
+ * Saves callee-saved registers on the current stack, stores the stack pointer into the *prev_stack_pointer,
+ * then switches to the next_stack_pointer and restores callee-saved registers from the new stack.
+ */
+void ff_linux_fiber_switch_context(void **prev_stack_pointer, void *next_stack_pointer);
+
+/**
+ * The entry point of new fibers. It receives the fiber function and its argument
+ * in callee-saved registers, which are restored from the initial stack of the fiber.
+ */
+void ff_linux_fiber_trampoline();
+
+#if defined(__x86_64__)
+
+/**
+ * the size of the initial stack frame, which is restored by the ff_linux_fiber_switch_context()
+ * when switching to the new fiber: mxcsr and x87 control word, r15, r14, r13, r12, rbx, rbp
+ * and the return address. The frame is padded to 16 bytes.
+ */
+#define INITIAL_STACK_FRAME_WORDS 10
+
+__asm__(
+	".text\n"
+	".globl ff_linux_fiber_switch_context\n"
+	".hidden ff_linux_fiber_switch_context\n"
+	".type ff_linux_fiber_switch_context, @function\n"
+	"ff_linux_fiber_switch_context:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size ff_linux_fiber_switch_context, .-ff_linux_fiber_switch_context\n"
+	"\n"
+	".globl ff_linux_fiber_trampoline\n"
+	".hidden ff_linux_fiber_trampoline\n"
+	".type ff_linux_fiber_trampoline, @function\n"
+	"ff_linux_fiber_trampoline:\n"
+	"	movq %r13, %rdi\n"
+	"	callq *%r12\n"
+	"	ud2\n"
+	".size ff_linux_fiber_trampoline, .-ff_linux_fiber_trampoline\n"
+);
+
+static void *initialize_stack(void *stack_top, ff_arch_fiber_func arch_fiber_func, void *ctx)
+{
+	uint64_t *frame;
+
+	/* the stack pointer must be aligned to 16 bytes after the trampoline is entered via ret */
+	frame = ((uint64_t *) stack_top) - INITIAL_STACK_FRAME_WORDS;
+	memset(frame, 0, INITIAL_STACK_FRAME_WORDS * sizeof(frame[0]));
+	/* default mxcsr and x87 control word */
+	frame[0] = (((uint64_t) 0x037f) << 32) | 0x1f80;
+	/* r13 */
+	frame[3] = (uint64_t) (uintptr_t) ctx;
+	/* r12 */
+	frame[4] = (uint64_t) (uintptr_t) arch_fiber_func;
+	/* return address */
+	frame[7] = (uint64_t) (uintptr_t) ff_linux_fiber_trampoline;
+
+	return frame;
+}
+
+#elif defined(__aarch64__)
+
+/**
+ * the size of the initial stack frame, which is restored by the ff_linux_fiber_switch_context()
+ * when switching to the new fiber: x19-x28, x29 (fp), x30 (lr) and d8-d15.
+ */
+#define INITIAL_STACK_FRAME_WORDS 20
+
+__asm__(
+	".text\n"
+	".globl ff_linux_fiber_switch_context\n"
+	".hidden ff_linux_fiber_switch_context\n"
+	".type ff_linux_fiber_switch_context, %function\n"
+	"ff_linux_fiber_switch_context:\n"
+	"	sub sp, sp, #0xa0\n"
+	"	stp x19, x20, [sp, #0x00]\n"
+	"	stp x21, x22, [sp, #0x10]\n"
+	"	stp x23, x24, [sp, #0x20]\n"
+	"	stp x25, x26, [sp, #0x30]\n"
+	"	stp x27, x28, [sp, #0x40]\n"
+	"	stp x29, x30, [sp, #0x50]\n"
+	"	stp d8, d9, [sp, #0x60]\n"
+	"	stp d10, d11, [sp, #0x70]\n"
+	"	stp d12, d13, [sp, #0x80]\n"
+	"	stp d14, d15, [sp, #0x90]\n"
+	"	mov x9, sp\n"
+	"	str x9, [x0]\n"
+	"	mov sp, x1\n"
+	"	ldp x19, x20, [sp, #0x00]\n"
+	"	ldp x21, x22, [sp, #0x10]\n"
+	"	ldp x23, x24, [sp, #0x20]\n"
+	"	ldp x25, x26, [sp, #0x30]\n"
+	"	ldp x27, x28, [sp, #0x40]\n"
+	"	ldp x29, x30, [sp, #0x50]\n"
+	"	ldp d8, d9, [sp, #0x60]\n"
+	"	ldp d10, d11, [sp, #0x70]\n"
+	"	ldp d12, d13, [sp, #0x80]\n"
+	"	ldp d14, d15, [sp, #0x90]\n"
+	"	add sp, sp, #0xa0\n"
+	"	ret\n"
+	".size ff_linux_fiber_switch_context, .-ff_linux_fiber_switch_context\n"
+	"\n"
+	".globl ff_linux_fiber_trampoline\n"
+	".hidden ff_linux_fiber_trampoline\n"
+	".type ff_linux_fiber_trampoline, %function\n"
+	"ff_linux_fiber_trampoline:\n"
+	"	mov x0, x20\n"
+	"	blr x19\n"
+	"	brk #0\n"
+	".size ff_linux_fiber_trampoline, .-ff_linux_fiber_trampoline\n"
+);
+
+static void *initialize_stack(void *stack_top, ff_arch_fiber_func arch_fiber_func, void *ctx)
+{
+	uint64_t *frame;
+
+	frame = ((uint64_t *) stack_top) - INITIAL_STACK_FRAME_WORDS;
+	memset(frame, 0, INITIAL_STACK_FRAME_WORDS * sizeof(frame[0]));
+	/* x19 */
+	frame[0] = (uint64_t) (uintptr_t) arch_fiber_func;
+	/* x20 */
+	frame[1] = (uint64_t) (uintptr_t) ctx;
+	/* x30 */
+	frame[11] = (uint64_t) (uintptr_t) ff_linux_fiber_trampoline;
+
+	return frame;
+}
+
+#endif
+
+#endif
+
+static void write_stderr(const char *msg)
+{
+	ssize_t rv;
+
+	rv = write(STDERR_FILENO, msg, strlen(msg));
+	(void) rv;
+}
+
+static void segv_handler(int sig, siginfo_t *info, void *ucontext)
+{
+	struct ff_arch_fiber *fiber;
+	char *fault_addr;
+
+	fiber = current_fiber;
+	fault_addr = (char *) info->si_addr;
+	if (fiber != NULL && fiber->stack != NULL && fault_addr >= fiber->stack && fault_addr < fiber->stack + page_size)
+	{
+		/* only async-signal-safe functions may be called here, so ff_log cannot be used */
+		write_stderr("fatal error: fiber stack overflow. Increase the stack_size passed to the ff_fiber_create()\n");
+		prev_segv_action.sa_handler = SIG_DFL;
+		prev_segv_action.sa_flags = 0;
+	}
+
+	if (prev_segv_action.sa_flags & SA_SIGINFO)
+	{
+		prev_segv_action.sa_sigaction(sig, info, ucontext);
+	}
+	else if (prev_segv_action.sa_handler != SIG_DFL && prev_segv_action.sa_handler != SIG_IGN)
+	{
+		prev_segv_action.sa_handler(sig);
+	}
+	else
+	{
+		/* restore the default action, so the faulting instruction will terminate the process
+		 * with the core dump after the return from the handler.
+		 */
+		sigaction(SIGSEGV, &prev_segv_action, NULL);
+	}
+}
+
+static void install_segv_handler()
+{
+	struct sigaction action;
+	int rv;
+
+	page_size = (size_t) sysconf(_SC_PAGESIZE);
+
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = segv_handler;
+	action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+	sigemptyset(&action.sa_mask);
+	rv = sigaction(SIGSEGV, &action, &prev_segv_action);
+	ff_linux_fatal_error_check(rv == 0, L"cannot install the SIGSEGV handler");
+}
+
+/**
+ * Sets up the alternate signal stack for the current thread if the thread doesn't have it yet.
+ */
+static void initialize_signal_stack()
+{
+	stack_t ss;
+	int rv;
+
+	rv = sigaltstack(NULL, &ss);
+	ff_linux_fatal_error_check(rv == 0, L"cannot obtain the alternate signal stack");
+	if (!(ss.ss_flags & SS_DISABLE))
+	{
+		return;
+	}
+
+	signal_stack = mmap(NULL, SIGNAL_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	ff_linux_fatal_error_check(signal_stack != MAP_FAILED, L"cannot allocate the alternate signal stack");
+	ss.ss_sp = signal_stack;
+	ss.ss_size = SIGNAL_STACK_SIZE;
+	ss.ss_flags = 0;
+	rv = sigaltstack(&ss, NULL);
+	ff_linux_fatal_error_check(rv == 0, L"cannot set the alternate signal stack");
+}
+
+static void shutdown_signal_stack()
+{
+	stack_t ss;
+	int rv;
+
+	if (signal_stack == NULL)
+	{
+		return;
+	}
+
+	memset(&ss, 0, sizeof(ss));
+	ss.ss_flags = SS_DISABLE;
+	rv = sigaltstack(&ss, NULL);
+	ff_assert(rv == 0);
+	rv = munmap(signal_stack, SIGNAL_STACK_SIZE);
+	ff_assert(rv == 0);
+	signal_stack = NULL;
+}
 
 struct ff_arch_fiber *ff_arch_fiber_initialize()
 {
 	struct ff_arch_fiber *fiber;
+	int rv;
+
+	rv = pthread_once(&segv_handler_once, install_segv_handler);
+	ff_assert(rv == 0);
+	initialize_signal_stack();
 
 	fiber = &main_fiber;
 	current_fiber = fiber;
@@ -27,42 +379,346 @@ void ff_arch_fiber_shutdown(struct ff_arch_fiber *fiber)
 {
 	ff_assert(fiber == current_fiber);
 	ff_assert(fiber == &main_fiber);
+#ifndef FF_ARCH_FIBER_UCONTEXT
+	ff_assert(shared_stack.fibers_cnt == 0);
+#endif
 
 	memset(&main_fiber, 0, sizeof(main_fiber));
 	current_fiber = NULL;
+	shutdown_signal_stack();
+}
+
+/**
+ * Maps the stack with the given usable size and the guard page below it.
+ * Returns the lowest address of the mapping.
+ */
+static char *allocate_stack(size_t usable_stack_size)
+{
+	void *stack;
+	int rv;
+
+	/* the kernel commits stack pages lazily on the first access, so unused parts
+	 * of the stack don't consume memory. Stack overflow hits the guard page
+	 * at the bottom of the stack, which is reported by the segv_handler().
+	 */
+	stack = mmap(NULL, usable_stack_size + page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+	ff_linux_fatal_error_check(stack != MAP_FAILED, L"cannot allocate the fiber stack with size=%lu", (unsigned long) usable_stack_size);
+	rv = mprotect(stack, page_size, PROT_NONE);
+	ff_linux_fatal_error_check(rv == 0, L"cannot protect the guard page of the fiber stack");
+
+	return (char *) stack;
+}
+
+static void free_stack(char *stack, size_t stack_mapping_size)
+{
+	int rv;
+
+	rv = munmap(stack, stack_mapping_size);
+	ff_assert(rv == 0);
+}
+
+#ifndef FF_ARCH_FIBER_UCONTEXT
+
+/**
+ * Copies the used part of the shared stack of the given fiber to the heap.
+ */
+static void save_shared_stack(struct ff_arch_fiber *fiber, char *stack_top)
+{
+	size_t used_stack_size;
+
+	ff_assert(fiber->pins_cnt == 0);
+
+	used_stack_size = stack_top - (char *) fiber->stack_pointer;
+	if (used_stack_size > fiber->saved_stack_capacity || used_stack_size < fiber->saved_stack_capacity / 2)
+	{
+		/* keep the buffer right-sized, so idle fibers don't hold memory for stack peaks */
+		ff_free(fiber->saved_stack);
+		fiber->saved_stack = (char *) ff_malloc(used_stack_size);
+		fiber->saved_stack_capacity = used_stack_size;
+	}
+	memcpy(fiber->saved_stack, fiber->stack_pointer, used_stack_size);
+	fiber->saved_stack_size = used_stack_size;
+}
+
+static void shared_stack_switcher_func(void *ctx)
+{
+	(void) ctx;
+
+	for (;;)
+	{
+		struct ff_arch_fiber *next_fiber;
+		char *stack_top;
+
+		next_fiber = shared_stack.next_fiber;
+		ff_assert(next_fiber != NULL);
+		ff_assert(next_fiber != shared_stack.owner);
+		stack_top = shared_stack.stack + shared_stack.stack_mapping_size;
+		if (shared_stack.owner != NULL)
+		{
+			save_shared_stack(shared_stack.owner, stack_top);
+		}
+		ff_assert((char *) next_fiber->stack_pointer == stack_top - next_fiber->saved_stack_size);
+		memcpy(next_fiber->stack_pointer, next_fiber->saved_stack, next_fiber->saved_stack_size);
+		shared_stack.owner = next_fiber;
+		shared_stack.next_fiber = NULL;
+		ff_linux_fiber_switch_context(&shared_stack.switcher_fiber->stack_pointer, next_fiber->stack_pointer);
+	}
 }
 
+#endif
+
 struct ff_arch_fiber *ff_arch_fiber_create(ff_arch_fiber_func arch_fiber_func, void *ctx, int stack_size)
 {
 	struct ff_arch_fiber *fiber;
+	size_t usable_stack_size;
 
 	ff_assert(stack_size > 0);
+	ff_assert(page_size > 0);
 
+	usable_stack_size = ((size_t) stack_size + page_size - 1) & ~(page_size - 1);
 	fiber = (struct ff_arch_fiber *) ff_malloc(sizeof(*fiber));
-	fiber->stack = ff_calloc(stack_size, sizeof(char));
+	fiber->stack = allocate_stack(usable_stack_size);
+	fiber->stack_mapping_size = usable_stack_size + page_size;
+#ifdef FF_ARCH_FIBER_UCONTEXT
 	getcontext(&fiber->context);
-	fiber->context.uc_stack.ss_sp = fiber->stack;
-	fiber->context.uc_stack.ss_size = stack_size;
+	fiber->context.uc_stack.ss_sp = fiber->stack + page_size;
+	fiber->context.uc_stack.ss_size = usable_stack_size;
 	fiber->context.uc_link = NULL;
 	makecontext(&fiber->context, (void (*)()) arch_fiber_func, 1, ctx);
+#else
+	{
+		uintptr_t stack_top;
+
+		stack_top = (uintptr_t) (fiber->stack + fiber->stack_mapping_size);
+		fiber->stack_pointer = initialize_stack((void *) stack_top, arch_fiber_func, ctx);
+		fiber->saved_stack = NULL;
+		fiber->saved_stack_size = 0;
+		fiber->saved_stack_capacity = 0;
+		fiber->pins_cnt = 0;
+		fiber->has_shared_stack = 0;
+	}
+#endif
 
 	return fiber;
 }
 
+struct ff_arch_fiber *ff_arch_fiber_create_with_shared_stack(ff_arch_fiber_func arch_fiber_func, void *ctx)
+{
+	struct ff_arch_fiber *fiber;
+
+#ifdef FF_ARCH_FIBER_UCONTEXT
+	/* the stack pointer of the suspended fiber is hidden in the platform-specific ucontext_t,
+	 * so the used part of the stack cannot be determined.
+	 */
+	fiber = ff_arch_fiber_create(arch_fiber_func, ctx, DEFAULT_STACK_SIZE);
+#else
+	size_t initial_stack_size;
+
+	ff_assert(page_size > 0);
+
+	if (shared_stack.stack == NULL)
+	{
+		ff_assert(shared_stack.fibers_cnt == 0);
+		shared_stack.stack = allocate_stack(SHARED_STACK_SIZE);
+		shared_stack.stack_mapping_size = SHARED_STACK_SIZE + page_size;
+		shared_stack.owner = NULL;
+		shared_stack.next_fiber = NULL;
+		shared_stack.switcher_fiber = ff_arch_fiber_create(shared_stack_switcher_func, NULL, SWITCHER_STACK_SIZE);
+	}
+
+	/* the initial stack frame of the fiber is prepared in the heap and is copied
+	 * to the shared stack on the first switch to the fiber.
+	 */
+	initial_stack_size = INITIAL_STACK_FRAME_WORDS * sizeof(uint64_t);
+	fiber = (struct ff_arch_fiber *) ff_malloc(sizeof(*fiber));
+	fiber->stack = shared_stack.stack;
+	fiber->stack_mapping_size = shared_stack.stack_mapping_size;
+	fiber->saved_stack = (char *) ff_malloc(initial_stack_size);
+	fiber->saved_stack_size = initial_stack_size;
+	fiber->saved_stack_capacity = initial_stack_size;
+	initialize_stack(fiber->saved_stack + initial_stack_size, arch_fiber_func, ctx);
+	fiber->stack_pointer = fiber->stack + fiber->stack_mapping_size - initial_stack_size;
+	fiber->pins_cnt = 0;
+	fiber->has_shared_stack = 1;
+	shared_stack.fibers_cnt++;
+#endif
+
+	return fiber;
+}
+
+int ff_arch_fiber_has_shared_stack(struct ff_arch_fiber *fiber)
+{
+#ifdef FF_ARCH_FIBER_UCONTEXT
+	(void) fiber;
+	return 0;
+#else
+	return fiber->has_shared_stack;
+#endif
+}
+
+void ff_arch_fiber_pin_stack(struct ff_arch_fiber *fiber)
+{
+#ifdef FF_ARCH_FIBER_UCONTEXT
+	(void) fiber;
+#else
+	fiber->pins_cnt++;
+#endif
+}
+
+void ff_arch_fiber_unpin_stack(struct ff_arch_fiber *fiber)
+{
+#ifdef FF_ARCH_FIBER_UCONTEXT
+	(void) fiber;
+#else
+	fiber->pins_cnt--;
+	ff_assert(fiber->pins_cnt >= 0);
+#endif
+}
+
+int ff_arch_fiber_is_stack_available(struct ff_arch_fiber *fiber)
+{
+#ifdef FF_ARCH_FIBER_UCONTEXT
+	(void) fiber;
+	return 1;
+#else
+	int is_available;
+
+	is_available = !fiber->has_shared_stack || shared_stack.owner == NULL ||
+		shared_stack.owner == fiber || shared_stack.owner->pins_cnt == 0;
+	return is_available;
+#endif
+}
+
 void ff_arch_fiber_delete(struct ff_arch_fiber *fiber)
 {
 	ff_assert(fiber != current_fiber);
 	ff_assert(fiber != &main_fiber);
 
-	ff_free(fiber->stack);
+#ifndef FF_ARCH_FIBER_UCONTEXT
+	ff_assert(fiber->pins_cnt == 0);
+	if (fiber->has_shared_stack)
+	{
+		ff_free(fiber->saved_stack);
+		if (shared_stack.owner == fiber)
+		{
+			shared_stack.owner = NULL;
+		}
+		shared_stack.fibers_cnt--;
+		ff_assert(shared_stack.fibers_cnt >= 0);
+		if (shared_stack.fibers_cnt == 0)
+		{
+			ff_arch_fiber_delete(shared_stack.switcher_fiber);
+			free_stack(shared_stack.stack, shared_stack.stack_mapping_size);
+			memset(&shared_stack, 0, sizeof(shared_stack));
+		}
+		ff_free(fiber);
+		return;
+	}
+#endif
+	free_stack(fiber->stack, fiber->stack_mapping_size);
 	ff_free(fiber);
 }
 
+void ff_arch_fiber_trim_stack(struct ff_arch_fiber *fiber)
+{
+#ifdef FF_ARCH_FIBER_UCONTEXT
+	/* the stack pointer of the suspended fiber is hidden in the platform-specific ucontext_t */
+	(void) fiber;
+#else
+	char *unused_stack_start;
+	char *unused_stack_end;
+	int rv;
+
+	ff_assert(fiber != current_fiber);
+	ff_assert(fiber != &main_fiber);
+
+	if (fiber->has_shared_stack)
+	{
+		/* only the used part of the stack is kept in the heap */
+		return;
+	}
+
+	unused_stack_start = fiber->stack + page_size;
+	unused_stack_end = (char *) ((uintptr_t) ((char *) fiber->stack_pointer - STACK_RED_ZONE_SIZE) & ~(page_size - 1));
+	if (unused_stack_end > unused_stack_start)
+	{
+		/* the kernel provides zero-filled pages on the next access to the discarded pages */
+		rv = madvise(unused_stack_start, unused_stack_end - unused_stack_start, MADV_DONTNEED);
+		ff_assert(rv == 0);
+	}
+#endif
+}
+
+int ff_arch_fiber_paint_stack(struct ff_arch_fiber *fiber)
+{
+#ifdef FF_ARCH_FIBER_UCONTEXT
+	/* the stack pointer of the suspended fiber is hidden in the platform-specific ucontext_t */
+	(void) fiber;
+	return 0;
+#else
+	uintptr_t *word;
+	uintptr_t *unused_stack_end;
+
+	ff_assert(fiber != current_fiber);
+	ff_assert(fiber != &main_fiber);
+
+	if (fiber->has_shared_stack)
+	{
+		/* the shared stack is used by many fibers, so the peak usage of the given fiber cannot be determined */
+		return 0;
+	}
+
+	/* the suspended fiber may be resumed in the middle of its stack after it is reused
+	 * from the fiber cache, so paint only the area below its stack pointer.
+	 */
+	word = (uintptr_t *) (fiber->stack + page_size);
+	unused_stack_end = (uintptr_t *) ((char *) fiber->stack_pointer - STACK_RED_ZONE_SIZE);
+	while (word < unused_stack_end)
+	{
+		*word = STACK_CANARY;
+		word++;
+	}
+	return 1;
+#endif
+}
+
+int ff_arch_fiber_get_stack_usage(struct ff_arch_fiber *fiber)
+{
+	uintptr_t *word;
+	char *stack_top;
+	int stack_usage;
+
+	stack_top = fiber->stack + fiber->stack_mapping_size;
+	word = (uintptr_t *) (fiber->stack + page_size);
+	while ((char *) word < stack_top && *word == STACK_CANARY)
+	{
+		word++;
+	}
+	stack_usage = (int) (stack_top - (char *) word);
+	return stack_usage;
+}
+
 void ff_arch_fiber_switch(struct ff_arch_fiber *fiber)
 {
-	ucontext_t *current_context;
+	struct ff_arch_fiber *prev_fiber;
+
+	ff_assert(fiber != current_fiber);
 
-	current_context = &current_fiber->context;
+	prev_fiber = current_fiber;
 	current_fiber = fiber;
-	swapcontext(current_context, &fiber->context);
+#ifdef FF_ARCH_FIBER_UCONTEXT
+	swapcontext(&prev_fiber->context, &fiber->context);
+#else
+	if (fiber->has_shared_stack && shared_stack.owner != fiber)
+	{
+		/* move the shared stack contents on the stack of the switcher fiber */
+		ff_assert(ff_arch_fiber_is_stack_available(fiber));
+		shared_stack.next_fiber = fiber;
+		ff_linux_fiber_switch_context(&prev_fiber->stack_pointer, shared_stack.switcher_fiber->stack_pointer);
+	}
+	else
+	{
+		ff_linux_fiber_switch_context(&prev_fiber->stack_pointer, fiber->stack_pointer);
+	}
+#endif
 }
@@ -17,6 +17,7 @@
 
 struct ff_arch_file
 {
+	struct ff_linux_completion_port_fd_state fd_state;
 	int fd;
 	enum ff_arch_file_access_mode access_mode;
 };
@@ -53,7 +54,7 @@ struct file_data
 	struct ff_arch_completion_port *completion_port;
 };
 
-static struct file_data file_ctx;
+static FF_THREAD_LOCAL struct file_data file_ctx;
 
 static void threadpool_open_file_func(void *ctx)
 {
@@ -193,10 +194,38 @@ static void wait_for_file_io(struct ff_arch_file *file)
 
 	current_fiber = ff_fiber_get_current();
 	operation_type = (file->access_mode == FF_ARCH_FILE_READ) ? FF_COMPLETION_PORT_OPERATION_READ : FF_COMPLETION_PORT_OPERATION_WRITE;
-	ff_linux_completion_port_register_operation(file_ctx.completion_port, file->fd, operation_type, current_fiber);
+	ff_linux_completion_port_register_operation(file_ctx.completion_port, &file->fd_state, operation_type, current_fiber);
 	ff_core_yield_fiber();
 }
 
+/**
+ * Reads or writes the file at the current position via the io_uring.
+ * Returns the non-negative result of the operation or -1 on error. The errno is set on error.
+ */
+static ssize_t complete_file_io(struct ff_arch_file *file, int opcode, void *buf, int len)
+{
+	struct ff_linux_completion_port_io_operation operation;
+	struct io_uring_sqe *sqe;
+	struct ff_fiber *current_fiber;
+	int result;
+
+	current_fiber = ff_fiber_get_current();
+	ff_fiber_pin_stack(current_fiber);
+	sqe = ff_linux_completion_port_prepare_io_operation(file_ctx.completion_port, &operation, opcode, file->fd, current_fiber);
+	sqe->addr = (uint64_t) (uintptr_t) buf;
+	sqe->len = len;
+	sqe->off = (uint64_t) -1;
+	ff_core_yield_fiber();
+	ff_fiber_unpin_stack(current_fiber);
+	result = operation.result;
+	if (result < 0)
+	{
+		errno = -result;
+		result = -1;
+	}
+	return result;
+}
+
 void ff_linux_file_initialize(struct ff_arch_completion_port *completion_port)
 {
 	file_ctx.completion_port = completion_port;
@@ -223,6 +252,7 @@ struct ff_arch_file *ff_arch_file_open(const wchar_t *path, enum ff_arch_file_ac
 	{
 		file = (struct ff_arch_file *) ff_malloc(sizeof(*file));
 		file->fd = data.fd;
+		ff_linux_completion_port_initialize_fd_state(&file->fd_state, data.fd);
 		file->access_mode = access_mode;
 	}
 	else
@@ -254,7 +284,14 @@ int ff_arch_file_read(struct ff_arch_file *file, void *buf, int len)
 	ff_assert(file->access_mode == FF_ARCH_FILE_READ);
 
 again:
-	bytes_read = read(file->fd, buf, len);
+	if (ff_linux_completion_port_is_io_uring(file_ctx.completion_port))
+	{
+		bytes_read = complete_file_io(file, IORING_OP_READ, buf, len);
+	}
+	else
+	{
+		bytes_read = read(file->fd, buf, len);
+	}
 	if (bytes_read == -1)
 	{
 		if (errno == EINTR)
@@ -282,7 +319,14 @@ int ff_arch_file_write(struct ff_arch_file *file, const void *buf, int len)
 	ff_assert(file->access_mode == FF_ARCH_FILE_WRITE);
 
 again:
-	bytes_written = write(file->fd, buf, len);
+	if (ff_linux_completion_port_is_io_uring(file_ctx.completion_port))
+	{
+		bytes_written = complete_file_io(file, IORING_OP_WRITE, (void *) buf, len);
+	}
+	else
+	{
+		bytes_written = write(file->fd, buf, len);
+	}
 	if (bytes_written == -1)
 	{
 		if (errno == EINTR)
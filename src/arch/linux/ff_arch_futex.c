@@ -0,0 +1,57 @@
+#include "private/ff_common.h"
+
+#include "private/arch/ff_arch_futex.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct ff_arch_futex
+{
+	int value;
+};
+
+struct ff_arch_futex *ff_arch_futex_create()
+{
+	struct ff_arch_futex *futex;
+
+	futex = (struct ff_arch_futex *) ff_malloc(sizeof(*futex));
+	futex->value = 0;
+
+	return futex;
+}
+
+void ff_arch_futex_delete(struct ff_arch_futex *futex)
+{
+	ff_free(futex);
+}
+
+int ff_arch_futex_get_value(struct ff_arch_futex *futex)
+{
+	int value;
+
+	value = __atomic_load_n(&futex->value, __ATOMIC_ACQUIRE);
+	return value;
+}
+
+void ff_arch_futex_wait(struct ff_arch_futex *futex, int value)
+{
+	long rv;
+
+	rv = syscall(SYS_futex, &futex->value, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+	/* EAGAIN means the value has been already changed, while EINTR means the spurious wakeup */
+	ff_assert(rv == 0 || errno == EAGAIN || errno == EINTR);
+}
+
+void ff_arch_futex_wake(struct ff_arch_futex *futex, int waiters_cnt)
+{
+	long rv;
+
+	ff_assert(waiters_cnt > 0);
+
+	__sync_fetch_and_add(&futex->value, 1);
+	rv = syscall(SYS_futex, &futex->value, FUTEX_WAKE_PRIVATE, waiters_cnt, NULL, NULL, 0);
+	ff_assert(rv >= 0);
+}
@@ -1,3 +1,5 @@
+#include "private/ff_common.h"
+
 #include "private/arch/ff_arch_misc.h"
 #include "private/arch/ff_arch_completion_port.h"
 #include "ff_linux_file.h"
@@ -9,6 +11,24 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+
+/**
+ * the signal, which interrupts the thread in order to obtain its stack trace.
+ * The default action for SIGURG is to ignore it, so stray signals are harmless.
+ * The application's handler for SIGURG is preserved: signals, which aren't stack trace requests,
+ * are forwarded to it, and it is restored by the ff_arch_misc_shutdown().
+ */
+#define STACK_TRACE_SIGNAL SIGURG
+
+#define MAX_STACK_TRACE_FRAMES 64
+
+/**
+ * the maximum time in milliseconds to wait for the interrupted thread to capture its stack trace.
+ */
+#define STACK_TRACE_TIMEOUT 100
 
 struct misc_data
 {
@@ -16,7 +36,18 @@ struct misc_data
 	int tmp_dir_path_len;
 };
 
-static struct misc_data misc_ctx;
+static FF_THREAD_LOCAL struct misc_data misc_ctx;
+
+/* guards installing and restoring the stack trace signal handler */
+static pthread_mutex_t stack_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int is_stack_trace_handler_installed = 0;
+/* the action for the STACK_TRACE_SIGNAL, which was set before the stack trace signal handler */
+static struct sigaction old_stack_trace_action;
+static void *stack_trace_frames[MAX_STACK_TRACE_FRAMES];
+/* the number of captured frames or -1 while the stack trace is requested */
+static int stack_trace_frames_cnt = 0;
+/* the thread, which is requested to capture its stack trace */
+static pthread_t stack_trace_thread;
 
 static void initialize_tmp_dir_path()
 {
@@ -45,6 +76,22 @@ static void shutdown_tmp_dir_path()
 	ff_free((void *) misc_ctx.tmp_dir_path);
 }
 
+static void restore_stack_trace_signal_handler()
+{
+	int rv;
+
+	rv = pthread_mutex_lock(&stack_trace_mutex);
+	ff_assert(rv == 0);
+	if (is_stack_trace_handler_installed)
+	{
+		rv = sigaction(STACK_TRACE_SIGNAL, &old_stack_trace_action, NULL);
+		ff_linux_fatal_error_check(rv == 0, L"cannot restore the previous handler for the stack trace signal");
+		is_stack_trace_handler_installed = 0;
+	}
+	rv = pthread_mutex_unlock(&stack_trace_mutex);
+	ff_assert(rv == 0);
+}
+
 void ff_arch_misc_initialize(struct ff_arch_completion_port *completion_port)
 {
 	initialize_tmp_dir_path();
@@ -54,22 +101,23 @@ void ff_arch_misc_initialize(struct ff_arch_completion_port *completion_port)
 
 void ff_arch_misc_shutdown()
 {
+	restore_stack_trace_signal_handler();
 	ff_linux_file_shutdown();
 	ff_linux_net_shutdown();
 	shutdown_tmp_dir_path();
 }
 
-int64_t ff_arch_misc_get_current_time()
+int64_t ff_arch_misc_get_monotonic_time_ns()
 {
 	struct timespec ts;
 	int rv;
-	int64_t current_time;
+	int64_t monotonic_time;
 
-	rv = clock_gettime(CLOCK_REALTIME, &ts);
+	rv = clock_gettime(CLOCK_MONOTONIC, &ts);
 	assert(rv == 0);
 	(void)rv;
-	current_time = (((int64_t) ts.tv_sec) * 1000) + (ts.tv_nsec / (1000 * 1000));
-	return current_time;
+	monotonic_time = (((int64_t) ts.tv_sec) * 1000 * 1000 * 1000) + ts.tv_nsec;
+	return monotonic_time;
 }
 
 void ff_arch_misc_sleep(int interval)
@@ -93,6 +141,105 @@ void ff_arch_misc_sleep(int interval)
 	}
 }
 
+int64_t ff_arch_misc_get_current_thread_id()
+{
+	int64_t thread_id;
+
+	thread_id = (int64_t) pthread_self();
+	return thread_id;
+}
+
+static void stack_trace_signal_handler(int sig, siginfo_t *info, void *ucontext)
+{
+	int saved_errno;
+	int frames_cnt;
+
+	if (__atomic_load_n(&stack_trace_frames_cnt, __ATOMIC_ACQUIRE) != -1 || !pthread_equal(pthread_self(), stack_trace_thread))
+	{
+		/* the signal isn't the stack trace request, so pass it to the application's handler */
+		if (old_stack_trace_action.sa_flags & SA_SIGINFO)
+		{
+			old_stack_trace_action.sa_sigaction(sig, info, ucontext);
+		}
+		else if (old_stack_trace_action.sa_handler != SIG_DFL && old_stack_trace_action.sa_handler != SIG_IGN)
+		{
+			old_stack_trace_action.sa_handler(sig);
+		}
+		return;
+	}
+
+	saved_errno = errno;
+	frames_cnt = backtrace(stack_trace_frames, MAX_STACK_TRACE_FRAMES);
+	__atomic_store_n(&stack_trace_frames_cnt, frames_cnt, __ATOMIC_RELEASE);
+	errno = saved_errno;
+}
+
+static void install_stack_trace_signal_handler()
+{
+	struct sigaction action;
+	int rv;
+
+	rv = pthread_mutex_lock(&stack_trace_mutex);
+	ff_assert(rv == 0);
+	if (!is_stack_trace_handler_installed)
+	{
+		/* the first backtrace() call loads libgcc, which isn't allowed in the signal handler */
+		backtrace(stack_trace_frames, 1);
+
+		memset(&action, 0, sizeof(action));
+		action.sa_sigaction = stack_trace_signal_handler;
+		action.sa_flags = SA_RESTART | SA_SIGINFO;
+		sigemptyset(&action.sa_mask);
+		rv = sigaction(STACK_TRACE_SIGNAL, &action, &old_stack_trace_action);
+		ff_linux_fatal_error_check(rv == 0, L"cannot install the stack trace signal handler");
+		is_stack_trace_handler_installed = 1;
+	}
+	rv = pthread_mutex_unlock(&stack_trace_mutex);
+	ff_assert(rv == 0);
+}
+
+void ff_arch_misc_log_thread_stack_trace(int64_t thread_id)
+{
+	char **symbols;
+	int frames_cnt;
+	int i;
+	int rv;
+
+	install_stack_trace_signal_handler();
+
+	stack_trace_thread = (pthread_t) thread_id;
+	__atomic_store_n(&stack_trace_frames_cnt, -1, __ATOMIC_RELEASE);
+	rv = pthread_kill((pthread_t) thread_id, STACK_TRACE_SIGNAL);
+	if (rv != 0)
+	{
+		ff_log_warning(L"cannot interrupt the thread=%lld in order to obtain its stack trace. error=%d", (long long) thread_id, rv);
+		return;
+	}
+	for (i = 0; i < STACK_TRACE_TIMEOUT; i++)
+	{
+		frames_cnt = __atomic_load_n(&stack_trace_frames_cnt, __ATOMIC_ACQUIRE);
+		if (frames_cnt != -1)
+		{
+			break;
+		}
+		ff_arch_misc_sleep(1);
+	}
+	if (frames_cnt == -1)
+	{
+		ff_log_warning(L"the thread=%lld didn't respond to the stack trace request", (long long) thread_id);
+		return;
+	}
+
+	symbols = backtrace_symbols(stack_trace_frames, frames_cnt);
+	ff_log_warning(L"the stack trace of the thread=%lld:", (long long) thread_id);
+	/* skip the frames of the signal handler */
+	for (i = 2; i < frames_cnt; i++)
+	{
+		ff_log_warning(L"  #%d %hs", i - 2, (symbols != NULL) ? symbols[i] : "?");
+	}
+	free(symbols);
+}
+
 #define MAX_CPUINFO_LINE_SIZE 0x10000
 
 int ff_arch_misc_get_cpus_cnt()
@@ -12,26 +12,27 @@
 
 struct ff_arch_tcp
 {
-	int sd_rd;
-	int sd_wr;
+	/* holds the reader and the writer fibers waiting for the sd */
+	struct ff_linux_completion_port_fd_state fd_state;
+	int sd;
 };
 
 static struct ff_arch_tcp *create_tcp(int sd)
 {
 	struct ff_arch_tcp *tcp;
 	int rv;
-	int sd_rd, sd_wr;
 
-	sd_rd = sd;
-	rv = fcntl(sd_rd, F_SETFL, O_NONBLOCK);
+	/* the io_uring polls nonblocking sockets by itself, while fibers on the shared stack
+	 * perform nonblocking syscalls on the same sockets.
+	 */
+	rv = fcntl(sd, F_SETFL, O_NONBLOCK);
 	ff_linux_fatal_error_check(rv != -1, L"cannot set nonblocking mode for the TCP socket");
 
-	sd_wr = dup(sd_rd);
-	ff_linux_fatal_error_check(sd_wr != -1, L"cannot duplicate TCP socket");
+	ff_linux_net_setup_busy_poll(sd);
 
 	tcp = (struct ff_arch_tcp *) ff_malloc(sizeof(*tcp));
-	tcp->sd_rd = sd_rd;
-	tcp->sd_wr = sd_wr;
+	ff_linux_completion_port_initialize_fd_state(&tcp->fd_state, sd);
+	tcp->sd = sd;
 
 	return tcp;
 }
@@ -52,9 +53,7 @@ void ff_arch_tcp_delete(struct ff_arch_tcp *tcp)
 {
 	int rv;
 
-	rv = close(tcp->sd_rd);
-	ff_assert(rv != -1);
-	rv = close(tcp->sd_wr);
+	rv = close(tcp->sd);
 	ff_assert(rv != -1);
 	ff_free(tcp);
 }
@@ -73,23 +72,23 @@ enum ff_result ff_arch_tcp_bind(struct ff_arch_tcp *tcp, const struct ff_arch_ne
 	{
 		int one = 1;
 
-		rv = setsockopt(tcp->sd_rd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		rv = setsockopt(tcp->sd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
 		ff_assert(rv != -1);
 	}
 
-	rv = bind(tcp->sd_rd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	rv = bind(tcp->sd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
 	if (rv != -1)
 	{
 		if (is_listening)
 		{
-			rv = listen(tcp->sd_rd, SOMAXCONN);
+			rv = listen(tcp->sd, SOMAXCONN);
 			ff_linux_fatal_error_check(rv != -1, L"error in the listen()");
 		}
 		result = FF_SUCCESS;
 	}
 	else
 	{
-		ff_log_debug(L"cannot bind the sd_rd=%d to the addr=%p. errno=%d", tcp->sd_rd, addr, errno);
+		ff_log_debug(L"cannot bind the sd=%d to the addr=%p. errno=%d", tcp->sd, addr, errno);
 	}
 
 	return result;
@@ -101,7 +100,20 @@ enum ff_result ff_arch_tcp_connect(struct ff_arch_tcp *tcp, const struct ff_arch
 	enum ff_result result = FF_SUCCESS;
 
 again:
-	rv = connect(tcp->sd_wr, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	if (ff_linux_net_is_io_uring())
+	{
+		struct ff_linux_completion_port_io_operation operation;
+		struct io_uring_sqe *sqe;
+
+		sqe = ff_linux_net_prepare_io(&operation, IORING_OP_CONNECT, tcp->sd);
+		sqe->addr = (uint64_t) (uintptr_t) &addr->addr;
+		sqe->off = sizeof(addr->addr);
+		rv = ff_linux_net_complete_io(&operation);
+	}
+	else
+	{
+		rv = connect(tcp->sd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	}
 	if (rv == -1)
 	{
 		if (errno == EINTR)
@@ -115,22 +127,26 @@ again:
 			int err;
 			socklen_t optlen = sizeof(err);
 
-			ff_linux_net_wait_for_io(tcp->sd_wr, FF_LINUX_NET_IO_WRITE);
-			rv = getsockopt(tcp->sd_wr, SOL_SOCKET, SO_ERROR, &err, &optlen);
-			ff_assert(rv != -1);
-			ff_assert(optlen == sizeof(err));
-			if (err == 0)
+			result = ff_linux_net_wait_for_io(&tcp->fd_state, FF_LINUX_NET_IO_WRITE);
+			if (result == FF_SUCCESS)
 			{
-				result = FF_SUCCESS;
+				rv = getsockopt(tcp->sd, SOL_SOCKET, SO_ERROR, &err, &optlen);
+				ff_assert(rv != -1);
+				ff_assert(optlen == sizeof(err));
+				if (err != 0)
+				{
+					ff_log_debug(L"error while connecting sd=%d to the addr=%p. err=%d", tcp->sd, addr, err);
+					result = FF_FAILURE;
+				}
 			}
 			else
 			{
-				ff_log_debug(L"error while connecting sd_wr=%d to the addr=%p. err=%d", tcp->sd_wr, addr, err);
+				ff_log_debug(L"connection of the sd=%d to the addr=%p has been cancelled", tcp->sd, addr);
 			}
 		}
 		else
 		{
-			ff_log_debug(L"cannot connect the sd_wr=%d to the addr=%p. errno=%d", tcp->sd_wr, addr, errno);
+			ff_log_debug(L"cannot connect the sd=%d to the addr=%p. errno=%d", tcp->sd, addr, errno);
 		}
 	}
 
@@ -142,9 +158,23 @@ struct ff_arch_tcp *ff_arch_tcp_accept(struct ff_arch_tcp *tcp, struct ff_arch_n
 	int accepted_sd;
 	socklen_t addrlen = sizeof(remote_addr->addr);
 	struct ff_arch_tcp *accepted_tcp = NULL;
+	enum ff_result wait_result;
 
 again:
-	accepted_sd = accept(tcp->sd_rd, (struct sockaddr *) &remote_addr->addr, &addrlen);
+	if (ff_linux_net_is_io_uring())
+	{
+		struct ff_linux_completion_port_io_operation operation;
+		struct io_uring_sqe *sqe;
+
+		sqe = ff_linux_net_prepare_io(&operation, IORING_OP_ACCEPT, tcp->sd);
+		sqe->addr = (uint64_t) (uintptr_t) &remote_addr->addr;
+		sqe->addr2 = (uint64_t) (uintptr_t) &addrlen;
+		accepted_sd = ff_linux_net_complete_io(&operation);
+	}
+	else
+	{
+		accepted_sd = accept(tcp->sd, (struct sockaddr *) &remote_addr->addr, &addrlen);
+	}
 	if (accepted_sd == -1)
 	{
 		if (errno == EINTR)
@@ -153,10 +183,13 @@ again:
 		}
 		if (errno == EAGAIN || errno == EWOULDBLOCK)
 		{
-			ff_linux_net_wait_for_io(tcp->sd_rd, FF_LINUX_NET_IO_READ);
-			goto again;
+			wait_result = ff_linux_net_wait_for_io(&tcp->fd_state, FF_LINUX_NET_IO_READ);
+			if (wait_result == FF_SUCCESS)
+			{
+				goto again;
+			}
 		}
-		ff_log_debug(L"cannot accept connection to the sd_rd=%d, remote_addr=%p. errno=%d", tcp->sd_rd, remote_addr, errno);
+		ff_log_debug(L"cannot accept connection to the sd=%d, remote_addr=%p. errno=%d", tcp->sd, remote_addr, errno);
 	}
 	else
 	{
@@ -171,9 +204,23 @@ int ff_arch_tcp_read(struct ff_arch_tcp *tcp, void *buf, int len)
 {
 	ssize_t bytes_read;
 	int bytes_read_int;
+	enum ff_result wait_result;
 
 again:
-	bytes_read = recv(tcp->sd_rd, buf, len, 0);
+	if (ff_linux_net_is_io_uring())
+	{
+		struct ff_linux_completion_port_io_operation operation;
+		struct io_uring_sqe *sqe;
+
+		sqe = ff_linux_net_prepare_io(&operation, IORING_OP_RECV, tcp->sd);
+		sqe->addr = (uint64_t) (uintptr_t) buf;
+		sqe->len = len;
+		bytes_read = ff_linux_net_complete_io(&operation);
+	}
+	else
+	{
+		bytes_read = recv(tcp->sd, buf, len, 0);
+	}
 	if (bytes_read == -1)
 	{
 		if (errno == EINTR)
@@ -182,10 +229,13 @@ again:
 		}
 		if (errno == EAGAIN)
 		{
-			ff_linux_net_wait_for_io(tcp->sd_rd, FF_LINUX_NET_IO_READ);
-			goto again;
+			wait_result = ff_linux_net_wait_for_io(&tcp->fd_state, FF_LINUX_NET_IO_READ);
+			if (wait_result == FF_SUCCESS)
+			{
+				goto again;
+			}
 		}
-		ff_log_debug(L"cannot read from the sd_rd=%d to the buf=%p, len=%d. errno=%d", tcp->sd_rd, buf, len, errno);
+		ff_log_debug(L"cannot read from the sd=%d to the buf=%p, len=%d. errno=%d", tcp->sd, buf, len, errno);
 	}
 
 	bytes_read_int = (int) bytes_read;
@@ -196,9 +246,23 @@ int ff_arch_tcp_write(struct ff_arch_tcp *tcp, const void *buf, int len)
 {
 	ssize_t bytes_written;
 	int bytes_written_int;
+	enum ff_result wait_result;
 
 again:
-	bytes_written = send(tcp->sd_wr, buf, len, 0);
+	if (ff_linux_net_is_io_uring())
+	{
+		struct ff_linux_completion_port_io_operation operation;
+		struct io_uring_sqe *sqe;
+
+		sqe = ff_linux_net_prepare_io(&operation, IORING_OP_SEND, tcp->sd);
+		sqe->addr = (uint64_t) (uintptr_t) buf;
+		sqe->len = len;
+		bytes_written = ff_linux_net_complete_io(&operation);
+	}
+	else
+	{
+		bytes_written = send(tcp->sd, buf, len, 0);
+	}
 	if (bytes_written == -1)
 	{
 		if (errno == EINTR)
@@ -207,10 +271,13 @@ again:
 		}
 		if (errno == EAGAIN || errno == EWOULDBLOCK)
 		{
-			ff_linux_net_wait_for_io(tcp->sd_wr, FF_LINUX_NET_IO_WRITE);
-			goto again;
+			wait_result = ff_linux_net_wait_for_io(&tcp->fd_state, FF_LINUX_NET_IO_WRITE);
+			if (wait_result == FF_SUCCESS)
+			{
+				goto again;
+			}
 		}
-		ff_log_debug(L"cannot write to the sd_wr=%d from the buf=%p, len=%d. errno=%d", tcp->sd_wr, buf, len, errno);
+		ff_log_debug(L"cannot write to the sd=%d from the buf=%p, len=%d. errno=%d", tcp->sd, buf, len, errno);
 	}
 
 	bytes_written_int = (int) bytes_written;
@@ -221,13 +288,13 @@ void ff_arch_tcp_disconnect(struct ff_arch_tcp *tcp)
 {
 	int rv;
 
-	rv = shutdown(tcp->sd_rd, SHUT_RD);
+	rv = shutdown(tcp->sd, SHUT_RD);
 	if (rv != -1)
 	{
-		rv = shutdown(tcp->sd_wr, SHUT_WR);
+		rv = shutdown(tcp->sd, SHUT_WR);
 		if (rv == -1)
 		{
-			/* server socket returns ENOTCONN error when shutting down the tcp->sd_wr */
+			/* server socket returns ENOTCONN error when shutting down the writing side of the tcp->sd */
 			ff_assert(errno == ENOTCONN);
 		}
 	}
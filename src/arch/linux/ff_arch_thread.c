@@ -61,6 +61,20 @@ void ff_arch_thread_delete(struct ff_arch_thread *thread)
 	ff_free(thread);
 }
 
+void ff_arch_thread_set_cpu_affinity(struct ff_arch_thread *thread, int cpu_index)
+{
+	cpu_set_t cpu_set;
+	int rv;
+
+	ff_assert(cpu_index >= 0);
+	ff_assert(cpu_index < CPU_SETSIZE);
+
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu_index, &cpu_set);
+	rv = pthread_attr_setaffinity_np(&thread->attr, sizeof(cpu_set), &cpu_set);
+	ff_linux_fatal_error_check(rv == 0, L"cannot set cpu affinity for the thread");
+}
+
 void ff_arch_thread_start(struct ff_arch_thread *thread, void *ctx)
 {
 	int rv;
@@ -13,32 +13,35 @@
 
 struct ff_arch_udp
 {
+	struct ff_linux_completion_port_fd_state fd_state;
 	struct ff_fiber *reader_fiber;
 	struct ff_fiber *writer_fiber;
+	/* io_uring operations, which are waited for by the reader_fiber and the writer_fiber */
+	struct ff_linux_completion_port_io_operation *reader_operation;
+	struct ff_linux_completion_port_io_operation *writer_operation;
 	int is_working;
-	int sd_rd;
-	int sd_wr;
+	int sd;
 };
 
 static struct ff_arch_udp *create_udp(int sd)
 {
 	struct ff_arch_udp *udp;
 	int rv;
-	int sd_rd, sd_wr;
 
-	sd_rd = sd;
-	rv = fcntl(sd_rd, F_SETFL, O_NONBLOCK);
+	/* the io_uring polls nonblocking sockets by itself, while fibers on the shared stack
+	 * perform nonblocking syscalls on the same sockets.
+	 */
+	rv = fcntl(sd, F_SETFL, O_NONBLOCK);
 	ff_linux_fatal_error_check(rv != -1, L"cannot set nonblocking mode for the UDP socket");
 
-	sd_wr = dup(sd_rd);
-	ff_linux_fatal_error_check(sd_wr != -1, L"cannot duplicate UDP socket");
-
 	udp = (struct ff_arch_udp *) ff_malloc(sizeof(*udp));
+	ff_linux_completion_port_initialize_fd_state(&udp->fd_state, sd);
 	udp->reader_fiber = NULL;
 	udp->writer_fiber = NULL;
+	udp->reader_operation = NULL;
+	udp->writer_operation = NULL;
 	udp->is_working = 1;
-	udp->sd_rd = sd_rd;
-	udp->sd_wr = sd_wr;
+	udp->sd = sd;
 
 	return udp;
 }
@@ -49,9 +52,7 @@ static void shutdown_udp(struct ff_arch_udp *udp)
 
 	ff_assert(udp->is_working);
 
-	rv = close(udp->sd_rd);
-	ff_assert(rv != -1);
-	rv = close(udp->sd_wr);
+	rv = close(udp->sd);
 	ff_assert(rv != -1);
 }
 
@@ -70,7 +71,7 @@ struct ff_arch_udp *ff_arch_udp_create(int is_broadcast)
 		int rv;
 		
 		opt_val = 1;
-		rv = setsockopt(udp->sd_wr, SOL_SOCKET, SO_BROADCAST, &opt_val, sizeof(opt_val));
+		rv = setsockopt(udp->sd, SOL_SOCKET, SO_BROADCAST, &opt_val, sizeof(opt_val));
 		ff_assert(rv != -1);
 	}
 
@@ -104,14 +105,14 @@ enum ff_result ff_arch_udp_bind(struct ff_arch_udp *udp, const struct ff_arch_ne
 		goto end;
 	}
 
-	rv = bind(udp->sd_rd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	rv = bind(udp->sd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
 	if (rv != -1)
 	{
 		result = FF_SUCCESS;
 	}
 	else
 	{
-		ff_log_debug(L"cannot bind sr_rd=%d to the addr=%p. errno=%d", udp->sd_rd, addr, errno);
+		ff_log_debug(L"cannot bind sd=%d to the addr=%p. errno=%d", udp->sd, addr, errno);
 	}
 
 end:
@@ -124,6 +125,7 @@ int ff_arch_udp_read(struct ff_arch_udp *udp, struct ff_arch_net_addr *peer_addr
 	int bytes_read_int;
 	socklen_t addrlen = sizeof(peer_addr->addr);
 	struct ff_fiber *current_fiber;
+	enum ff_result wait_result;
 
 	current_fiber = ff_fiber_get_current();
 	ff_assert(current_fiber != NULL);
@@ -134,7 +136,34 @@ again:
 		ff_log_debug(L"udp=%p was already shutdowned, so it cannot be used for reading to the buf=%p, len=%d, peer_addr=%p", udp, buf, len, peer_addr);
 		goto end;
 	}
-	bytes_read = recvfrom(udp->sd_rd, buf, len, 0, (struct sockaddr *) &peer_addr->addr, &addrlen);
+	if (ff_linux_net_is_io_uring())
+	{
+		struct ff_linux_completion_port_io_operation operation;
+		struct io_uring_sqe *sqe;
+		struct msghdr msg;
+		struct iovec iov;
+
+		iov.iov_base = buf;
+		iov.iov_len = len;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = &peer_addr->addr;
+		msg.msg_namelen = addrlen;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		sqe = ff_linux_net_prepare_io(&operation, IORING_OP_RECVMSG, udp->sd);
+		sqe->addr = (uint64_t) (uintptr_t) &msg;
+		sqe->len = 1;
+		udp->reader_fiber = current_fiber;
+		udp->reader_operation = &operation;
+		bytes_read = ff_linux_net_complete_io(&operation);
+		udp->reader_operation = NULL;
+		udp->reader_fiber = NULL;
+		addrlen = msg.msg_namelen;
+	}
+	else
+	{
+		bytes_read = recvfrom(udp->sd, buf, len, 0, (struct sockaddr *) &peer_addr->addr, &addrlen);
+	}
 	if (bytes_read == -1)
 	{
 		if (errno == EINTR)
@@ -144,11 +173,14 @@ again:
 		if (errno == EAGAIN)
 		{
 			udp->reader_fiber = current_fiber;
-			ff_linux_net_wait_for_io(udp->sd_rd, FF_LINUX_NET_IO_READ);
+			wait_result = ff_linux_net_wait_for_io(&udp->fd_state, FF_LINUX_NET_IO_READ);
 			udp->reader_fiber = NULL;
-			goto again;
+			if (wait_result == FF_SUCCESS)
+			{
+				goto again;
+			}
 		}
-		ff_log_debug(L"error while reading from the sd_rd=%d to the buf=%p, len=%d, peer_addr=%p. errno=%d", udp->sd_rd, buf, len, peer_addr, errno);
+		ff_log_debug(L"error while reading from the sd=%d to the buf=%p, len=%d, peer_addr=%p. errno=%d", udp->sd, buf, len, peer_addr, errno);
 	}
 	else
 	{
@@ -165,6 +197,7 @@ int ff_arch_udp_write(struct ff_arch_udp *udp, const struct ff_arch_net_addr *ad
 	ssize_t bytes_written = -1;
 	int bytes_written_int;
 	struct ff_fiber *current_fiber;
+	enum ff_result wait_result;
 
 	current_fiber = ff_fiber_get_current();
 	ff_assert(current_fiber != NULL);
@@ -175,7 +208,33 @@ again:
 		ff_log_debug(L"udp=%p was already shutdowned, so it cannot be used for writing from the buf=%p, len=%d to the addr=%p", udp, buf, len, addr);
 		goto end;
 	}
-	bytes_written = sendto(udp->sd_wr, buf, len, 0, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	if (ff_linux_net_is_io_uring())
+	{
+		struct ff_linux_completion_port_io_operation operation;
+		struct io_uring_sqe *sqe;
+		struct msghdr msg;
+		struct iovec iov;
+
+		iov.iov_base = (void *) buf;
+		iov.iov_len = len;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = (void *) &addr->addr;
+		msg.msg_namelen = sizeof(addr->addr);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		sqe = ff_linux_net_prepare_io(&operation, IORING_OP_SENDMSG, udp->sd);
+		sqe->addr = (uint64_t) (uintptr_t) &msg;
+		sqe->len = 1;
+		udp->writer_fiber = current_fiber;
+		udp->writer_operation = &operation;
+		bytes_written = ff_linux_net_complete_io(&operation);
+		udp->writer_operation = NULL;
+		udp->writer_fiber = NULL;
+	}
+	else
+	{
+		bytes_written = sendto(udp->sd, buf, len, 0, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	}
 	if (bytes_written == -1)
 	{
 		if (errno == EINTR)
@@ -185,11 +244,14 @@ again:
 		if (errno == EAGAIN || errno == EWOULDBLOCK)
 		{
 			udp->writer_fiber = current_fiber;
-			ff_linux_net_wait_for_io(udp->sd_wr, FF_LINUX_NET_IO_WRITE);
+			wait_result = ff_linux_net_wait_for_io(&udp->fd_state, FF_LINUX_NET_IO_WRITE);
 			udp->writer_fiber = NULL;
-			goto again;
+			if (wait_result == FF_SUCCESS)
+			{
+				goto again;
+			}
 		}
-		ff_log_debug(L"error while writing to the sd_wr=%d from the buf=%p, len=%d to the addr=%p. errno=%d", udp->sd_wr, buf, len, addr, errno);
+		ff_log_debug(L"error while writing to the sd=%d from the buf=%p, len=%d to the addr=%p. errno=%d", udp->sd, buf, len, addr, errno);
 	}
 
 end:
@@ -203,13 +265,21 @@ void ff_arch_udp_disconnect(struct ff_arch_udp *udp)
 	{
 		shutdown_udp(udp);
 		udp->is_working = 0;
-		if (udp->reader_fiber != NULL)
+		if (udp->reader_operation != NULL)
+		{
+			ff_linux_net_cancel_io(udp->reader_operation);
+		}
+		else if (udp->reader_fiber != NULL)
+		{
+			ff_linux_net_wakeup_fiber(&udp->fd_state, FF_LINUX_NET_IO_READ, udp->reader_fiber);
+		}
+		if (udp->writer_operation != NULL)
 		{
-			ff_linux_net_wakeup_fiber(udp->reader_fiber);
+			ff_linux_net_cancel_io(udp->writer_operation);
 		}
-		if (udp->writer_fiber != NULL)
+		else if (udp->writer_fiber != NULL)
 		{
-			ff_linux_net_wakeup_fiber(udp->writer_fiber);
+			ff_linux_net_wakeup_fiber(&udp->fd_state, FF_LINUX_NET_IO_WRITE, udp->writer_fiber);
 		}
 	}
 	else
@@ -3,6 +3,8 @@
 
 #include "private/arch/ff_arch_completion_port.h"
 
+#include <linux/io_uring.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,7 +15,70 @@ enum ff_linux_completion_port_operation_type
 	FF_COMPLETION_PORT_OPERATION_WRITE
 };
 
-void ff_linux_completion_port_register_operation(struct ff_arch_completion_port *completion_port, int fd, enum ff_linux_completion_port_operation_type operation_type, const void *data);
+/**
+ * the state of the file descriptor, which can be waited for in the completion port.
+ * It is embedded into the structure owning the file descriptor.
+ * The file descriptor is registered in the epoll only once, when the first operation on it
+ * is waited for, and stays registered until it is closed.
+ */
+struct ff_linux_completion_port_fd_state
+{
+	struct ff_arch_completion_port *completion_port;
+	/* the data, which will be returned by the ff_arch_completion_port_get() when the fd becomes readable */
+	const void *reader_data;
+	/* the data, which will be returned by the ff_arch_completion_port_get() when the fd becomes writable */
+	const void *writer_data;
+	int fd;
+};
+
+void ff_linux_completion_port_initialize_fd_state(struct ff_linux_completion_port_fd_state *fd_state, int fd);
+
+/**
+ * Waits until the fd becomes ready for the given operation. The ff_arch_completion_port_get()
+ * will return the data when this occurs.
+ * Only one reader and one writer can wait for the same fd simultaneously.
+ */
+void ff_linux_completion_port_register_operation(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_fd_state *fd_state, enum ff_linux_completion_port_operation_type operation_type, const void *data);
+
+/**
+ * Stops waiting for the fd readiness, which was registered by the ff_linux_completion_port_register_operation().
+ * Returns 0 if the data has been already passed to the ff_arch_completion_port_get(),
+ * i.e. the fd has become ready before the call.
+ */
+int ff_linux_completion_port_deregister_operation(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_fd_state *fd_state, enum ff_linux_completion_port_operation_type operation_type, const void *data);
+
+/**
+ * the I/O operation, which is submitted to the io_uring of the completion port.
+ */
+struct ff_linux_completion_port_io_operation
+{
+	/* the data, which will be returned by the ff_arch_completion_port_get() when the operation completes */
+	const void *data;
+	/* the result of the completed operation. Negative value is the -errno */
+	int result;
+};
+
+/**
+ * Returns 1 if I/O operations on the completion port must be submitted
+ * via the ff_linux_completion_port_prepare_io_operation() instead of waiting for fds readiness.
+ */
+int ff_linux_completion_port_is_io_uring(struct ff_arch_completion_port *completion_port);
+
+/**
+ * Returns the io_uring submission queue entry for the operation on the given fd.
+ * The caller must fill operation-specific fields of the entry.
+ * Entries are submitted to the kernel in batches, when the ff_arch_completion_port_get()
+ * has nothing to return. The operation must stay valid until the ff_arch_completion_port_get()
+ * returns the data.
+ */
+struct io_uring_sqe *ff_linux_completion_port_prepare_io_operation(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_io_operation *operation, int opcode, int fd, const void *data);
+
+/**
+ * Cancels the operation prepared by the ff_linux_completion_port_prepare_io_operation().
+ * The ff_arch_completion_port_get() will return the data of the operation with the -ECANCELED result
+ * if the operation wasn't completed yet.
+ */
+void ff_linux_completion_port_cancel_io_operation(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_io_operation *operation);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,198 @@
+#include "private/ff_common.h"
+
+#include "ff_linux_io_uring.h"
+#include "ff_linux_error_check.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct ff_linux_io_uring
+{
+	int fd;
+	/* both the submission and the completion rings, which are mapped by a single mmap() call */
+	void *rings;
+	size_t rings_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_array;
+	unsigned int sq_mask;
+	unsigned int sq_entries;
+	/* the tail of submission queue entries returned by the ff_linux_io_uring_get_sqe() */
+	unsigned int sqe_tail;
+	/* the tail of submission queue entries already passed to the kernel */
+	unsigned int submitted_tail;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+static void *map_ring(int fd, size_t size, off_t offset)
+{
+	void *ring;
+
+	ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+	ff_linux_fatal_error_check(ring != MAP_FAILED, L"cannot map the io_uring");
+	return ring;
+}
+
+static void unmap_ring(void *ring, size_t size)
+{
+	int rv;
+
+	rv = munmap(ring, size);
+	ff_assert(rv == 0);
+}
+
+struct ff_linux_io_uring *ff_linux_io_uring_create(int entries_cnt)
+{
+	struct ff_linux_io_uring *io_uring;
+	struct io_uring_params params;
+	char *rings;
+	size_t cq_ring_size;
+	int fd;
+	int rv;
+
+	memset(&params, 0, sizeof(params));
+	fd = (int) syscall(__NR_io_uring_setup, entries_cnt, &params);
+	if (fd == -1)
+	{
+		ff_log_debug(L"cannot create the io_uring with entries_cnt=%d. errno=%d", entries_cnt, errno);
+		return NULL;
+	}
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_FAST_POLL))
+	{
+		/* old kernels map rings separately and complete socket operations in worker threads
+		 * instead of polling sockets.
+		 */
+		ff_log_debug(L"the io_uring doesn't support required features=%u", params.features);
+		rv = close(fd);
+		ff_assert(rv == 0);
+		return NULL;
+	}
+
+	io_uring = (struct ff_linux_io_uring *) ff_malloc(sizeof(*io_uring));
+	io_uring->fd = fd;
+	io_uring->rings_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (cq_ring_size > io_uring->rings_size)
+	{
+		io_uring->rings_size = cq_ring_size;
+	}
+	io_uring->rings = map_ring(fd, io_uring->rings_size, IORING_OFF_SQ_RING);
+	io_uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	io_uring->sqes = (struct io_uring_sqe *) map_ring(fd, io_uring->sqes_size, IORING_OFF_SQES);
+
+	rings = (char *) io_uring->rings;
+	io_uring->sq_head = (unsigned int *) (rings + params.sq_off.head);
+	io_uring->sq_tail = (unsigned int *) (rings + params.sq_off.tail);
+	io_uring->sq_array = (unsigned int *) (rings + params.sq_off.array);
+	io_uring->sq_mask = *(unsigned int *) (rings + params.sq_off.ring_mask);
+	io_uring->sq_entries = params.sq_entries;
+	io_uring->sqe_tail = *io_uring->sq_tail;
+	io_uring->submitted_tail = io_uring->sqe_tail;
+
+	io_uring->cq_head = (unsigned int *) (rings + params.cq_off.head);
+	io_uring->cq_tail = (unsigned int *) (rings + params.cq_off.tail);
+	io_uring->cq_mask = *(unsigned int *) (rings + params.cq_off.ring_mask);
+	io_uring->cqes = (struct io_uring_cqe *) (rings + params.cq_off.cqes);
+
+	return io_uring;
+}
+
+void ff_linux_io_uring_delete(struct ff_linux_io_uring *io_uring)
+{
+	int rv;
+
+	unmap_ring(io_uring->sqes, io_uring->sqes_size);
+	unmap_ring(io_uring->rings, io_uring->rings_size);
+	rv = close(io_uring->fd);
+	ff_assert(rv == 0);
+	ff_free(io_uring);
+}
+
+struct io_uring_sqe *ff_linux_io_uring_get_sqe(struct ff_linux_io_uring *io_uring, uint64_t user_data)
+{
+	struct io_uring_sqe *sqe;
+	unsigned int index;
+
+	if (io_uring->sqe_tail - __atomic_load_n(io_uring->sq_head, __ATOMIC_ACQUIRE) >= io_uring->sq_entries)
+	{
+		ff_linux_io_uring_submit(io_uring, 0);
+		ff_assert(io_uring->sqe_tail - __atomic_load_n(io_uring->sq_head, __ATOMIC_ACQUIRE) < io_uring->sq_entries);
+	}
+
+	index = io_uring->sqe_tail & io_uring->sq_mask;
+	io_uring->sq_array[index] = index;
+	sqe = &io_uring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = user_data;
+	io_uring->sqe_tail++;
+
+	return sqe;
+}
+
+void ff_linux_io_uring_submit(struct ff_linux_io_uring *io_uring, int min_completions_cnt)
+{
+	unsigned int to_submit;
+	unsigned int flags;
+
+	to_submit = io_uring->sqe_tail - io_uring->submitted_tail;
+	if (to_submit == 0 && min_completions_cnt == 0)
+	{
+		return;
+	}
+
+	/* make submission queue entries visible to the kernel before publishing the new tail */
+	__atomic_store_n(io_uring->sq_tail, io_uring->sqe_tail, __ATOMIC_RELEASE);
+	flags = (min_completions_cnt > 0) ? IORING_ENTER_GETEVENTS : 0;
+	for (;;)
+	{
+		int submitted_cnt;
+
+		submitted_cnt = (int) syscall(__NR_io_uring_enter, io_uring->fd, to_submit, min_completions_cnt, flags, NULL, 0);
+		if (submitted_cnt != -1)
+		{
+			ff_assert((unsigned int) submitted_cnt <= to_submit);
+			io_uring->submitted_tail += submitted_cnt;
+			to_submit -= submitted_cnt;
+			if (to_submit == 0)
+			{
+				break;
+			}
+			/* the kernel couldn't consume all the entries, so try submitting the rest without waiting */
+			flags = 0;
+			min_completions_cnt = 0;
+			continue;
+		}
+		ff_linux_fatal_error_check(errno == EINTR || errno == EAGAIN || errno == EBUSY, L"io_uring_enter() failed");
+		if (errno != EINTR || to_submit == 0)
+		{
+			/* the kernel is short of resources or the completion queue must be drained first.
+			 * Remaining entries will be submitted by the next ff_linux_io_uring_submit() call.
+			 */
+			break;
+		}
+	}
+}
+
+int ff_linux_io_uring_get_completion(struct ff_linux_io_uring *io_uring, uint64_t *user_data, int *result)
+{
+	struct io_uring_cqe *cqe;
+	unsigned int head;
+
+	head = *io_uring->cq_head;
+	if (head == __atomic_load_n(io_uring->cq_tail, __ATOMIC_ACQUIRE))
+	{
+		return 0;
+	}
+	cqe = &io_uring->cqes[head & io_uring->cq_mask];
+	*user_data = cqe->user_data;
+	*result = cqe->res;
+	__atomic_store_n(io_uring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+	return 1;
+}
@@ -0,0 +1,45 @@
+#ifndef FF_LINUX_IO_URING_H
+#define FF_LINUX_IO_URING_H
+
+#include "private/ff_common.h"
+
+#include <linux/io_uring.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ff_linux_io_uring;
+
+/**
+ * Creates the io_uring with the given number of submission queue entries.
+ * Returns NULL if the io_uring isn't supported by the kernel.
+ */
+struct ff_linux_io_uring *ff_linux_io_uring_create(int entries_cnt);
+
+void ff_linux_io_uring_delete(struct ff_linux_io_uring *io_uring);
+
+/**
+ * Returns the zeroed submission queue entry with the given user_data.
+ * The entry is passed to the kernel by the next ff_linux_io_uring_submit().
+ * If the submission queue is full, then pending entries are submitted immediately.
+ */
+struct io_uring_sqe *ff_linux_io_uring_get_sqe(struct ff_linux_io_uring *io_uring, uint64_t user_data);
+
+/**
+ * Submits all the pending submission queue entries to the kernel and waits
+ * until at least min_completions_cnt completions become available.
+ */
+void ff_linux_io_uring_submit(struct ff_linux_io_uring *io_uring, int min_completions_cnt);
+
+/**
+ * Removes the next completion from the completion queue.
+ * Returns 0 if the completion queue is empty.
+ */
+int ff_linux_io_uring_get_completion(struct ff_linux_io_uring *io_uring, uint64_t *user_data, int *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
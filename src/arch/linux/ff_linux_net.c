@@ -6,19 +6,37 @@
 #include "private/arch/ff_arch_completion_port.h"
 #include "ff_linux_completion_port.h"
 
+#include <errno.h>
 #include <signal.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+/* SO_BUSY_POLL is missing in sys/socket.h of old glibc versions */
+#ifndef SO_BUSY_POLL
+#	define SO_BUSY_POLL 46
+#endif
 
 struct net_data
 {
 	struct ff_arch_completion_port *completion_port;
 	sighandler_t old_sigpipe_handler;
+	/* the SO_BUSY_POLL value in microseconds for new sockets. 0 disables the busy polling */
+	int busy_poll;
 };
 
-static struct net_data net_ctx;
+static FF_THREAD_LOCAL struct net_data net_ctx;
 
 void ff_linux_net_initialize(struct ff_arch_completion_port *completion_port)
 {
+	const char *busy_poll;
+
 	net_ctx.completion_port = completion_port;
+	net_ctx.busy_poll = 0;
+	busy_poll = getenv("FF_SO_BUSY_POLL");
+	if (busy_poll != NULL)
+	{
+		net_ctx.busy_poll = atoi(busy_poll);
+	}
 
 	/* ignore SIGPIPE signals, which can occur when writing to the ff_tcp,
  	 * when remote side shutdowned reading from the tcp.
@@ -34,18 +52,141 @@ void ff_linux_net_shutdown()
 	ff_assert(sigpipe_handler == SIG_IGN);
 }
 
-void ff_linux_net_wait_for_io(int sd, enum ff_linux_net_io_type io_type)
+void ff_linux_net_wakeup_fiber(struct ff_linux_completion_port_fd_state *fd_state, enum ff_linux_net_io_type io_type, struct ff_fiber *fiber)
+{
+	enum ff_linux_completion_port_operation_type operation_type;
+	int is_registered;
+
+	operation_type = (io_type == FF_LINUX_NET_IO_READ) ? FF_COMPLETION_PORT_OPERATION_READ : FF_COMPLETION_PORT_OPERATION_WRITE;
+	is_registered = ff_linux_completion_port_deregister_operation(net_ctx.completion_port, fd_state, operation_type, fiber);
+	if (is_registered)
+	{
+		ff_arch_completion_port_put(net_ctx.completion_port, fiber);
+	}
+	/* otherwise the fiber has been already woken up by the fd readiness */
+}
+
+static void cancel_wait_for_read(struct ff_fiber *fiber, void *ctx)
+{
+	ff_linux_net_wakeup_fiber((struct ff_linux_completion_port_fd_state *) ctx, FF_LINUX_NET_IO_READ, fiber);
+}
+
+static void cancel_wait_for_write(struct ff_fiber *fiber, void *ctx)
+{
+	ff_linux_net_wakeup_fiber((struct ff_linux_completion_port_fd_state *) ctx, FF_LINUX_NET_IO_WRITE, fiber);
+}
+
+static void cancel_complete_io(struct ff_fiber *fiber, void *ctx)
+{
+	struct ff_linux_completion_port_io_operation *operation;
+
+	(void)fiber;
+	/* the fiber is woken up by the completion of the operation with the -ECANCELED result */
+	operation = (struct ff_linux_completion_port_io_operation *) ctx;
+	ff_linux_completion_port_cancel_io_operation(net_ctx.completion_port, operation);
+}
+
+enum ff_result ff_linux_net_wait_for_io(struct ff_linux_completion_port_fd_state *fd_state, enum ff_linux_net_io_type io_type)
 {
 	struct ff_fiber *current_fiber;
 	enum ff_linux_completion_port_operation_type operation_type;
+	ff_fiber_cancel_func cancel_func;
+	enum ff_result result;
 
 	current_fiber = ff_fiber_get_current();
-	operation_type = (io_type == FF_LINUX_NET_IO_READ) ? FF_COMPLETION_PORT_OPERATION_READ : FF_COMPLETION_PORT_OPERATION_WRITE;
-	ff_linux_completion_port_register_operation(net_ctx.completion_port, sd, operation_type, current_fiber);
+	if (io_type == FF_LINUX_NET_IO_READ)
+	{
+		operation_type = FF_COMPLETION_PORT_OPERATION_READ;
+		cancel_func = cancel_wait_for_read;
+	}
+	else
+	{
+		operation_type = FF_COMPLETION_PORT_OPERATION_WRITE;
+		cancel_func = cancel_wait_for_write;
+	}
+	result = ff_fiber_begin_cancellable_operation(cancel_func, fd_state);
+	if (result == FF_SUCCESS)
+	{
+		ff_linux_completion_port_register_operation(net_ctx.completion_port, fd_state, operation_type, current_fiber);
+		ff_core_yield_fiber();
+		ff_fiber_end_cancellable_operation();
+	}
+	if (ff_fiber_is_cancelled(current_fiber))
+	{
+		/* the fd may be ready, but the cancelled fiber shouldn't perform the operation */
+		errno = ECANCELED;
+		result = FF_FAILURE;
+	}
+	return result;
+}
+
+void ff_linux_net_setup_busy_poll(int sd)
+{
+	if (net_ctx.busy_poll > 0)
+	{
+		int rv;
+
+		rv = setsockopt(sd, SOL_SOCKET, SO_BUSY_POLL, &net_ctx.busy_poll, sizeof(net_ctx.busy_poll));
+		if (rv == -1)
+		{
+			/* the kernel requires CAP_NET_ADMIN for values above the net.core.busy_read sysctl */
+			ff_log_debug(L"cannot set SO_BUSY_POLL=%d for the sd=%d. errno=%d", net_ctx.busy_poll, sd, errno);
+		}
+	}
+}
+
+int ff_linux_net_is_io_uring()
+{
+	int is_io_uring;
+
+	/* the kernel accesses buffers of the pending io_uring operation, so the fiber's stack must be pinned
+	 * until the operation completes. The pinned shared stack would block all the other fibers on it
+	 * while the operation waits for the remote side, so such fibers use nonblocking syscalls instead.
+	 */
+	is_io_uring = ff_linux_completion_port_is_io_uring(net_ctx.completion_port) &&
+		!ff_fiber_has_shared_stack(ff_fiber_get_current());
+	return is_io_uring;
+}
+
+struct io_uring_sqe *ff_linux_net_prepare_io(struct ff_linux_completion_port_io_operation *operation, int opcode, int sd)
+{
+	struct io_uring_sqe *sqe;
+	struct ff_fiber *current_fiber;
+
+	current_fiber = ff_fiber_get_current();
+	/* the kernel accesses the operation and buffers on the fiber's stack until the operation completes,
+	 * so the stack mustn't be shared with other fibers. See the ff_linux_net_is_io_uring().
+	 */
+	ff_assert(!ff_fiber_has_shared_stack(current_fiber));
+	sqe = ff_linux_completion_port_prepare_io_operation(net_ctx.completion_port, operation, opcode, sd, current_fiber);
+	return sqe;
+}
+
+int ff_linux_net_complete_io(struct ff_linux_completion_port_io_operation *operation)
+{
+	enum ff_result begin_result;
+	int result;
+
+	ff_assert(operation->data == ff_fiber_get_current());
+
+	begin_result = ff_fiber_begin_cancellable_operation(cancel_complete_io, operation);
+	if (begin_result != FF_SUCCESS)
+	{
+		/* the operation has been already prepared, so it must be waited for after the cancellation */
+		ff_linux_completion_port_cancel_io_operation(net_ctx.completion_port, operation);
+	}
 	ff_core_yield_fiber();
+	ff_fiber_end_cancellable_operation();
+	result = operation->result;
+	if (result < 0)
+	{
+		errno = -result;
+		result = -1;
+	}
+	return result;
 }
 
-void ff_linux_net_wakeup_fiber(struct ff_fiber *fiber)
+void ff_linux_net_cancel_io(struct ff_linux_completion_port_io_operation *operation)
 {
-	ff_arch_completion_port_put(net_ctx.completion_port, fiber);
+	ff_linux_completion_port_cancel_io_operation(net_ctx.completion_port, operation);
 }
@@ -3,6 +3,7 @@
 
 #include "private/arch/ff_arch_completion_port.h"
 #include "private/ff_fiber.h"
+#include "ff_linux_completion_port.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,9 +19,50 @@ void ff_linux_net_initialize(struct ff_arch_completion_port *completion_port);
 
 void ff_linux_net_shutdown();
 
-void ff_linux_net_wait_for_io(int sd, enum ff_linux_net_io_type io_type);
+/**
+ * Suspends the current fiber until the socket becomes ready for the given io_type.
+ * Returns FF_FAILURE and sets the errno to ECANCELED if the fiber has been cancelled
+ * via the ff_fiber_cancel().
+ */
+enum ff_result ff_linux_net_wait_for_io(struct ff_linux_completion_port_fd_state *fd_state, enum ff_linux_net_io_type io_type);
 
-void ff_linux_net_wakeup_fiber(struct ff_fiber *fiber);
+/**
+ * Wakes up the fiber, which waits for the fd_state in the ff_linux_net_wait_for_io(),
+ * unless it has been already woken up by the fd readiness.
+ */
+void ff_linux_net_wakeup_fiber(struct ff_linux_completion_port_fd_state *fd_state, enum ff_linux_net_io_type io_type, struct ff_fiber *fiber);
+
+/**
+ * Enables the SO_BUSY_POLL option on the given socket if it has been requested
+ * via the FF_SO_BUSY_POLL environment variable. The value of the variable is the busy poll
+ * time in microseconds, during which the kernel polls the device queue for new packets.
+ */
+void ff_linux_net_setup_busy_poll(int sd);
+
+/**
+ * Returns 1 if socket operations of the current fiber must be performed via the ff_linux_net_prepare_io()
+ * and the ff_linux_net_complete_io() instead of non-blocking syscalls.
+ * Fibers on the shared stack always use non-blocking syscalls.
+ */
+int ff_linux_net_is_io_uring();
+
+/**
+ * Returns the io_uring submission queue entry for the operation on the given sd.
+ * The caller must fill operation-specific fields of the entry and then call the ff_linux_net_complete_io().
+ */
+struct io_uring_sqe *ff_linux_net_prepare_io(struct ff_linux_completion_port_io_operation *operation, int opcode, int sd);
+
+/**
+ * Suspends the current fiber until the operation prepared by the ff_linux_net_prepare_io() completes.
+ * Returns the non-negative result of the operation or -1 on error. The errno is set on error.
+ * The operation is cancelled with the ECANCELED error if the fiber is cancelled via the ff_fiber_cancel().
+ */
+int ff_linux_net_complete_io(struct ff_linux_completion_port_io_operation *operation);
+
+/**
+ * Cancels the operation, which is waited for in the ff_linux_net_complete_io() by another fiber.
+ */
+void ff_linux_net_cancel_io(struct ff_linux_completion_port_io_operation *operation);
 
 #ifdef __cplusplus
 }
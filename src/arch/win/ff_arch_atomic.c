@@ -0,0 +1,50 @@
+#include "ff_win_stdafx.h"
+
+#include "private/arch/ff_arch_atomic.h"
+
+void *ff_arch_atomic_cmpxchg_ptr(void **dst, void *old_value, void *new_value)
+{
+	void *prev_value;
+
+	prev_value = InterlockedCompareExchangePointer(dst, new_value, old_value);
+	return prev_value;
+}
+
+void *ff_arch_atomic_xchg_ptr(void **dst, void *value)
+{
+	void *prev_value;
+
+	prev_value = InterlockedExchangePointer(dst, value);
+	return prev_value;
+}
+
+int ff_arch_atomic_cmpxchg_int(int *dst, int old_value, int new_value)
+{
+	LONG prev_value;
+
+	prev_value = InterlockedCompareExchange((LONG volatile *) dst, (LONG) new_value, (LONG) old_value);
+	return (int) prev_value;
+}
+
+int ff_arch_atomic_add_int(int *dst, int value)
+{
+	LONG prev_value;
+
+	prev_value = InterlockedExchangeAdd((LONG volatile *) dst, (LONG) value);
+	return (int) prev_value;
+}
+
+int ff_arch_atomic_load_int(int *src)
+{
+	int value;
+
+	/* reads of volatile variables have acquire semantics in MSVC */
+	value = *(int volatile *) src;
+	return value;
+}
+
+void ff_arch_atomic_store_int(int *dst, int value)
+{
+	/* writes to volatile variables have release semantics in MSVC */
+	*(int volatile *) dst = value;
+}
@@ -2,6 +2,7 @@
 
 #include "private/arch/ff_arch_completion_port.h"
 #include "ff_win_completion_port.h"
+#include "private/arch/ff_arch_misc.h"
 #include "private/ff_dictionary.h"
 #include "private/ff_hash.h"
 
@@ -12,9 +13,20 @@
 struct ff_arch_completion_port
 {
 	HANDLE handle;
+	HANDLE timer;
+	const void *timer_data;
 	struct ff_dictionary *overlapped_dictionary;
 };
 
+static VOID CALLBACK timer_callback(PVOID ctx, BOOLEAN is_timer_fired)
+{
+	struct ff_arch_completion_port *completion_port;
+
+	(void)is_timer_fired;
+	completion_port = (struct ff_arch_completion_port *) ctx;
+	ff_arch_completion_port_put(completion_port, completion_port->timer_data);
+}
+
 static uint32_t dictionary_get_overlapped_hash(const void *key)
 {
 	LPOVERLAPPED overlapped;
@@ -46,6 +58,8 @@ struct ff_arch_completion_port *ff_arch_completion_port_create(int concurrency)
 	completion_port = (struct ff_arch_completion_port *) ff_malloc(sizeof(*completion_port));
 	completion_port->handle = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, (ULONG_PTR) NULL, concurrency);
 	ff_winapi_fatal_error_check(completion_port->handle != NULL, L"cannot create completion port");
+	completion_port->timer = NULL;
+	completion_port->timer_data = NULL;
 	completion_port->overlapped_dictionary = ff_dictionary_create(OVERLAPPED_DICTIONARY_ORDER, dictionary_get_overlapped_hash, dictionary_is_equal_overlapped);
 	return completion_port;
 }
@@ -54,31 +68,40 @@ void ff_arch_completion_port_delete(struct ff_arch_completion_port *completion_p
 {
 	BOOL result;
 
+	ff_assert(completion_port->timer == NULL);
 	ff_dictionary_delete(completion_port->overlapped_dictionary);
 	result = CloseHandle(completion_port->handle);
 	ff_assert(result != FALSE);
 	ff_free(completion_port);
 }
 
-void ff_arch_completion_port_get(struct ff_arch_completion_port *completion_port, const void **data)
+/**
+ * Waits for the completion packet during the given timeout in milliseconds.
+ * Returns 0 if the timeout expired.
+ */
+static int get_completion_packet(struct ff_arch_completion_port *completion_port, const void **data, DWORD timeout)
 {
 	DWORD bytes_transferred;
 	ULONG_PTR key;
 	LPOVERLAPPED overlapped;
 	BOOL rv;
-	
+
 	rv = GetQueuedCompletionStatus(
 		completion_port->handle,
 		&bytes_transferred,
 		&key,
 		&overlapped,
-		INFINITE
+		timeout
 	);
 	if (rv == FALSE)
 	{
 		DWORD last_error;
 
 		last_error = GetLastError();
+		if (overlapped == NULL && last_error == WAIT_TIMEOUT)
+		{
+			return 0;
+		}
 		ff_log_debug(L"GetQueuedCompletionStatus() failed on key=%p, overlapped=%p. GetLastError()=%lu", key, overlapped, last_error);
 	}
 
@@ -93,6 +116,23 @@ void ff_arch_completion_port_get(struct ff_arch_completion_port *completion_port
 	{
 		*data = (const void *) key;
 	}
+	return 1;
+}
+
+void ff_arch_completion_port_get(struct ff_arch_completion_port *completion_port, const void **data)
+{
+	int is_success;
+
+	is_success = get_completion_packet(completion_port, data, INFINITE);
+	ff_assert(is_success);
+}
+
+int ff_arch_completion_port_try_get(struct ff_arch_completion_port *completion_port, const void **data)
+{
+	int is_success;
+
+	is_success = get_completion_packet(completion_port, data, 0);
+	return is_success;
 }
 
 void ff_arch_completion_port_put(struct ff_arch_completion_port *completion_port, const void *data)
@@ -105,6 +145,36 @@ void ff_arch_completion_port_put(struct ff_arch_completion_port *completion_port
 	ff_assert(result != FALSE);
 }
 
+void ff_arch_completion_port_set_timer(struct ff_arch_completion_port *completion_port, int64_t expiration_time, const void *data)
+{
+	int64_t interval;
+	BOOL result;
+
+	ff_arch_completion_port_cancel_timer(completion_port);
+	interval = expiration_time - ff_arch_misc_get_monotonic_time_ns() / (1000 * 1000);
+	if (interval < 0)
+	{
+		interval = 0;
+	}
+	completion_port->timer_data = data;
+	result = CreateTimerQueueTimer(&completion_port->timer, NULL, timer_callback, completion_port, (DWORD) interval, 0, WT_EXECUTEINTIMERTHREAD | WT_EXECUTEONLYONCE);
+	ff_winapi_fatal_error_check(result != FALSE, L"cannot create timer queue timer");
+}
+
+void ff_arch_completion_port_cancel_timer(struct ff_arch_completion_port *completion_port)
+{
+	if (completion_port->timer != NULL)
+	{
+		BOOL result;
+
+		/* wait until the timer_callback() completes */
+		result = DeleteTimerQueueTimer(NULL, completion_port->timer, INVALID_HANDLE_VALUE);
+		ff_assert(result != FALSE);
+		completion_port->timer = NULL;
+		completion_port->timer_data = NULL;
+	}
+}
+
 void ff_win_completion_port_register_overlapped_data(struct ff_arch_completion_port *completion_port, LPOVERLAPPED overlapped, const void *data)
 {
 	enum ff_result result;
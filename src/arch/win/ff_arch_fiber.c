@@ -7,7 +7,7 @@ struct ff_arch_fiber
 	LPVOID handle;
 };
 
-static struct ff_arch_fiber main_fiber;
+static FF_THREAD_LOCAL struct ff_arch_fiber main_fiber;
 
 struct ff_arch_fiber *ff_arch_fiber_initialize()
 {
@@ -39,12 +39,63 @@ struct ff_arch_fiber *ff_arch_fiber_create(ff_arch_fiber_func arch_fiber_func, v
 	return fiber;
 }
 
+struct ff_arch_fiber *ff_arch_fiber_create_with_shared_stack(ff_arch_fiber_func arch_fiber_func, void *ctx)
+{
+	struct ff_arch_fiber *fiber;
+
+	/* windows fibers cannot share stacks, so create the fiber with the default stack size */
+	fiber = ff_arch_fiber_create(arch_fiber_func, ctx, 0x10000);
+	return fiber;
+}
+
+int ff_arch_fiber_has_shared_stack(struct ff_arch_fiber *fiber)
+{
+	(void) fiber;
+	return 0;
+}
+
+void ff_arch_fiber_pin_stack(struct ff_arch_fiber *fiber)
+{
+	(void) fiber;
+}
+
+void ff_arch_fiber_unpin_stack(struct ff_arch_fiber *fiber)
+{
+	(void) fiber;
+}
+
+int ff_arch_fiber_is_stack_available(struct ff_arch_fiber *fiber)
+{
+	(void) fiber;
+	return 1;
+}
+
 void ff_arch_fiber_delete(struct ff_arch_fiber *fiber)
 {
 	DeleteFiber(fiber->handle);
 	ff_free(fiber);
 }
 
+void ff_arch_fiber_trim_stack(struct ff_arch_fiber *fiber)
+{
+	/* the stack of the fiber is managed by the CreateFiber(), which doesn't expose its bounds */
+	(void) fiber;
+}
+
+int ff_arch_fiber_paint_stack(struct ff_arch_fiber *fiber)
+{
+	/* the stack of the fiber is managed by the CreateFiber(), which doesn't expose its bounds */
+	(void) fiber;
+	return 0;
+}
+
+int ff_arch_fiber_get_stack_usage(struct ff_arch_fiber *fiber)
+{
+	(void) fiber;
+	ff_assert(0);
+	return 0;
+}
+
 void ff_arch_fiber_switch(struct ff_arch_fiber *fiber)
 {
 	SwitchToFiber(fiber->handle);
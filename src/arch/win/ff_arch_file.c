@@ -43,7 +43,7 @@ struct file_data
 	struct ff_arch_completion_port *completion_port;
 };
 
-static struct file_data file_ctx;
+static FF_THREAD_LOCAL struct file_data file_ctx;
 
 static void threadpool_open_file_func(void *ctx)
 {
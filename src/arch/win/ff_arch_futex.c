@@ -0,0 +1,93 @@
+#include "ff_win_stdafx.h"
+
+#include "private/arch/ff_arch_futex.h"
+
+#define SPIN_COUNT 100
+#define MAX_SEMAPHORE_VALUE 0x7fffffff
+
+/**
+ * WaitOnAddress() isn't available in the targeted Windows versions, so the futex
+ * is emulated with the semaphore. The critical section is used only for registering waiters,
+ * so it doesn't guard the value of the futex.
+ */
+struct ff_arch_futex
+{
+	CRITICAL_SECTION critical_section;
+	HANDLE semaphore;
+	LONG volatile value;
+	int waiters_cnt;
+};
+
+struct ff_arch_futex *ff_arch_futex_create()
+{
+	struct ff_arch_futex *futex;
+	BOOL rv;
+
+	futex = (struct ff_arch_futex *) ff_malloc(sizeof(*futex));
+	rv = InitializeCriticalSectionAndSpinCount(&futex->critical_section, SPIN_COUNT);
+	ff_assert(rv != FALSE);
+	futex->semaphore = CreateSemaphore(NULL, 0, MAX_SEMAPHORE_VALUE, NULL);
+	ff_winapi_fatal_error_check(futex->semaphore != NULL, L"cannot create the semaphore for the futex");
+	futex->value = 0;
+	futex->waiters_cnt = 0;
+
+	return futex;
+}
+
+void ff_arch_futex_delete(struct ff_arch_futex *futex)
+{
+	BOOL rv;
+
+	ff_assert(futex->waiters_cnt == 0);
+
+	rv = CloseHandle(futex->semaphore);
+	ff_assert(rv != FALSE);
+	DeleteCriticalSection(&futex->critical_section);
+	ff_free(futex);
+}
+
+int ff_arch_futex_get_value(struct ff_arch_futex *futex)
+{
+	LONG value;
+
+	value = InterlockedCompareExchange(&futex->value, 0, 0);
+	return (int) value;
+}
+
+void ff_arch_futex_wait(struct ff_arch_futex *futex, int value)
+{
+	DWORD rv;
+
+	EnterCriticalSection(&futex->critical_section);
+	if (futex->value != (LONG) value)
+	{
+		LeaveCriticalSection(&futex->critical_section);
+		return;
+	}
+	futex->waiters_cnt++;
+	LeaveCriticalSection(&futex->critical_section);
+
+	rv = WaitForSingleObject(futex->semaphore, INFINITE);
+	ff_winapi_fatal_error_check(rv == WAIT_OBJECT_0, L"unexpected result while waiting for the futex");
+}
+
+void ff_arch_futex_wake(struct ff_arch_futex *futex, int waiters_cnt)
+{
+	int woken_cnt;
+
+	ff_assert(waiters_cnt > 0);
+
+	EnterCriticalSection(&futex->critical_section);
+	InterlockedIncrement(&futex->value);
+	woken_cnt = futex->waiters_cnt < waiters_cnt ? futex->waiters_cnt : waiters_cnt;
+	futex->waiters_cnt -= woken_cnt;
+	LeaveCriticalSection(&futex->critical_section);
+
+	if (woken_cnt > 0)
+	{
+		BOOL rv;
+
+		rv = ReleaseSemaphore(futex->semaphore, woken_cnt, NULL);
+		ff_winapi_fatal_error_check(rv != FALSE, L"cannot release the semaphore of the futex");
+	}
+}
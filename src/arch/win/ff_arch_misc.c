@@ -16,7 +16,7 @@ struct misc_data
 	int tmp_dir_path_len;
 };
 
-static struct misc_data misc_ctx;
+static FF_THREAD_LOCAL struct misc_data misc_ctx;
 
 static void initialize_tmp_dir_path()
 {
@@ -50,12 +50,21 @@ void ff_arch_misc_shutdown()
 	shutdown_tmp_dir_path();
 }
 
-int64_t ff_arch_misc_get_current_time()
-{
-	int64_t current_time;
-
-	current_time = GetTickCount();
-	return current_time;
+int64_t ff_arch_misc_get_monotonic_time_ns()
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	int64_t monotonic_time;
+	BOOL result;
+
+	result = QueryPerformanceFrequency(&frequency);
+	ff_assert(result != FALSE);
+	result = QueryPerformanceCounter(&counter);
+	ff_assert(result != FALSE);
+	/* split the conversion in order to avoid overflow when multiplying the counter */
+	monotonic_time = (counter.QuadPart / frequency.QuadPart) * 1000 * 1000 * 1000;
+	monotonic_time += ((counter.QuadPart % frequency.QuadPart) * 1000 * 1000 * 1000) / frequency.QuadPart;
+	return monotonic_time;
 }
 
 void ff_arch_misc_sleep(int interval)
@@ -63,6 +72,20 @@ void ff_arch_misc_sleep(int interval)
 	Sleep(interval);
 }
 
+int64_t ff_arch_misc_get_current_thread_id()
+{
+	int64_t thread_id;
+
+	thread_id = (int64_t) GetCurrentThreadId();
+	return thread_id;
+}
+
+void ff_arch_misc_log_thread_stack_trace(int64_t thread_id)
+{
+	/* walking the stack of other thread requires dbghelp, which isn't linked to the library */
+	ff_log_warning(L"the stack trace of the thread=%lld isn't available on this platform", thread_id);
+}
+
 int ff_arch_misc_get_cpus_cnt()
 {
 	int cpus_cnt;
@@ -41,6 +41,17 @@ void ff_arch_thread_delete(struct ff_arch_thread *thread)
 	ff_free(thread);
 }
 
+void ff_arch_thread_set_cpu_affinity(struct ff_arch_thread *thread, int cpu_index)
+{
+	DWORD_PTR prev_mask;
+
+	ff_assert(cpu_index >= 0);
+	ff_assert(cpu_index < (int) (sizeof(DWORD_PTR) * 8));
+
+	prev_mask = SetThreadAffinityMask(thread->handle, ((DWORD_PTR) 1) << cpu_index);
+	ff_winapi_fatal_error_check(prev_mask != 0, L"cannot set cpu affinity for the thread");
+}
+
 void ff_arch_thread_start(struct ff_arch_thread *thread, void *ctx)
 {
 	DWORD result;
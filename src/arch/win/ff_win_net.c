@@ -14,7 +14,7 @@ struct net_data
 	LPFN_GETACCEPTEXSOCKADDRS get_accept_ex_sockaddrs;
 };
 
-static struct net_data net_ctx;
+static FF_THREAD_LOCAL struct net_data net_ctx;
 
 void ff_win_net_initialize(struct ff_arch_completion_port *completion_port)
 {
@@ -71,17 +71,47 @@ void ff_win_net_register_socket(SOCKET socket)
 	ff_win_completion_port_register_handle(net_ctx.completion_port, (HANDLE) socket);
 }
 
+/**
+ * the overlapped operation, which can be cancelled by the ff_fiber_cancel()
+ */
+struct overlapped_io
+{
+	SOCKET socket;
+	WSAOVERLAPPED *overlapped;
+};
+
+static void cancel_overlapped_io(struct ff_fiber *fiber, void *ctx)
+{
+	struct overlapped_io *io;
+
+	(void)fiber;
+	/* the fiber is woken up by the completion of the operation with the ERROR_OPERATION_ABORTED error */
+	io = (struct overlapped_io *) ctx;
+	CancelIoEx((HANDLE) io->socket, io->overlapped);
+}
+
 int ff_win_net_complete_overlapped_io(SOCKET socket, WSAOVERLAPPED *overlapped)
 {
 	struct ff_fiber *current_fiber;
+	struct overlapped_io io;
 	int int_bytes_transferred = -1;
 	BOOL result;
 	DWORD flags;
 	DWORD bytes_transferred;
+	enum ff_result begin_result;
 
 	current_fiber = ff_fiber_get_current();
+	io.socket = socket;
+	io.overlapped = overlapped;
 	ff_win_completion_port_register_overlapped_data(net_ctx.completion_port, overlapped, current_fiber);
+	begin_result = ff_fiber_begin_cancellable_operation(cancel_overlapped_io, &io);
+	if (begin_result != FF_SUCCESS)
+	{
+		/* the operation has been already started, so it must be waited for after the cancellation */
+		cancel_overlapped_io(current_fiber, &io);
+	}
 	ff_core_yield_fiber();
+	ff_fiber_end_cancellable_operation();
 	ff_win_completion_port_deregister_overlapped_data(net_ctx.completion_port, overlapped);
 
 	result = WSAGetOverlappedResult(socket, overlapped, &bytes_transferred, FALSE, &flags);
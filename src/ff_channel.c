@@ -0,0 +1,567 @@
+#include "private/ff_common.h"
+
+#include "private/ff_channel.h"
+#include "private/ff_core.h"
+#include "private/ff_fiber.h"
+
+/**
+ * the list of fibers blocked on the channel in the order they were blocked
+ */
+struct waiter_queue
+{
+	struct channel_waiter *head;
+	struct channel_waiter *tail;
+};
+
+/**
+ * the case of the ff_channel_select(), which is blocked on the channel
+ */
+struct channel_waiter
+{
+	struct select_state *state;
+	/* the queue, which contains the waiter, or NULL if the waiter isn't queued */
+	struct waiter_queue *queue;
+	struct channel_waiter *next;
+	struct channel_waiter *prev;
+	/* the copy of the value to send or the buffer for the received value */
+	void *value;
+	int case_index;
+};
+
+/**
+ * the state of the blocked ff_channel_select(), which is shared among its waiters
+ */
+struct select_state
+{
+	struct ff_fiber *fiber;
+	struct channel_waiter *waiters;
+	int cases_cnt;
+	/* the index of the completed case or -1 if no cases have been completed */
+	int completed_case_index;
+	enum ff_result result;
+	/* is set when the fiber is scheduled, so it isn't scheduled twice */
+	int is_woken;
+};
+
+struct ff_channel
+{
+	/* the ring buffer for capacity values */
+	char *buf;
+	int element_size;
+	int capacity;
+	int start_pos;
+	int size;
+	struct waiter_queue senders;
+	struct waiter_queue receivers;
+	int is_closed;
+};
+
+/**
+ * the index of the case, which is tried first by the next ff_channel_select()
+ */
+static FF_THREAD_LOCAL int select_start_index = 0;
+
+static void enqueue_waiter(struct waiter_queue *queue, struct channel_waiter *waiter)
+{
+	waiter->queue = queue;
+	waiter->next = NULL;
+	waiter->prev = queue->tail;
+	if (queue->tail != NULL)
+	{
+		queue->tail->next = waiter;
+	}
+	else
+	{
+		queue->head = waiter;
+	}
+	queue->tail = waiter;
+}
+
+static void remove_waiter(struct channel_waiter *waiter)
+{
+	struct waiter_queue *queue;
+
+	queue = waiter->queue;
+	ff_assert(queue != NULL);
+	if (waiter->prev != NULL)
+	{
+		waiter->prev->next = waiter->next;
+	}
+	else
+	{
+		queue->head = waiter->next;
+	}
+	if (waiter->next != NULL)
+	{
+		waiter->next->prev = waiter->prev;
+	}
+	else
+	{
+		queue->tail = waiter->prev;
+	}
+	waiter->queue = NULL;
+	waiter->next = NULL;
+	waiter->prev = NULL;
+}
+
+/**
+ * Removes all the waiters of the blocked ff_channel_select() from channels
+ * and schedules its fiber for execution.
+ */
+static void wake_select(struct select_state *state)
+{
+	int i;
+
+	ff_assert(!state->is_woken);
+	for (i = 0; i < state->cases_cnt; i++)
+	{
+		struct channel_waiter *waiter;
+
+		waiter = &state->waiters[i];
+		if (waiter->queue != NULL)
+		{
+			remove_waiter(waiter);
+		}
+	}
+	state->is_woken = 1;
+	ff_core_schedule_fiber(state->fiber);
+}
+
+/**
+ * Completes the case of the blocked ff_channel_select(), which corresponds to the given waiter.
+ */
+static void complete_waiter(struct channel_waiter *waiter, enum ff_result result)
+{
+	struct select_state *state;
+
+	state = waiter->state;
+	ff_assert(state->completed_case_index == -1);
+	state->completed_case_index = waiter->case_index;
+	state->result = result;
+	wake_select(state);
+}
+
+/**
+ * Wakes up the blocked ff_channel_select() without completing its cases.
+ * It is called on the timeout expiration and on the fiber cancellation.
+ */
+static void abort_select(struct ff_fiber *fiber, void *ctx)
+{
+	struct select_state *state;
+
+	state = (struct select_state *) ctx;
+	ff_assert(state->fiber == fiber);
+	if (!state->is_woken)
+	{
+		wake_select(state);
+	}
+}
+
+static void push_value(struct ff_channel *channel, const void *value)
+{
+	int pos;
+
+	ff_assert(channel->size < channel->capacity);
+
+	pos = channel->start_pos + channel->size;
+	if (pos >= channel->capacity)
+	{
+		pos -= channel->capacity;
+	}
+	memcpy(channel->buf + pos * channel->element_size, value, channel->element_size);
+	channel->size++;
+}
+
+static void pop_value(struct ff_channel *channel, void *value)
+{
+	ff_assert(channel->size > 0);
+
+	memcpy(value, channel->buf + channel->start_pos * channel->element_size, channel->element_size);
+	channel->start_pos++;
+	if (channel->start_pos == channel->capacity)
+	{
+		channel->start_pos = 0;
+	}
+	channel->size--;
+}
+
+/**
+ * Tries completing the case without blocking.
+ * The handoff_fiber is set to the blocked receiver, which has got the value directly
+ * from the sender via the unbuffered channel, so it can run immediately.
+ * Returns 0 if the case cannot be completed at the moment.
+ */
+static int try_case(struct ff_channel_select_case *select_case, struct ff_fiber **handoff_fiber)
+{
+	struct ff_channel *channel;
+	struct channel_waiter *waiter;
+
+	channel = select_case->channel;
+	if (select_case->operation == FF_CHANNEL_SEND)
+	{
+		if (channel->is_closed)
+		{
+			select_case->result = FF_FAILURE;
+			return 1;
+		}
+		waiter = channel->receivers.head;
+		if (waiter != NULL)
+		{
+			/* hand the value directly to the receiver, which has been blocked first */
+			ff_assert(channel->size == 0);
+			memcpy(waiter->value, select_case->value, channel->element_size);
+			/* only unbuffered channels switch to the receiver, so senders can fill buffered channels in batches */
+			if (channel->capacity == 0)
+			{
+				*handoff_fiber = waiter->state->fiber;
+			}
+			complete_waiter(waiter, FF_SUCCESS);
+			select_case->result = FF_SUCCESS;
+			return 1;
+		}
+		if (channel->size < channel->capacity)
+		{
+			push_value(channel, select_case->value);
+			select_case->result = FF_SUCCESS;
+			return 1;
+		}
+	}
+	else
+	{
+		waiter = channel->senders.head;
+		if (channel->size > 0)
+		{
+			pop_value(channel, select_case->value);
+			if (waiter != NULL)
+			{
+				/* the buffer has been full, so move the value of the blocked sender to the buffer */
+				push_value(channel, waiter->value);
+				complete_waiter(waiter, FF_SUCCESS);
+			}
+			select_case->result = FF_SUCCESS;
+			return 1;
+		}
+		if (waiter != NULL)
+		{
+			/* the unbuffered channel - take the value directly from the sender */
+			memcpy(select_case->value, waiter->value, channel->element_size);
+			complete_waiter(waiter, FF_SUCCESS);
+			select_case->result = FF_SUCCESS;
+			return 1;
+		}
+		if (channel->is_closed)
+		{
+			select_case->result = FF_FAILURE;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Rounds up the size, so values in the select state are aligned to the int64_t boundary.
+ */
+static size_t get_aligned_size(size_t size)
+{
+	size_t aligned_size;
+
+	aligned_size = (size + sizeof(int64_t) - 1) & ~(sizeof(int64_t) - 1);
+	return aligned_size;
+}
+
+/**
+ * Allocates the state of the blocked ff_channel_select() together with buffers for values,
+ * since values cannot be accessed on the stack of the fiber, which can be moved while the fiber is blocked.
+ */
+static struct select_state *create_select_state(struct ff_channel_select_case *cases, int cases_cnt)
+{
+	struct select_state *state;
+	size_t state_size;
+	size_t values_size = 0;
+	char *value_buf;
+	int i;
+
+	state_size = get_aligned_size(sizeof(*state) + cases_cnt * sizeof(state->waiters[0]));
+	for (i = 0; i < cases_cnt; i++)
+	{
+		values_size += get_aligned_size(cases[i].channel->element_size);
+	}
+
+	state = (struct select_state *) ff_malloc(state_size + values_size);
+	state->fiber = ff_fiber_get_current();
+	state->waiters = (struct channel_waiter *) (state + 1);
+	state->cases_cnt = cases_cnt;
+	state->completed_case_index = -1;
+	state->result = FF_FAILURE;
+	state->is_woken = 0;
+
+	value_buf = ((char *) state) + state_size;
+	for (i = 0; i < cases_cnt; i++)
+	{
+		struct ff_channel_select_case *select_case;
+		struct channel_waiter *waiter;
+		struct ff_channel *channel;
+
+		select_case = &cases[i];
+		channel = select_case->channel;
+		waiter = &state->waiters[i];
+		waiter->state = state;
+		waiter->value = value_buf;
+		waiter->case_index = i;
+		if (select_case->operation == FF_CHANNEL_SEND)
+		{
+			memcpy(waiter->value, select_case->value, channel->element_size);
+			enqueue_waiter(&channel->senders, waiter);
+		}
+		else
+		{
+			enqueue_waiter(&channel->receivers, waiter);
+		}
+		value_buf += get_aligned_size(channel->element_size);
+	}
+
+	return state;
+}
+
+/**
+ * Selects the case, which can be completed. Blocks during the timeout in milliseconds
+ * if there are no such cases. The timeout is infinite if it is 0.
+ * Returns the index of the completed case or -1 on timeout.
+ */
+static int select_cases(struct ff_channel_select_case *cases, int cases_cnt, int timeout)
+{
+	struct select_state *state;
+	struct ff_core_timeout_operation_data *timeout_operation_data;
+	struct ff_fiber *handoff_fiber = NULL;
+	int start_index;
+	int completed_case_index;
+	int i;
+
+	ff_assert(cases_cnt > 0);
+
+	start_index = select_start_index;
+	if (start_index >= cases_cnt)
+	{
+		start_index = 0;
+	}
+	select_start_index = start_index + 1;
+	for (i = 0; i < cases_cnt; i++)
+	{
+		int case_index;
+		int is_completed;
+
+		case_index = start_index + i;
+		if (case_index >= cases_cnt)
+		{
+			case_index -= cases_cnt;
+		}
+		is_completed = try_case(&cases[case_index], &handoff_fiber);
+		if (is_completed)
+		{
+			if (handoff_fiber != NULL)
+			{
+				ff_fiber_switch_to(handoff_fiber);
+			}
+			return case_index;
+		}
+	}
+
+	if (timeout == 0)
+	{
+		state = create_select_state(cases, cases_cnt);
+		ff_core_yield_fiber();
+	}
+	else
+	{
+		enum ff_result result;
+
+		if (ff_fiber_is_cancelled(ff_fiber_get_current()))
+		{
+			ff_log_debug(L"the fiber has been cancelled, so it won't wait for channels");
+			return -1;
+		}
+		state = create_select_state(cases, cases_cnt);
+		result = ff_fiber_begin_cancellable_operation(abort_select, state);
+		ff_assert(result == FF_SUCCESS);
+		timeout_operation_data = ff_core_register_timeout_operation(timeout, abort_select, state);
+		ff_core_yield_fiber();
+		ff_fiber_end_cancellable_operation();
+		ff_core_deregister_timeout_operation(timeout_operation_data);
+	}
+
+	ff_assert(state->is_woken);
+	completed_case_index = state->completed_case_index;
+	if (completed_case_index != -1)
+	{
+		struct ff_channel_select_case *completed_case;
+
+		completed_case = &cases[completed_case_index];
+		completed_case->result = state->result;
+		if (completed_case->operation == FF_CHANNEL_RECEIVE && state->result == FF_SUCCESS)
+		{
+			memcpy(completed_case->value, state->waiters[completed_case_index].value, completed_case->channel->element_size);
+		}
+	}
+	ff_free(state);
+
+	return completed_case_index;
+}
+
+struct ff_channel *ff_channel_create(int element_size, int capacity)
+{
+	struct ff_channel *channel;
+
+	ff_assert(element_size > 0);
+	ff_assert(capacity >= 0);
+
+	channel = (struct ff_channel *) ff_malloc(sizeof(*channel));
+	channel->buf = (capacity > 0) ? (char *) ff_calloc(capacity, element_size) : NULL;
+	channel->element_size = element_size;
+	channel->capacity = capacity;
+	channel->start_pos = 0;
+	channel->size = 0;
+	channel->senders.head = NULL;
+	channel->senders.tail = NULL;
+	channel->receivers.head = NULL;
+	channel->receivers.tail = NULL;
+	channel->is_closed = 0;
+
+	return channel;
+}
+
+void ff_channel_delete(struct ff_channel *channel)
+{
+	ff_assert(channel->senders.head == NULL);
+	ff_assert(channel->receivers.head == NULL);
+
+	if (channel->buf != NULL)
+	{
+		ff_free(channel->buf);
+	}
+	ff_free(channel);
+}
+
+enum ff_result ff_channel_send(struct ff_channel *channel, const void *value)
+{
+	struct ff_channel_select_case send_case;
+
+	send_case.channel = channel;
+	send_case.operation = FF_CHANNEL_SEND;
+	send_case.value = (void *) value;
+	select_cases(&send_case, 1, 0);
+	if (send_case.result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot send the value=%p to the closed channel=%p", value, channel);
+	}
+	return send_case.result;
+}
+
+enum ff_result ff_channel_send_with_timeout(struct ff_channel *channel, const void *value, int timeout)
+{
+	struct ff_channel_select_case send_case;
+	int case_index;
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(timeout > 0);
+
+	send_case.channel = channel;
+	send_case.operation = FF_CHANNEL_SEND;
+	send_case.value = (void *) value;
+	case_index = select_cases(&send_case, 1, timeout);
+	if (case_index != -1)
+	{
+		result = send_case.result;
+	}
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot send the value=%p to the channel=%p during the timeout=%d", value, channel, timeout);
+	}
+	return result;
+}
+
+enum ff_result ff_channel_receive(struct ff_channel *channel, void *value)
+{
+	struct ff_channel_select_case receive_case;
+
+	receive_case.channel = channel;
+	receive_case.operation = FF_CHANNEL_RECEIVE;
+	receive_case.value = value;
+	select_cases(&receive_case, 1, 0);
+	if (receive_case.result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot receive the value from the closed channel=%p", channel);
+	}
+	return receive_case.result;
+}
+
+enum ff_result ff_channel_receive_with_timeout(struct ff_channel *channel, void *value, int timeout)
+{
+	struct ff_channel_select_case receive_case;
+	int case_index;
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(timeout > 0);
+
+	receive_case.channel = channel;
+	receive_case.operation = FF_CHANNEL_RECEIVE;
+	receive_case.value = value;
+	case_index = select_cases(&receive_case, 1, timeout);
+	if (case_index != -1)
+	{
+		result = receive_case.result;
+	}
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot receive the value from the channel=%p during the timeout=%d", channel, timeout);
+	}
+	return result;
+}
+
+void ff_channel_close(struct ff_channel *channel)
+{
+	if (!channel->is_closed)
+	{
+		channel->is_closed = 1;
+		/* receivers can be blocked only on the empty channel, so they have nothing to receive */
+		while (channel->receivers.head != NULL)
+		{
+			complete_waiter(channel->receivers.head, FF_FAILURE);
+		}
+		while (channel->senders.head != NULL)
+		{
+			complete_waiter(channel->senders.head, FF_FAILURE);
+		}
+	}
+	else
+	{
+		ff_log_debug(L"the channel=%p was already closed, so it won't be closed again", channel);
+	}
+}
+
+int ff_channel_get_size(struct ff_channel *channel)
+{
+	return channel->size;
+}
+
+int ff_channel_select(struct ff_channel_select_case *cases, int cases_cnt)
+{
+	int case_index;
+
+	case_index = select_cases(cases, cases_cnt, 0);
+	ff_assert(case_index != -1);
+	return case_index;
+}
+
+int ff_channel_select_with_timeout(struct ff_channel_select_case *cases, int cases_cnt, int timeout)
+{
+	int case_index;
+
+	ff_assert(timeout > 0);
+
+	case_index = select_cases(cases, cases_cnt, timeout);
+	if (case_index == -1)
+	{
+		ff_log_debug(L"none of %d cases have been selected during the timeout=%d", cases_cnt, timeout);
+	}
+	return case_index;
+}
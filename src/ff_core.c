@@ -5,12 +5,14 @@
 #include "private/ff_fiber.h"
 #include "private/ff_threadpool.h"
 #include "private/ff_fiberpool.h"
-#include "private/ff_stack.h"
-#include "private/ff_container.h"
-#include "private/ff_mutex.h"
-#include "private/ff_semaphore.h"
+#include "private/ff_queue.h"
+#include "private/ff_timing_wheel.h"
+#include "private/ff_event.h"
 #include "private/arch/ff_arch_completion_port.h"
 #include "private/arch/ff_arch_misc.h"
+#include "private/arch/ff_arch_thread.h"
+#include "private/arch/ff_arch_atomic.h"
+#include "private/arch/ff_arch_mutex.h"
 
 /**
  * This number must be equal to 1.
@@ -28,67 +30,318 @@
 #define MAX_FIBERPOOL_SIZE 5000
 
 /**
- * interval in milliseconds for timeout checker fiber,
- * which executes cancellation callbacks for timed out operations.
+ * the maximum number of consecutive runs of fibers from the lifo slot
+ * before the next fiber from the head of pending fibers queue is run.
+ * The lifo slot improves cache locality, because the most recently scheduled fiber
+ * usually works with data, which is still in the cache.
+ * Set it to 0 in order to disable the lifo slot.
  */
-#define TIMEOUT_CHECKER_INTERVAL 100
+#define LIFO_SLOT_MAX_RUNS 3
+
+/**
+ * the maximum number of fibers from higher priority classes, which can run
+ * while fibers of the given priority class are ready to run.
+ * After that the next fiber of the starving priority class is run out of order.
+ */
+#define MAX_STARVED_RUNS 16
+
+/**
+ * the interval in milliseconds, after which the ff_core_yield_if_needed() yields the current fiber.
+ */
+#define FIBER_TIME_SLICE 10
+
+/**
+ * the number of times per time slice the ff_core_yield_if_needed() aims to read the clock.
+ * The clock is read only once per the adaptive number of calls, so CPU-heavy loops
+ * calling the function on each iteration don't pay for the clock read on each iteration.
+ */
+#define TIME_SLICE_CLOCK_READS_CNT 16
+
+/**
+ * the maximum number of ff_core_yield_if_needed() calls between clock reads.
+ */
+#define MAX_TIME_SLICE_CHECK_INTERVAL 1024
+
+/**
+ * the default number of fiber switches between checks of the completion port
+ * for ready I/O operations while there are other fibers ready to run.
+ */
+#define DEFAULT_IO_POLL_SWITCHES_INTERVAL 64
+
+/**
+ * the default interval in nanoseconds between checks of the completion port
+ * for ready I/O operations while there are other fibers ready to run.
+ * It is disabled by default, because it requires reading the clock on every fiber switch.
+ */
+#define DEFAULT_IO_POLL_TIME_INTERVAL 0
+
+/**
+ * the maximum number of events obtained by a single check of the completion port,
+ * so fibers ready to run aren't starved by the I/O.
+ */
+#define MAX_IO_POLL_EVENTS_CNT 64
+
+/**
+ * the stack size for the watchdog thread.
+ */
+#define WATCHDOG_THREAD_STACK_SIZE 0x10000
+
+/**
+ * the expiration time of the disarmed completion port's timer.
+ */
+#define TIMER_DISARMED ((int64_t) (((uint64_t) -1) >> 1))
+
+/**
+ * the stack size for threads of additional schedulers.
+ */
+#define SCHEDULER_THREAD_STACK_SIZE 0x10000
 
 struct ff_core_timeout_operation_data
 {
-	int64_t expiration_time;
-	struct ff_container_entry *timeout_operation_entry;
+	struct ff_core_timer_entry timer_entry;
 	ff_core_cancel_timeout_func cancel_timeout_func;
 	struct ff_fiber *fiber;
 	void *ctx;
 	int is_expired;
 };
 
-struct timeout_checker_data
+struct generic_threadpool_data
 {
-	int64_t current_time;
+	/* the task is embedded, so the threadpool doesn't allocate memory for it */
+	struct ff_threadpool_task task;
+	/* the scheduler, which runs the fiber.
+	 * It cannot be obtained from the core_ctx, because the core_ctx
+	 * is local to the scheduler thread.
+	 */
+	struct scheduler_data *scheduler;
+	struct ff_fiber *fiber;
+	ff_core_threadpool_func func;
+	void *ctx;
+	/* the link in the scheduler's stack of completed threadpool calls */
+	struct generic_threadpool_data *next;
 };
 
-struct threadpool_sleep_data
+/**
+ * the function deferred by the ff_core_fiberpool_execute_deferred().
+ * The timer entry and the fiberpool task are embedded, so the deferred function
+ * requires a single memory allocation.
+ */
+struct deferred_func_data
 {
-	int interval;
+	struct ff_core_timer_entry timer_entry;
+	struct ff_fiberpool_task task;
+	ff_core_fiberpool_func func;
+	void *ctx;
 };
 
-struct generic_threadpool_data
+struct mailbox_message
 {
-	struct ff_fiber *fiber;
-	ff_core_threadpool_func func;
+	struct mailbox_message *next;
+	ff_core_fiberpool_func func;
 	void *ctx;
 };
 
-struct deferred_func_data
+struct shared_task
 {
 	ff_core_fiberpool_func func;
 	void *ctx;
-	struct ff_core_timeout_operation_data *timeout_operation_data;
+	enum ff_fiber_priority priority;
+};
+
+struct scheduler_data
+{
+	struct ff_arch_completion_port *completion_port;
+	/* lock-free stack of messages posted by the ff_core_post_to_scheduler().
+	 * The address of the mailbox is used as a marker of the completion port event,
+	 * which notifies the scheduler about new messages.
+	 */
+	struct mailbox_message *mailbox;
+	/* lock-free stack of calls completed by threadpool threads.
+	 * The address of the threadpool_completions is used as a marker of the completion port event,
+	 * which is posted only when the stack becomes non-empty. So calls completed while the scheduler
+	 * is busy are delivered to it in a single batch.
+	 */
+	struct generic_threadpool_data *threadpool_completions;
+	/* not yet started tasks, which can be stolen by idle schedulers.
+	 * The address of the shared_tasks is used as a marker of the completion port event,
+	 * which wakes up the idle scheduler for stealing tasks.
+	 * Used only in the FF_CORE_SCHEDULER_WORK_STEALING mode.
+	 */
+	struct ff_queue *shared_tasks;
+	struct ff_arch_mutex *shared_tasks_mutex;
+	/* is modified under the shared_tasks_mutex, but is read by other schedulers without it,
+	 * so it is accessed via atomic operations.
+	 */
+	int shared_tasks_cnt;
+	/* equals to 1 while the scheduler waits for events in the completion port */
+	int is_idle;
+	struct ff_arch_thread *thread;
+	int id;
+	/* the following fields are updated by the scheduler thread and are read by the watchdog thread */
+	volatile int switches_cnt;
+	volatile int is_waiting;
+	volatile ff_fiber_func running_fiber_func;
+	int64_t thread_id;
+	/* io poll statistics, which are read by the ff_core_get_io_poll_stats() */
+	struct ff_core_io_poll_stats io_poll_stats;
+	/* priority statistics, which are read by the ff_core_get_priority_stats() */
+	struct ff_core_priority_stats priority_stats;
+};
+
+/**
+ * the watchdog state of the scheduler
+ */
+struct watchdog_scheduler_data
+{
+	int switches_cnt;
+	int64_t last_switch_time;
+	int is_reported;
+};
+
+/**
+ * the watchdog, which detects fibers running for too long without switching to other fibers.
+ */
+struct watchdog_data
+{
+	struct ff_arch_thread *thread;
+	struct watchdog_scheduler_data *schedulers;
+	int budget;
+	volatile int is_stopped;
+};
+
+/**
+ * FIFO queue of fibers with the same priority class, which are ready to run.
+ * Fibers are chained via their run queue links, so scheduling never allocates memory.
+ */
+struct run_queue
+{
+	struct ff_fiber *head;
+	struct ff_fiber *tail;
+	/* the number of fibers from higher priority classes, which ran while the queue wasn't empty */
+	int starved_runs_cnt;
 };
 
 struct core_data
 {
+	struct scheduler_data *scheduler;
 	struct ff_arch_completion_port *completion_port;
-	struct ff_stack *pending_fibers;
+	/* pending fibers indexed by their priority class */
+	struct run_queue run_queues[FF_FIBER_PRIORITIES_CNT];
+	/* the bit mask of non-empty run queues, where the bit number is the priority class */
+	int run_queues_mask;
+	/* the most recently scheduled fiber, which runs before fibers from the pending fibers queue */
+	struct ff_fiber *lifo_slot;
+	int lifo_slot_runs_cnt;
 	struct ff_threadpool *threadpool;
 	struct ff_fiberpool *fiberpool;
-	struct ff_container *timeout_operations;
-	struct ff_mutex *timeout_operations_mutex;
-	struct ff_semaphore *timeout_operations_semaphore;
+	struct ff_timing_wheel *timeout_operations;
+	int timeout_operations_cnt;
+	int64_t timer_expiration_time;
 	struct ff_fiber *timeout_checker_fiber;
+	int is_timeout_checker_waiting;
+	/* the fiber, which passes messages from the mailbox and stolen tasks to the fiberpool.
+	 * This cannot be done directly in the ff_core_yield_fiber(), because the ff_fiberpool_execute_async()
+	 * can block when the fiberpool is saturated.
+	 */
+	struct ff_fiber *dispatcher_fiber;
+	int is_dispatcher_waiting;
+	int is_dispatcher_stopped;
+	int is_shutting_down;
+	/* the event, which stops the main fiber of additional schedulers */
+	struct ff_event *stop_event;
+	/* the value of the scheduler's switches_cnt at the start of the current time slice */
+	int time_slice_switches_cnt;
+	/* the monotonic time of the start of the current time slice in nanoseconds */
+	int64_t time_slice_start_time;
+	/* the number of ff_core_yield_if_needed() calls since the last clock read */
+	int time_slice_calls_cnt;
+	/* the number of ff_core_yield_if_needed() calls between clock reads */
+	int time_slice_check_interval;
+	/* the monotonic time of the last clock read by the ff_core_yield_if_needed() */
+	int64_t time_slice_check_time;
+	/* the cached monotonic time in nanoseconds, which is returned by the ff_core_now_ns() */
+	int64_t current_time;
+	/* the value of the scheduler's switches_cnt, when the current_time was refreshed */
+	int current_time_switches_cnt;
+	/* the number of fiber switches since the last check of the completion port */
+	int io_poll_switches_cnt;
+	/* the monotonic time of the last check of the completion port in nanoseconds */
+	int64_t io_poll_time;
+	/* the monotonic time in nanoseconds, when the running fiber was switched to,
+	 * or 0 if the run time isn't measured.
+	 */
+	int64_t run_start_time;
+	enum ff_fiber_priority running_priority;
 };
 
-static struct core_data core_ctx;
-static int is_core_initialized = 0;
+static FF_THREAD_LOCAL struct core_data core_ctx;
+static FF_THREAD_LOCAL int is_core_initialized = 0;
+
+static struct scheduler_data *schedulers = NULL;
+static int schedulers_cnt = 0;
+static enum ff_core_scheduler_mode scheduler_mode = FF_CORE_SCHEDULER_ISOLATED;
+static struct watchdog_data watchdog;
+static int io_poll_switches_interval = DEFAULT_IO_POLL_SWITCHES_INTERVAL;
+static int64_t io_poll_time_interval = DEFAULT_IO_POLL_TIME_INTERVAL;
+static int is_run_time_stats_enabled = 0;
 
 static void generic_core_threadpool_func(void *ctx)
 {
 	struct generic_threadpool_data *data;
+	struct scheduler_data *scheduler;
+	struct generic_threadpool_data *prev_data;
 
 	data = (struct generic_threadpool_data *) ctx;
 	data->func(data->ctx);
-	ff_arch_completion_port_put(core_ctx.completion_port, data->fiber);
+
+	/* the data mustn't be accessed after it is pushed to the stack,
+	 * because the scheduler can resume the fiber, which owns the data.
+	 */
+	scheduler = data->scheduler;
+	prev_data = NULL;
+	for (;;)
+	{
+		struct generic_threadpool_data *head;
+
+		data->next = prev_data;
+		head = (struct generic_threadpool_data *) ff_arch_atomic_cmpxchg_ptr((void **) &scheduler->threadpool_completions, prev_data, data);
+		if (head == prev_data)
+		{
+			break;
+		}
+		prev_data = head;
+	}
+
+	if (prev_data == NULL)
+	{
+		/* the stack was empty, so the scheduler must be notified about completed calls.
+		 * Subsequent completions will be delivered together with this one.
+		 */
+		ff_arch_completion_port_put(scheduler->completion_port, &scheduler->threadpool_completions);
+	}
+}
+
+static void wakeup_timeout_checker()
+{
+	if (core_ctx.is_timeout_checker_waiting)
+	{
+		core_ctx.is_timeout_checker_waiting = 0;
+		ff_core_schedule_fiber(core_ctx.timeout_checker_fiber);
+	}
+}
+
+/**
+ * Completes the timeout operation, which has been counted in the timeout_operations_cnt.
+ * The shutdown waits until all the timeout operations are completed.
+ */
+static void complete_timeout_operation()
+{
+	core_ctx.timeout_operations_cnt--;
+	ff_assert(core_ctx.timeout_operations_cnt >= 0);
+	if (core_ctx.is_shutting_down && core_ctx.timeout_operations_cnt == 0)
+	{
+		wakeup_timeout_checker();
+	}
 }
 
 static void deferred_func(void *ctx)
@@ -97,57 +350,91 @@ static void deferred_func(void *ctx)
 
 	data = (struct deferred_func_data *) ctx;
 	data->func(data->ctx);
-	ff_core_deregister_timeout_operation(data->timeout_operation_data);
+	complete_timeout_operation();
 	ff_free(data);
 }
 
-static void threadpool_sleep(void *ctx)
+static void sleep_timeout_func(struct ff_fiber *fiber, void *ctx)
 {
-	struct threadpool_sleep_data *data;
-
-	data = (struct threadpool_sleep_data *) ctx;
-	ff_arch_misc_sleep(data->interval);
+	(void)ctx;
+	ff_core_schedule_fiber(fiber);
 }
 
-static void internal_sleep(int interval)
+static void expire_deferred_func(void *ctx)
 {
-	struct threadpool_sleep_data data;
+	struct deferred_func_data *data;
+
+	data = (struct deferred_func_data *) ctx;
+	/* the deferred_func must be executed by the current scheduler,
+	 * because it completes the timeout operation.
+	 */
+	ff_fiberpool_execute_task(core_ctx.fiberpool, &data->task);
+}
 
-	data.interval = interval;
-	ff_core_threadpool_execute(threadpool_sleep, &data);
+static int64_t refresh_current_time()
+{
+	core_ctx.current_time = ff_arch_misc_get_monotonic_time_ns();
+	core_ctx.current_time_switches_cnt = core_ctx.scheduler->switches_cnt;
+	return core_ctx.current_time;
 }
 
-static void sleep_timeout_func(struct ff_fiber *fiber, void *ctx)
+/**
+ * Returns the cached monotonic time in milliseconds, which is used by timeout operations.
+ */
+static int64_t get_current_time()
 {
-	(void)ctx;
-	ff_core_schedule_fiber(fiber);
+	return ff_core_now_ns() / (1000 * 1000);
 }
 
-static void deferred_timeout_func(struct ff_fiber *fiber, void *ctx)
+static void expire_timer_entry(struct ff_timing_wheel_entry *entry, void *ctx)
 {
-	(void)fiber;
-	ff_core_fiberpool_execute_async(deferred_func, ctx);
+	struct ff_core_timer_entry *timer_entry;
+
+	(void)ctx;
+	timer_entry = (struct ff_core_timer_entry *) entry->data;
+	timer_entry->expire_func(timer_entry->ctx);
 }
 
-static void timeout_operations_visitor_func(const void *data, void *ctx)
+static void expire_timeout_operation(void *ctx)
 {
 	struct ff_core_timeout_operation_data *timeout_operation_data;
-	struct timeout_checker_data *timeout_checker_data;
 
-	timeout_operation_data = (struct ff_core_timeout_operation_data *) data;
-	timeout_checker_data = (struct timeout_checker_data *) ctx;
-	if (!timeout_operation_data->is_expired)
+	timeout_operation_data = (struct ff_core_timeout_operation_data *) ctx;
+	ff_assert(!timeout_operation_data->is_expired);
+	timeout_operation_data->is_expired = 1;
+	timeout_operation_data->cancel_timeout_func(timeout_operation_data->fiber, timeout_operation_data->ctx);
+}
+
+static void set_timer(int64_t expiration_time)
+{
+	if (expiration_time != core_ctx.timer_expiration_time)
 	{
-		if (timeout_checker_data->current_time > timeout_operation_data->expiration_time)
+		if (expiration_time == TIMER_DISARMED)
+		{
+			ff_arch_completion_port_cancel_timer(core_ctx.completion_port);
+		}
+		else
 		{
-			timeout_operation_data->cancel_timeout_func(timeout_operation_data->fiber, timeout_operation_data->ctx);
-			timeout_operation_data->is_expired = 1;
+			/* the address of the timeout_operations is used as a marker of the timer event,
+			 * which is handled by the ff_core_yield_fiber().
+			 */
+			ff_arch_completion_port_set_timer(core_ctx.completion_port, expiration_time, &core_ctx.timeout_operations);
 		}
+		core_ctx.timer_expiration_time = expiration_time;
 	}
-	else
+}
+
+static void update_timer()
+{
+	int64_t expiration_time = TIMER_DISARMED;
+	int is_empty;
+
+	is_empty = ff_timing_wheel_is_empty(core_ctx.timeout_operations);
+	if (!is_empty)
 	{
-		ff_log_debug(L"timeout operation already expired. timeout_operation_data=%p, timeout_checker_data=%p", timeout_operation_data, timeout_checker_data);
+		expiration_time = ff_timing_wheel_get_next_expiration_time(core_ctx.timeout_operations);
 	}
+	set_timer(expiration_time);
 }
 
 static void timeout_checker_func(void *ctx)
@@ -155,159 +442,1289 @@ static void timeout_checker_func(void *ctx)
 	(void)ctx;
 	for (;;)
 	{
-		struct timeout_checker_data timeout_checker_data;
-		int is_empty;
+		int64_t current_time;
 
-		ff_semaphore_down(core_ctx.timeout_operations_semaphore);
-		is_empty = ff_container_is_empty(core_ctx.timeout_operations);
-		if (is_empty)
+		if (core_ctx.is_shutting_down && core_ctx.timeout_operations_cnt == 0)
 		{
 			break;
 		}
-		timeout_checker_data.current_time = ff_arch_misc_get_current_time();
-		ff_mutex_lock(core_ctx.timeout_operations_mutex);
-		ff_container_for_each(core_ctx.timeout_operations, timeout_operations_visitor_func, &timeout_checker_data);
-		ff_mutex_unlock(core_ctx.timeout_operations_mutex);
-		ff_semaphore_up(core_ctx.timeout_operations_semaphore);
 
-		internal_sleep(TIMEOUT_CHECKER_INTERVAL);
+		current_time = get_current_time();
+		ff_timing_wheel_advance(core_ctx.timeout_operations, current_time, expire_timer_entry, NULL);
+		update_timer();
+
+		/* sleep until the completion port's timer fires */
+		core_ctx.is_timeout_checker_waiting = 1;
+		ff_core_yield_fiber();
 	}
 }
 
-void ff_core_initialize(const wchar_t *log_filename)
+static void drain_mailbox()
 {
-	ff_assert(!is_core_initialized);
-	ff_log_initialize(log_filename);
-	ff_fiber_initialize();
-	core_ctx.completion_port = ff_arch_completion_port_create(COMPLETION_PORT_CONCURRENCY);
-	ff_arch_misc_initialize(core_ctx.completion_port);
-	core_ctx.pending_fibers = ff_stack_create();
-	core_ctx.threadpool = ff_threadpool_create(MAX_THREADPOOL_SIZE);
-	core_ctx.fiberpool = ff_fiberpool_create(MAX_FIBERPOOL_SIZE);
-	core_ctx.timeout_operations = ff_container_create();
-	core_ctx.timeout_operations_mutex = ff_mutex_create();
-	core_ctx.timeout_operations_semaphore = ff_semaphore_create(0);
-	core_ctx.timeout_checker_fiber = ff_fiber_create(timeout_checker_func, 0);
-	ff_fiber_start(core_ctx.timeout_checker_fiber, NULL);
-	is_core_initialized = 1;
+	struct mailbox_message *message;
+
+	message = (struct mailbox_message *) ff_arch_atomic_xchg_ptr((void **) &core_ctx.scheduler->mailbox, NULL);
+	while (message != NULL)
+	{
+		struct mailbox_message *next_message;
+
+		next_message = message->next;
+		ff_fiberpool_execute_async(core_ctx.fiberpool, message->func, message->ctx);
+		ff_free(message);
+		message = next_message;
+	}
 }
 
-void ff_core_shutdown()
+static struct shared_task *pop_shared_task(struct scheduler_data *scheduler)
 {
-	ff_assert(is_core_initialized);
-	ff_semaphore_up(core_ctx.timeout_operations_semaphore);
-	ff_fiber_join(core_ctx.timeout_checker_fiber);
-	ff_fiber_delete(core_ctx.timeout_checker_fiber);
-	ff_semaphore_delete(core_ctx.timeout_operations_semaphore);
-	ff_mutex_delete(core_ctx.timeout_operations_mutex);
-	ff_container_delete(core_ctx.timeout_operations);
-	ff_fiberpool_delete(core_ctx.fiberpool);
-	ff_threadpool_delete(core_ctx.threadpool);
-	ff_stack_delete(core_ctx.pending_fibers);
-	ff_arch_misc_shutdown();
-	ff_arch_completion_port_delete(core_ctx.completion_port);
-	ff_fiber_shutdown();
-	ff_log_shutdown();
-	is_core_initialized = 0;
+	struct shared_task *task = NULL;
+
+	ff_arch_mutex_lock(scheduler->shared_tasks_mutex);
+	if (scheduler->shared_tasks_cnt > 0)
+	{
+		ff_queue_front(scheduler->shared_tasks, (const void **) &task);
+		ff_queue_pop(scheduler->shared_tasks);
+		ff_arch_atomic_add_int(&scheduler->shared_tasks_cnt, -1);
+	}
+	ff_arch_mutex_unlock(scheduler->shared_tasks_mutex);
+
+	return task;
 }
 
-void ff_core_sleep(int interval)
+static void execute_shared_task(struct shared_task *task)
 {
-	struct ff_core_timeout_operation_data *timeout_operation_data;
+	ff_core_fiberpool_func func;
+	void *ctx;
 
-	ff_assert(interval > 0);
+	func = task->func;
+	ctx = task->ctx;
+	ff_fiber_set_priority(ff_fiber_get_current(), task->priority);
+	ff_free(task);
+	func(ctx);
+}
 
-	timeout_operation_data = ff_core_register_timeout_operation(interval, sleep_timeout_func, NULL);
-	ff_core_yield_fiber();
-	ff_core_deregister_timeout_operation(timeout_operation_data);
+static void local_shared_task_func(void *ctx)
+{
+	struct shared_task *task;
+
+	(void)ctx;
+	task = pop_shared_task(core_ctx.scheduler);
+	if (task != NULL)
+	{
+		execute_shared_task(task);
+	}
+	/* otherwise the task has been already stolen by other scheduler */
 }
 
-void ff_core_threadpool_execute(ff_core_threadpool_func func, void *ctx)
+static void stolen_shared_task_func(void *ctx)
 {
-	struct generic_threadpool_data data;
+	struct shared_task *task;
 
-	data.fiber = ff_fiber_get_current();
-	data.func = func;
-	data.ctx = ctx;
-	ff_threadpool_execute_async(core_ctx.threadpool, generic_core_threadpool_func, &data);
-	ff_core_yield_fiber();
+	task = (struct shared_task *) ctx;
+	execute_shared_task(task);
 }
 
-void ff_core_fiberpool_execute_async(ff_core_fiberpool_func func, void *ctx)
+static void wakeup_idle_scheduler()
 {
-	ff_fiberpool_execute_async(core_ctx.fiberpool, func, ctx);
+	int i;
+
+	for (i = 1; i < schedulers_cnt; i++)
+	{
+		struct scheduler_data *scheduler;
+
+		scheduler = &schedulers[(core_ctx.scheduler->id + i) % schedulers_cnt];
+		if (ff_arch_atomic_load_int(&scheduler->is_idle))
+		{
+			int prev_is_idle;
+
+			/* only one waker can clear the is_idle flag, so the idle scheduler is woken up only once */
+			prev_is_idle = ff_arch_atomic_cmpxchg_int(&scheduler->is_idle, 1, 0);
+			if (prev_is_idle)
+			{
+				ff_arch_completion_port_put(scheduler->completion_port, &scheduler->shared_tasks);
+				break;
+			}
+		}
+	}
 }
 
-void ff_core_fiberpool_execute_deferred(ff_core_fiberpool_func func, void *ctx, int interval)
+static void push_shared_task(ff_core_fiberpool_func func, void *ctx, enum ff_fiber_priority priority)
 {
-	struct deferred_func_data *data;
+	struct scheduler_data *scheduler;
+	struct shared_task *task;
+	int prev_shared_tasks_cnt;
 
-	ff_assert(interval > 0);
+	scheduler = core_ctx.scheduler;
+	task = (struct shared_task *) ff_malloc(sizeof(*task));
+	task->func = func;
+	task->ctx = ctx;
+	task->priority = priority;
+	ff_arch_mutex_lock(scheduler->shared_tasks_mutex);
+	ff_queue_push(scheduler->shared_tasks, task);
+	/* the full memory barrier orders the increment before reading is_idle flags of other schedulers
+	 * in the wakeup_idle_scheduler(), while idle schedulers set the flag before re-checking the counter.
+	 */
+	prev_shared_tasks_cnt = ff_arch_atomic_add_int(&scheduler->shared_tasks_cnt, 1);
+	ff_arch_mutex_unlock(scheduler->shared_tasks_mutex);
 
-	data = (struct deferred_func_data *) ff_malloc(sizeof(*data));
-	data->func = func;
-	data->ctx = ctx;
-	data->timeout_operation_data = ff_core_register_timeout_operation(interval, deferred_timeout_func, data);
+	/* the task will be executed by the current scheduler unless it is stolen by other scheduler */
+	ff_fiberpool_execute_async_with_priority(core_ctx.fiberpool, local_shared_task_func, NULL, priority);
+
+	if (prev_shared_tasks_cnt > 0)
+	{
+		/* the current scheduler has a backlog of not yet started tasks,
+		 * so ask an idle scheduler for help.
+		 */
+		wakeup_idle_scheduler();
+	}
 }
 
-struct ff_core_timeout_operation_data *ff_core_register_timeout_operation(int timeout, ff_core_cancel_timeout_func cancel_timeout_func, void *ctx)
+static int has_shared_tasks_to_steal()
 {
-	struct ff_core_timeout_operation_data *timeout_operation_data;
-	int64_t current_time;
+	int has_shared_tasks = 0;
+	int i;
 
-	ff_assert(timeout > 0);
+	for (i = 1; i < schedulers_cnt; i++)
+	{
+		struct scheduler_data *victim;
 
-	timeout_operation_data = (struct ff_core_timeout_operation_data *) ff_malloc(sizeof(*timeout_operation_data));
-	current_time = ff_arch_misc_get_current_time();
-	timeout_operation_data->expiration_time = current_time + timeout;
-	timeout_operation_data->cancel_timeout_func = cancel_timeout_func;
-	timeout_operation_data->fiber = ff_fiber_get_current();
-	timeout_operation_data->ctx = ctx;
-	timeout_operation_data->is_expired = 0;
+		victim = &schedulers[(core_ctx.scheduler->id + i) % schedulers_cnt];
+		if (ff_arch_atomic_load_int(&victim->shared_tasks_cnt) > 0)
+		{
+			has_shared_tasks = 1;
+			break;
+		}
+	}
+
+	return has_shared_tasks;
+}
 
-	ff_semaphore_up(core_ctx.timeout_operations_semaphore);
-	ff_mutex_lock(core_ctx.timeout_operations_mutex);
-	timeout_operation_data->timeout_operation_entry = ff_container_add_entry(core_ctx.timeout_operations, timeout_operation_data);
-	ff_mutex_unlock(core_ctx.timeout_operations_mutex);
+static int steal_shared_task()
+{
+	int is_stolen = 0;
+	int i;
 
-	return timeout_operation_data;
+	for (i = 1; i < schedulers_cnt; i++)
+	{
+		struct scheduler_data *victim;
+		struct shared_task *task;
+
+		victim = &schedulers[(core_ctx.scheduler->id + i) % schedulers_cnt];
+		if (ff_arch_atomic_load_int(&victim->shared_tasks_cnt) > 0)
+		{
+			task = pop_shared_task(victim);
+			if (task != NULL)
+			{
+				ff_fiberpool_execute_async_with_priority(core_ctx.fiberpool, stolen_shared_task_func, task, task->priority);
+				is_stolen = 1;
+				break;
+			}
+		}
+	}
+
+	return is_stolen;
 }
 
-enum ff_result ff_core_deregister_timeout_operation(struct ff_core_timeout_operation_data *timeout_operation_data)
+/**
+ * Checks whether other schedulers have tasks, which can be stolen, before waiting
+ * for events in the completion port.
+ * Returns 1 if there are such tasks, otherwise marks the current scheduler as idle and returns 0.
+ */
+static int has_shared_tasks_to_steal_or_become_idle()
 {
-	enum ff_result result;
+	int has_shared_tasks;
 
-	ff_mutex_lock(core_ctx.timeout_operations_mutex);
-	ff_container_remove_entry(timeout_operation_data->timeout_operation_entry);
-	ff_mutex_unlock(core_ctx.timeout_operations_mutex);
-	ff_semaphore_down(core_ctx.timeout_operations_semaphore);
+	has_shared_tasks = has_shared_tasks_to_steal();
+	if (!has_shared_tasks)
+	{
+		int prev_is_idle;
 
-	result = timeout_operation_data->is_expired ? FF_FAILURE : FF_SUCCESS;
-	ff_free(timeout_operation_data);
-	return result;
+		prev_is_idle = ff_arch_atomic_cmpxchg_int(&core_ctx.scheduler->is_idle, 0, 1);
+		ff_assert(!prev_is_idle);
+
+		/* other schedulers could push tasks before the is_idle flag has been set,
+		 * so check them again.
+		 */
+		has_shared_tasks = has_shared_tasks_to_steal();
+		if (has_shared_tasks)
+		{
+			ff_arch_atomic_cmpxchg_int(&core_ctx.scheduler->is_idle, 1, 0);
+		}
+	}
+
+	return has_shared_tasks;
 }
 
-void ff_core_schedule_fiber(struct ff_fiber *fiber)
+static void wakeup_dispatcher()
+{
+	if (core_ctx.is_dispatcher_waiting)
+	{
+		core_ctx.is_dispatcher_waiting = 0;
+		ff_core_schedule_fiber(core_ctx.dispatcher_fiber);
+	}
+}
+
+static void dispatcher_func(void *ctx)
+{
+	(void)ctx;
+	for (;;)
+	{
+		drain_mailbox();
+		if (core_ctx.is_dispatcher_stopped)
+		{
+			break;
+		}
+		if (scheduler_mode == FF_CORE_SCHEDULER_WORK_STEALING)
+		{
+			steal_shared_task();
+		}
+		if (core_ctx.scheduler->mailbox != NULL)
+		{
+			/* messages were posted while the dispatcher was blocked in the fiberpool,
+			 * so their notification could be dropped by the wakeup_dispatcher().
+			 */
+			continue;
+		}
+
+		core_ctx.is_dispatcher_waiting = 1;
+		ff_core_yield_fiber();
+	}
+}
+
+static int has_pending_fibers()
 {
-	ff_stack_push(core_ctx.pending_fibers, fiber);
+	return core_ctx.run_queues_mask != 0;
 }
 
-void ff_core_yield_fiber()
+static void initialize_scheduler(struct scheduler_data *scheduler)
 {
-	int is_empty;
-	struct ff_fiber *next_fiber = NULL;
+	int priority;
 
-	is_empty = ff_stack_is_empty(core_ctx.pending_fibers);
-	if (!is_empty)
+	ff_assert(!is_core_initialized);
+	ff_fiber_initialize();
+	core_ctx.scheduler = scheduler;
+	core_ctx.completion_port = scheduler->completion_port;
+	ff_arch_misc_initialize(core_ctx.completion_port);
+	for (priority = 0; priority < FF_FIBER_PRIORITIES_CNT; priority++)
 	{
-		ff_stack_top(core_ctx.pending_fibers, (const void **) &next_fiber);
-		ff_assert(next_fiber != NULL);
-		ff_stack_pop(core_ctx.pending_fibers);
+		struct run_queue *run_queue;
+
+		run_queue = &core_ctx.run_queues[priority];
+		run_queue->head = NULL;
+		run_queue->tail = NULL;
+		run_queue->starved_runs_cnt = 0;
 	}
-	else
+	core_ctx.run_queues_mask = 0;
+	core_ctx.lifo_slot = NULL;
+	core_ctx.lifo_slot_runs_cnt = 0;
+	core_ctx.threadpool = ff_threadpool_create(MAX_THREADPOOL_SIZE);
+	core_ctx.fiberpool = ff_fiberpool_create(MAX_FIBERPOOL_SIZE);
+	core_ctx.timeout_operations = ff_timing_wheel_create(ff_arch_misc_get_monotonic_time_ns() / (1000 * 1000));
+	core_ctx.timeout_operations_cnt = 0;
+	core_ctx.timer_expiration_time = TIMER_DISARMED;
+	core_ctx.timeout_checker_fiber = ff_fiber_create(timeout_checker_func, 0);
+	core_ctx.is_timeout_checker_waiting = 0;
+	core_ctx.dispatcher_fiber = ff_fiber_create(dispatcher_func, 0);
+	core_ctx.is_dispatcher_waiting = 0;
+	core_ctx.is_dispatcher_stopped = 0;
+	core_ctx.is_shutting_down = 0;
+	core_ctx.stop_event = NULL;
+	core_ctx.time_slice_switches_cnt = 0;
+	core_ctx.time_slice_start_time = 0;
+	core_ctx.time_slice_calls_cnt = 0;
+	core_ctx.time_slice_check_interval = 1;
+	core_ctx.time_slice_check_time = 0;
+	core_ctx.io_poll_switches_cnt = 0;
+	core_ctx.io_poll_time = ff_arch_misc_get_monotonic_time_ns();
+	core_ctx.run_start_time = 0;
+	core_ctx.running_priority = FF_FIBER_PRIORITY_NORMAL;
+	scheduler->switches_cnt = 0;
+	scheduler->is_waiting = 0;
+	scheduler->running_fiber_func = NULL;
+	scheduler->thread_id = ff_arch_misc_get_current_thread_id();
+	memset(&scheduler->io_poll_stats, 0, sizeof(scheduler->io_poll_stats));
+	memset(&scheduler->priority_stats, 0, sizeof(scheduler->priority_stats));
+	refresh_current_time();
+	ff_fiber_start(core_ctx.timeout_checker_fiber, NULL);
+	ff_fiber_start(core_ctx.dispatcher_fiber, NULL);
+	is_core_initialized = 1;
+}
+
+static void shutdown_scheduler()
+{
+	ff_assert(is_core_initialized);
+	/* the timeout checker exits after all the pending timeout operations are deregistered */
+	core_ctx.is_shutting_down = 1;
+	wakeup_timeout_checker();
+	ff_fiber_join(core_ctx.timeout_checker_fiber);
+	ff_fiber_delete(core_ctx.timeout_checker_fiber);
+	ff_assert(core_ctx.timeout_operations_cnt == 0);
+	ff_assert(core_ctx.timer_expiration_time == TIMER_DISARMED);
+	ff_timing_wheel_delete(core_ctx.timeout_operations);
+	core_ctx.is_dispatcher_stopped = 1;
+	wakeup_dispatcher();
+	ff_fiber_join(core_ctx.dispatcher_fiber);
+	ff_fiber_delete(core_ctx.dispatcher_fiber);
+	ff_fiberpool_delete(core_ctx.fiberpool);
+	ff_threadpool_delete(core_ctx.threadpool);
+	ff_assert(!has_pending_fibers());
+	ff_assert(core_ctx.lifo_slot == NULL);
+	ff_arch_misc_shutdown();
+	ff_fiber_shutdown();
+	is_core_initialized = 0;
+}
+
+static void stop_scheduler_func(void *ctx)
+{
+	(void)ctx;
+	ff_event_set(core_ctx.stop_event);
+}
+
+static void scheduler_thread_func(void *ctx)
+{
+	struct scheduler_data *scheduler;
+
+	scheduler = (struct scheduler_data *) ctx;
+	initialize_scheduler(scheduler);
+	core_ctx.stop_event = ff_event_create(FF_EVENT_AUTO);
+	ff_event_wait(core_ctx.stop_event);
+	ff_event_delete(core_ctx.stop_event);
+	shutdown_scheduler();
+}
+
+static void threadpool_join_scheduler_thread(void *ctx)
+{
+	struct ff_arch_thread *thread;
+
+	thread = (struct ff_arch_thread *) ctx;
+	ff_arch_thread_join(thread);
+}
+
+static void check_scheduler_progress(int scheduler_id, int64_t current_time)
+{
+	struct scheduler_data *scheduler;
+	struct watchdog_scheduler_data *watchdog_scheduler;
+	int switches_cnt;
+
+	scheduler = &schedulers[scheduler_id];
+	watchdog_scheduler = &watchdog.schedulers[scheduler_id];
+	switches_cnt = scheduler->switches_cnt;
+	if (scheduler->is_waiting || switches_cnt != watchdog_scheduler->switches_cnt)
+	{
+		watchdog_scheduler->switches_cnt = switches_cnt;
+		watchdog_scheduler->last_switch_time = current_time;
+		watchdog_scheduler->is_reported = 0;
+		return;
+	}
+	if (!watchdog_scheduler->is_reported && current_time - watchdog_scheduler->last_switch_time >= watchdog.budget)
+	{
+		/* report each stalled fiber only once */
+		watchdog_scheduler->is_reported = 1;
+		ff_log_warning(L"the fiber with fiber_func=%p runs on the scheduler=%d for more than %d ms without switching to other fibers",
+			(void *) scheduler->running_fiber_func, scheduler_id, watchdog.budget);
+		ff_arch_misc_log_thread_stack_trace(scheduler->thread_id);
+	}
+}
+
+static void watchdog_thread_func(void *ctx)
+{
+	int check_interval;
+
+	(void)ctx;
+	check_interval = watchdog.budget / 2;
+	if (check_interval == 0)
+	{
+		check_interval = 1;
+	}
+	while (!watchdog.is_stopped)
+	{
+		int64_t current_time;
+		int i;
+
+		ff_arch_misc_sleep(check_interval);
+		current_time = ff_arch_misc_get_monotonic_time_ns() / (1000 * 1000);
+		for (i = 0; i < schedulers_cnt; i++)
+		{
+			check_scheduler_progress(i, current_time);
+		}
+	}
+}
+
+static void start_watchdog(int budget)
+{
+	int64_t current_time;
+	int i;
+
+	ff_assert(budget > 0);
+	ff_assert(watchdog.thread == NULL);
+
+	current_time = ff_arch_misc_get_monotonic_time_ns() / (1000 * 1000);
+	watchdog.schedulers = (struct watchdog_scheduler_data *) ff_calloc(schedulers_cnt, sizeof(watchdog.schedulers[0]));
+	for (i = 0; i < schedulers_cnt; i++)
+	{
+		watchdog.schedulers[i].switches_cnt = schedulers[i].switches_cnt;
+		watchdog.schedulers[i].last_switch_time = current_time;
+	}
+	watchdog.budget = budget;
+	watchdog.is_stopped = 0;
+	watchdog.thread = ff_arch_thread_create(watchdog_thread_func, WATCHDOG_THREAD_STACK_SIZE);
+	ff_arch_thread_start(watchdog.thread, NULL);
+}
+
+static void stop_watchdog()
+{
+	if (watchdog.thread == NULL)
+	{
+		return;
+	}
+	watchdog.is_stopped = 1;
+	ff_core_threadpool_execute(threadpool_join_scheduler_thread, watchdog.thread);
+	ff_arch_thread_delete(watchdog.thread);
+	ff_free(watchdog.schedulers);
+	memset(&watchdog, 0, sizeof(watchdog));
+}
+
+void ff_core_initialize(const wchar_t *log_filename)
+{
+	ff_core_initialize_schedulers(log_filename, 1, FF_CORE_SCHEDULER_ISOLATED);
+}
+
+void ff_core_initialize_schedulers(const wchar_t *log_filename, int new_schedulers_cnt, enum ff_core_scheduler_mode mode)
+{
+	const char *watchdog_budget_env;
+	int cpus_cnt;
+	int i;
+
+	ff_assert(new_schedulers_cnt > 0);
+	ff_assert(schedulers == NULL);
+
+	ff_log_initialize(log_filename);
+	ff_fiber_initialize_stack_profiler();
+	schedulers = (struct scheduler_data *) ff_calloc(new_schedulers_cnt, sizeof(schedulers[0]));
+	schedulers_cnt = new_schedulers_cnt;
+	scheduler_mode = mode;
+	for (i = 0; i < schedulers_cnt; i++)
+	{
+		struct scheduler_data *scheduler;
+
+		scheduler = &schedulers[i];
+		scheduler->completion_port = ff_arch_completion_port_create(COMPLETION_PORT_CONCURRENCY);
+		scheduler->mailbox = NULL;
+		scheduler->threadpool_completions = NULL;
+		scheduler->shared_tasks = NULL;
+		scheduler->shared_tasks_mutex = NULL;
+		if (scheduler_mode == FF_CORE_SCHEDULER_WORK_STEALING)
+		{
+			scheduler->shared_tasks = ff_queue_create();
+			scheduler->shared_tasks_mutex = ff_arch_mutex_create();
+		}
+		scheduler->shared_tasks_cnt = 0;
+		scheduler->is_idle = 0;
+		scheduler->thread = NULL;
+		scheduler->id = i;
+	}
+
+	/* the current thread becomes the first scheduler */
+	initialize_scheduler(&schedulers[0]);
+
+	watchdog_budget_env = getenv("FF_WATCHDOG_BUDGET");
+	if (watchdog_budget_env != NULL && atoi(watchdog_budget_env) > 0)
+	{
+		start_watchdog(atoi(watchdog_budget_env));
+	}
+
+	cpus_cnt = ff_arch_misc_get_cpus_cnt();
+	for (i = 1; i < schedulers_cnt; i++)
+	{
+		struct scheduler_data *scheduler;
+
+		scheduler = &schedulers[i];
+		scheduler->thread = ff_arch_thread_create(scheduler_thread_func, SCHEDULER_THREAD_STACK_SIZE);
+		ff_arch_thread_set_cpu_affinity(scheduler->thread, i % cpus_cnt);
+		ff_arch_thread_start(scheduler->thread, scheduler);
+	}
+}
+
+void ff_core_shutdown()
+{
+	int i;
+
+	ff_assert(is_core_initialized);
+	ff_assert(core_ctx.scheduler == &schedulers[0]);
+
+	stop_watchdog();
+	for (i = 1; i < schedulers_cnt; i++)
+	{
+		ff_core_post_to_scheduler(i, stop_scheduler_func, NULL);
+	}
+	for (i = 1; i < schedulers_cnt; i++)
+	{
+		struct scheduler_data *scheduler;
+
+		scheduler = &schedulers[i];
+		ff_core_threadpool_execute(threadpool_join_scheduler_thread, scheduler->thread);
+		ff_arch_thread_delete(scheduler->thread);
+	}
+
+	shutdown_scheduler();
+
+	for (i = 0; i < schedulers_cnt; i++)
+	{
+		struct scheduler_data *scheduler;
+
+		scheduler = &schedulers[i];
+		ff_assert(scheduler->mailbox == NULL);
+		ff_assert(scheduler->threadpool_completions == NULL);
+		ff_assert(scheduler->shared_tasks_cnt == 0);
+		if (scheduler_mode == FF_CORE_SCHEDULER_WORK_STEALING)
+		{
+			ff_arch_mutex_delete(scheduler->shared_tasks_mutex);
+			ff_queue_delete(scheduler->shared_tasks);
+		}
+		ff_arch_completion_port_delete(scheduler->completion_port);
+	}
+	ff_free(schedulers);
+	schedulers = NULL;
+	schedulers_cnt = 0;
+	scheduler_mode = FF_CORE_SCHEDULER_ISOLATED;
+	ff_fiber_shutdown_stack_profiler();
+	ff_log_shutdown();
+}
+
+int ff_core_get_schedulers_cnt()
+{
+	ff_assert(schedulers_cnt > 0);
+
+	return schedulers_cnt;
+}
+
+int ff_core_get_current_scheduler_id()
+{
+	ff_assert(is_core_initialized);
+
+	return core_ctx.scheduler->id;
+}
+
+void ff_core_post_to_scheduler(int scheduler_id, ff_core_fiberpool_func func, void *ctx)
+{
+	struct scheduler_data *scheduler;
+	struct mailbox_message *message;
+	struct mailbox_message *prev_message;
+
+	ff_assert(scheduler_id >= 0);
+	ff_assert(scheduler_id < schedulers_cnt);
+
+	scheduler = &schedulers[scheduler_id];
+	message = (struct mailbox_message *) ff_malloc(sizeof(*message));
+	message->func = func;
+	message->ctx = ctx;
+	prev_message = NULL;
+	for (;;)
+	{
+		struct mailbox_message *head;
+
+		message->next = prev_message;
+		head = (struct mailbox_message *) ff_arch_atomic_cmpxchg_ptr((void **) &scheduler->mailbox, prev_message, message);
+		if (head == prev_message)
+		{
+			break;
+		}
+		prev_message = head;
+	}
+
+	if (prev_message == NULL)
+	{
+		/* the mailbox was empty, so the scheduler must be notified about new messages.
+		 * Subsequent messages will be drained together with this one.
+		 */
+		ff_arch_completion_port_put(scheduler->completion_port, &scheduler->mailbox);
+	}
+}
+
+int64_t ff_core_now_ns()
+{
+	if (core_ctx.current_time_switches_cnt != core_ctx.scheduler->switches_cnt)
+	{
+		/* the fiber has been switched since the last refresh, so the cached time can be stale */
+		refresh_current_time();
+	}
+	return core_ctx.current_time;
+}
+
+/**
+ * Wakes up the cancelled fiber, which sleeps in the ff_core_sleep(), before the timeout expiration.
+ */
+static void cancel_sleep(struct ff_fiber *fiber, void *ctx)
+{
+	struct ff_core_timeout_operation_data *timeout_operation_data;
+
+	timeout_operation_data = (struct ff_core_timeout_operation_data *) ctx;
+	ff_assert(timeout_operation_data->fiber == fiber);
+	if (!timeout_operation_data->is_expired)
+	{
+		ff_core_remove_timer_entry(&timeout_operation_data->timer_entry);
+		expire_timeout_operation(timeout_operation_data);
+	}
+}
+
+void ff_core_sleep(int interval)
+{
+	struct ff_core_timeout_operation_data *timeout_operation_data;
+	enum ff_result result;
+
+	ff_assert(interval > 0);
+
+	timeout_operation_data = ff_core_register_timeout_operation(interval, sleep_timeout_func, NULL);
+	result = ff_fiber_begin_cancellable_operation(cancel_sleep, timeout_operation_data);
+	if (result == FF_SUCCESS)
+	{
+		ff_core_yield_fiber();
+		ff_fiber_end_cancellable_operation();
+	}
+	ff_core_deregister_timeout_operation(timeout_operation_data);
+}
+
+void ff_core_set_watchdog_budget(int budget)
+{
+	ff_assert(budget >= 0);
+	ff_assert(core_ctx.scheduler == &schedulers[0]);
+
+	stop_watchdog();
+	if (budget > 0)
+	{
+		start_watchdog(budget);
+	}
+}
+
+void ff_core_set_io_poll_policy(int switches_interval, int time_interval)
+{
+	ff_assert(switches_interval >= 0);
+	ff_assert(time_interval >= 0);
+
+	io_poll_switches_interval = switches_interval;
+	io_poll_time_interval = ((int64_t) time_interval) * 1000;
+}
+
+void ff_core_get_io_poll_stats(struct ff_core_io_poll_stats *stats)
+{
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+	for (i = 0; i < schedulers_cnt; i++)
+	{
+		struct ff_core_io_poll_stats *scheduler_stats;
+
+		scheduler_stats = &schedulers[i].io_poll_stats;
+		stats->polls_cnt += scheduler_stats->polls_cnt;
+		stats->events_cnt += scheduler_stats->events_cnt;
+		stats->total_delay += scheduler_stats->total_delay;
+		if (scheduler_stats->max_delay > stats->max_delay)
+		{
+			stats->max_delay = scheduler_stats->max_delay;
+		}
+	}
+}
+
+void ff_core_get_priority_stats(struct ff_core_priority_stats *stats)
+{
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+	for (i = 0; i < schedulers_cnt; i++)
+	{
+		struct ff_core_priority_stats *scheduler_stats;
+		int priority;
+
+		scheduler_stats = &schedulers[i].priority_stats;
+		for (priority = 0; priority < FF_FIBER_PRIORITIES_CNT; priority++)
+		{
+			stats->runs_cnt[priority] += scheduler_stats->runs_cnt[priority];
+			stats->starvation_runs_cnt[priority] += scheduler_stats->starvation_runs_cnt[priority];
+			stats->run_time[priority] += scheduler_stats->run_time[priority];
+		}
+	}
+}
+
+void ff_core_enable_run_time_stats(int is_enabled)
+{
+	is_run_time_stats_enabled = is_enabled;
+}
+
+void ff_core_threadpool_execute(ff_core_threadpool_func func, void *ctx)
+{
+	struct generic_threadpool_data data;
+
+	data.task.func = generic_core_threadpool_func;
+	data.task.ctx = &data;
+	data.scheduler = core_ctx.scheduler;
+	data.fiber = ff_fiber_get_current();
+	data.func = func;
+	data.ctx = ctx;
+	/* the threadpool accesses the data and the ctx on the fiber's stack */
+	ff_fiber_pin_stack(data.fiber);
+	ff_threadpool_execute_task(core_ctx.threadpool, &data.task);
+	ff_core_yield_fiber();
+	ff_fiber_unpin_stack(data.fiber);
+}
+
+void ff_core_fiberpool_execute_async(ff_core_fiberpool_func func, void *ctx)
+{
+	ff_core_fiberpool_execute_async_with_priority(func, ctx, FF_FIBER_PRIORITY_NORMAL);
+}
+
+void ff_core_fiberpool_execute_async_with_priority(ff_core_fiberpool_func func, void *ctx, enum ff_fiber_priority priority)
+{
+	if (scheduler_mode == FF_CORE_SCHEDULER_WORK_STEALING)
+	{
+		push_shared_task(func, ctx, priority);
+	}
+	else
+	{
+		ff_fiberpool_execute_async_with_priority(core_ctx.fiberpool, func, ctx, priority);
+	}
+}
+
+void ff_core_fiberpool_execute_deferred(ff_core_fiberpool_func func, void *ctx, int interval)
+{
+	struct deferred_func_data *data;
+
+	ff_assert(interval > 0);
+
+	data = (struct deferred_func_data *) ff_malloc(sizeof(*data));
+	data->timer_entry.expire_func = expire_deferred_func;
+	data->timer_entry.ctx = data;
+	data->task.func = deferred_func;
+	data->task.ctx = data;
+	data->task.priority = FF_FIBER_PRIORITY_NORMAL;
+	data->task.is_allocated = 0;
+	data->func = func;
+	data->ctx = ctx;
+	/* the shutdown waits until the deferred func is executed */
+	core_ctx.timeout_operations_cnt++;
+	ff_core_add_timer_entry(&data->timer_entry, get_current_time() + interval);
+}
+
+void ff_core_fiberpool_execute_task(struct ff_fiberpool_task *task)
+{
+	ff_fiberpool_execute_task(core_ctx.fiberpool, task);
+}
+
+int64_t ff_core_get_timer_time()
+{
+	return get_current_time();
+}
+
+void ff_core_add_timer_entry(struct ff_core_timer_entry *timer_entry, int64_t expiration_time)
+{
+	int is_empty;
+
+	is_empty = ff_timing_wheel_is_empty(core_ctx.timeout_operations);
+	if (is_empty)
+	{
+		/* move the empty timing wheel to the current time, so the new entry
+		 * will be placed into the proper level of the timing wheel.
+		 */
+		ff_timing_wheel_advance(core_ctx.timeout_operations, get_current_time(), expire_timer_entry, NULL);
+	}
+	ff_timing_wheel_add_entry(core_ctx.timeout_operations, &timer_entry->timing_wheel_entry, expiration_time, timer_entry);
+	if (expiration_time < core_ctx.timer_expiration_time)
+	{
+		set_timer(expiration_time);
+	}
+}
+
+void ff_core_remove_timer_entry(struct ff_core_timer_entry *timer_entry)
+{
+	int is_empty;
+
+	ff_timing_wheel_remove_entry(core_ctx.timeout_operations, &timer_entry->timing_wheel_entry);
+	is_empty = ff_timing_wheel_is_empty(core_ctx.timeout_operations);
+	if (is_empty)
+	{
+		/* there is no need in waking up the timeout checker anymore */
+		set_timer(TIMER_DISARMED);
+	}
+}
+
+struct ff_core_timeout_operation_data *ff_core_register_timeout_operation(int timeout, ff_core_cancel_timeout_func cancel_timeout_func, void *ctx)
+{
+	struct ff_core_timeout_operation_data *timeout_operation_data;
+
+	ff_assert(timeout > 0);
+
+	timeout_operation_data = (struct ff_core_timeout_operation_data *) ff_malloc(sizeof(*timeout_operation_data));
+	timeout_operation_data->timer_entry.expire_func = expire_timeout_operation;
+	timeout_operation_data->timer_entry.ctx = timeout_operation_data;
+	timeout_operation_data->cancel_timeout_func = cancel_timeout_func;
+	timeout_operation_data->fiber = ff_fiber_get_current();
+	timeout_operation_data->ctx = ctx;
+	timeout_operation_data->is_expired = 0;
+	core_ctx.timeout_operations_cnt++;
+	ff_core_add_timer_entry(&timeout_operation_data->timer_entry, get_current_time() + timeout);
+
+	return timeout_operation_data;
+}
+
+enum ff_result ff_core_deregister_timeout_operation(struct ff_core_timeout_operation_data *timeout_operation_data)
+{
+	enum ff_result result;
+
+	if (!timeout_operation_data->is_expired)
+	{
+		ff_core_remove_timer_entry(&timeout_operation_data->timer_entry);
+	}
+	complete_timeout_operation();
+
+	result = timeout_operation_data->is_expired ? FF_FAILURE : FF_SUCCESS;
+	ff_free(timeout_operation_data);
+	return result;
+}
+
+static void push_pending_fiber(struct ff_fiber *fiber)
+{
+	struct run_queue *run_queue;
+	struct ff_fiber **link;
+
+	run_queue = &core_ctx.run_queues[ff_fiber_get_priority(fiber)];
+	link = ff_fiber_get_run_queue_link(fiber);
+	ff_assert(*link == NULL);
+	ff_assert(fiber != run_queue->tail);
+
+	if (run_queue->tail == NULL)
+	{
+		ff_assert(run_queue->head == NULL);
+		run_queue->head = fiber;
+		core_ctx.run_queues_mask |= 1 << ff_fiber_get_priority(fiber);
+	}
+	else
+	{
+		link = ff_fiber_get_run_queue_link(run_queue->tail);
+		*link = fiber;
+	}
+	run_queue->tail = fiber;
+}
+
+/**
+ * Returns 1 if there are pending fibers with priority higher than the given priority.
+ */
+static int has_higher_priority_fibers(enum ff_fiber_priority priority)
+{
+	return (core_ctx.run_queues_mask & ((1 << priority) - 1)) != 0;
+}
+
+/**
+ * Selects the priority class of the next pending fiber.
+ * Pending fibers with higher priority are selected first unless fibers with lower priority
+ * have been waiting for more than MAX_STARVED_RUNS runs.
+ * Returns -1 if there are no pending fibers.
+ */
+static int select_run_queue()
+{
+	int selected_priority;
+	int priority;
+	int mask;
+
+	mask = core_ctx.run_queues_mask;
+	if (mask == 0)
+	{
+		return -1;
+	}
+	selected_priority = 0;
+	while (!(mask & (1 << selected_priority)))
+	{
+		selected_priority++;
+	}
+	if ((mask >> (selected_priority + 1)) == 0)
+	{
+		/* the fast path: there are no pending fibers with lower priority */
+		return selected_priority;
+	}
+
+	for (priority = selected_priority + 1; priority < FF_FIBER_PRIORITIES_CNT; priority++)
+	{
+		if ((mask & (1 << priority)) && core_ctx.run_queues[priority].starved_runs_cnt >= MAX_STARVED_RUNS)
+		{
+			core_ctx.scheduler->priority_stats.starvation_runs_cnt[priority]++;
+			selected_priority = priority;
+			break;
+		}
+	}
+	core_ctx.run_queues[selected_priority].starved_runs_cnt = 0;
+	for (priority = selected_priority + 1; priority < FF_FIBER_PRIORITIES_CNT; priority++)
+	{
+		if (mask & (1 << priority))
+		{
+			core_ctx.run_queues[priority].starved_runs_cnt++;
+		}
+	}
+	return selected_priority;
+}
+
+static struct ff_fiber *pop_pending_fiber()
+{
+	struct run_queue *run_queue;
+	struct ff_fiber *fiber;
+	struct ff_fiber **link;
+	int priority;
+
+	priority = select_run_queue();
+	if (priority == -1)
+	{
+		return NULL;
+	}
+
+	run_queue = &core_ctx.run_queues[priority];
+	fiber = run_queue->head;
+	link = ff_fiber_get_run_queue_link(fiber);
+	run_queue->head = *link;
+	*link = NULL;
+	if (run_queue->head == NULL)
+	{
+		run_queue->tail = NULL;
+		run_queue->starved_runs_cnt = 0;
+		core_ctx.run_queues_mask &= ~(1 << priority);
+	}
+
+	return fiber;
+}
+
+/**
+ * Returns the next fiber, which is ready to run, or NULL if there are no such fibers.
+ */
+static struct ff_fiber *get_next_pending_fiber()
+{
+	struct ff_fiber *fiber;
+
+	fiber = core_ctx.lifo_slot;
+	if (fiber != NULL)
+	{
+		core_ctx.lifo_slot = NULL;
+		if ((core_ctx.lifo_slot_runs_cnt < LIFO_SLOT_MAX_RUNS || !has_pending_fibers()) && !has_higher_priority_fibers(ff_fiber_get_priority(fiber)))
+		{
+			core_ctx.lifo_slot_runs_cnt++;
+			return fiber;
+		}
+		/* move the fiber to the tail of the queue in order to avoid starvation of other fibers
+		 * and in order to run fibers with higher priority first.
+		 */
+		push_pending_fiber(fiber);
+	}
+	core_ctx.lifo_slot_runs_cnt = 0;
+	fiber = pop_pending_fiber();
+
+	return fiber;
+}
+
+void ff_core_schedule_fiber(struct ff_fiber *fiber)
+{
+	if (LIFO_SLOT_MAX_RUNS > 0)
+	{
+		ff_assert(fiber != core_ctx.lifo_slot);
+		if (core_ctx.lifo_slot != NULL)
+		{
+			push_pending_fiber(core_ctx.lifo_slot);
+		}
+		core_ctx.lifo_slot = fiber;
+	}
+	else
+	{
+		push_pending_fiber(fiber);
+	}
+}
+
+/**
+ * Schedules all the fibers, whose threadpool calls have been completed, in the order of completion.
+ */
+static void schedule_threadpool_completions()
+{
+	struct generic_threadpool_data *data;
+	struct generic_threadpool_data *reversed_data = NULL;
+
+	data = (struct generic_threadpool_data *) ff_arch_atomic_xchg_ptr((void **) &core_ctx.scheduler->threadpool_completions, NULL);
+	while (data != NULL)
+	{
+		struct generic_threadpool_data *next_data;
+
+		next_data = data->next;
+		data->next = reversed_data;
+		reversed_data = data;
+		data = next_data;
+	}
+	while (reversed_data != NULL)
+	{
+		/* the data lives on the stack of the fiber, so it must be read before the fiber runs */
+		data = reversed_data;
+		reversed_data = data->next;
+		push_pending_fiber(data->fiber);
+	}
+}
+
+/**
+ * Converts the data obtained from the completion port to the fiber, which is ready to run.
+ * Returns NULL if the data is a marker of the internal event, which has been already handled.
+ */
+static struct ff_fiber *dispatch_completion_port_data(const void *data)
+{
+	struct ff_fiber *fiber = NULL;
+
+	ff_assert(data != NULL);
+	if (data == &core_ctx.scheduler->shared_tasks)
+	{
+		/* other scheduler has a backlog of tasks, which can be stolen */
+	}
+	else if (data == &core_ctx.timeout_operations)
+	{
+		/* the timer of the completion port fired */
+		wakeup_timeout_checker();
+	}
+	else if (data == &core_ctx.scheduler->mailbox)
+	{
+		wakeup_dispatcher();
+	}
+	else if (data == &core_ctx.scheduler->threadpool_completions)
+	{
+		schedule_threadpool_completions();
+	}
+	else
+	{
+		fiber = (struct ff_fiber *) data;
+	}
+	return fiber;
+}
+
+/**
+ * Returns 1 if the completion port must be checked for ready I/O operations
+ * before running the next pending fiber.
+ */
+static int is_io_poll_needed(int64_t *current_time)
+{
+	core_ctx.io_poll_switches_cnt++;
+	if (io_poll_switches_interval > 0 && core_ctx.io_poll_switches_cnt >= io_poll_switches_interval)
+	{
+		*current_time = ff_arch_misc_get_monotonic_time_ns();
+		return 1;
+	}
+	if (io_poll_time_interval > 0)
+	{
+		*current_time = ff_arch_misc_get_monotonic_time_ns();
+		if (*current_time - core_ctx.io_poll_time >= io_poll_time_interval)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Moves fibers with ready I/O operations from the completion port to the tail of pending fibers,
+ * so they run after fibers, which became ready earlier.
+ */
+static void poll_completion_port(int64_t current_time)
+{
+	struct ff_core_io_poll_stats *stats;
+	int64_t delay;
+	int events_cnt;
+
+	stats = &core_ctx.scheduler->io_poll_stats;
+	delay = (current_time - core_ctx.io_poll_time) / 1000;
+	for (events_cnt = 0; events_cnt < MAX_IO_POLL_EVENTS_CNT; events_cnt++)
+	{
+		struct ff_fiber *fiber;
+		const void *data;
+		int is_success;
+
+		is_success = ff_arch_completion_port_try_get(core_ctx.completion_port, &data);
+		if (!is_success)
+		{
+			break;
+		}
+		fiber = dispatch_completion_port_data(data);
+		if (fiber != NULL)
+		{
+			push_pending_fiber(fiber);
+		}
+	}
+	stats->polls_cnt++;
+	if (events_cnt > 0)
+	{
+		stats->events_cnt += events_cnt;
+		stats->total_delay += delay * events_cnt;
+		if (delay > stats->max_delay)
+		{
+			stats->max_delay = delay;
+		}
+	}
+	core_ctx.io_poll_switches_cnt = 0;
+	core_ctx.io_poll_time = current_time;
+}
+
+/**
+ * Accounts the run time of the current fiber, which is going to be switched out,
+ * and checks the completion port for ready I/O operations if needed.
+ */
+static void leave_current_fiber()
+{
+	int64_t current_time;
+	int is_poll_needed;
+
+	if (core_ctx.run_start_time != 0)
+	{
+		core_ctx.scheduler->priority_stats.run_time[core_ctx.running_priority] += ff_arch_misc_get_monotonic_time_ns() - core_ctx.run_start_time;
+	}
+	is_poll_needed = is_io_poll_needed(&current_time);
+	if (is_poll_needed && (core_ctx.lifo_slot != NULL || has_pending_fibers()))
+	{
+		poll_completion_port(current_time);
+	}
+}
+
+static void run_fiber(struct ff_fiber *fiber)
+{
+	enum ff_fiber_priority priority;
+
+	priority = ff_fiber_get_priority(fiber);
+	core_ctx.scheduler->priority_stats.runs_cnt[priority]++;
+	core_ctx.running_priority = priority;
+	core_ctx.run_start_time = is_run_time_stats_enabled ? ff_arch_misc_get_monotonic_time_ns() : 0;
+	core_ctx.scheduler->switches_cnt++;
+	core_ctx.scheduler->running_fiber_func = ff_fiber_get_func(fiber);
+	ff_fiber_switch(fiber);
+}
+
+void ff_core_yield_fiber()
+{
+	struct ff_fiber *next_fiber;
+
+	leave_current_fiber();
+	for (;;)
+	{
+		const void *data;
+
+		next_fiber = get_next_pending_fiber();
+		if (next_fiber != NULL)
+		{
+			if (ff_fiber_park_if_stack_unavailable(next_fiber))
+			{
+				/* pick the next candidate instead of the fiber waiting for the shared stack */
+				continue;
+			}
+			break;
+		}
+
+		if (scheduler_mode == FF_CORE_SCHEDULER_WORK_STEALING && !core_ctx.is_shutting_down && core_ctx.is_dispatcher_waiting)
+		{
+			int has_shared_tasks;
+
+			has_shared_tasks = has_shared_tasks_to_steal_or_become_idle();
+			if (has_shared_tasks)
+			{
+				/* the dispatcher will steal the task */
+				wakeup_dispatcher();
+				continue;
+			}
+			core_ctx.scheduler->is_waiting = 1;
+			ff_arch_completion_port_get(core_ctx.completion_port, &data);
+			core_ctx.scheduler->is_waiting = 0;
+			ff_arch_atomic_cmpxchg_int(&core_ctx.scheduler->is_idle, 1, 0);
+		}
+		else
+		{
+			core_ctx.scheduler->is_waiting = 1;
+			ff_arch_completion_port_get(core_ctx.completion_port, &data);
+			core_ctx.scheduler->is_waiting = 0;
+		}
+		/* I/O operations are dispatched without delays while there are no other fibers ready to run */
+		core_ctx.io_poll_switches_cnt = 0;
+		core_ctx.io_poll_time = ff_arch_misc_get_monotonic_time_ns();
+		next_fiber = dispatch_completion_port_data(data);
+		if (next_fiber != NULL && !ff_fiber_park_if_stack_unavailable(next_fiber))
+		{
+			break;
+		}
+	}
+	run_fiber(next_fiber);
+}
+
+void ff_core_switch_to_fiber(struct ff_fiber *fiber)
+{
+	struct ff_fiber *current_fiber;
+	enum ff_fiber_priority priority;
+
+	current_fiber = ff_fiber_get_current();
+	ff_assert(fiber != current_fiber);
+
+	priority = ff_fiber_get_priority(fiber);
+	if (fiber != core_ctx.lifo_slot || priority > ff_fiber_get_priority(current_fiber) || has_higher_priority_fibers(priority))
+	{
+		/* the fiber isn't the most recently scheduled one or it must wait for fibers with higher priority,
+		 * so it runs in the usual order.
+		 */
+		return;
+	}
+	if (ff_fiber_park_if_stack_unavailable(fiber))
+	{
+		/* the fiber will be rescheduled when its shared stack is released */
+		core_ctx.lifo_slot = NULL;
+		return;
+	}
+	leave_current_fiber();
+	/* the current fiber continues as soon as the given fiber blocks,
+	 * so the given fiber can hand off its results back to the current fiber.
+	 */
+	core_ctx.lifo_slot = current_fiber;
+	run_fiber(fiber);
+}
+
+void ff_core_yield_if_needed()
+{
+	int64_t current_time;
+	int64_t check_time_step;
+	int switches_cnt;
+
+	switches_cnt = core_ctx.scheduler->switches_cnt;
+	if (switches_cnt != core_ctx.time_slice_switches_cnt)
+	{
+		/* the fiber has been switched since the last call, so start the new time slice.
+		 * The check interval starts from 1, because the cost of iterations of the new fiber is unknown.
+		 */
+		core_ctx.time_slice_switches_cnt = switches_cnt;
+		core_ctx.time_slice_start_time = ff_core_now_ns();
+		core_ctx.time_slice_check_time = core_ctx.time_slice_start_time;
+		core_ctx.time_slice_calls_cnt = 0;
+		core_ctx.time_slice_check_interval = 1;
+		return;
+	}
+	core_ctx.time_slice_calls_cnt++;
+	if (core_ctx.time_slice_calls_cnt < core_ctx.time_slice_check_interval)
+	{
+		return;
+	}
+	core_ctx.time_slice_calls_cnt = 0;
+
+	/* the cached time doesn't advance while the fiber runs without switching, so read the clock */
+	current_time = refresh_current_time();
+
+	/* adapt the check interval to the cost of calls, so the clock is read
+	 * about TIME_SLICE_CLOCK_READS_CNT times per time slice.
+	 */
+	check_time_step = ((int64_t) FIBER_TIME_SLICE) * 1000 * 1000 / TIME_SLICE_CLOCK_READS_CNT;
+	if (current_time - core_ctx.time_slice_check_time < check_time_step)
+	{
+		if (core_ctx.time_slice_check_interval < MAX_TIME_SLICE_CHECK_INTERVAL)
+		{
+			core_ctx.time_slice_check_interval *= 2;
+		}
+	}
+	else if (core_ctx.time_slice_check_interval > 1)
+	{
+		core_ctx.time_slice_check_interval /= 2;
+	}
+	core_ctx.time_slice_check_time = current_time;
+
+	if (current_time - core_ctx.time_slice_start_time >= ((int64_t) FIBER_TIME_SLICE) * 1000 * 1000)
 	{
-		ff_arch_completion_port_get(core_ctx.completion_port, (const void **) &next_fiber);
-		ff_assert(next_fiber != NULL);
+		/* put the fiber to the tail of the run queue, so other ready fibers will run first */
+		push_pending_fiber(ff_fiber_get_current());
+		ff_core_yield_fiber();
 	}
-	ff_fiber_switch(next_fiber);
 }
@@ -3,11 +3,10 @@
 #include "private/ff_event.h"
 #include "private/ff_core.h"
 #include "private/ff_fiber.h"
-#include "private/ff_stack.h"
 
 struct ff_event
 {
-	struct ff_stack *pending_fibers;
+	struct ff_fiber_wait_queue pending_fibers;
 	enum ff_event_type event_type;
 	int is_set;
 };
@@ -18,7 +17,7 @@ static void cancel_event_wait(struct ff_fiber *fiber, void *ctx)
 	enum ff_result result;
 	
 	event = (struct ff_event *) ctx;
-	result = ff_stack_remove_entry(event->pending_fibers, fiber);
+	result = ff_fiber_wait_queue_remove(&event->pending_fibers, fiber);
 	if (result == FF_SUCCESS)
 	{
 		ff_core_schedule_fiber(fiber);
@@ -34,7 +33,7 @@ struct ff_event *ff_event_create(enum ff_event_type event_type)
 	struct ff_event *event;
 
 	event = (struct ff_event *) ff_malloc(sizeof(*event));
-	event->pending_fibers = ff_stack_create();
+	ff_fiber_wait_queue_initialize(&event->pending_fibers);
 	event->event_type = event_type;
 	event->is_set = 0;
 
@@ -43,32 +42,34 @@ struct ff_event *ff_event_create(enum ff_event_type event_type)
 
 void ff_event_delete(struct ff_event *event)
 {
-	ff_stack_delete(event->pending_fibers);
+	ff_assert(ff_fiber_wait_queue_is_empty(&event->pending_fibers));
+
 	ff_free(event);
 }
 
-void ff_event_set(struct ff_event *event)
+/**
+ * Sets the event and returns the last fiber, which has been woken up by the event,
+ * or NULL if there were no waiting fibers.
+ */
+static struct ff_fiber *set_event(struct ff_event *event)
 {
+	struct ff_fiber *woken_fiber = NULL;
+
 	if (!event->is_set)
 	{
-		struct ff_stack *pending_fibers;
-
-		pending_fibers = event->pending_fibers;
 		for (;;)
 		{
 			struct ff_fiber *fiber;
-			int is_empty;
 
-			is_empty = ff_stack_is_empty(pending_fibers);
-			if (is_empty)
+			fiber = ff_fiber_wait_queue_pop(&event->pending_fibers);
+			if (fiber == NULL)
 			{
 				event->is_set = 1;
 				break;
 			}
 
-			ff_stack_top(pending_fibers, (const void **) &fiber);
-			ff_stack_pop(pending_fibers);
 			ff_core_schedule_fiber(fiber);
+			woken_fiber = fiber;
 			if (event->event_type == FF_EVENT_AUTO)
 			{
 				/* there is no need to set the event in this case,
@@ -78,6 +79,23 @@ void ff_event_set(struct ff_event *event)
 			}
 		}
 	}
+	return woken_fiber;
+}
+
+void ff_event_set(struct ff_event *event)
+{
+	set_event(event);
+}
+
+void ff_event_set_and_switch(struct ff_event *event)
+{
+	struct ff_fiber *woken_fiber;
+
+	woken_fiber = set_event(event);
+	if (woken_fiber != NULL)
+	{
+		ff_fiber_switch_to(woken_fiber);
+	}
 }
 
 void ff_event_reset(struct ff_event *event)
@@ -92,7 +110,7 @@ void ff_event_wait(struct ff_event *event)
 		struct ff_fiber *current_fiber;
 
 		current_fiber = ff_fiber_get_current();
-		ff_stack_push(event->pending_fibers, current_fiber);
+		ff_fiber_wait_queue_push(&event->pending_fibers, current_fiber);
 		ff_core_yield_fiber();
 		/* the event can be already reset (event->is_set == 0) at this moment:
 		 * f1: ff_event_reset(); // event->is_set = 0;
@@ -123,10 +141,20 @@ enum ff_result ff_event_wait_with_timeout(struct ff_event *event, int timeout)
 		struct ff_core_timeout_operation_data *timeout_operation_data;
 
 		current_fiber = ff_fiber_get_current();
-		ff_stack_push(event->pending_fibers, current_fiber);
-		timeout_operation_data = ff_core_register_timeout_operation(timeout, cancel_event_wait, event);
-		ff_core_yield_fiber();
-		result = ff_core_deregister_timeout_operation(timeout_operation_data);
+		result = ff_fiber_begin_cancellable_operation(cancel_event_wait, event);
+		if (result == FF_SUCCESS)
+		{
+			ff_fiber_wait_queue_push(&event->pending_fibers, current_fiber);
+			timeout_operation_data = ff_core_register_timeout_operation(timeout, cancel_event_wait, event);
+			ff_core_yield_fiber();
+			ff_fiber_end_cancellable_operation();
+			result = ff_core_deregister_timeout_operation(timeout_operation_data);
+		}
+		if (ff_fiber_is_cancelled(current_fiber))
+		{
+			ff_log_debug(L"the fiber=%p has been cancelled while waiting for the event=%p", current_fiber, event);
+			result = FF_FAILURE;
+		}
 		/* the event can be already reset (event->is_set == 0) at this moment:
 		 * f1: ff_event_reset(); // event->is_set = 0;
 		 * f2: enter ff_event_wait(); // f2 has been blocked
@@ -4,9 +4,43 @@
 #include "private/ff_event.h"
 #include "private/ff_core.h"
 #include "private/arch/ff_arch_fiber.h"
+#include "private/arch/ff_arch_misc.h"
+#include "private/arch/ff_arch_mutex.h"
 
 #define DEFAULT_FIBER_STACK_SIZE 0x10000
 
+/**
+ * the stack size of the smallest size class in the fiber cache.
+ * Each next size class has twice bigger stack size than the previous one.
+ */
+#define MIN_CACHED_STACK_SIZE 0x4000
+
+/**
+ * the number of size classes in the fiber cache.
+ * Fibers with stacks bigger than the largest size class aren't cached.
+ */
+#define STACK_SIZE_CLASSES_CNT 7
+
+/**
+ * the size class for fibers with the shared stack.
+ */
+#define SHARED_STACK_SIZE_CLASS STACK_SIZE_CLASSES_CNT
+
+/**
+ * the maximum number of cached fibers per size class.
+ */
+#define MAX_CACHED_FIBERS_CNT 1024
+
+/**
+ * the interval in milliseconds, after which stacks of idle cached fibers are trimmed.
+ */
+#define IDLE_STACK_TRIM_INTERVAL 10000
+
+/**
+ * the initial number of entries in the stack profiler's statistics.
+ */
+#define INITIAL_STACK_USAGES_CAPACITY 16
+
 struct ff_fiber
 {
 	/* context, which will be passed to the func */
@@ -20,10 +54,146 @@ struct ff_fiber
 
 	/* platform-specific fiber */
 	struct ff_arch_fiber *arch_fiber;
+
+	/* the link to the next fiber in the scheduler's run queue */
+	struct ff_fiber *run_queue_link;
+
+	/* the wait queue, which contains the blocked fiber, or NULL */
+	struct ff_fiber_wait_queue *wait_queue;
+
+	/* links to neighbour fibers in the wait_queue */
+	struct ff_fiber *wait_queue_next;
+	struct ff_fiber *wait_queue_prev;
+
+	/* the link to the next fiber in the fiber cache or in the list of fibers
+	 * waiting for the shared stack.
+	 */
+	struct ff_fiber *cache_link;
+
+	/* the time when the fiber was put into the fiber cache */
+	int64_t cached_time;
+
+	/* the size class of the fiber's stack or -1 if the fiber cannot be cached */
+	int stack_size_class;
+
+	/* is set while the fiber_func is executed */
+	int is_running;
+
+	/* is set if the stack of the cached fiber was trimmed */
+	int is_stack_trimmed;
+
+	/* is set if the stack was painted for the stack profiler at the ff_fiber_start() */
+	int is_stack_profiled;
+
+	/* the stack size of the fiber or 0 for fibers with shared stack */
+	int stack_size;
+
+	/* the priority class, which selects the scheduler's run queue for the fiber */
+	enum ff_fiber_priority priority;
+
+	/* the function, which aborts the cancellable operation the fiber is blocked in, or NULL */
+	ff_fiber_cancel_func cancel_func;
+
+	/* context, which will be passed to the cancel_func */
+	void *cancel_ctx;
+
+	/* is set by the ff_fiber_cancel() */
+	int is_cancelled;
 };
 
-static struct ff_fiber main_fiber;
-static struct ff_fiber *current_fiber = NULL;
+/**
+ * the stack profiler state shared among all the scheduler threads.
+ */
+struct stack_profiler
+{
+	struct ff_arch_mutex *mutex;
+	struct ff_fiber_stack_usage *stack_usages;
+	int stack_usages_cnt;
+	int stack_usages_capacity;
+	int is_enabled;
+};
+
+/**
+ * cache of deleted fibers, which aren't running, so they can be reused without
+ * allocating the fiber, its stop_event and its stack.
+ * Each size class contains fibers ordered by cached_time from the newest to the oldest.
+ */
+struct fiber_cache
+{
+	struct ff_fiber *fibers[STACK_SIZE_CLASSES_CNT + 1];
+	int fibers_cnt[STACK_SIZE_CLASSES_CNT + 1];
+	int64_t last_trim_time;
+};
+
+static FF_THREAD_LOCAL struct ff_fiber main_fiber;
+static FF_THREAD_LOCAL struct ff_fiber *current_fiber = NULL;
+static FF_THREAD_LOCAL struct fiber_cache fiber_cache;
+
+/**
+ * fibers, which cannot run until the pinned fiber occupying the shared stack unpins it.
+ * Each thread has a single shared stack, so all the waiters wait for the same stack.
+ */
+static FF_THREAD_LOCAL struct ff_fiber *shared_stack_waiters = NULL;
+
+static struct stack_profiler stack_profiler;
+
+/**
+ * Records the peak stack usage of the given fiber, which has finished its fiber_func.
+ */
+static void record_stack_usage(struct ff_fiber *fiber)
+{
+	struct ff_fiber_stack_usage *stack_usage;
+	int fiber_stack_usage;
+	int i;
+
+	fiber_stack_usage = ff_arch_fiber_get_stack_usage(fiber->arch_fiber);
+
+	ff_arch_mutex_lock(stack_profiler.mutex);
+	stack_usage = NULL;
+	for (i = 0; i < stack_profiler.stack_usages_cnt; i++)
+	{
+		if (stack_profiler.stack_usages[i].fiber_func == fiber->func)
+		{
+			stack_usage = &stack_profiler.stack_usages[i];
+			break;
+		}
+	}
+	if (stack_usage == NULL)
+	{
+		if (stack_profiler.stack_usages_cnt == stack_profiler.stack_usages_capacity)
+		{
+			struct ff_fiber_stack_usage *stack_usages;
+			int capacity;
+
+			capacity = stack_profiler.stack_usages_capacity * 2;
+			if (capacity == 0)
+			{
+				capacity = INITIAL_STACK_USAGES_CAPACITY;
+			}
+			stack_usages = (struct ff_fiber_stack_usage *) ff_calloc(capacity, sizeof(stack_usages[0]));
+			if (stack_profiler.stack_usages != NULL)
+			{
+				memcpy(stack_usages, stack_profiler.stack_usages, stack_profiler.stack_usages_cnt * sizeof(stack_usages[0]));
+				ff_free(stack_profiler.stack_usages);
+			}
+			stack_profiler.stack_usages = stack_usages;
+			stack_profiler.stack_usages_capacity = capacity;
+		}
+		stack_usage = &stack_profiler.stack_usages[stack_profiler.stack_usages_cnt];
+		stack_profiler.stack_usages_cnt++;
+		stack_usage->fiber_func = fiber->func;
+	}
+	stack_usage->fibers_cnt++;
+	if (fiber_stack_usage > stack_usage->max_stack_usage)
+	{
+		stack_usage->max_stack_usage = fiber_stack_usage;
+	}
+	if (fiber->stack_size > stack_usage->max_stack_size)
+	{
+		stack_usage->max_stack_size = fiber->stack_size;
+	}
+	ff_arch_mutex_unlock(stack_profiler.mutex);
+}
 
 /**
  * @private
@@ -34,10 +204,138 @@ static void generic_arch_fiber_func(void *ctx)
 	struct ff_fiber *fiber;
 
 	fiber = (struct ff_fiber *) ctx;
-	fiber->func(fiber->ctx);
-	ff_event_set(fiber->stop_event);
-	ff_core_yield_fiber();
-	ff_assert(0);
+	for (;;)
+	{
+		fiber->func(fiber->ctx);
+		if (fiber->is_stack_profiled)
+		{
+			record_stack_usage(fiber);
+			fiber->is_stack_profiled = 0;
+		}
+		fiber->is_running = 0;
+		ff_event_set(fiber->stop_event);
+		/* the fiber is resumed here only after it is reused from the fiber cache */
+		ff_core_yield_fiber();
+		ff_assert(fiber->is_running);
+	}
+}
+
+static int get_stack_size_class(int stack_size)
+{
+	int stack_size_class;
+	int class_stack_size;
+
+	stack_size_class = 0;
+	class_stack_size = MIN_CACHED_STACK_SIZE;
+	while (class_stack_size < stack_size)
+	{
+		stack_size_class++;
+		if (stack_size_class == STACK_SIZE_CLASSES_CNT)
+		{
+			return -1;
+		}
+		class_stack_size <<= 1;
+	}
+	return stack_size_class;
+}
+
+static void delete_fiber(struct ff_fiber *fiber)
+{
+	ff_arch_fiber_delete(fiber->arch_fiber);
+	ff_event_delete(fiber->stop_event);
+	ff_free(fiber);
+}
+
+/**
+ * Returns memory occupied by stacks of fibers, which stay in the fiber cache
+ * for longer than IDLE_STACK_TRIM_INTERVAL, to the OS.
+ */
+static void trim_idle_stacks(int64_t current_time)
+{
+	int stack_size_class;
+
+	if (current_time - fiber_cache.last_trim_time < IDLE_STACK_TRIM_INTERVAL)
+	{
+		return;
+	}
+	fiber_cache.last_trim_time = current_time;
+
+	for (stack_size_class = 0; stack_size_class < STACK_SIZE_CLASSES_CNT + 1; stack_size_class++)
+	{
+		struct ff_fiber *fiber;
+
+		fiber = fiber_cache.fibers[stack_size_class];
+		while (fiber != NULL && current_time - fiber->cached_time < IDLE_STACK_TRIM_INTERVAL)
+		{
+			fiber = fiber->cache_link;
+		}
+		/* older fibers have been already trimmed if the current fiber is trimmed */
+		while (fiber != NULL && !fiber->is_stack_trimmed)
+		{
+			ff_arch_fiber_trim_stack(fiber->arch_fiber);
+			fiber->is_stack_trimmed = 1;
+			fiber = fiber->cache_link;
+		}
+	}
+}
+
+static struct ff_fiber *acquire_cached_fiber(int stack_size_class)
+{
+	struct ff_fiber *fiber;
+
+	fiber = fiber_cache.fibers[stack_size_class];
+	if (fiber != NULL)
+	{
+		fiber_cache.fibers[stack_size_class] = fiber->cache_link;
+		fiber_cache.fibers_cnt[stack_size_class]--;
+		ff_assert(fiber_cache.fibers_cnt[stack_size_class] >= 0);
+		fiber->cache_link = NULL;
+		ff_event_reset(fiber->stop_event);
+	}
+	return fiber;
+}
+
+/**
+ * Puts the given fiber into the fiber cache.
+ * Returns 0 if the fiber cannot be cached.
+ */
+static int release_fiber_to_cache(struct ff_fiber *fiber)
+{
+	int stack_size_class;
+	int64_t current_time;
+
+	stack_size_class = fiber->stack_size_class;
+	if (fiber->is_running || stack_size_class == -1 || fiber_cache.fibers_cnt[stack_size_class] >= MAX_CACHED_FIBERS_CNT)
+	{
+		return 0;
+	}
+
+	current_time = ff_core_now_ns() / (1000 * 1000);
+	fiber->ctx = NULL;
+	fiber->func = NULL;
+	fiber->cached_time = current_time;
+	fiber->is_stack_trimmed = 0;
+	fiber->cache_link = fiber_cache.fibers[stack_size_class];
+	fiber_cache.fibers[stack_size_class] = fiber;
+	fiber_cache.fibers_cnt[stack_size_class]++;
+	trim_idle_stacks(current_time);
+	return 1;
+}
+
+static void delete_cached_fibers()
+{
+	int stack_size_class;
+
+	for (stack_size_class = 0; stack_size_class < STACK_SIZE_CLASSES_CNT + 1; stack_size_class++)
+	{
+		struct ff_fiber *fiber;
+
+		while ((fiber = acquire_cached_fiber(stack_size_class)) != NULL)
+		{
+			delete_fiber(fiber);
+		}
+		ff_assert(fiber_cache.fibers_cnt[stack_size_class] == 0);
+	}
 }
 
 void ff_fiber_initialize()
@@ -47,13 +345,31 @@ void ff_fiber_initialize()
 	main_fiber.func = NULL;
 	main_fiber.stop_event = NULL;
 	main_fiber.arch_fiber = ff_arch_fiber_initialize();
+	main_fiber.run_queue_link = NULL;
+	main_fiber.wait_queue = NULL;
+	main_fiber.wait_queue_next = NULL;
+	main_fiber.wait_queue_prev = NULL;
+	main_fiber.cache_link = NULL;
+	main_fiber.stack_size_class = -1;
+	main_fiber.is_running = 1;
+	main_fiber.is_stack_trimmed = 0;
+	main_fiber.is_stack_profiled = 0;
+	main_fiber.stack_size = 0;
+	main_fiber.priority = FF_FIBER_PRIORITY_NORMAL;
+	main_fiber.cancel_func = NULL;
+	main_fiber.cancel_ctx = NULL;
+	main_fiber.is_cancelled = 0;
 	current_fiber = &main_fiber;
+	memset(&fiber_cache, 0, sizeof(fiber_cache));
+	fiber_cache.last_trim_time = ff_arch_misc_get_monotonic_time_ns() / (1000 * 1000);
 }
 
 void ff_fiber_shutdown()
 {
 	ff_assert(current_fiber == &main_fiber);
+	ff_assert(shared_stack_waiters == NULL);
 
+	delete_cached_fibers();
 	ff_arch_fiber_shutdown(main_fiber.arch_fiber);
 	current_fiber = NULL;
 }
@@ -62,39 +378,100 @@ void ff_fiber_switch(struct ff_fiber *fiber)
 {
 	if (fiber != current_fiber)
 	{
+		ff_assert(ff_arch_fiber_is_stack_available(fiber->arch_fiber));
 		current_fiber = fiber;
 		ff_arch_fiber_switch(fiber->arch_fiber);
 	}
 }
 
+int ff_fiber_park_if_stack_unavailable(struct ff_fiber *fiber)
+{
+	int is_stack_available;
+
+	is_stack_available = ff_arch_fiber_is_stack_available(fiber->arch_fiber);
+	if (!is_stack_available)
+	{
+		/* the fiber will be rescheduled by the ff_fiber_unpin_stack(), which releases the shared stack */
+		ff_assert(fiber->cache_link == NULL);
+		fiber->cache_link = shared_stack_waiters;
+		shared_stack_waiters = fiber;
+	}
+	return !is_stack_available;
+}
+
 struct ff_fiber *ff_fiber_create(ff_fiber_func fiber_func, int stack_size)
 {
 	struct ff_fiber *fiber;
+	int stack_size_class;
 
-	ff_assert(stack_size >= 0);
+	ff_assert(stack_size >= 0 || stack_size == FF_FIBER_SHARED_STACK);
 
 	if (stack_size == 0)
 	{
 		stack_size = DEFAULT_FIBER_STACK_SIZE;
 	}
 
+	stack_size_class = (stack_size == FF_FIBER_SHARED_STACK) ? SHARED_STACK_SIZE_CLASS : get_stack_size_class(stack_size);
+	if (stack_size_class != -1)
+	{
+		fiber = acquire_cached_fiber(stack_size_class);
+		if (fiber != NULL)
+		{
+			fiber->func = fiber_func;
+			fiber->priority = FF_FIBER_PRIORITY_NORMAL;
+			fiber->is_cancelled = 0;
+			return fiber;
+		}
+		if (stack_size_class != SHARED_STACK_SIZE_CLASS)
+		{
+			/* round up the stack size, so the fiber can be reused for any stack size from its size class */
+			stack_size = MIN_CACHED_STACK_SIZE << stack_size_class;
+		}
+	}
+
 	fiber = (struct ff_fiber *) ff_malloc(sizeof(*fiber));
 	fiber->ctx = NULL;
 	fiber->func = fiber_func;
 	fiber->stop_event = ff_event_create(FF_EVENT_MANUAL);
-	fiber->arch_fiber = ff_arch_fiber_create(generic_arch_fiber_func, fiber, stack_size);
+	if (stack_size_class == SHARED_STACK_SIZE_CLASS)
+	{
+		fiber->arch_fiber = ff_arch_fiber_create_with_shared_stack(generic_arch_fiber_func, fiber);
+	}
+	else
+	{
+		fiber->arch_fiber = ff_arch_fiber_create(generic_arch_fiber_func, fiber, stack_size);
+	}
+	fiber->run_queue_link = NULL;
+	fiber->wait_queue = NULL;
+	fiber->wait_queue_next = NULL;
+	fiber->wait_queue_prev = NULL;
+	fiber->cache_link = NULL;
+	fiber->cached_time = 0;
+	fiber->stack_size_class = stack_size_class;
+	fiber->is_running = 0;
+	fiber->is_stack_trimmed = 0;
+	fiber->is_stack_profiled = 0;
+	fiber->stack_size = (stack_size_class == SHARED_STACK_SIZE_CLASS) ? 0 : stack_size;
+	fiber->priority = FF_FIBER_PRIORITY_NORMAL;
+	fiber->cancel_func = NULL;
+	fiber->cancel_ctx = NULL;
+	fiber->is_cancelled = 0;
 
 	return fiber;
 }
 
 void ff_fiber_delete(struct ff_fiber *fiber)
 {
+	int is_cached;
+
 	ff_assert(fiber != current_fiber);
 	ff_assert(fiber != &main_fiber);
 
-	ff_arch_fiber_delete(fiber->arch_fiber);
-	ff_event_delete(fiber->stop_event);
-	ff_free(fiber);
+	is_cached = release_fiber_to_cache(fiber);
+	if (!is_cached)
+	{
+		delete_fiber(fiber);
+	}
 }
 
 void ff_fiber_start(struct ff_fiber *fiber, void *ctx)
@@ -102,7 +479,15 @@ void ff_fiber_start(struct ff_fiber *fiber, void *ctx)
 	ff_assert(fiber != current_fiber);
 	ff_assert(fiber != &main_fiber);
 
+	ff_assert(!fiber->is_running);
+
+	if (stack_profiler.is_enabled)
+	{
+		fiber->is_stack_profiled = ff_arch_fiber_paint_stack(fiber->arch_fiber);
+	}
 	fiber->ctx = ctx;
+	fiber->is_running = 1;
+	fiber->is_cancelled = 0;
 	ff_core_schedule_fiber(fiber);
 }
 
@@ -118,3 +503,262 @@ struct ff_fiber *ff_fiber_get_current()
 {
 	return current_fiber;
 }
+
+void ff_fiber_switch_to(struct ff_fiber *fiber)
+{
+	ff_assert(fiber != current_fiber);
+
+	ff_core_switch_to_fiber(fiber);
+}
+
+void ff_fiber_initialize_stack_profiler()
+{
+	const char *profiler_env;
+
+	ff_assert(stack_profiler.mutex == NULL);
+
+	stack_profiler.mutex = ff_arch_mutex_create();
+	stack_profiler.stack_usages = NULL;
+	stack_profiler.stack_usages_cnt = 0;
+	stack_profiler.stack_usages_capacity = 0;
+	profiler_env = getenv("FF_STACK_PROFILER");
+	stack_profiler.is_enabled = (profiler_env != NULL && strcmp(profiler_env, "1") == 0);
+}
+
+void ff_fiber_shutdown_stack_profiler()
+{
+	ff_assert(stack_profiler.mutex != NULL);
+
+	ff_fiber_log_stack_usages();
+	ff_arch_mutex_delete(stack_profiler.mutex);
+	if (stack_profiler.stack_usages != NULL)
+	{
+		ff_free(stack_profiler.stack_usages);
+	}
+	memset(&stack_profiler, 0, sizeof(stack_profiler));
+}
+
+void ff_fiber_enable_stack_profiler(int is_enabled)
+{
+	ff_assert(stack_profiler.mutex != NULL);
+
+	stack_profiler.is_enabled = is_enabled;
+}
+
+int ff_fiber_get_stack_usages(struct ff_fiber_stack_usage *stack_usages, int max_stack_usages_cnt)
+{
+	int stack_usages_cnt;
+
+	ff_assert(max_stack_usages_cnt >= 0);
+	ff_assert(stack_profiler.mutex != NULL);
+
+	ff_arch_mutex_lock(stack_profiler.mutex);
+	stack_usages_cnt = stack_profiler.stack_usages_cnt;
+	if (max_stack_usages_cnt > stack_usages_cnt)
+	{
+		max_stack_usages_cnt = stack_usages_cnt;
+	}
+	if (max_stack_usages_cnt > 0)
+	{
+		memcpy(stack_usages, stack_profiler.stack_usages, max_stack_usages_cnt * sizeof(stack_usages[0]));
+	}
+	ff_arch_mutex_unlock(stack_profiler.mutex);
+
+	return stack_usages_cnt;
+}
+
+void ff_fiber_log_stack_usages()
+{
+	int i;
+
+	ff_assert(stack_profiler.mutex != NULL);
+
+	ff_arch_mutex_lock(stack_profiler.mutex);
+	for (i = 0; i < stack_profiler.stack_usages_cnt; i++)
+	{
+		struct ff_fiber_stack_usage *stack_usage;
+
+		stack_usage = &stack_profiler.stack_usages[i];
+		ff_log_info(L"stack usage: fiber_func=%p, fibers_cnt=%d, max_stack_usage=%d, max_stack_size=%d",
+			(void *) stack_usage->fiber_func, stack_usage->fibers_cnt, stack_usage->max_stack_usage, stack_usage->max_stack_size);
+	}
+	ff_arch_mutex_unlock(stack_profiler.mutex);
+}
+
+int ff_fiber_has_shared_stack(struct ff_fiber *fiber)
+{
+	int has_shared_stack;
+
+	has_shared_stack = ff_arch_fiber_has_shared_stack(fiber->arch_fiber);
+	return has_shared_stack;
+}
+
+void ff_fiber_pin_stack(struct ff_fiber *fiber)
+{
+	ff_arch_fiber_pin_stack(fiber->arch_fiber);
+}
+
+void ff_fiber_unpin_stack(struct ff_fiber *fiber)
+{
+	ff_arch_fiber_unpin_stack(fiber->arch_fiber);
+	if (!ff_arch_fiber_has_shared_stack(fiber->arch_fiber) || shared_stack_waiters == NULL ||
+		!ff_arch_fiber_is_stack_available(shared_stack_waiters->arch_fiber))
+	{
+		/* the shared stack is still occupied by the pinned fiber */
+		return;
+	}
+	while (shared_stack_waiters != NULL)
+	{
+		struct ff_fiber *waiter;
+
+		/* waiters re-check the shared stack availability when they are switched to */
+		waiter = shared_stack_waiters;
+		shared_stack_waiters = waiter->cache_link;
+		waiter->cache_link = NULL;
+		ff_core_schedule_fiber(waiter);
+	}
+}
+
+void ff_fiber_set_priority(struct ff_fiber *fiber, enum ff_fiber_priority priority)
+{
+	ff_assert(priority >= FF_FIBER_PRIORITY_HIGH);
+	ff_assert(priority < FF_FIBER_PRIORITIES_CNT);
+
+	fiber->priority = priority;
+}
+
+enum ff_fiber_priority ff_fiber_get_priority(struct ff_fiber *fiber)
+{
+	return fiber->priority;
+}
+
+void ff_fiber_cancel(struct ff_fiber *fiber)
+{
+	if (!fiber->is_cancelled)
+	{
+		ff_fiber_cancel_func cancel_func;
+
+		fiber->is_cancelled = 1;
+		cancel_func = fiber->cancel_func;
+		if (cancel_func != NULL)
+		{
+			/* the cancel_func wakes up the fiber, so it mustn't be called twice */
+			fiber->cancel_func = NULL;
+			cancel_func(fiber, fiber->cancel_ctx);
+		}
+	}
+}
+
+int ff_fiber_is_cancelled(struct ff_fiber *fiber)
+{
+	return fiber->is_cancelled;
+}
+
+enum ff_result ff_fiber_begin_cancellable_operation(ff_fiber_cancel_func cancel_func, void *ctx)
+{
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(current_fiber->cancel_func == NULL);
+
+	if (!current_fiber->is_cancelled)
+	{
+		current_fiber->cancel_func = cancel_func;
+		current_fiber->cancel_ctx = ctx;
+		result = FF_SUCCESS;
+	}
+	return result;
+}
+
+void ff_fiber_end_cancellable_operation()
+{
+	current_fiber->cancel_func = NULL;
+	current_fiber->cancel_ctx = NULL;
+}
+
+void ff_fiber_reset_cancellation(struct ff_fiber *fiber)
+{
+	ff_assert(fiber->cancel_func == NULL);
+
+	fiber->is_cancelled = 0;
+}
+
+ff_fiber_func ff_fiber_get_func(struct ff_fiber *fiber)
+{
+	return fiber->func;
+}
+
+struct ff_fiber **ff_fiber_get_run_queue_link(struct ff_fiber *fiber)
+{
+	return &fiber->run_queue_link;
+}
+
+void ff_fiber_wait_queue_initialize(struct ff_fiber_wait_queue *queue)
+{
+	queue->head = NULL;
+	queue->tail = NULL;
+}
+
+int ff_fiber_wait_queue_is_empty(struct ff_fiber_wait_queue *queue)
+{
+	return queue->head == NULL;
+}
+
+void ff_fiber_wait_queue_push(struct ff_fiber_wait_queue *queue, struct ff_fiber *fiber)
+{
+	ff_assert(fiber->wait_queue == NULL);
+
+	fiber->wait_queue = queue;
+	fiber->wait_queue_next = NULL;
+	fiber->wait_queue_prev = queue->tail;
+	if (queue->tail != NULL)
+	{
+		queue->tail->wait_queue_next = fiber;
+	}
+	else
+	{
+		queue->head = fiber;
+	}
+	queue->tail = fiber;
+}
+
+enum ff_result ff_fiber_wait_queue_remove(struct ff_fiber_wait_queue *queue, struct ff_fiber *fiber)
+{
+	if (fiber->wait_queue != queue)
+	{
+		/* the fiber has been already removed from the queue */
+		return FF_FAILURE;
+	}
+
+	if (fiber->wait_queue_prev != NULL)
+	{
+		fiber->wait_queue_prev->wait_queue_next = fiber->wait_queue_next;
+	}
+	else
+	{
+		queue->head = fiber->wait_queue_next;
+	}
+	if (fiber->wait_queue_next != NULL)
+	{
+		fiber->wait_queue_next->wait_queue_prev = fiber->wait_queue_prev;
+	}
+	else
+	{
+		queue->tail = fiber->wait_queue_prev;
+	}
+	fiber->wait_queue = NULL;
+	fiber->wait_queue_next = NULL;
+	fiber->wait_queue_prev = NULL;
+	return FF_SUCCESS;
+}
+
+struct ff_fiber *ff_fiber_wait_queue_pop(struct ff_fiber_wait_queue *queue)
+{
+	struct ff_fiber *fiber;
+
+	fiber = queue->head;
+	if (fiber != NULL)
+	{
+		ff_fiber_wait_queue_remove(queue, fiber);
+	}
+	return fiber;
+}
@@ -0,0 +1,220 @@
+#include "private/ff_common.h"
+
+#include "private/ff_fiber_group.h"
+#include "private/ff_core.h"
+#include "private/ff_event.h"
+#include "private/ff_fiber.h"
+
+struct fiber_group_child
+{
+	/* the task, which runs the child in the fiberpool */
+	struct ff_fiberpool_task task;
+	struct ff_fiber_group *group;
+	ff_fiber_group_func func;
+	void *ctx;
+	/* the fiber, which executes the func, or NULL if the child isn't started yet */
+	struct ff_fiber *fiber;
+	/* the link in the list of active children or in the list of free children */
+	struct fiber_group_child *next;
+	struct fiber_group_child **prev_ptr;
+};
+
+struct ff_fiber_group
+{
+	/* the list of spawned children, which aren't completed yet */
+	struct fiber_group_child *active_children;
+	/* completed children, which are reused by subsequent spawns */
+	struct fiber_group_child *free_children;
+	/* the event, which is set when completed_cnt reaches the wait_cnt */
+	struct ff_event *wait_event;
+	int spawned_cnt;
+	int completed_cnt;
+	/* the number of completed children, which is awaited by the waiting fiber, or 0 */
+	int wait_cnt;
+	int is_cancelled;
+};
+
+static void complete_child(struct fiber_group_child *child)
+{
+	struct ff_fiber_group *group;
+
+	group = child->group;
+	*child->prev_ptr = child->next;
+	if (child->next != NULL)
+	{
+		child->next->prev_ptr = child->prev_ptr;
+	}
+	child->fiber = NULL;
+	child->prev_ptr = NULL;
+	child->next = group->free_children;
+	group->free_children = child;
+
+	group->completed_cnt++;
+	ff_assert(group->completed_cnt <= group->spawned_cnt);
+	if (group->completed_cnt == group->wait_cnt)
+	{
+		/* the group can be deleted by the waiting fiber after this call */
+		ff_event_set(group->wait_event);
+	}
+}
+
+static void child_fiberpool_func(void *ctx)
+{
+	struct fiber_group_child *child;
+	struct ff_fiber *current_fiber;
+
+	child = (struct fiber_group_child *) ctx;
+	current_fiber = ff_fiber_get_current();
+	child->fiber = current_fiber;
+	if (child->group->is_cancelled)
+	{
+		ff_fiber_cancel(current_fiber);
+	}
+	child->func(child->ctx);
+	/* the fiber returns to the fiberpool, where it will execute other tasks */
+	ff_fiber_reset_cancellation(current_fiber);
+	complete_child(child);
+}
+
+static enum ff_result wait_for_children(struct ff_fiber_group *group, int completed_cnt, int timeout)
+{
+	enum ff_result result = FF_SUCCESS;
+
+	ff_assert(completed_cnt >= 0);
+	ff_assert(completed_cnt <= group->spawned_cnt);
+	ff_assert(group->wait_cnt == 0);
+
+	if (group->completed_cnt < completed_cnt)
+	{
+		group->wait_cnt = completed_cnt;
+		/* the event can remain set after the previous wait has been timed out */
+		ff_event_reset(group->wait_event);
+		if (timeout > 0)
+		{
+			result = ff_event_wait_with_timeout(group->wait_event, timeout);
+		}
+		else
+		{
+			ff_event_wait(group->wait_event);
+		}
+		group->wait_cnt = 0;
+		ff_assert(result != FF_SUCCESS || group->completed_cnt >= completed_cnt);
+	}
+	return result;
+}
+
+struct ff_fiber_group *ff_fiber_group_create()
+{
+	struct ff_fiber_group *group;
+
+	group = (struct ff_fiber_group *) ff_malloc(sizeof(*group));
+	group->active_children = NULL;
+	group->free_children = NULL;
+	group->wait_event = ff_event_create(FF_EVENT_AUTO);
+	group->spawned_cnt = 0;
+	group->completed_cnt = 0;
+	group->wait_cnt = 0;
+	group->is_cancelled = 0;
+
+	return group;
+}
+
+void ff_fiber_group_delete(struct ff_fiber_group *group)
+{
+	struct fiber_group_child *child;
+
+	ff_assert(group->active_children == NULL);
+	ff_assert(group->completed_cnt == group->spawned_cnt);
+	ff_assert(group->wait_cnt == 0);
+
+	child = group->free_children;
+	while (child != NULL)
+	{
+		struct fiber_group_child *next_child;
+
+		next_child = child->next;
+		ff_free(child);
+		child = next_child;
+	}
+	ff_event_delete(group->wait_event);
+	ff_free(group);
+}
+
+void ff_fiber_group_spawn(struct ff_fiber_group *group, ff_fiber_group_func func, void *ctx)
+{
+	struct fiber_group_child *child;
+	struct ff_fiber *current_fiber;
+
+	child = group->free_children;
+	if (child != NULL)
+	{
+		group->free_children = child->next;
+	}
+	else
+	{
+		child = (struct fiber_group_child *) ff_malloc(sizeof(*child));
+		child->task.func = child_fiberpool_func;
+		child->task.ctx = child;
+		child->task.is_allocated = 0;
+		child->group = group;
+	}
+	current_fiber = ff_fiber_get_current();
+	child->task.priority = ff_fiber_get_priority(current_fiber);
+	child->func = func;
+	child->ctx = ctx;
+	child->fiber = NULL;
+	child->next = group->active_children;
+	child->prev_ptr = &group->active_children;
+	if (group->active_children != NULL)
+	{
+		group->active_children->prev_ptr = &child->next;
+	}
+	group->active_children = child;
+	group->spawned_cnt++;
+
+	ff_core_fiberpool_execute_task(&child->task);
+}
+
+void ff_fiber_group_wait(struct ff_fiber_group *group)
+{
+	wait_for_children(group, group->spawned_cnt, 0);
+}
+
+void ff_fiber_group_wait_first(struct ff_fiber_group *group, int completed_cnt)
+{
+	wait_for_children(group, completed_cnt, 0);
+}
+
+enum ff_result ff_fiber_group_wait_first_with_timeout(struct ff_fiber_group *group, int completed_cnt, int timeout)
+{
+	enum ff_result result;
+
+	ff_assert(timeout > 0);
+
+	result = wait_for_children(group, completed_cnt, timeout);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"the group=%p has completed only %d children instead of %d during the timeout=%d", group, group->completed_cnt, completed_cnt, timeout);
+	}
+	return result;
+}
+
+void ff_fiber_group_cancel(struct ff_fiber_group *group)
+{
+	struct fiber_group_child *child;
+
+	group->is_cancelled = 1;
+	/* cancel functions only wake up children, so they cannot modify the list while iterating over it */
+	for (child = group->active_children; child != NULL; child = child->next)
+	{
+		if (child->fiber != NULL)
+		{
+			ff_fiber_cancel(child->fiber);
+		}
+	}
+}
+
+int ff_fiber_group_get_completed_cnt(struct ff_fiber_group *group)
+{
+	return group->completed_cnt;
+}
@@ -1,58 +1,76 @@
 #include "private/ff_common.h"
 
 #include "private/ff_fiberpool.h"
-#include "private/ff_blocking_stack.h"
+#include "private/ff_semaphore.h"
 #include "private/ff_fiber.h"
 
 struct ff_fiberpool
 {
-	struct ff_blocking_stack *pending_tasks;
+	/* the stack of pending tasks linked via their next fields, so pushing the task
+	 * doesn't allocate memory.
+	 */
+	struct ff_fiberpool_task *pending_tasks;
+	/* the number of pending tasks, which are waited for by idle worker fibers */
+	struct ff_semaphore *pending_tasks_semaphore;
+	/* limits the number of pending tasks, so producers block when the fiberpool is saturated */
+	struct ff_semaphore *free_slots_semaphore;
+	int is_stopped;
 	struct ff_fiber **fibers;
 	int max_fibers_cnt;
 	int running_fibers_cnt;
 	int busy_fibers_cnt;
 };
 
-struct fiberpool_task
-{
-	ff_fiberpool_func func;
-	void *ctx;
-};
-
 static void generic_fiberpool_func(void *ctx)
 {
 	struct ff_fiberpool *fiberpool;
-	struct ff_blocking_stack *pending_tasks;
+	struct ff_fiber *current_fiber;
 
 	fiberpool = (struct ff_fiberpool *) ctx;
-	pending_tasks = fiberpool->pending_tasks;
+	current_fiber = ff_fiber_get_current();
 	for (;;)
 	{
-		struct fiberpool_task *task;
+		struct ff_fiberpool_task *task;
+		int is_allocated;
 
 		ff_assert(fiberpool->busy_fibers_cnt > 0);
 		ff_assert(fiberpool->busy_fibers_cnt <= fiberpool->running_fibers_cnt);
 		ff_assert(fiberpool->running_fibers_cnt <= fiberpool->max_fibers_cnt);
 
 		fiberpool->busy_fibers_cnt--;
-		ff_blocking_stack_pop(pending_tasks, (const void **) &task);
+		ff_semaphore_down(fiberpool->pending_tasks_semaphore);
+		task = fiberpool->pending_tasks;
 		if (task == NULL)
 		{
+			/* the fiberpool is stopped and there are no pending tasks */
+			ff_assert(fiberpool->is_stopped);
 			break;
 		}
+		fiberpool->pending_tasks = task->next;
+		task->next = NULL;
+		ff_semaphore_up(fiberpool->free_slots_semaphore);
 		fiberpool->busy_fibers_cnt++;
 
+		/* the task can be freed by its func if it is owned by the caller */
+		is_allocated = task->is_allocated;
+		ff_fiber_set_priority(current_fiber, task->priority);
 		task->func(task->ctx);
-		ff_free(task);
+		ff_fiber_set_priority(current_fiber, FF_FIBER_PRIORITY_NORMAL);
+		if (is_allocated)
+		{
+			ff_free(task);
+		}
 	}
 	fiberpool->running_fibers_cnt--;
 }
 
-static void add_worker_fiber(struct ff_fiberpool *fiberpool)
+static void add_worker_fiber(struct ff_fiberpool *fiberpool, enum ff_fiber_priority priority)
 {
 	struct ff_fiber *worker_fiber;
 
 	worker_fiber = ff_fiber_create(generic_fiberpool_func, 0);
+	/* the new worker is scheduled with the priority of the task, which caused its creation */
+	ff_fiber_set_priority(worker_fiber, priority);
 	fiberpool->fibers[fiberpool->running_fibers_cnt] = worker_fiber;
 	fiberpool->running_fibers_cnt++;
 	fiberpool->busy_fibers_cnt++;
@@ -66,7 +84,10 @@ struct ff_fiberpool *ff_fiberpool_create(int max_fibers_cnt)
 	ff_assert(max_fibers_cnt > 0);
 
 	fiberpool = (struct ff_fiberpool *) ff_malloc(sizeof(*fiberpool));
-	fiberpool->pending_tasks = ff_blocking_stack_create(max_fibers_cnt);
+	fiberpool->pending_tasks = NULL;
+	fiberpool->pending_tasks_semaphore = ff_semaphore_create(0);
+	fiberpool->free_slots_semaphore = ff_semaphore_create(max_fibers_cnt);
+	fiberpool->is_stopped = 0;
 	fiberpool->fibers = (struct ff_fiber **) ff_calloc(max_fibers_cnt, sizeof(fiberpool->fibers[0]));
 	fiberpool->max_fibers_cnt = max_fibers_cnt;
 	fiberpool->running_fibers_cnt = 0;
@@ -77,16 +98,16 @@ struct ff_fiberpool *ff_fiberpool_create(int max_fibers_cnt)
 
 void ff_fiberpool_delete(struct ff_fiberpool *fiberpool)
 {
-	struct ff_blocking_stack *pending_tasks;
 	struct ff_fiber **fibers;
 	int i;
 	int running_fibers_cnt;
 
-	pending_tasks = fiberpool->pending_tasks;
+	/* worker fibers exit after all the pending tasks are executed */
+	fiberpool->is_stopped = 1;
 	running_fibers_cnt = fiberpool->running_fibers_cnt;
 	for (i = 0; i < running_fibers_cnt; i++)
 	{
-		ff_blocking_stack_push(pending_tasks, NULL);
+		ff_semaphore_up(fiberpool->pending_tasks_semaphore);
 	}
 	fibers = fiberpool->fibers;
 	for (i = 0; i < running_fibers_cnt; i++)
@@ -99,30 +120,52 @@ void ff_fiberpool_delete(struct ff_fiberpool *fiberpool)
 	}
 	ff_assert(fiberpool->busy_fibers_cnt == 0);
 	ff_assert(fiberpool->running_fibers_cnt == 0);
+	ff_assert(fiberpool->pending_tasks == NULL);
 
 	ff_free(fibers);
-	ff_blocking_stack_delete(pending_tasks);
+	ff_semaphore_delete(fiberpool->free_slots_semaphore);
+	ff_semaphore_delete(fiberpool->pending_tasks_semaphore);
 	ff_free(fiberpool);
 }
 
 void ff_fiberpool_execute_async(struct ff_fiberpool *fiberpool, ff_fiberpool_func func, void *ctx)
 {
-	struct fiberpool_task *task;
+	ff_fiberpool_execute_async_with_priority(fiberpool, func, ctx, FF_FIBER_PRIORITY_NORMAL);
+}
+
+void ff_fiberpool_execute_async_with_priority(struct ff_fiberpool *fiberpool, ff_fiberpool_func func, void *ctx, enum ff_fiber_priority priority)
+{
+	struct ff_fiberpool_task *task;
+
+	task = (struct ff_fiberpool_task *) ff_malloc(sizeof(*task));
+	task->func = func;
+	task->ctx = ctx;
+	task->priority = priority;
+	task->is_allocated = 1;
+	ff_fiberpool_execute_task(fiberpool, task);
+}
+
+void ff_fiberpool_execute_task(struct ff_fiberpool *fiberpool, struct ff_fiberpool_task *task)
+{
+	enum ff_fiber_priority priority;
 
 	ff_assert(fiberpool->busy_fibers_cnt >= 0);
 	ff_assert(fiberpool->busy_fibers_cnt <= fiberpool->running_fibers_cnt);
 	ff_assert(fiberpool->running_fibers_cnt <= fiberpool->max_fibers_cnt);
 
-	task = (struct fiberpool_task *) ff_malloc(sizeof(*task));
-	task->func = func;
-	task->ctx = ctx;
-	ff_blocking_stack_push(fiberpool->pending_tasks, task);
+	ff_assert(!fiberpool->is_stopped);
+
+	priority = task->priority;
+	ff_semaphore_down(fiberpool->free_slots_semaphore);
+	task->next = fiberpool->pending_tasks;
+	fiberpool->pending_tasks = task;
+	ff_semaphore_up(fiberpool->pending_tasks_semaphore);
 
 	if (fiberpool->running_fibers_cnt < fiberpool->max_fibers_cnt)
 	{
 		if (fiberpool->busy_fibers_cnt == fiberpool->running_fibers_cnt)
 		{
-			add_worker_fiber(fiberpool);
+			add_worker_fiber(fiberpool, priority);
 		}
 	}
 	else
@@ -1,11 +1,14 @@
 #include "private/ff_common.h"
 #include "private/ff_loopback.h"
 #include "private/ff_event.h"
+#include "private/ff_fiber.h"
 
 struct ff_loopback
 {
 	struct ff_event *read_event;
 	struct ff_event *write_event;
+	/* the fiber blocked on the empty loopback or NULL. The ff_loopback_flush() hands off data to it */
+	struct ff_fiber *waiting_reader;
 	char *buffer;
 	char *read_ptr;
 	char *write_ptr;
@@ -22,6 +25,7 @@ struct ff_loopback *ff_loopback_create(int buffer_size)
 	loopback = (struct ff_loopback *) ff_malloc(sizeof(*loopback));
 	loopback->read_event = ff_event_create(FF_EVENT_AUTO);
 	loopback->write_event = ff_event_create(FF_EVENT_AUTO);
+	loopback->waiting_reader = NULL;
 	loopback->buffer = (char *) ff_malloc(buffer_size);
 	loopback->read_ptr = loopback->buffer;
 	loopback->write_ptr = loopback->buffer;
@@ -34,6 +38,7 @@ struct ff_loopback *ff_loopback_create(int buffer_size)
 void ff_loopback_delete(struct ff_loopback *loopback)
 {
 	ff_assert(loopback != NULL);
+	ff_assert(loopback->waiting_reader == NULL);
 
 	ff_free(loopback->buffer);
 	ff_event_delete(loopback->write_event);
@@ -66,7 +71,9 @@ enum ff_result ff_loopback_read(struct ff_loopback *loopback, void *buf, int len
 					ff_log_debug(L"the loopback=%p is disconnected, so it cannot read the rest of len=%d bytes to the buf=%p", loopback, len, buf);
 					goto end;
 				}
+				loopback->waiting_reader = ff_fiber_get_current();
 				ff_event_wait(loopback->read_event);
+				loopback->waiting_reader = NULL;
 				continue;
 			}
 			else if (bytes_left == loopback->buffer_size - 1)
@@ -116,6 +123,7 @@ enum ff_result ff_loopback_write(struct ff_loopback *loopback, const void *buf,
 	{
 		int bytes_written;
 		int bytes_left;
+		int is_empty = 0;
 
 		if (loopback->is_disconnected)
 		{
@@ -136,7 +144,7 @@ enum ff_result ff_loopback_write(struct ff_loopback *loopback, const void *buf,
 		{
 			if (loopback->write_ptr == loopback->read_ptr)
 			{
-				ff_event_set(loopback->read_event);
+				is_empty = 1;
 			}
 			else if (loopback->write_ptr - loopback->read_ptr == loopback->buffer_size - 1)
 			{
@@ -144,8 +152,9 @@ enum ff_result ff_loopback_write(struct ff_loopback *loopback, const void *buf,
 				continue;
 			}
 			bytes_left = loopback->buffer_size - (loopback->write_ptr - loopback->buffer);
-			if (bytes_left == loopback->buffer_size)
+			if (loopback->read_ptr == loopback->buffer)
 			{
+				/* the write_ptr mustn't wrap around to the read_ptr, because this means the empty buffer */
 				bytes_left--;
 			}
 		}
@@ -162,6 +171,14 @@ enum ff_result ff_loopback_write(struct ff_loopback *loopback, const void *buf,
 		{
 			loopback->write_ptr = loopback->buffer;
 		}
+		if (is_empty)
+		{
+			/* the reader can be blocked on the empty buffer. It runs after the writer yields,
+			 * so the writer can fill the buffer in a batch. The ff_loopback_flush() hands off
+			 * the written data to the reader immediately.
+			 */
+			ff_event_set(loopback->read_event);
+		}
 	}
 	result = FF_SUCCESS;
 
@@ -169,6 +186,17 @@ end:
 	return result;
 }
 
+void ff_loopback_flush(struct ff_loopback *loopback)
+{
+	ff_assert(loopback != NULL);
+
+	if (loopback->waiting_reader != NULL && loopback->read_ptr != loopback->write_ptr)
+	{
+		/* the reader has been woken up by the written data, but hasn't run yet */
+		ff_fiber_switch_to(loopback->waiting_reader);
+	}
+}
+
 void ff_loopback_disconnect(struct ff_loopback *loopback)
 {
 	ff_assert(loopback != NULL);
@@ -82,6 +82,13 @@ enum ff_result ff_pipe_write(struct ff_pipe *pipe, const void *buf, int len)
 	return result;
 }
 
+void ff_pipe_flush(struct ff_pipe *pipe)
+{
+	ff_assert(pipe != NULL);
+
+	ff_loopback_flush(pipe->write_loopback);
+}
+
 void ff_pipe_disconnect(struct ff_pipe *pipe)
 {
 	ff_assert(pipe != NULL);
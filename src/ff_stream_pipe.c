@@ -45,9 +45,11 @@ static enum ff_result write_to_pipe(void *ctx, const void *buf, int len)
 
 static enum ff_result flush_pipe(void *ctx)
 {
-	(void)ctx;
+	struct ff_pipe *pipe;
 
-	/* the pipe is automatically flushed, so there is no need in its flushing anymore */
+	/* written data is already visible to the reader, so the flush only hands it off to the reader */
+	pipe = (struct ff_pipe *) ctx;
+	ff_pipe_flush(pipe);
 
 	return FF_SUCCESS;
 }
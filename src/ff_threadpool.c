@@ -1,62 +1,238 @@
 #include "private/ff_common.h"
 
 #include "private/ff_threadpool.h"
-#include "private/arch/ff_arch_completion_port.h"
+#include "private/arch/ff_arch_atomic.h"
+#include "private/arch/ff_arch_futex.h"
 #include "private/arch/ff_arch_thread.h"
-#include "private/arch/ff_arch_misc.h"
 #include "private/arch/ff_arch_mutex.h"
 
 #define THREADPOOL_THREAD_STACK_SIZE 0x10000
 
+/**
+ * the number of cells in the ring of pending tasks. Must be a power of 2.
+ * Tasks, which don't fit the ring, are put into the overflow list.
+ */
+#define TASKS_RING_SIZE 1024
+
+/**
+ * the cell of the bounded multi-producer multi-consumer ring of pending tasks.
+ * The sequence is equal to the position of the cell in the ring if the cell is free for the producer
+ * at this position, and is equal to the position + 1 if the cell contains the task for the consumer
+ * at this position. Positions wrap around, so they are compared only via get_positions_diff().
+ */
+struct task_ring_cell
+{
+	int sequence;
+	struct ff_threadpool_task *task;
+};
+
 struct ff_threadpool
 {
-	struct ff_arch_completion_port *completion_port;
+	struct task_ring_cell *tasks_ring;
+	int enqueue_position;
+	int dequeue_position;
+
+	/* the list of tasks, which didn't fit the ring. It is guarded by the mutex */
+	struct ff_threadpool_task *overflow_head;
+	struct ff_threadpool_task *overflow_tail;
+	int overflow_tasks_cnt;
+
+	/* idle worker threads are parked on the futex until new tasks arrive */
+	struct ff_arch_futex *wakeup_futex;
+	int idle_threads_cnt;
+	int is_stopped;
+
+	/* the mutex guards the overflow list and adding worker threads */
 	struct ff_arch_mutex *mutex;
 	struct ff_arch_thread **threads;
 	int max_threads_cnt;
 	int running_threads_cnt;
-	int busy_threads_cnt;
 };
 
-struct threadpool_task
+static int get_positions_diff(int position1, int position2)
 {
-	ff_threadpool_func func;
-	void *ctx;
-};
+	return (int) ((unsigned int) position1 - (unsigned int) position2);
+}
+
+static int get_next_position(int position, int offset)
+{
+	return (int) ((unsigned int) position + (unsigned int) offset);
+}
+
+static struct task_ring_cell *get_task_ring_cell(struct ff_threadpool *threadpool, int position)
+{
+	return &threadpool->tasks_ring[(unsigned int) position & (TASKS_RING_SIZE - 1)];
+}
+
+static int push_task_to_ring(struct ff_threadpool *threadpool, struct ff_threadpool_task *task)
+{
+	for (;;)
+	{
+		struct task_ring_cell *cell;
+		int position;
+		int diff;
+
+		position = ff_arch_atomic_load_int(&threadpool->enqueue_position);
+		cell = get_task_ring_cell(threadpool, position);
+		diff = get_positions_diff(ff_arch_atomic_load_int(&cell->sequence), position);
+		if (diff == 0)
+		{
+			if (ff_arch_atomic_cmpxchg_int(&threadpool->enqueue_position, position, get_next_position(position, 1)) == position)
+			{
+				cell->task = task;
+				/* publish the task to consumers */
+				ff_arch_atomic_store_int(&cell->sequence, get_next_position(position, 1));
+				return 1;
+			}
+		}
+		else if (diff < 0)
+		{
+			/* the ring is full */
+			return 0;
+		}
+	}
+}
+
+static struct ff_threadpool_task *pop_task_from_ring(struct ff_threadpool *threadpool)
+{
+	for (;;)
+	{
+		struct task_ring_cell *cell;
+		int position;
+		int diff;
+
+		position = ff_arch_atomic_load_int(&threadpool->dequeue_position);
+		cell = get_task_ring_cell(threadpool, position);
+		diff = get_positions_diff(ff_arch_atomic_load_int(&cell->sequence), get_next_position(position, 1));
+		if (diff == 0)
+		{
+			if (ff_arch_atomic_cmpxchg_int(&threadpool->dequeue_position, position, get_next_position(position, 1)) == position)
+			{
+				struct ff_threadpool_task *task;
+
+				task = cell->task;
+				/* release the cell to the producer, which will wrap around to it */
+				ff_arch_atomic_store_int(&cell->sequence, get_next_position(position, TASKS_RING_SIZE));
+				return task;
+			}
+		}
+		else if (diff < 0)
+		{
+			/* the ring is empty */
+			return NULL;
+		}
+	}
+}
+
+static void push_task(struct ff_threadpool *threadpool, struct ff_threadpool_task *task)
+{
+	if (!push_task_to_ring(threadpool, task))
+	{
+		struct ff_arch_mutex *mutex;
+
+		ff_log_debug(L"the tasks ring of the threadpool=%p is full, so the task=%p is put into the overflow list", threadpool, task);
+		mutex = threadpool->mutex;
+		ff_arch_mutex_lock(mutex);
+		task->next = NULL;
+		if (threadpool->overflow_tail == NULL)
+		{
+			threadpool->overflow_head = task;
+		}
+		else
+		{
+			threadpool->overflow_tail->next = task;
+		}
+		threadpool->overflow_tail = task;
+		ff_arch_atomic_add_int(&threadpool->overflow_tasks_cnt, 1);
+		ff_arch_mutex_unlock(mutex);
+	}
+}
+
+static struct ff_threadpool_task *pop_task(struct ff_threadpool *threadpool)
+{
+	struct ff_threadpool_task *task;
+
+	task = pop_task_from_ring(threadpool);
+	if (task == NULL && ff_arch_atomic_load_int(&threadpool->overflow_tasks_cnt) > 0)
+	{
+		struct ff_arch_mutex *mutex;
+
+		mutex = threadpool->mutex;
+		ff_arch_mutex_lock(mutex);
+		task = threadpool->overflow_head;
+		if (task != NULL)
+		{
+			threadpool->overflow_head = task->next;
+			if (threadpool->overflow_head == NULL)
+			{
+				threadpool->overflow_tail = NULL;
+			}
+			ff_arch_atomic_add_int(&threadpool->overflow_tasks_cnt, -1);
+		}
+		ff_arch_mutex_unlock(mutex);
+	}
+	return task;
+}
+
+/**
+ * returns the next task for the worker thread or NULL if the threadpool is stopped.
+ * Pending tasks are executed before stopping.
+ */
+static struct ff_threadpool_task *wait_for_task(struct ff_threadpool *threadpool)
+{
+	struct ff_threadpool_task *task;
+
+	for (;;)
+	{
+		int wakeup_value;
+
+		task = pop_task(threadpool);
+		if (task != NULL || ff_arch_atomic_load_int(&threadpool->is_stopped))
+		{
+			break;
+		}
+
+		wakeup_value = ff_arch_futex_get_value(threadpool->wakeup_futex);
+		/* the idle threads counter is incremented with the full memory barrier before re-checking the tasks,
+		 * while the ff_threadpool_execute_task() pushes the task before checking the counter.
+		 * So either the worker thread sees the task or the producer sees the idle thread and wakes it up.
+		 */
+		ff_arch_atomic_add_int(&threadpool->idle_threads_cnt, 1);
+		task = pop_task(threadpool);
+		if (task == NULL && !ff_arch_atomic_load_int(&threadpool->is_stopped))
+		{
+			ff_arch_futex_wait(threadpool->wakeup_futex, wakeup_value);
+		}
+		ff_arch_atomic_add_int(&threadpool->idle_threads_cnt, -1);
+		if (task != NULL)
+		{
+			break;
+		}
+	}
+	return task;
+}
 
 static void generic_threadpool_func(void *ctx)
 {
 	struct ff_threadpool *threadpool;
-	struct ff_arch_completion_port *completion_port;
 	struct ff_arch_mutex *mutex;
 
 	threadpool = (struct ff_threadpool *) ctx;
-	completion_port = threadpool->completion_port;
-	mutex = threadpool->mutex;
 	for (;;)
 	{
-		struct threadpool_task *task;
+		struct ff_threadpool_task *task;
 
-		ff_arch_mutex_lock(mutex);
-		ff_assert(threadpool->busy_threads_cnt > 0);
-		ff_assert(threadpool->busy_threads_cnt <= threadpool->running_threads_cnt);
-		ff_assert(threadpool->running_threads_cnt <= threadpool->max_threads_cnt);
-		threadpool->busy_threads_cnt--;
-		ff_arch_mutex_unlock(mutex);
-		ff_arch_completion_port_get(completion_port, (const void **) &task);
+		task = wait_for_task(threadpool);
 		if (task == NULL)
 		{
 			break;
 		}
-		ff_arch_mutex_lock(mutex);
-		threadpool->busy_threads_cnt++;
-		ff_arch_mutex_unlock(mutex);
-
+		/* the task can be freed by the func, so it mustn't be accessed after the call */
 		task->func(task->ctx);
-		ff_free(task);
 	}
+	mutex = threadpool->mutex;
 	ff_arch_mutex_lock(mutex);
-	threadpool->running_threads_cnt--;
+	ff_arch_atomic_store_int(&threadpool->running_threads_cnt, threadpool->running_threads_cnt - 1);
 	ff_arch_mutex_unlock(mutex);
 }
 
@@ -67,8 +243,7 @@ static void add_worker_thread(struct ff_threadpool *threadpool)
 	worker_thread = ff_arch_thread_create(generic_threadpool_func, THREADPOOL_THREAD_STACK_SIZE);
 
 	threadpool->threads[threadpool->running_threads_cnt] = worker_thread;
-	threadpool->running_threads_cnt++;
-	threadpool->busy_threads_cnt++;
+	ff_arch_atomic_store_int(&threadpool->running_threads_cnt, threadpool->running_threads_cnt + 1);
 
 	ff_arch_thread_start(worker_thread, threadpool);
 }
@@ -76,34 +251,43 @@ static void add_worker_thread(struct ff_threadpool *threadpool)
 struct ff_threadpool *ff_threadpool_create(int max_threads_cnt)
 {
 	struct ff_threadpool *threadpool;
-	int cpus_cnt;
+	int i;
 
 	ff_assert(max_threads_cnt > 0);
 
-	cpus_cnt = ff_arch_misc_get_cpus_cnt();
 	threadpool = (struct ff_threadpool *) ff_malloc(sizeof(*threadpool));
-	threadpool->completion_port = ff_arch_completion_port_create(cpus_cnt);
+	threadpool->tasks_ring = (struct task_ring_cell *) ff_calloc(TASKS_RING_SIZE, sizeof(threadpool->tasks_ring[0]));
+	for (i = 0; i < TASKS_RING_SIZE; i++)
+	{
+		threadpool->tasks_ring[i].sequence = i;
+	}
+	threadpool->enqueue_position = 0;
+	threadpool->dequeue_position = 0;
+	threadpool->overflow_head = NULL;
+	threadpool->overflow_tail = NULL;
+	threadpool->overflow_tasks_cnt = 0;
+	threadpool->wakeup_futex = ff_arch_futex_create();
+	threadpool->idle_threads_cnt = 0;
+	threadpool->is_stopped = 0;
 	threadpool->mutex = ff_arch_mutex_create();
 	threadpool->threads = (struct ff_arch_thread **) ff_calloc(max_threads_cnt, sizeof(threadpool->threads[0]));
 	threadpool->max_threads_cnt = max_threads_cnt;
 	threadpool->running_threads_cnt = 0;
-	threadpool->busy_threads_cnt = 0;
 
 	return threadpool;
 }
 
 void ff_threadpool_delete(struct ff_threadpool *threadpool)
 {
-	struct ff_arch_completion_port *completion_port;
 	struct ff_arch_thread **threads;
 	int i;
 	int running_threads_cnt;
 
-	completion_port = threadpool->completion_port;
 	running_threads_cnt = threadpool->running_threads_cnt;
-	for (i = 0; i < running_threads_cnt; i++)
+	ff_arch_atomic_store_int(&threadpool->is_stopped, 1);
+	if (running_threads_cnt > 0)
 	{
-		ff_arch_completion_port_put(completion_port, NULL);
+		ff_arch_futex_wake(threadpool->wakeup_futex, running_threads_cnt);
 	}
 	threads = threadpool->threads;
 	for (i = 0; i < running_threads_cnt; i++)
@@ -114,40 +298,47 @@ void ff_threadpool_delete(struct ff_threadpool *threadpool)
 		ff_arch_thread_join(thread);
 		ff_arch_thread_delete(thread);
 	}
-	ff_assert(threadpool->busy_threads_cnt == 0);
 	ff_assert(threadpool->running_threads_cnt == 0);
+	ff_assert(threadpool->idle_threads_cnt == 0);
+	ff_assert(threadpool->overflow_tasks_cnt == 0);
+	ff_assert(threadpool->enqueue_position == threadpool->dequeue_position);
 
 	ff_free(threads);
 	ff_arch_mutex_delete(threadpool->mutex);
-	ff_arch_completion_port_delete(completion_port);
+	ff_arch_futex_delete(threadpool->wakeup_futex);
+	ff_free(threadpool->tasks_ring);
 	ff_free(threadpool);
 }
 
-void ff_threadpool_execute_async(struct ff_threadpool *threadpool, ff_threadpool_func func, void *ctx)
+void ff_threadpool_execute_task(struct ff_threadpool *threadpool, struct ff_threadpool_task *task)
 {
-	struct threadpool_task *task;
-	struct ff_arch_mutex *mutex;
+	ff_assert(task != NULL);
+	ff_assert(task->func != NULL);
 
-	task = (struct threadpool_task *) ff_malloc(sizeof(*task));
-	task->func = func;
-	task->ctx = ctx;
-	ff_arch_completion_port_put(threadpool->completion_port, task);
+	push_task(threadpool, task);
 
-	mutex = threadpool->mutex;
-	ff_arch_mutex_lock(mutex);
-	ff_assert(threadpool->busy_threads_cnt >= 0);
-	ff_assert(threadpool->busy_threads_cnt <= threadpool->running_threads_cnt);
-	ff_assert(threadpool->running_threads_cnt <= threadpool->max_threads_cnt);
-	if (threadpool->running_threads_cnt < threadpool->max_threads_cnt)
+	/* the atomic addition is used instead of the plain load, because it is the full memory barrier,
+	 * which orders the push above before reading the idle threads counter.
+	 */
+	if (ff_arch_atomic_add_int(&threadpool->idle_threads_cnt, 0) > 0)
 	{
-		if (threadpool->busy_threads_cnt == threadpool->running_threads_cnt)
+		ff_arch_futex_wake(threadpool->wakeup_futex, 1);
+	}
+	else if (ff_arch_atomic_load_int(&threadpool->running_threads_cnt) < threadpool->max_threads_cnt)
+	{
+		struct ff_arch_mutex *mutex;
+
+		mutex = threadpool->mutex;
+		ff_arch_mutex_lock(mutex);
+		/* other producers could already add the worker thread for their tasks */
+		if (threadpool->running_threads_cnt < threadpool->max_threads_cnt && ff_arch_atomic_load_int(&threadpool->idle_threads_cnt) == 0)
 		{
 			add_worker_thread(threadpool);
 		}
+		ff_arch_mutex_unlock(mutex);
 	}
 	else
 	{
 		ff_log_debug(L"threadpool=%p already has maximum size %d, so it cannot contain new threads", threadpool, threadpool->max_threads_cnt);
 	}
-	ff_arch_mutex_unlock(mutex);
 }
@@ -0,0 +1,143 @@
+#include "private/ff_common.h"
+
+#include "private/ff_timer.h"
+#include "private/ff_core.h"
+#include "private/ff_event.h"
+
+struct ff_timer
+{
+	struct ff_core_timer_entry timer_entry;
+	/* the task, which calls the func in the FF_TIMER_FIBERPOOL mode */
+	struct ff_fiberpool_task task;
+	/* the event, which is set while the func isn't pending in the fiberpool */
+	struct ff_event *idle_event;
+	ff_timer_func func;
+	void *ctx;
+	enum ff_timer_mode mode;
+	/* the period of the periodic timer or 0 for the one-shot timer */
+	int period;
+	int64_t expiration_time;
+	int is_active;
+	int is_func_pending;
+};
+
+static void timer_fiberpool_func(void *ctx)
+{
+	struct ff_timer *timer;
+
+	timer = (struct ff_timer *) ctx;
+	ff_assert(timer->is_func_pending);
+	timer->func(timer->ctx);
+	timer->is_func_pending = 0;
+	ff_event_set(timer->idle_event);
+}
+
+static void add_timer_entry(struct ff_timer *timer, int64_t expiration_time)
+{
+	timer->expiration_time = expiration_time;
+	timer->is_active = 1;
+	ff_core_add_timer_entry(&timer->timer_entry, expiration_time);
+}
+
+static void expire_timer(void *ctx)
+{
+	struct ff_timer *timer;
+
+	timer = (struct ff_timer *) ctx;
+	ff_assert(timer->is_active);
+	timer->is_active = 0;
+	if (timer->period > 0)
+	{
+		int64_t current_time;
+		int64_t expiration_time;
+
+		/* the next expiration time doesn't drift unless the scheduler falls behind the period */
+		current_time = ff_core_get_timer_time();
+		expiration_time = timer->expiration_time + timer->period;
+		if (expiration_time <= current_time)
+		{
+			expiration_time = current_time + timer->period;
+		}
+		add_timer_entry(timer, expiration_time);
+	}
+
+	if (timer->mode == FF_TIMER_INLINE)
+	{
+		timer->func(timer->ctx);
+	}
+	else if (!timer->is_func_pending)
+	{
+		timer->is_func_pending = 1;
+		ff_event_reset(timer->idle_event);
+		ff_core_fiberpool_execute_task(&timer->task);
+	}
+	/* otherwise the previous call of the func is still in progress, so skip the firing */
+}
+
+static void start_timer(struct ff_timer *timer, int interval, int period)
+{
+	ff_assert(interval > 0);
+
+	ff_timer_stop(timer);
+	timer->period = period;
+	add_timer_entry(timer, ff_core_get_timer_time() + interval);
+}
+
+struct ff_timer *ff_timer_create(enum ff_timer_mode mode, ff_timer_func func, void *ctx)
+{
+	struct ff_timer *timer;
+
+	timer = (struct ff_timer *) ff_malloc(sizeof(*timer));
+	timer->timer_entry.expire_func = expire_timer;
+	timer->timer_entry.ctx = timer;
+	timer->task.func = timer_fiberpool_func;
+	timer->task.ctx = timer;
+	timer->task.priority = FF_FIBER_PRIORITY_NORMAL;
+	timer->task.is_allocated = 0;
+	timer->idle_event = ff_event_create(FF_EVENT_MANUAL);
+	ff_event_set(timer->idle_event);
+	timer->func = func;
+	timer->ctx = ctx;
+	timer->mode = mode;
+	timer->period = 0;
+	timer->expiration_time = 0;
+	timer->is_active = 0;
+	timer->is_func_pending = 0;
+
+	return timer;
+}
+
+void ff_timer_delete(struct ff_timer *timer)
+{
+	ff_timer_stop(timer);
+	ff_event_wait(timer->idle_event);
+	ff_assert(!timer->is_func_pending);
+	ff_event_delete(timer->idle_event);
+	ff_free(timer);
+}
+
+void ff_timer_start(struct ff_timer *timer, int interval)
+{
+	start_timer(timer, interval, 0);
+}
+
+void ff_timer_start_periodic(struct ff_timer *timer, int period)
+{
+	ff_assert(period > 0);
+
+	start_timer(timer, period, period);
+}
+
+void ff_timer_stop(struct ff_timer *timer)
+{
+	if (timer->is_active)
+	{
+		ff_core_remove_timer_entry(&timer->timer_entry);
+		timer->is_active = 0;
+	}
+}
+
+int ff_timer_is_active(struct ff_timer *timer)
+{
+	return timer->is_active;
+}
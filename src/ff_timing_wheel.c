@@ -0,0 +1,293 @@
+#include "private/ff_common.h"
+
+#include "private/ff_timing_wheel.h"
+
+/**
+ * the number of bits in the slot index on each level of the timing wheel.
+ */
+#define SLOT_BITS 8
+
+/**
+ * the number of slots on each level of the timing wheel.
+ */
+#define SLOTS_CNT (1 << SLOT_BITS)
+
+#define SLOT_MASK (SLOTS_CNT - 1)
+
+/**
+ * the number of levels in the timing wheel.
+ * The timing wheel covers 2^(SLOT_BITS * LEVELS_CNT) ticks.
+ * Entries with longer expiration intervals are placed into the last level
+ * and are cascaded until they reach the first level.
+ */
+#define LEVELS_CNT 4
+
+#define MAX_INTERVAL ((((int64_t) 1) << (SLOT_BITS * LEVELS_CNT)) - 1)
+
+struct ff_timing_wheel
+{
+	struct ff_timing_wheel_entry *slots[LEVELS_CNT][SLOTS_CNT];
+	int entries_cnt[LEVELS_CNT];
+	/* the next tick, which should be processed by the ff_timing_wheel_advance() */
+	int64_t current_tick;
+};
+
+static void add_entry(struct ff_timing_wheel *timing_wheel, struct ff_timing_wheel_entry *entry)
+{
+	struct ff_timing_wheel_entry **slot;
+	int64_t expiration_tick;
+	int64_t interval;
+	int level;
+	int slot_index;
+
+	expiration_tick = entry->expiration_time;
+	if (expiration_tick < timing_wheel->current_tick)
+	{
+		expiration_tick = timing_wheel->current_tick;
+	}
+	interval = expiration_tick - timing_wheel->current_tick;
+	if (interval > MAX_INTERVAL)
+	{
+		/* the entry will be cascaded to the proper slot later */
+		interval = MAX_INTERVAL;
+		expiration_tick = timing_wheel->current_tick + interval;
+	}
+
+	level = 0;
+	while (interval >= (((int64_t) 1) << (SLOT_BITS * (level + 1))))
+	{
+		level++;
+	}
+	ff_assert(level < LEVELS_CNT);
+
+	slot_index = (int) ((expiration_tick >> (SLOT_BITS * level)) & SLOT_MASK);
+	slot = &timing_wheel->slots[level][slot_index];
+	entry->next = *slot;
+	entry->prev_ptr = slot;
+	entry->level = level;
+	if (*slot != NULL)
+	{
+		(*slot)->prev_ptr = &entry->next;
+	}
+	*slot = entry;
+	timing_wheel->entries_cnt[level]++;
+}
+
+static void remove_entry(struct ff_timing_wheel *timing_wheel, struct ff_timing_wheel_entry *entry)
+{
+	ff_assert(*entry->prev_ptr == entry);
+
+	*entry->prev_ptr = entry->next;
+	if (entry->next != NULL)
+	{
+		ff_assert(entry->next->prev_ptr == &entry->next);
+		entry->next->prev_ptr = entry->prev_ptr;
+	}
+	entry->next = NULL;
+	entry->prev_ptr = NULL;
+	timing_wheel->entries_cnt[entry->level]--;
+	ff_assert(timing_wheel->entries_cnt[entry->level] >= 0);
+}
+
+/**
+ * Moves all entries from the given slot on the given level to lower levels.
+ */
+static void cascade_slot(struct ff_timing_wheel *timing_wheel, int level, int slot_index)
+{
+	struct ff_timing_wheel_entry *entry;
+
+	entry = timing_wheel->slots[level][slot_index];
+	timing_wheel->slots[level][slot_index] = NULL;
+	while (entry != NULL)
+	{
+		struct ff_timing_wheel_entry *next_entry;
+
+		next_entry = entry->next;
+		timing_wheel->entries_cnt[level]--;
+		ff_assert(timing_wheel->entries_cnt[level] >= 0);
+		add_entry(timing_wheel, entry);
+		entry = next_entry;
+	}
+}
+
+struct ff_timing_wheel *ff_timing_wheel_create(int64_t current_time)
+{
+	struct ff_timing_wheel *timing_wheel;
+
+	timing_wheel = (struct ff_timing_wheel *) ff_calloc(1, sizeof(*timing_wheel));
+	timing_wheel->current_tick = current_time;
+
+	return timing_wheel;
+}
+
+void ff_timing_wheel_delete(struct ff_timing_wheel *timing_wheel)
+{
+	ff_assert(ff_timing_wheel_is_empty(timing_wheel));
+
+	ff_free(timing_wheel);
+}
+
+void ff_timing_wheel_add_entry(struct ff_timing_wheel *timing_wheel, struct ff_timing_wheel_entry *entry, int64_t expiration_time, const void *data)
+{
+	entry->expiration_time = expiration_time;
+	entry->data = data;
+	add_entry(timing_wheel, entry);
+}
+
+void ff_timing_wheel_remove_entry(struct ff_timing_wheel *timing_wheel, struct ff_timing_wheel_entry *entry)
+{
+	ff_assert(entry->prev_ptr != NULL);
+
+	remove_entry(timing_wheel, entry);
+}
+
+void ff_timing_wheel_advance(struct ff_timing_wheel *timing_wheel, int64_t current_time, ff_timing_wheel_expire_func expire_func, void *ctx)
+{
+	while (timing_wheel->current_tick <= current_time)
+	{
+		struct ff_timing_wheel_entry *expired_entries;
+		int64_t tick;
+		int slot_index;
+		int is_empty;
+
+		is_empty = ff_timing_wheel_is_empty(timing_wheel);
+		if (is_empty)
+		{
+			timing_wheel->current_tick = current_time + 1;
+			break;
+		}
+
+		tick = timing_wheel->current_tick;
+		slot_index = (int) (tick & SLOT_MASK);
+		if (slot_index == 0)
+		{
+			int level;
+
+			/* cascade entries from upper levels, which became close enough to the current tick */
+			for (level = 1; level < LEVELS_CNT; level++)
+			{
+				int upper_slot_index;
+
+				upper_slot_index = (int) ((tick >> (SLOT_BITS * level)) & SLOT_MASK);
+				if (timing_wheel->entries_cnt[level] > 0)
+				{
+					cascade_slot(timing_wheel, level, upper_slot_index);
+				}
+				if (upper_slot_index != 0)
+				{
+					break;
+				}
+			}
+		}
+		else if (timing_wheel->entries_cnt[0] == 0)
+		{
+			int64_t next_tick;
+
+			/* there is no need in visiting empty slots on the first level.
+			 * Jump directly to the next cascading point.
+			 */
+			next_tick = (tick | SLOT_MASK) + 1;
+			if (next_tick > current_time + 1)
+			{
+				next_tick = current_time + 1;
+			}
+			timing_wheel->current_tick = next_tick;
+			continue;
+		}
+
+		/* move expired entries to the local list, so the expire_func can add entries
+		 * to the timing wheel or remove not yet expired entries from the local list.
+		 */
+		expired_entries = timing_wheel->slots[0][slot_index];
+		timing_wheel->slots[0][slot_index] = NULL;
+		if (expired_entries != NULL)
+		{
+			expired_entries->prev_ptr = &expired_entries;
+		}
+		timing_wheel->current_tick = tick + 1;
+		while (expired_entries != NULL)
+		{
+			struct ff_timing_wheel_entry *entry;
+
+			entry = expired_entries;
+			ff_assert(entry->level == 0);
+			ff_assert(entry->expiration_time <= tick);
+			remove_entry(timing_wheel, entry);
+			expire_func(entry, ctx);
+		}
+	}
+}
+
+int64_t ff_timing_wheel_get_next_expiration_time(struct ff_timing_wheel *timing_wheel)
+{
+	int64_t tick;
+	int64_t next_expiration_time;
+	int level;
+
+	ff_assert(!ff_timing_wheel_is_empty(timing_wheel));
+
+	tick = timing_wheel->current_tick;
+	next_expiration_time = tick + MAX_INTERVAL;
+	if (timing_wheel->entries_cnt[0] > 0)
+	{
+		int i;
+
+		for (i = 0; i < SLOTS_CNT; i++)
+		{
+			if (timing_wheel->slots[0][(tick + i) & SLOT_MASK] != NULL)
+			{
+				next_expiration_time = tick + i;
+				break;
+			}
+		}
+		ff_assert(i < SLOTS_CNT);
+	}
+
+	/* entries from upper levels can expire earlier than entries from the first level
+	 * after they will be cascaded, so take into account the nearest cascading point
+	 * of non-empty slots on each upper level.
+	 */
+	for (level = 1; level < LEVELS_CNT; level++)
+	{
+		if (timing_wheel->entries_cnt[level] > 0)
+		{
+			int64_t level_tick;
+			int i;
+
+			level_tick = tick >> (SLOT_BITS * level);
+			for (i = 1; i <= SLOTS_CNT; i++)
+			{
+				if (timing_wheel->slots[level][(level_tick + i) & SLOT_MASK] != NULL)
+				{
+					int64_t cascade_time;
+
+					cascade_time = (level_tick + i) << (SLOT_BITS * level);
+					if (cascade_time < next_expiration_time)
+					{
+						next_expiration_time = cascade_time;
+					}
+					break;
+				}
+			}
+			ff_assert(i <= SLOTS_CNT);
+		}
+	}
+
+	return next_expiration_time;
+}
+
+int ff_timing_wheel_is_empty(struct ff_timing_wheel *timing_wheel)
+{
+	int is_empty = 1;
+	int level;
+
+	for (level = 0; level < LEVELS_CNT; level++)
+	{
+		if (timing_wheel->entries_cnt[level] > 0)
+		{
+			is_empty = 0;
+			break;
+		}
+	}
+	return is_empty;
+}
@@ -0,0 +1,1503 @@
+#include "ff/ff_common.h"
+#include "ff/ff_blocking_queue.h"
+#include "ff/ff_channel.h"
+#include "ff/ff_core.h"
+#include "ff/ff_event.h"
+#include "ff/ff_fiber.h"
+#include "ff/ff_fiber_group.h"
+#include "ff/ff_pipe.h"
+#include "ff/ff_semaphore.h"
+#include "ff/ff_timer.h"
+#include "ff/ff_tcp.h"
+#include "ff/arch/ff_arch_net_addr.h"
+#include "private/ff_core.h"
+#include "private/arch/ff_arch_fiber.h"
+#include "private/ff_timing_wheel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG_FILENAME L"ff_benchmarks_log.txt"
+
+/**
+ * the number of memory allocations made by the process.
+ * malloc() and calloc() are interposed below in order to count allocations
+ * made inside the fiber framework library.
+ */
+static int64_t allocations_cnt = 0;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+
+void *malloc(size_t size)
+{
+	__sync_fetch_and_add(&allocations_cnt, 1);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	__sync_fetch_and_add(&allocations_cnt, 1);
+	return __libc_calloc(nmemb, size);
+}
+
+static int64_t get_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((int64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/* start of ff_timing_wheel benchmarks */
+
+/**
+ * timeouts are spread uniformly over one hour, the tick is one millisecond
+ */
+#define TIMING_WHEEL_TIMEOUTS_RANGE 3600000
+
+#define TIMING_WHEEL_TICKS_CNT 100000
+
+static void timing_wheel_expire_func(struct ff_timing_wheel_entry *entry, void *ctx)
+{
+	int *expired_cnt;
+
+	(void)entry;
+	expired_cnt = (int *) ctx;
+	(*expired_cnt)++;
+}
+
+static void bench_timing_wheel_tick(int timeouts_cnt)
+{
+	struct ff_timing_wheel *timing_wheel;
+	struct ff_timing_wheel_entry *entries;
+	int64_t start_time, end_time;
+	int64_t tick;
+	int expired_cnt = 0;
+	int i;
+
+	entries = (struct ff_timing_wheel_entry *) ff_calloc(timeouts_cnt, sizeof(entries[0]));
+	timing_wheel = ff_timing_wheel_create(0);
+	srand(1234);
+	for (i = 0; i < timeouts_cnt; i++)
+	{
+		int64_t expiration_time;
+
+		expiration_time = 1 + (((int64_t) rand()) * RAND_MAX + rand()) % TIMING_WHEEL_TIMEOUTS_RANGE;
+		ff_timing_wheel_add_entry(timing_wheel, &entries[i], expiration_time, NULL);
+	}
+
+	start_time = get_time_ns();
+	for (tick = 0; tick < TIMING_WHEEL_TICKS_CNT; tick++)
+	{
+		ff_timing_wheel_advance(timing_wheel, tick, timing_wheel_expire_func, &expired_cnt);
+	}
+	end_time = get_time_ns();
+
+	printf("timing_wheel: pending_timeouts=%d, ticks=%d, expired=%d, ns_per_tick=%.1f\n",
+		timeouts_cnt, TIMING_WHEEL_TICKS_CNT, expired_cnt, (double) (end_time - start_time) / TIMING_WHEEL_TICKS_CNT);
+
+	ff_timing_wheel_advance(timing_wheel, TIMING_WHEEL_TIMEOUTS_RANGE, timing_wheel_expire_func, &expired_cnt);
+	ff_timing_wheel_delete(timing_wheel);
+	ff_free(entries);
+}
+
+static void bench_timing_wheel_all(void)
+{
+	bench_timing_wheel_tick(1000);
+	bench_timing_wheel_tick(100000);
+	bench_timing_wheel_tick(1000000);
+}
+
+/* end of ff_timing_wheel benchmarks */
+
+/* start of ff_core schedulers benchmarks */
+
+#define SKEWED_LOAD_TASKS_CNT 20000
+
+/**
+ * the number of iterations of the cpu-bound loop in each task
+ */
+#define SKEWED_LOAD_TASK_ITERATIONS 20000
+
+struct skewed_load_data
+{
+	int completed_tasks_cnt;
+	struct ff_event *completed_event;
+};
+
+static void skewed_load_complete_func(void *ctx)
+{
+	struct skewed_load_data *data;
+
+	data = (struct skewed_load_data *) ctx;
+	data->completed_tasks_cnt++;
+	if (data->completed_tasks_cnt == SKEWED_LOAD_TASKS_CNT)
+	{
+		ff_event_set(data->completed_event);
+	}
+}
+
+static void skewed_load_task_func(void *ctx)
+{
+	volatile uint32_t hash = 0;
+	int i;
+
+	for (i = 0; i < SKEWED_LOAD_TASK_ITERATIONS; i++)
+	{
+		hash = hash * 31 + i;
+	}
+	ff_core_post_to_scheduler(0, skewed_load_complete_func, ctx);
+}
+
+/**
+ * all the tasks are started by the first scheduler, so other schedulers
+ * can help it only by stealing tasks.
+ */
+static void bench_core_skewed_load(const char *name, int schedulers_cnt, enum ff_core_scheduler_mode mode)
+{
+	struct skewed_load_data data;
+	int64_t start_time, end_time;
+	int i;
+
+	ff_core_initialize_schedulers(LOG_FILENAME, schedulers_cnt, mode);
+	data.completed_tasks_cnt = 0;
+	data.completed_event = ff_event_create(FF_EVENT_AUTO);
+
+	start_time = get_time_ns();
+	for (i = 0; i < SKEWED_LOAD_TASKS_CNT; i++)
+	{
+		ff_core_fiberpool_execute_async(skewed_load_task_func, &data);
+	}
+	ff_event_wait(data.completed_event);
+	end_time = get_time_ns();
+
+	ff_event_delete(data.completed_event);
+	ff_core_shutdown();
+
+	printf("skewed_load: mode=%s, schedulers=%d, tasks=%d, tasks_per_sec=%.0f\n",
+		name, schedulers_cnt, SKEWED_LOAD_TASKS_CNT, SKEWED_LOAD_TASKS_CNT * 1e9 / (end_time - start_time));
+}
+
+static void bench_core_schedulers_all(void)
+{
+	bench_core_skewed_load("single", 1, FF_CORE_SCHEDULER_ISOLATED);
+	bench_core_skewed_load("isolated", 4, FF_CORE_SCHEDULER_ISOLATED);
+	bench_core_skewed_load("work_stealing", 4, FF_CORE_SCHEDULER_WORK_STEALING);
+}
+
+/* end of ff_core schedulers benchmarks */
+
+/* start of context switch benchmarks */
+
+#define CONTEXT_SWITCHES_CNT 1000000
+
+static void context_switch_fiber_func(void *ctx)
+{
+	struct ff_fiber *fiber;
+	int switches_cnt;
+	int i;
+
+	switches_cnt = *(int *) ctx;
+	fiber = ff_fiber_get_current();
+	for (i = 0; i < switches_cnt; i++)
+	{
+		ff_core_schedule_fiber(fiber);
+		ff_core_yield_fiber();
+	}
+}
+
+static void bench_context_switch(int fibers_cnt)
+{
+	struct ff_fiber **fibers;
+	int64_t start_time, end_time;
+	int64_t start_allocations_cnt, end_allocations_cnt;
+	int switches_per_fiber;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	switches_per_fiber = CONTEXT_SWITCHES_CNT / fibers_cnt;
+	fibers = (struct ff_fiber **) ff_calloc(fibers_cnt, sizeof(fibers[0]));
+	for (i = 0; i < fibers_cnt; i++)
+	{
+		fibers[i] = ff_fiber_create(context_switch_fiber_func, 0);
+	}
+
+	start_allocations_cnt = allocations_cnt;
+	start_time = get_time_ns();
+	for (i = 0; i < fibers_cnt; i++)
+	{
+		ff_fiber_start(fibers[i], &switches_per_fiber);
+	}
+	for (i = 0; i < fibers_cnt; i++)
+	{
+		ff_fiber_join(fibers[i]);
+	}
+	end_time = get_time_ns();
+	end_allocations_cnt = allocations_cnt;
+
+	for (i = 0; i < fibers_cnt; i++)
+	{
+		ff_fiber_delete(fibers[i]);
+	}
+	ff_free(fibers);
+	ff_core_shutdown();
+
+	printf("context_switch: fibers=%d, switches=%d, ns_per_switch=%.1f, allocations_per_switch=%.3f\n",
+		fibers_cnt, switches_per_fiber * fibers_cnt,
+		(double) (end_time - start_time) / (switches_per_fiber * fibers_cnt),
+		(double) (end_allocations_cnt - start_allocations_cnt) / (switches_per_fiber * fibers_cnt));
+}
+
+static struct ff_arch_fiber *arch_main_fiber;
+
+static void arch_fiber_switch_func(void *ctx)
+{
+	(void)ctx;
+	for (;;)
+	{
+		ff_arch_fiber_switch(arch_main_fiber);
+	}
+}
+
+/**
+ * measures the raw context switch between two fibers without the scheduler
+ */
+static void bench_arch_fiber_switch(void)
+{
+	struct ff_arch_fiber *arch_fiber;
+	int64_t start_time, end_time;
+	int i;
+
+	arch_main_fiber = ff_arch_fiber_initialize();
+	arch_fiber = ff_arch_fiber_create(arch_fiber_switch_func, NULL, 0x10000);
+
+	start_time = get_time_ns();
+	for (i = 0; i < CONTEXT_SWITCHES_CNT / 2; i++)
+	{
+		ff_arch_fiber_switch(arch_fiber);
+	}
+	end_time = get_time_ns();
+
+	ff_arch_fiber_delete(arch_fiber);
+	ff_arch_fiber_shutdown(arch_main_fiber);
+
+	printf("arch_fiber_switch: switches=%d, ns_per_switch=%.1f\n",
+		CONTEXT_SWITCHES_CNT, (double) (end_time - start_time) / CONTEXT_SWITCHES_CNT);
+}
+
+#define YIELD_IF_NEEDED_CALLS_CNT 50000000
+
+/**
+ * measures the cost of the ff_core_yield_if_needed() in the CPU-heavy loop
+ */
+static void bench_yield_if_needed(void)
+{
+	int64_t start_time, end_time;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	start_time = get_time_ns();
+	for (i = 0; i < YIELD_IF_NEEDED_CALLS_CNT; i++)
+	{
+		ff_core_yield_if_needed();
+	}
+	end_time = get_time_ns();
+	ff_core_shutdown();
+
+	printf("yield_if_needed: calls=%d, ns_per_call=%.2f\n",
+		YIELD_IF_NEEDED_CALLS_CNT, (double) (end_time - start_time) / YIELD_IF_NEEDED_CALLS_CNT);
+}
+
+static void bench_context_switch_all(void)
+{
+	bench_arch_fiber_switch();
+	bench_context_switch(1);
+	bench_context_switch(2);
+	bench_context_switch(100);
+	bench_context_switch(10000);
+	bench_yield_if_needed();
+}
+
+/* end of context switch benchmarks */
+
+/* start of ff_timer benchmarks */
+
+#define TIMERS_CNT 1000
+
+#define TIMERS_RUN_TIME 200
+
+static int timer_firings_cnt;
+
+static void timer_bench_func(void *ctx)
+{
+	(void)ctx;
+	timer_firings_cnt++;
+}
+
+static void bench_timer(enum ff_timer_mode mode)
+{
+	struct ff_timer **timers;
+	int64_t start_allocations_cnt, end_allocations_cnt;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	timers = (struct ff_timer **) ff_calloc(TIMERS_CNT, sizeof(timers[0]));
+	for (i = 0; i < TIMERS_CNT; i++)
+	{
+		timers[i] = ff_timer_create(mode, timer_bench_func, NULL);
+	}
+
+	timer_firings_cnt = 0;
+	start_allocations_cnt = allocations_cnt;
+	for (i = 0; i < TIMERS_CNT; i++)
+	{
+		ff_timer_start_periodic(timers[i], 1);
+	}
+	ff_core_sleep(TIMERS_RUN_TIME);
+	for (i = 0; i < TIMERS_CNT; i++)
+	{
+		ff_timer_stop(timers[i]);
+	}
+	end_allocations_cnt = allocations_cnt;
+
+	for (i = 0; i < TIMERS_CNT; i++)
+	{
+		ff_timer_delete(timers[i]);
+	}
+	ff_free(timers);
+	ff_core_shutdown();
+
+	printf("timer: mode=%s, timers=%d, firings=%d, allocations_per_firing=%.3f\n",
+		(mode == FF_TIMER_INLINE) ? "inline" : "fiberpool", TIMERS_CNT, timer_firings_cnt,
+		(double) (end_allocations_cnt - start_allocations_cnt) / timer_firings_cnt);
+}
+
+static int is_deferred_bench_stopped;
+
+static void deferred_bench_func(void *ctx)
+{
+	timer_firings_cnt++;
+	if (!is_deferred_bench_stopped)
+	{
+		ff_core_fiberpool_execute_deferred(deferred_bench_func, ctx, 1);
+	}
+}
+
+/**
+ * measures periodic calls via ff_core_fiberpool_execute_deferred() for comparison with timers
+ */
+static void bench_timer_deferred(void)
+{
+	int64_t start_allocations_cnt, end_allocations_cnt;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	timer_firings_cnt = 0;
+	is_deferred_bench_stopped = 0;
+	start_allocations_cnt = allocations_cnt;
+	for (i = 0; i < TIMERS_CNT; i++)
+	{
+		ff_core_fiberpool_execute_deferred(deferred_bench_func, NULL, 1);
+	}
+	ff_core_sleep(TIMERS_RUN_TIME);
+	is_deferred_bench_stopped = 1;
+	end_allocations_cnt = allocations_cnt;
+	/* the shutdown waits for pending deferred calls */
+	ff_core_shutdown();
+
+	printf("timer: mode=deferred, timers=%d, firings=%d, allocations_per_firing=%.3f\n",
+		TIMERS_CNT, timer_firings_cnt,
+		(double) (end_allocations_cnt - start_allocations_cnt) / timer_firings_cnt);
+}
+
+static void bench_timer_all(void)
+{
+	bench_timer(FF_TIMER_INLINE);
+	bench_timer(FF_TIMER_FIBERPOOL);
+	bench_timer_deferred();
+}
+
+/* end of ff_timer benchmarks */
+
+/* start of fiber lifecycle benchmarks */
+
+#define FIBER_LIFECYCLES_CNT 200000
+
+static void fiber_lifecycle_func(void *ctx)
+{
+	int *counter;
+
+	counter = (int *) ctx;
+	(*counter)++;
+}
+
+/**
+ * measures create, start, join and delete throughput for batches of short-lived fibers
+ */
+static void bench_fiber_lifecycle(int batch_size)
+{
+	struct ff_fiber **fibers;
+	int64_t start_time, end_time;
+	int64_t start_allocations_cnt, end_allocations_cnt;
+	int batches_cnt;
+	int counter;
+	int i, j;
+
+	ff_core_initialize(LOG_FILENAME);
+	batches_cnt = FIBER_LIFECYCLES_CNT / batch_size;
+	fibers = (struct ff_fiber **) ff_calloc(batch_size, sizeof(fibers[0]));
+	counter = 0;
+
+	start_allocations_cnt = allocations_cnt;
+	start_time = get_time_ns();
+	for (i = 0; i < batches_cnt; i++)
+	{
+		for (j = 0; j < batch_size; j++)
+		{
+			fibers[j] = ff_fiber_create(fiber_lifecycle_func, 0);
+			ff_fiber_start(fibers[j], &counter);
+		}
+		for (j = 0; j < batch_size; j++)
+		{
+			ff_fiber_join(fibers[j]);
+			ff_fiber_delete(fibers[j]);
+		}
+	}
+	end_time = get_time_ns();
+	end_allocations_cnt = allocations_cnt;
+
+	ff_free(fibers);
+	ff_core_shutdown();
+	ff_assert(counter == batches_cnt * batch_size);
+
+	printf("fiber_lifecycle: batch_size=%d, fibers=%d, fibers_per_sec=%.0f, allocations_per_fiber=%.3f\n",
+		batch_size, counter, (double) counter * 1000000000 / (end_time - start_time),
+		(double) (end_allocations_cnt - start_allocations_cnt) / counter);
+}
+
+static void bench_fiber_lifecycle_all(void)
+{
+	bench_fiber_lifecycle(1);
+	bench_fiber_lifecycle(100);
+	bench_fiber_lifecycle(1000);
+}
+
+/* end of fiber lifecycle benchmarks */
+
+/* start of ff_fiber_group benchmarks */
+
+/**
+ * the number of backends queried by each scatter-gather query
+ */
+#define SCATTER_GATHER_BACKENDS_CNT 16
+
+/**
+ * the number of answers, which are enough for completing the scatter-gather query
+ */
+#define SCATTER_GATHER_ANSWERS_CNT 4
+
+#define SCATTER_GATHER_QUERIES_CNT 10000
+
+/**
+ * the response time of slow backends in milliseconds
+ */
+#define SCATTER_GATHER_SLOW_BACKEND_TIME 1000
+
+/**
+ * measures spawn and wait throughput for batches of fiber group children
+ * for comparison with the fiber lifecycle
+ */
+static void bench_fiber_group(int batch_size)
+{
+	struct ff_fiber_group *group;
+	int64_t start_time, end_time;
+	int64_t start_allocations_cnt, end_allocations_cnt;
+	int batches_cnt;
+	int counter;
+	int i, j;
+
+	ff_core_initialize(LOG_FILENAME);
+	batches_cnt = FIBER_LIFECYCLES_CNT / batch_size;
+	group = ff_fiber_group_create();
+	counter = 0;
+
+	start_allocations_cnt = allocations_cnt;
+	start_time = get_time_ns();
+	for (i = 0; i < batches_cnt; i++)
+	{
+		for (j = 0; j < batch_size; j++)
+		{
+			ff_fiber_group_spawn(group, fiber_lifecycle_func, &counter);
+		}
+		ff_fiber_group_wait(group);
+	}
+	end_time = get_time_ns();
+	end_allocations_cnt = allocations_cnt;
+
+	ff_fiber_group_delete(group);
+	ff_core_shutdown();
+	ff_assert(counter == batches_cnt * batch_size);
+
+	printf("fiber_group: batch_size=%d, children=%d, children_per_sec=%.0f, allocations_per_child=%.3f\n",
+		batch_size, counter, (double) counter * 1000000000 / (end_time - start_time),
+		(double) (end_allocations_cnt - start_allocations_cnt) / counter);
+}
+
+static void scatter_gather_backend_func(void *ctx)
+{
+	int is_slow;
+
+	is_slow = *(int *) ctx;
+	if (is_slow)
+	{
+		/* the sleep is aborted when the query cancels stragglers */
+		ff_core_sleep(SCATTER_GATHER_SLOW_BACKEND_TIME);
+	}
+}
+
+/**
+ * measures queries, which wait for the first answers from backends and cancel the rest
+ */
+static void bench_fiber_group_scatter_gather(void)
+{
+	int64_t start_time, end_time;
+	int is_fast = 0;
+	int is_slow = 1;
+	int i, j;
+
+	ff_core_initialize(LOG_FILENAME);
+	start_time = get_time_ns();
+	for (i = 0; i < SCATTER_GATHER_QUERIES_CNT; i++)
+	{
+		struct ff_fiber_group *group;
+
+		group = ff_fiber_group_create();
+		for (j = 0; j < SCATTER_GATHER_BACKENDS_CNT; j++)
+		{
+			ff_fiber_group_spawn(group, scatter_gather_backend_func, (j < SCATTER_GATHER_ANSWERS_CNT) ? &is_fast : &is_slow);
+		}
+		ff_fiber_group_wait_first(group, SCATTER_GATHER_ANSWERS_CNT);
+		ff_fiber_group_cancel(group);
+		ff_fiber_group_wait(group);
+		ff_fiber_group_delete(group);
+	}
+	end_time = get_time_ns();
+	ff_core_shutdown();
+
+	printf("fiber_group: scatter_gather, backends=%d, answers=%d, queries=%d, queries_per_sec=%.0f\n",
+		SCATTER_GATHER_BACKENDS_CNT, SCATTER_GATHER_ANSWERS_CNT, SCATTER_GATHER_QUERIES_CNT,
+		(double) SCATTER_GATHER_QUERIES_CNT * 1000000000 / (end_time - start_time));
+}
+
+static void bench_fiber_group_all(void)
+{
+	bench_fiber_group(1);
+	bench_fiber_group(100);
+	bench_fiber_group(1000);
+	bench_fiber_group_scatter_gather();
+}
+
+/* end of ff_fiber_group benchmarks */
+
+/* start of ff_channel benchmarks */
+
+#define CHANNEL_MESSAGES_CNT 1000000
+
+static void channel_producer_func(void *ctx)
+{
+	struct ff_channel *channel;
+	int64_t i;
+
+	channel = (struct ff_channel *) ctx;
+	for (i = 0; i < CHANNEL_MESSAGES_CNT; i++)
+	{
+		ff_channel_send(channel, &i);
+	}
+}
+
+/**
+ * measures the throughput of passing messages from the producer fiber to the consumer fiber
+ */
+static void bench_channel(int capacity)
+{
+	struct ff_channel *channel;
+	int64_t start_time, end_time;
+	int64_t start_allocations_cnt, end_allocations_cnt;
+	int64_t value;
+	int64_t i;
+
+	ff_core_initialize(LOG_FILENAME);
+	channel = ff_channel_create(sizeof(value), capacity);
+	start_allocations_cnt = allocations_cnt;
+	start_time = get_time_ns();
+	ff_core_fiberpool_execute_async(channel_producer_func, channel);
+	for (i = 0; i < CHANNEL_MESSAGES_CNT; i++)
+	{
+		ff_channel_receive(channel, &value);
+		ff_assert(value == i);
+	}
+	end_time = get_time_ns();
+	end_allocations_cnt = allocations_cnt;
+	ff_channel_delete(channel);
+	ff_core_shutdown();
+
+	printf("channel: capacity=%d, messages=%d, messages_per_sec=%.0f, allocations_per_message=%.3f\n",
+		capacity, CHANNEL_MESSAGES_CNT, (double) CHANNEL_MESSAGES_CNT * 1000000000 / (end_time - start_time),
+		(double) (end_allocations_cnt - start_allocations_cnt) / CHANNEL_MESSAGES_CNT);
+}
+
+static void blocking_queue_producer_func(void *ctx)
+{
+	struct ff_blocking_queue *queue;
+	int64_t i;
+
+	queue = (struct ff_blocking_queue *) ctx;
+	for (i = 0; i < CHANNEL_MESSAGES_CNT; i++)
+	{
+		ff_blocking_queue_put(queue, (const void *) (intptr_t) i);
+	}
+}
+
+/**
+ * measures the same workload as the bench_channel() using the ff_blocking_queue for comparison
+ */
+static void bench_channel_blocking_queue(int capacity)
+{
+	struct ff_blocking_queue *queue;
+	int64_t start_time, end_time;
+	int64_t start_allocations_cnt, end_allocations_cnt;
+	const void *value;
+	int64_t i;
+
+	ff_core_initialize(LOG_FILENAME);
+	queue = ff_blocking_queue_create(capacity);
+	start_allocations_cnt = allocations_cnt;
+	start_time = get_time_ns();
+	ff_core_fiberpool_execute_async(blocking_queue_producer_func, queue);
+	for (i = 0; i < CHANNEL_MESSAGES_CNT; i++)
+	{
+		ff_blocking_queue_get(queue, &value);
+		ff_assert((intptr_t) value == i);
+	}
+	end_time = get_time_ns();
+	end_allocations_cnt = allocations_cnt;
+	ff_blocking_queue_delete(queue);
+	ff_core_shutdown();
+
+	printf("channel: blocking_queue, capacity=%d, messages=%d, messages_per_sec=%.0f, allocations_per_message=%.3f\n",
+		capacity, CHANNEL_MESSAGES_CNT, (double) CHANNEL_MESSAGES_CNT * 1000000000 / (end_time - start_time),
+		(double) (end_allocations_cnt - start_allocations_cnt) / CHANNEL_MESSAGES_CNT);
+}
+
+static void bench_channel_all(void)
+{
+	bench_channel(0);
+	bench_channel(1);
+	bench_channel(100);
+	bench_channel_blocking_queue(1);
+	bench_channel_blocking_queue(100);
+}
+
+/* end of ff_channel benchmarks */
+
+/* start of fiber handoff benchmarks */
+
+#define HANDOFF_ROUND_TRIPS_CNT 200000
+#define HANDOFF_MESSAGE_SIZE 64
+#define HANDOFF_PIPE_BUFFER_SIZE 4096
+#define HANDOFF_LATENCY_MESSAGES_CNT 20000
+#define HANDOFF_PRODUCER_WORK_NS 2000
+
+struct handoff_pipe_data
+{
+	struct ff_pipe *pipe;
+	struct ff_event *stop_event;
+};
+
+static void handoff_pipe_server_func(void *ctx)
+{
+	struct handoff_pipe_data *data;
+	char buf[HANDOFF_MESSAGE_SIZE];
+	enum ff_result result;
+
+	data = (struct handoff_pipe_data *) ctx;
+	for (;;)
+	{
+		result = ff_pipe_read(data->pipe, buf, sizeof(buf));
+		if (result != FF_SUCCESS)
+		{
+			break;
+		}
+		result = ff_pipe_write(data->pipe, buf, sizeof(buf));
+		if (result != FF_SUCCESS)
+		{
+			break;
+		}
+		ff_pipe_flush(data->pipe);
+	}
+	ff_event_set(data->stop_event);
+}
+
+/**
+ * measures the latency of request-response round trips between two fibers over the ff_pipe
+ */
+static void bench_handoff_pipe_ping_pong(void)
+{
+	struct handoff_pipe_data data;
+	struct ff_pipe *client_pipe;
+	char buf[HANDOFF_MESSAGE_SIZE];
+	int64_t start_time, end_time;
+	enum ff_result result;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	ff_pipe_create_pair(HANDOFF_PIPE_BUFFER_SIZE, &client_pipe, &data.pipe);
+	data.stop_event = ff_event_create(FF_EVENT_MANUAL);
+	ff_core_fiberpool_execute_async(handoff_pipe_server_func, &data);
+	memset(buf, 0, sizeof(buf));
+	start_time = get_time_ns();
+	for (i = 0; i < HANDOFF_ROUND_TRIPS_CNT; i++)
+	{
+		result = ff_pipe_write(client_pipe, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+		ff_pipe_flush(client_pipe);
+		result = ff_pipe_read(client_pipe, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+	}
+	end_time = get_time_ns();
+	ff_pipe_disconnect(client_pipe);
+	ff_event_wait(data.stop_event);
+	ff_event_delete(data.stop_event);
+	ff_pipe_delete(data.pipe);
+	ff_pipe_delete(client_pipe);
+	ff_core_shutdown();
+
+	printf("handoff: pipe ping-pong, round_trips=%d, round_trips_per_sec=%.0f, avg_latency_ns=%.0f\n",
+		HANDOFF_ROUND_TRIPS_CNT, (double) HANDOFF_ROUND_TRIPS_CNT * 1000000000 / (end_time - start_time),
+		(double) (end_time - start_time) / HANDOFF_ROUND_TRIPS_CNT);
+}
+
+static void handoff_pipe_producer_func(void *ctx)
+{
+	struct handoff_pipe_data *data;
+	char buf[HANDOFF_MESSAGE_SIZE];
+	enum ff_result result;
+	int i;
+
+	data = (struct handoff_pipe_data *) ctx;
+	memset(buf, 0, sizeof(buf));
+	for (i = 0; i < HANDOFF_ROUND_TRIPS_CNT; i++)
+	{
+		result = ff_pipe_write(data->pipe, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+	}
+	ff_event_set(data->stop_event);
+}
+
+/**
+ * measures the throughput of the one-way stream of small messages between two fibers over the ff_pipe
+ */
+static void bench_handoff_pipe_stream(void)
+{
+	struct handoff_pipe_data data;
+	struct ff_pipe *consumer_pipe;
+	char buf[HANDOFF_MESSAGE_SIZE];
+	int64_t start_time, end_time;
+	enum ff_result result;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	ff_pipe_create_pair(HANDOFF_PIPE_BUFFER_SIZE, &consumer_pipe, &data.pipe);
+	data.stop_event = ff_event_create(FF_EVENT_MANUAL);
+	start_time = get_time_ns();
+	ff_core_fiberpool_execute_async(handoff_pipe_producer_func, &data);
+	for (i = 0; i < HANDOFF_ROUND_TRIPS_CNT; i++)
+	{
+		result = ff_pipe_read(consumer_pipe, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+	}
+	end_time = get_time_ns();
+	ff_event_wait(data.stop_event);
+	ff_event_delete(data.stop_event);
+	ff_pipe_delete(data.pipe);
+	ff_pipe_delete(consumer_pipe);
+	ff_core_shutdown();
+
+	printf("handoff: pipe stream, messages=%d, messages_per_sec=%.0f\n",
+		HANDOFF_ROUND_TRIPS_CNT, (double) HANDOFF_ROUND_TRIPS_CNT * 1000000000 / (end_time - start_time));
+}
+
+/**
+ * simulates the work of the producer between messages
+ */
+static void handoff_produce_message(void)
+{
+	int64_t start_time;
+
+	start_time = get_time_ns();
+	while (get_time_ns() - start_time < HANDOFF_PRODUCER_WORK_NS)
+	{
+		/* busy loop */
+	}
+}
+
+static void handoff_pipe_latency_producer_func(void *ctx)
+{
+	struct handoff_pipe_data *data;
+	int64_t send_time;
+	enum ff_result result;
+	int i;
+
+	data = (struct handoff_pipe_data *) ctx;
+	for (i = 0; i < HANDOFF_LATENCY_MESSAGES_CNT; i++)
+	{
+		handoff_produce_message();
+		send_time = get_time_ns();
+		result = ff_pipe_write(data->pipe, &send_time, sizeof(send_time));
+		ff_assert(result == FF_SUCCESS);
+		ff_pipe_flush(data->pipe);
+	}
+	ff_event_set(data->stop_event);
+}
+
+/**
+ * measures the delay between writing the message to the ff_pipe by the busy producer
+ * and reading it by the consumer
+ */
+static void bench_handoff_pipe_latency(void)
+{
+	struct handoff_pipe_data data;
+	struct ff_pipe *consumer_pipe;
+	int64_t send_time;
+	int64_t total_latency = 0;
+	enum ff_result result;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	ff_pipe_create_pair(HANDOFF_PIPE_BUFFER_SIZE, &consumer_pipe, &data.pipe);
+	data.stop_event = ff_event_create(FF_EVENT_MANUAL);
+	ff_core_fiberpool_execute_async(handoff_pipe_latency_producer_func, &data);
+	for (i = 0; i < HANDOFF_LATENCY_MESSAGES_CNT; i++)
+	{
+		result = ff_pipe_read(consumer_pipe, &send_time, sizeof(send_time));
+		ff_assert(result == FF_SUCCESS);
+		total_latency += get_time_ns() - send_time;
+	}
+	ff_event_wait(data.stop_event);
+	ff_event_delete(data.stop_event);
+	ff_pipe_delete(data.pipe);
+	ff_pipe_delete(consumer_pipe);
+	ff_core_shutdown();
+
+	printf("handoff: pipe latency, messages=%d, producer_work_ns=%d, avg_latency_ns=%.0f\n",
+		HANDOFF_LATENCY_MESSAGES_CNT, HANDOFF_PRODUCER_WORK_NS, (double) total_latency / HANDOFF_LATENCY_MESSAGES_CNT);
+}
+
+static void handoff_channel_latency_producer_func(void *ctx)
+{
+	struct ff_channel *channel;
+	int64_t send_time;
+	int i;
+
+	channel = (struct ff_channel *) ctx;
+	for (i = 0; i < HANDOFF_LATENCY_MESSAGES_CNT; i++)
+	{
+		handoff_produce_message();
+		send_time = get_time_ns();
+		ff_channel_send(channel, &send_time);
+	}
+}
+
+/**
+ * measures the delay between sending the message to the unbuffered ff_channel by the busy producer
+ * and receiving it by the consumer
+ */
+static void bench_handoff_channel_latency(void)
+{
+	struct ff_channel *channel;
+	int64_t send_time;
+	int64_t total_latency = 0;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	channel = ff_channel_create(sizeof(send_time), 0);
+	ff_core_fiberpool_execute_async(handoff_channel_latency_producer_func, channel);
+	for (i = 0; i < HANDOFF_LATENCY_MESSAGES_CNT; i++)
+	{
+		ff_channel_receive(channel, &send_time);
+		total_latency += get_time_ns() - send_time;
+	}
+	ff_channel_delete(channel);
+	ff_core_shutdown();
+
+	printf("handoff: channel latency, messages=%d, producer_work_ns=%d, avg_latency_ns=%.0f\n",
+		HANDOFF_LATENCY_MESSAGES_CNT, HANDOFF_PRODUCER_WORK_NS, (double) total_latency / HANDOFF_LATENCY_MESSAGES_CNT);
+}
+
+static void bench_handoff_all(void)
+{
+	bench_handoff_pipe_ping_pong();
+	bench_handoff_pipe_stream();
+	bench_handoff_pipe_latency();
+	bench_handoff_channel_latency();
+}
+
+/* end of fiber handoff benchmarks */
+
+/* start of ff_semaphore benchmarks */
+
+/**
+ * the timeout in milliseconds for waiters, which cannot acquire the semaphore
+ */
+#define SEMAPHORE_WAIT_TIMEOUT 100
+
+struct semaphore_timeouts_data
+{
+	struct ff_semaphore *semaphore;
+	struct ff_event *done_event;
+	int pending_waiters_cnt;
+};
+
+static void semaphore_timeouts_fiber_func(void *ctx)
+{
+	struct semaphore_timeouts_data *data;
+	enum ff_result result;
+
+	data = (struct semaphore_timeouts_data *) ctx;
+	result = ff_semaphore_down_with_timeout(data->semaphore, SEMAPHORE_WAIT_TIMEOUT);
+	ff_assert(result == FF_FAILURE);
+	data->pending_waiters_cnt--;
+	if (data->pending_waiters_cnt == 0)
+	{
+		ff_event_set(data->done_event);
+	}
+}
+
+/**
+ * measures the overhead of expiring timeouts of many fibers waiting for the overloaded semaphore
+ */
+static void bench_semaphore_timeouts(int waiters_cnt)
+{
+	struct semaphore_timeouts_data data;
+	struct ff_fiber **fibers;
+	int64_t start_time, end_time;
+	int64_t start_allocations_cnt, end_allocations_cnt;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.semaphore = ff_semaphore_create(0);
+	data.done_event = ff_event_create(FF_EVENT_MANUAL);
+	data.pending_waiters_cnt = waiters_cnt;
+	fibers = (struct ff_fiber **) malloc(waiters_cnt * sizeof(fibers[0]));
+	for (i = 0; i < waiters_cnt; i++)
+	{
+		fibers[i] = ff_fiber_create(semaphore_timeouts_fiber_func, FF_FIBER_SHARED_STACK);
+	}
+
+	start_allocations_cnt = allocations_cnt;
+	start_time = get_time_ns();
+	for (i = 0; i < waiters_cnt; i++)
+	{
+		ff_fiber_start(fibers[i], &data);
+	}
+	ff_event_wait(data.done_event);
+	end_time = get_time_ns();
+	end_allocations_cnt = allocations_cnt;
+
+	for (i = 0; i < waiters_cnt; i++)
+	{
+		ff_fiber_join(fibers[i]);
+		ff_fiber_delete(fibers[i]);
+	}
+	free(fibers);
+	ff_event_delete(data.done_event);
+	ff_semaphore_delete(data.semaphore);
+	ff_core_shutdown();
+
+	printf("semaphore: timeouts, waiters=%d, timeout_ms=%d, elapsed_ms=%.1f, overhead_per_waiter_ns=%.0f, allocations_per_waiter=%.3f\n",
+		waiters_cnt, SEMAPHORE_WAIT_TIMEOUT, (double) (end_time - start_time) / 1000000,
+		(double) (end_time - start_time - ((int64_t) SEMAPHORE_WAIT_TIMEOUT) * 1000000) / waiters_cnt,
+		(double) (end_allocations_cnt - start_allocations_cnt) / waiters_cnt);
+}
+
+static void bench_semaphore_all(void)
+{
+	bench_semaphore_timeouts(1000);
+	bench_semaphore_timeouts(10000);
+	bench_semaphore_timeouts(50000);
+}
+
+/* end of ff_semaphore benchmarks */
+
+/* start of ff_core threadpool benchmarks */
+
+#define THREADPOOL_CALLS_CNT 100000
+
+struct threadpool_execute_data
+{
+	int calls_per_fiber;
+	int completed_calls_cnt;
+};
+
+static void threadpool_noop_func(void *ctx)
+{
+	(void)ctx;
+}
+
+static void threadpool_execute_fiber_func(void *ctx)
+{
+	struct threadpool_execute_data *data;
+	int i;
+
+	data = (struct threadpool_execute_data *) ctx;
+	for (i = 0; i < data->calls_per_fiber; i++)
+	{
+		ff_core_threadpool_execute(threadpool_noop_func, NULL);
+		data->completed_calls_cnt++;
+	}
+}
+
+/**
+ * measures the round-trip overhead of offloading calls from fibers to the threadpool
+ */
+static void bench_threadpool_execute(int fibers_cnt)
+{
+	struct threadpool_execute_data data;
+	struct ff_fiber_group *group;
+	int64_t start_time, end_time;
+	int64_t start_allocations_cnt, end_allocations_cnt;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.calls_per_fiber = THREADPOOL_CALLS_CNT / fibers_cnt;
+	data.completed_calls_cnt = 0;
+	group = ff_fiber_group_create();
+
+	start_allocations_cnt = allocations_cnt;
+	start_time = get_time_ns();
+	for (i = 0; i < fibers_cnt; i++)
+	{
+		ff_fiber_group_spawn(group, threadpool_execute_fiber_func, &data);
+	}
+	ff_fiber_group_wait(group);
+	end_time = get_time_ns();
+	end_allocations_cnt = allocations_cnt;
+
+	ff_fiber_group_delete(group);
+	ff_core_shutdown();
+
+	printf("threadpool: execute, fibers=%d, calls=%d, round_trips_per_sec=%.0f, ns_per_call=%.0f, allocations_per_call=%.3f\n",
+		fibers_cnt, data.completed_calls_cnt, (double) data.completed_calls_cnt * 1000000000 / (end_time - start_time),
+		(double) (end_time - start_time) / data.completed_calls_cnt,
+		(double) (end_allocations_cnt - start_allocations_cnt) / data.completed_calls_cnt);
+}
+
+static void bench_threadpool_all(void)
+{
+	bench_threadpool_execute(1);
+	bench_threadpool_execute(8);
+	bench_threadpool_execute(64);
+	bench_threadpool_execute(1000);
+}
+
+/* end of ff_core threadpool benchmarks */
+
+/* start of idle fibers benchmarks */
+
+#define IDLE_FIBERS_CNT 10000
+
+/**
+ * returns the resident memory size of the process in bytes
+ */
+static int64_t get_resident_memory_size(void)
+{
+	FILE *stream;
+	long pages_cnt, resident_pages_cnt;
+	int rv;
+
+	stream = fopen("/proc/self/statm", "r");
+	if (stream == NULL)
+	{
+		return 0;
+	}
+	rv = fscanf(stream, "%ld %ld", &pages_cnt, &resident_pages_cnt);
+	fclose(stream);
+	if (rv != 2)
+	{
+		return 0;
+	}
+	return (int64_t) resident_pages_cnt * 4096;
+}
+
+static void idle_fiber_func(void *ctx)
+{
+	struct ff_event *event;
+	char buf[256];
+
+	/* touch some stack like a typical connection handler does */
+	event = (struct ff_event *) ctx;
+	memset(buf, 0, sizeof(buf));
+	ff_event_wait(event);
+}
+
+/**
+ * measures the resident memory occupied by fibers blocked on the event
+ */
+static void bench_idle_fibers(int stack_size, const char *name)
+{
+	struct ff_fiber **fibers;
+	struct ff_event *event;
+	int64_t start_memory_size, end_memory_size;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	event = ff_event_create(FF_EVENT_MANUAL);
+	fibers = (struct ff_fiber **) ff_calloc(IDLE_FIBERS_CNT, sizeof(fibers[0]));
+
+	start_memory_size = get_resident_memory_size();
+	for (i = 0; i < IDLE_FIBERS_CNT; i++)
+	{
+		fibers[i] = ff_fiber_create(idle_fiber_func, stack_size);
+		ff_fiber_start(fibers[i], event);
+	}
+	/* let all the fibers block on the event */
+	ff_core_sleep(10);
+	end_memory_size = get_resident_memory_size();
+
+	ff_event_set(event);
+	for (i = 0; i < IDLE_FIBERS_CNT; i++)
+	{
+		ff_fiber_join(fibers[i]);
+		ff_fiber_delete(fibers[i]);
+	}
+	ff_free(fibers);
+	ff_event_delete(event);
+	ff_core_shutdown();
+
+	printf("idle_fibers: stack=%s, fibers=%d, bytes_per_fiber=%.0f\n",
+		name, IDLE_FIBERS_CNT, (double) (end_memory_size - start_memory_size) / IDLE_FIBERS_CNT);
+}
+
+static void bench_idle_fibers_all(void)
+{
+	bench_idle_fibers(0, "private");
+	bench_idle_fibers(FF_FIBER_SHARED_STACK, "shared");
+}
+
+/* end of idle fibers benchmarks */
+
+/* start of tcp echo benchmarks */
+
+#define TCP_ECHO_PORT 43215
+
+#define TCP_ECHO_CLIENTS_CNT 16
+
+#define TCP_ECHO_REQUESTS_CNT 5000
+
+#define TCP_ECHO_MESSAGE_SIZE 64
+
+struct tcp_echo_data
+{
+	struct ff_arch_net_addr *addr;
+	struct ff_tcp *server_tcp;
+	struct ff_event *completed_event;
+	/* the number of finished clients and server connections */
+	int completed_cnt;
+};
+
+static void tcp_echo_complete(struct tcp_echo_data *data)
+{
+	data->completed_cnt++;
+	if (data->completed_cnt == 2 * TCP_ECHO_CLIENTS_CNT)
+	{
+		ff_event_set(data->completed_event);
+	}
+}
+
+struct tcp_echo_connection_data
+{
+	struct tcp_echo_data *data;
+	struct ff_tcp *tcp;
+};
+
+static void tcp_echo_server_connection_func(void *ctx)
+{
+	struct tcp_echo_connection_data *connection_data;
+	struct ff_tcp *tcp;
+	struct tcp_echo_data *data;
+	char buf[TCP_ECHO_MESSAGE_SIZE];
+	enum ff_result result;
+
+	connection_data = (struct tcp_echo_connection_data *) ctx;
+	data = connection_data->data;
+	tcp = connection_data->tcp;
+	ff_free(connection_data);
+	for (;;)
+	{
+		/* the client closes the connection after the last request */
+		result = ff_tcp_read(tcp, buf, sizeof(buf));
+		if (result != FF_SUCCESS)
+		{
+			break;
+		}
+		result = ff_tcp_write(tcp, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+		result = ff_tcp_flush(tcp);
+		ff_assert(result == FF_SUCCESS);
+	}
+	ff_tcp_delete(tcp);
+	tcp_echo_complete(data);
+}
+
+static void tcp_echo_acceptor_func(void *ctx)
+{
+	struct tcp_echo_data *data;
+	struct ff_arch_net_addr *remote_addr;
+	int i;
+
+	data = (struct tcp_echo_data *) ctx;
+	remote_addr = ff_arch_net_addr_create();
+	for (i = 0; i < TCP_ECHO_CLIENTS_CNT; i++)
+	{
+		struct tcp_echo_connection_data *connection_data;
+
+		connection_data = (struct tcp_echo_connection_data *) ff_malloc(sizeof(*connection_data));
+		connection_data->data = data;
+		connection_data->tcp = ff_tcp_accept(data->server_tcp, remote_addr);
+		ff_assert(connection_data->tcp != NULL);
+		ff_core_fiberpool_execute_async(tcp_echo_server_connection_func, connection_data);
+	}
+	ff_arch_net_addr_delete(remote_addr);
+}
+
+static void tcp_echo_client_func(void *ctx)
+{
+	struct ff_tcp *tcp;
+	struct tcp_echo_data *data;
+	char buf[TCP_ECHO_MESSAGE_SIZE];
+	enum ff_result result;
+	int i;
+
+	data = (struct tcp_echo_data *) ctx;
+	tcp = ff_tcp_create();
+	result = ff_tcp_connect(tcp, data->addr);
+	ff_assert(result == FF_SUCCESS);
+	memset(buf, 'x', sizeof(buf));
+	for (i = 0; i < TCP_ECHO_REQUESTS_CNT; i++)
+	{
+		result = ff_tcp_write(tcp, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+		result = ff_tcp_flush(tcp);
+		ff_assert(result == FF_SUCCESS);
+		result = ff_tcp_read(tcp, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+	}
+	ff_tcp_delete(tcp);
+	tcp_echo_complete(data);
+}
+
+/**
+ * The backend is selected by the FF_IO_BACKEND environment variable,
+ * which is read when the ff_core is initialized.
+ */
+static void bench_tcp_echo(const char *backend)
+{
+	struct tcp_echo_data data;
+	int64_t start_time, end_time;
+	enum ff_result result;
+	int i;
+
+	setenv("FF_IO_BACKEND", backend, 1);
+	ff_core_initialize(LOG_FILENAME);
+	data.addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(data.addr, L"127.0.0.1", TCP_ECHO_PORT);
+	ff_assert(result == FF_SUCCESS);
+	data.server_tcp = ff_tcp_create();
+	result = ff_tcp_bind(data.server_tcp, data.addr, FF_TCP_SERVER);
+	ff_assert(result == FF_SUCCESS);
+	data.completed_event = ff_event_create(FF_EVENT_AUTO);
+	data.completed_cnt = 0;
+
+	start_time = get_time_ns();
+	ff_core_fiberpool_execute_async(tcp_echo_acceptor_func, &data);
+	for (i = 0; i < TCP_ECHO_CLIENTS_CNT; i++)
+	{
+		ff_core_fiberpool_execute_async(tcp_echo_client_func, &data);
+	}
+	ff_event_wait(data.completed_event);
+	end_time = get_time_ns();
+
+	ff_event_delete(data.completed_event);
+	ff_tcp_delete(data.server_tcp);
+	ff_arch_net_addr_delete(data.addr);
+	ff_core_shutdown();
+	unsetenv("FF_IO_BACKEND");
+
+	printf("tcp_echo: backend=%s, clients=%d, requests=%d, requests_per_sec=%.0f\n",
+		backend, TCP_ECHO_CLIENTS_CNT, TCP_ECHO_CLIENTS_CNT * TCP_ECHO_REQUESTS_CNT,
+		TCP_ECHO_CLIENTS_CNT * TCP_ECHO_REQUESTS_CNT * 1e9 / (end_time - start_time));
+}
+
+static void bench_tcp_echo_all(void)
+{
+	bench_tcp_echo("epoll");
+	bench_tcp_echo("io_uring");
+}
+
+/* end of tcp echo benchmarks */
+
+/* start of tcp ping-pong benchmarks */
+
+#define TCP_PING_PONG_PORT 43216
+
+#define TCP_PING_PONG_ROUND_TRIPS_CNT 20000
+
+struct tcp_ping_pong_data
+{
+	struct ff_arch_net_addr *addr;
+	struct ff_event *ready_event;
+	struct ff_event *completed_event;
+};
+
+static void tcp_ping_pong_set_ready_event(void *ctx)
+{
+	struct tcp_ping_pong_data *data;
+
+	data = (struct tcp_ping_pong_data *) ctx;
+	ff_event_set(data->ready_event);
+}
+
+static void tcp_ping_pong_set_completed_event(void *ctx)
+{
+	struct tcp_ping_pong_data *data;
+
+	data = (struct tcp_ping_pong_data *) ctx;
+	ff_event_set(data->completed_event);
+}
+
+/**
+ * runs on the second scheduler, so every round trip wakes up another thread.
+ */
+static void tcp_ping_pong_server_func(void *ctx)
+{
+	struct tcp_ping_pong_data *data;
+	struct ff_tcp *server_tcp;
+	struct ff_tcp *tcp;
+	struct ff_arch_net_addr *remote_addr;
+	char buf[1];
+	enum ff_result result;
+
+	data = (struct tcp_ping_pong_data *) ctx;
+	server_tcp = ff_tcp_create();
+	result = ff_tcp_bind(server_tcp, data->addr, FF_TCP_SERVER);
+	ff_assert(result == FF_SUCCESS);
+	ff_core_post_to_scheduler(0, tcp_ping_pong_set_ready_event, data);
+
+	remote_addr = ff_arch_net_addr_create();
+	tcp = ff_tcp_accept(server_tcp, remote_addr);
+	ff_assert(tcp != NULL);
+	for (;;)
+	{
+		/* the client closes the connection after the last round trip */
+		result = ff_tcp_read(tcp, buf, sizeof(buf));
+		if (result != FF_SUCCESS)
+		{
+			break;
+		}
+		result = ff_tcp_write(tcp, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+		result = ff_tcp_flush(tcp);
+		ff_assert(result == FF_SUCCESS);
+	}
+	ff_tcp_delete(tcp);
+	ff_arch_net_addr_delete(remote_addr);
+	ff_tcp_delete(server_tcp);
+	ff_core_post_to_scheduler(0, tcp_ping_pong_set_completed_event, data);
+}
+
+/**
+ * The busy poll mode is selected by the FF_BUSY_POLL environment variable,
+ * which is read when schedulers are initialized.
+ */
+static void bench_tcp_ping_pong(const char *busy_poll)
+{
+	struct tcp_ping_pong_data data;
+	struct ff_tcp *tcp;
+	char buf[1];
+	int64_t start_time, end_time;
+	enum ff_result result;
+	int i;
+
+	setenv("FF_BUSY_POLL", busy_poll, 1);
+	ff_core_initialize_schedulers(LOG_FILENAME, 2, FF_CORE_SCHEDULER_ISOLATED);
+	data.addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(data.addr, L"127.0.0.1", TCP_PING_PONG_PORT);
+	ff_assert(result == FF_SUCCESS);
+	data.ready_event = ff_event_create(FF_EVENT_AUTO);
+	data.completed_event = ff_event_create(FF_EVENT_AUTO);
+	ff_core_post_to_scheduler(1, tcp_ping_pong_server_func, &data);
+	ff_event_wait(data.ready_event);
+
+	tcp = ff_tcp_create();
+	result = ff_tcp_connect(tcp, data.addr);
+	ff_assert(result == FF_SUCCESS);
+	buf[0] = 'x';
+	start_time = get_time_ns();
+	for (i = 0; i < TCP_PING_PONG_ROUND_TRIPS_CNT; i++)
+	{
+		result = ff_tcp_write(tcp, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+		result = ff_tcp_flush(tcp);
+		ff_assert(result == FF_SUCCESS);
+		result = ff_tcp_read(tcp, buf, sizeof(buf));
+		ff_assert(result == FF_SUCCESS);
+	}
+	end_time = get_time_ns();
+	ff_tcp_delete(tcp);
+	ff_event_wait(data.completed_event);
+
+	ff_event_delete(data.completed_event);
+	ff_event_delete(data.ready_event);
+	ff_arch_net_addr_delete(data.addr);
+	ff_core_shutdown();
+	unsetenv("FF_BUSY_POLL");
+
+	printf("tcp_ping_pong: busy_poll=%s, round_trips=%d, ns_per_round_trip=%.0f\n",
+		busy_poll, TCP_PING_PONG_ROUND_TRIPS_CNT, (double) (end_time - start_time) / TCP_PING_PONG_ROUND_TRIPS_CNT);
+}
+
+static void bench_tcp_ping_pong_all(void)
+{
+	bench_tcp_ping_pong("0");
+	bench_tcp_ping_pong("50");
+}
+
+/* end of tcp ping-pong benchmarks */
+
+static void bench_all(void)
+{
+	bench_timing_wheel_all();
+	bench_core_schedulers_all();
+	bench_context_switch_all();
+	bench_timer_all();
+	bench_fiber_lifecycle_all();
+	bench_fiber_group_all();
+	bench_channel_all();
+	bench_handoff_all();
+	bench_semaphore_all();
+	bench_threadpool_all();
+	bench_idle_fibers_all();
+	bench_tcp_echo_all();
+	bench_tcp_ping_pong_all();
+}
+
+int main(void)
+{
+	bench_all();
+	printf("ALL BENCHMARKS FINISHED\n");
+
+	return 0;
+}
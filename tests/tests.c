@@ -3,10 +3,13 @@
 #include "ff/arch/ff_arch_misc.h"
 #include "ff/ff_fiber.h"
 #include "ff/ff_event.h"
+#include "ff/ff_timer.h"
+#include "ff/ff_fiber_group.h"
 #include "ff/ff_mutex.h"
 #include "ff/ff_semaphore.h"
 #include "ff/ff_blocking_queue.h"
 #include "ff/ff_blocking_stack.h"
+#include "ff/ff_channel.h"
 #include "ff/ff_pool.h"
 #include "ff/ff_dictionary.h"
 #include "ff/ff_hash.h"
@@ -34,6 +37,61 @@
 
 #define ASSERT(expr, msg) assert((expr) && (msg))
 
+#ifndef WIN32
+
+#include <errno.h>
+#include <stddef.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+/**
+ * sets the environment variable, which is read by subsequent ff_core_initialize() calls.
+ * Returns the previous value of the variable, which must be passed to the restore_env_var().
+ */
+static char *set_env_var(const char *name, const char *value)
+{
+	const char *tmp;
+	char *prev_value = NULL;
+	int rv;
+
+	tmp = getenv(name);
+	if (tmp != NULL)
+	{
+		prev_value = strdup(tmp);
+		ASSERT(prev_value != NULL, "cannot copy the environment variable");
+	}
+	rv = setenv(name, value, 1);
+	ASSERT(rv == 0, "cannot set the environment variable");
+	return prev_value;
+}
+
+static void restore_env_var(const char *name, char *prev_value)
+{
+	int rv;
+
+	if (prev_value != NULL)
+	{
+		rv = setenv(name, prev_value, 1);
+		free(prev_value);
+	}
+	else
+	{
+		rv = unsetenv(name);
+	}
+	ASSERT(rv == 0, "cannot restore the environment variable");
+}
+
+#endif
+
 /* start of ff_malloc tests */
 
 static void test_malloc_basic(void)
@@ -109,6 +167,21 @@ static void test_core_sleep(void)
 	ff_core_shutdown();
 }
 
+static void test_core_now_ns(void)
+{
+	int64_t start_time;
+	int64_t current_time;
+
+	ff_core_initialize(LOG_FILENAME);
+	start_time = ff_core_now_ns();
+	current_time = ff_core_now_ns();
+	ASSERT(current_time == start_time, "the time should be cached while the fiber runs without switching");
+	ff_core_sleep(10);
+	current_time = ff_core_now_ns();
+	ASSERT(current_time - start_time >= 9 * 1000 * 1000, "the time should advance after the sleep");
+	ff_core_shutdown();
+}
+
 static void test_core_sleep_multiple(void)
 {
 	int i;
@@ -158,6 +231,43 @@ static void test_core_threadpool_execute_multiple(void)
 	ff_core_shutdown();
 }
 
+static void threadpool_concurrent_fiber_func(void *ctx)
+{
+	int *completed_cnt;
+	int i;
+
+	completed_cnt = (int *) ctx;
+	for (i = 0; i < 10; i++)
+	{
+		int a[2];
+
+		a[0] = i;
+		a[1] = 0;
+		ff_core_threadpool_execute(threadpool_int_increment, a);
+		ASSERT(a[1] == a[0] + 1, "unexpected result");
+	}
+	(*completed_cnt)++;
+}
+
+static void test_core_threadpool_execute_concurrent(void)
+{
+	struct ff_fiber_group *group;
+	int completed_cnt = 0;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	group = ff_fiber_group_create();
+	/* the number of simultaneous tasks exceeds the capacity of the threadpool's tasks ring */
+	for (i = 0; i < 2000; i++)
+	{
+		ff_fiber_group_spawn(group, threadpool_concurrent_fiber_func, &completed_cnt);
+	}
+	ff_fiber_group_wait(group);
+	ASSERT(completed_cnt == 2000, "all the fibers should complete");
+	ff_fiber_group_delete(group);
+	ff_core_shutdown();
+}
+
 static void fiberpool_int_increment(void *ctx)
 {
 	int *a;
@@ -218,18 +328,431 @@ static void test_core_fiberpool_execute_deferred_multiple(void)
 	ASSERT(a == 10, "unexpected result");
 }
 
+static void fiberpool_int_append(void *ctx)
+{
+	int *a;
+
+	a = (int *) ctx;
+	a[0] = a[0] * 10 + a[1];
+}
+
+static void test_core_fiberpool_execute_deferred_order(void)
+{
+	int a[3][2];
+
+	ff_core_initialize(LOG_FILENAME);
+	a[0][0] = 0;
+	a[0][1] = 3;
+	a[1][0] = 0;
+	a[1][1] = 2;
+	a[2][0] = 0;
+	a[2][1] = 1;
+	/* the deferred functions must be executed in the order of their expiration times,
+	 * not in the order of their registration.
+	 */
+	ff_core_fiberpool_execute_deferred(fiberpool_int_append, a[0], 300);
+	ff_core_fiberpool_execute_deferred(fiberpool_int_append, a[1], 200);
+	ff_core_fiberpool_execute_deferred(fiberpool_int_append, a[2], 2);
+	ff_core_sleep(100);
+	ASSERT(a[2][0] == 1, "unexpected result");
+	ASSERT(a[1][0] == 0, "unexpected result");
+	ASSERT(a[0][0] == 0, "unexpected result");
+	ff_core_sleep(150);
+	ASSERT(a[1][0] == 2, "unexpected result");
+	ASSERT(a[0][0] == 0, "unexpected result");
+	ff_core_shutdown();
+	ASSERT(a[0][0] == 3, "unexpected result");
+}
+
+static void test_core_schedulers_init(void)
+{
+	int i;
+
+	for (i = 1; i < 5; i++)
+	{
+		ff_core_initialize_schedulers(LOG_FILENAME, i, FF_CORE_SCHEDULER_ISOLATED);
+		ASSERT(ff_core_get_schedulers_cnt() == i, "unexpected schedulers count");
+		ASSERT(ff_core_get_current_scheduler_id() == 0, "unexpected scheduler id");
+		ff_core_shutdown();
+	}
+}
+
+#define SCHEDULERS_CNT 4
+
+struct schedulers_ping_data
+{
+	int scheduler_ids[SCHEDULERS_CNT];
+	int replies_cnt;
+	struct ff_event *replies_event;
+};
+
+static void scheduler_pong_func(void *ctx)
+{
+	struct schedulers_ping_data *data;
+
+	data = (struct schedulers_ping_data *) ctx;
+	ASSERT(ff_core_get_current_scheduler_id() == 0, "unexpected scheduler id");
+	data->replies_cnt++;
+	if (data->replies_cnt == SCHEDULERS_CNT)
+	{
+		ff_event_set(data->replies_event);
+	}
+}
+
+static void scheduler_ping_func(void *ctx)
+{
+	struct schedulers_ping_data *data;
+	int scheduler_id;
+
+	data = (struct schedulers_ping_data *) ctx;
+	scheduler_id = ff_core_get_current_scheduler_id();
+	/* each scheduler has its own timeouts */
+	ff_core_sleep(10);
+	data->scheduler_ids[scheduler_id] = scheduler_id;
+	ff_core_post_to_scheduler(0, scheduler_pong_func, data);
+}
+
+static void test_core_schedulers_post(void)
+{
+	struct schedulers_ping_data data;
+	int i;
+
+	ff_core_initialize_schedulers(LOG_FILENAME, SCHEDULERS_CNT, FF_CORE_SCHEDULER_ISOLATED);
+	data.replies_cnt = 0;
+	data.replies_event = ff_event_create(FF_EVENT_AUTO);
+	for (i = 0; i < SCHEDULERS_CNT; i++)
+	{
+		data.scheduler_ids[i] = -1;
+		ff_core_post_to_scheduler(i, scheduler_ping_func, &data);
+	}
+	ff_event_wait(data.replies_event);
+	ASSERT(data.replies_cnt == SCHEDULERS_CNT, "unexpected replies count");
+	for (i = 0; i < SCHEDULERS_CNT; i++)
+	{
+		ASSERT(data.scheduler_ids[i] == i, "the func was executed on unexpected scheduler");
+	}
+	ff_event_delete(data.replies_event);
+	ff_core_shutdown();
+}
+
+#define WORK_STEALING_TASKS_CNT 100
+
+struct work_stealing_data
+{
+	int completed_tasks_cnt;
+	struct ff_event *completed_event;
+};
+
+static void work_stealing_complete_func(void *ctx)
+{
+	struct work_stealing_data *data;
+
+	data = (struct work_stealing_data *) ctx;
+	data->completed_tasks_cnt++;
+	if (data->completed_tasks_cnt == WORK_STEALING_TASKS_CNT)
+	{
+		ff_event_set(data->completed_event);
+	}
+}
+
+static void work_stealing_task_func(void *ctx)
+{
+	ff_core_sleep(1);
+	ff_core_post_to_scheduler(0, work_stealing_complete_func, ctx);
+}
+
+static void test_core_schedulers_work_stealing(void)
+{
+	struct work_stealing_data data;
+	int i;
+
+	ff_core_initialize_schedulers(LOG_FILENAME, SCHEDULERS_CNT, FF_CORE_SCHEDULER_WORK_STEALING);
+	data.completed_tasks_cnt = 0;
+	data.completed_event = ff_event_create(FF_EVENT_AUTO);
+	for (i = 0; i < WORK_STEALING_TASKS_CNT; i++)
+	{
+		ff_core_fiberpool_execute_async(work_stealing_task_func, &data);
+	}
+	ff_event_wait(data.completed_event);
+	ASSERT(data.completed_tasks_cnt == WORK_STEALING_TASKS_CNT, "unexpected number of completed tasks");
+	ff_event_delete(data.completed_event);
+	ff_core_shutdown();
+}
+
+static void yield_if_needed_set_flag_func(void *ctx)
+{
+	int *is_flag_set;
+
+	is_flag_set = (int *) ctx;
+	*is_flag_set = 1;
+}
+
+static void test_core_yield_if_needed(void)
+{
+	volatile int is_flag_set = 0;
+
+	ff_core_initialize(LOG_FILENAME);
+	ff_core_fiberpool_execute_async(yield_if_needed_set_flag_func, (void *) &is_flag_set);
+	while (!is_flag_set)
+	{
+		/* the loop never ends if ff_core_yield_if_needed() doesn't let other fibers run */
+		ff_core_yield_if_needed();
+	}
+	ff_core_shutdown();
+}
+
+struct watchdog_data
+{
+	volatile int is_stopped;
+	struct ff_event *completed_event;
+};
+
+static void watchdog_complete_func(void *ctx)
+{
+	struct watchdog_data *data;
+
+	data = (struct watchdog_data *) ctx;
+	ff_event_set(data->completed_event);
+}
+
+static void watchdog_busy_loop_func(void *ctx)
+{
+	struct watchdog_data *data;
+
+	data = (struct watchdog_data *) ctx;
+	while (!data->is_stopped)
+	{
+		/* hog the scheduler without switching to other fibers */
+	}
+	ff_core_post_to_scheduler(0, watchdog_complete_func, ctx);
+}
+
+static void test_core_watchdog(void)
+{
+	struct watchdog_data data;
+
+	ff_core_initialize_schedulers(LOG_FILENAME, 2, FF_CORE_SCHEDULER_ISOLATED);
+	ff_core_set_watchdog_budget(20);
+	data.is_stopped = 0;
+	data.completed_event = ff_event_create(FF_EVENT_AUTO);
+	ff_core_post_to_scheduler(1, watchdog_busy_loop_func, &data);
+	ff_core_sleep(100);
+	data.is_stopped = 1;
+	ff_event_wait(data.completed_event);
+	ff_event_delete(data.completed_event);
+	ff_core_set_watchdog_budget(0);
+	ff_core_shutdown();
+}
+
+struct io_poll_data
+{
+	struct ff_event *ping_event;
+	struct ff_event *pong_event;
+	volatile int is_stopped;
+};
+
+static void io_poll_pong_func(void *ctx)
+{
+	struct io_poll_data *data;
+
+	data = (struct io_poll_data *) ctx;
+	while (!data->is_stopped)
+	{
+		ff_event_wait(data->ping_event);
+		ff_event_set(data->pong_event);
+	}
+}
+
+static void io_poll_ping_func(void *ctx)
+{
+	struct io_poll_data *data;
+
+	data = (struct io_poll_data *) ctx;
+	while (!data->is_stopped)
+	{
+		ff_event_set(data->ping_event);
+		ff_event_wait(data->pong_event);
+	}
+	ff_event_set(data->ping_event);
+}
+
+static void test_core_io_poll(void)
+{
+	struct io_poll_data data;
+	struct ff_core_io_poll_stats stats;
+
+	ff_core_initialize(LOG_FILENAME);
+	ff_core_set_io_poll_policy(10, 0);
+	data.ping_event = ff_event_create(FF_EVENT_AUTO);
+	data.pong_event = ff_event_create(FF_EVENT_AUTO);
+	data.is_stopped = 0;
+	ff_core_fiberpool_execute_async(io_poll_pong_func, &data);
+	ff_core_fiberpool_execute_async(io_poll_ping_func, &data);
+	/* fibers above are always ready to run, so the timer of the sleep
+	 * can be noticed only by periodic checks of the completion port.
+	 */
+	ff_core_sleep(10);
+	data.is_stopped = 1;
+	ff_core_get_io_poll_stats(&stats);
+	ASSERT(stats.polls_cnt > 0, "the completion port should be checked while there are ready fibers");
+	ASSERT(stats.events_cnt > 0, "the timer event should be obtained by the check");
+	ASSERT(stats.max_delay >= 0, "unexpected max_delay");
+	ff_core_sleep(10);
+	ff_event_delete(data.ping_event);
+	ff_event_delete(data.pong_event);
+	ff_core_set_io_poll_policy(64, 0);
+	ff_core_shutdown();
+}
+
+#define PRIORITY_LOW_TASKS_CNT 10
+
+struct priority_order_data
+{
+	enum ff_fiber_priority order[PRIORITY_LOW_TASKS_CNT + 1];
+	int runs_cnt;
+	struct ff_event *done_event;
+};
+
+static void priority_order_func(void *ctx)
+{
+	struct priority_order_data *data;
+
+	data = (struct priority_order_data *) ctx;
+	data->order[data->runs_cnt] = ff_fiber_get_priority(ff_fiber_get_current());
+	data->runs_cnt++;
+	if (data->runs_cnt == PRIORITY_LOW_TASKS_CNT + 1)
+	{
+		ff_event_set(data->done_event);
+	}
+}
+
+static void test_core_priority_order(void)
+{
+	struct priority_order_data data;
+	struct ff_core_priority_stats stats;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.runs_cnt = 0;
+	data.done_event = ff_event_create(FF_EVENT_AUTO);
+	for (i = 0; i < PRIORITY_LOW_TASKS_CNT; i++)
+	{
+		ff_core_fiberpool_execute_async_with_priority(priority_order_func, &data, FF_FIBER_PRIORITY_LOW);
+	}
+	ff_core_fiberpool_execute_async_with_priority(priority_order_func, &data, FF_FIBER_PRIORITY_HIGH);
+	ff_event_wait(data.done_event);
+	ASSERT(data.order[0] == FF_FIBER_PRIORITY_HIGH, "the fiber with high priority should run first");
+	for (i = 1; i <= PRIORITY_LOW_TASKS_CNT; i++)
+	{
+		ASSERT(data.order[i] == FF_FIBER_PRIORITY_LOW, "unexpected priority of the fiber");
+	}
+	ASSERT(ff_fiber_get_priority(ff_fiber_get_current()) == FF_FIBER_PRIORITY_NORMAL, "unexpected priority of the main fiber");
+	ff_core_get_priority_stats(&stats);
+	ASSERT(stats.runs_cnt[FF_FIBER_PRIORITY_HIGH] > 0, "the fiber with high priority should be counted");
+	ff_event_delete(data.done_event);
+	ff_core_shutdown();
+}
+
+struct priority_starvation_data
+{
+	struct ff_event *ping_event;
+	struct ff_event *pong_event;
+	int is_low_run;
+};
+
+static void priority_starvation_low_func(void *ctx)
+{
+	struct priority_starvation_data *data;
+
+	data = (struct priority_starvation_data *) ctx;
+	data->is_low_run = 1;
+}
+
+static void priority_starvation_ping_func(void *ctx)
+{
+	struct priority_starvation_data *data;
+
+	data = (struct priority_starvation_data *) ctx;
+	/* fibers with high priority are always ready to run, so the fiber with low priority
+	 * can run only due to the starvation protection.
+	 */
+	ff_core_fiberpool_execute_async_with_priority(priority_starvation_low_func, data, FF_FIBER_PRIORITY_LOW);
+	while (!data->is_low_run)
+	{
+		ff_event_set(data->ping_event);
+		ff_event_wait(data->pong_event);
+	}
+	ff_event_set(data->ping_event);
+}
+
+static void priority_starvation_pong_func(void *ctx)
+{
+	struct priority_starvation_data *data;
+
+	data = (struct priority_starvation_data *) ctx;
+	while (!data->is_low_run)
+	{
+		ff_event_wait(data->ping_event);
+		ff_event_set(data->pong_event);
+	}
+}
+
+static void test_core_priority_starvation(void)
+{
+	struct priority_starvation_data data;
+	struct ff_core_priority_stats stats;
+	struct ff_fiber *ping_fiber;
+	struct ff_fiber *pong_fiber;
+
+	ff_core_initialize(LOG_FILENAME);
+	ff_core_enable_run_time_stats(1);
+	data.ping_event = ff_event_create(FF_EVENT_AUTO);
+	data.pong_event = ff_event_create(FF_EVENT_AUTO);
+	data.is_low_run = 0;
+	pong_fiber = ff_fiber_create(priority_starvation_pong_func, 0);
+	ff_fiber_set_priority(pong_fiber, FF_FIBER_PRIORITY_HIGH);
+	ff_fiber_start(pong_fiber, &data);
+	ping_fiber = ff_fiber_create(priority_starvation_ping_func, 0);
+	ff_fiber_set_priority(ping_fiber, FF_FIBER_PRIORITY_HIGH);
+	ff_fiber_start(ping_fiber, &data);
+	ff_fiber_join(ping_fiber);
+	ff_fiber_join(pong_fiber);
+	ff_fiber_delete(ping_fiber);
+	ff_fiber_delete(pong_fiber);
+	ASSERT(data.is_low_run, "the fiber with low priority should run");
+	ff_core_get_priority_stats(&stats);
+	ASSERT(stats.starvation_runs_cnt[FF_FIBER_PRIORITY_LOW] > 0, "the fiber with low priority should be run out of order");
+	ASSERT(stats.starvation_runs_cnt[FF_FIBER_PRIORITY_HIGH] == 0, "fibers with high priority cannot starve");
+	ASSERT(stats.run_time[FF_FIBER_PRIORITY_HIGH] > 0, "the run time of fibers with high priority should be measured");
+	ff_core_enable_run_time_stats(0);
+	ff_event_delete(data.ping_event);
+	ff_event_delete(data.pong_event);
+	ff_core_shutdown();
+}
+
 static void test_core_all(void)
 {
 	test_core_init();
 	test_core_init_multiple();
 	test_core_sleep();
+	test_core_now_ns();
 	test_core_sleep_multiple();
 	test_core_threadpool_execute();
 	test_core_threadpool_execute_multiple();
+	test_core_threadpool_execute_concurrent();
 	test_core_fiberpool_execute();
 	test_core_fiberpool_execute_multiple();
 	test_core_fiberpool_execute_deferred();
 	test_core_fiberpool_execute_deferred_multiple();
+	test_core_fiberpool_execute_deferred_order();
+	test_core_schedulers_init();
+	test_core_schedulers_post();
+	test_core_schedulers_work_stealing();
+	test_core_yield_if_needed();
+	test_core_watchdog();
+	test_core_io_poll();
+	test_core_priority_order();
+	test_core_priority_starvation();
 }
 
 /* end of ff_core tests */
@@ -428,35 +951,419 @@ static void test_fiber_start_multiple(void)
 	ff_core_shutdown();
 }
 
-static void test_fiber_all(void)
+static void fiber_func_double(void *ctx)
 {
-	test_fiber_create_delete();
-	test_fiber_start_join();
-	test_fiber_start_multiple();
-}
-
-/* end of ff_fiber tests */
+	int *a;
 
-/* start of ff_event tests */
+	a = (int *) ctx;
+	(*a) *= 2;
+}
 
-static void test_event_manual_create_delete(void)
+static void test_fiber_reuse(void)
 {
-	struct ff_event *event;
+	struct ff_fiber *fiber;
+	int a = 0;
+	int i;
 
 	ff_core_initialize(LOG_FILENAME);
-
-	event = ff_event_create(FF_EVENT_MANUAL);
-	ASSERT(event != NULL, "unexpected result");
-	ff_event_delete(event);
-
+	for (i = 0; i < 10; i++)
+	{
+		/* deleted fibers may be reused by subsequent ff_fiber_create() calls */
+		fiber = ff_fiber_create(fiber_func, 0);
+		ff_fiber_start(fiber, &a);
+		ff_fiber_join(fiber);
+		ff_fiber_delete(fiber);
+		fiber = ff_fiber_create(fiber_func_double, 0);
+		ff_fiber_start(fiber, &a);
+		ff_fiber_join(fiber);
+		ff_fiber_delete(fiber);
+	}
+	ASSERT(a == 2046, "unexpected result");
+	/* fibers, which were never started, may be reused too */
+	fiber = ff_fiber_create(fiber_func, 0);
+	ff_fiber_delete(fiber);
+	fiber = ff_fiber_create(fiber_func, 0);
+	ff_fiber_start(fiber, &a);
+	ff_fiber_join(fiber);
+	ff_fiber_delete(fiber);
+	ASSERT(a == 2047, "unexpected result");
 	ff_core_shutdown();
 }
 
-static void test_event_auto_create_delete(void)
+struct shared_stack_fiber_data
 {
-	struct ff_event *event;
+	int id;
+	int *checks_cnt;
+};
 
-	ff_core_initialize(LOG_FILENAME);
+static void shared_stack_threadpool_func(void *ctx)
+{
+	int *a;
+
+	a = (int *) ctx;
+	(*a)++;
+}
+
+static int shared_stack_fill(int id, int depth)
+{
+	int buf[64];
+	int sum;
+	int i;
+
+	for (i = 0; i < 64; i++)
+	{
+		buf[i] = id * 1000 + depth + i;
+	}
+	if (depth > 0)
+	{
+		sum = shared_stack_fill(id, depth - 1);
+	}
+	else
+	{
+		/* other fibers overwrite the shared stack while this fiber sleeps */
+		ff_core_sleep(1);
+		sum = 0;
+	}
+	for (i = 0; i < 64; i++)
+	{
+		sum += (buf[i] == id * 1000 + depth + i) ? 1 : 0;
+	}
+	return sum;
+}
+
+static void shared_stack_fiber_func(void *ctx)
+{
+	struct shared_stack_fiber_data *data;
+	int a;
+	int sum;
+
+	data = (struct shared_stack_fiber_data *) ctx;
+	sum = shared_stack_fill(data->id, data->id % 10);
+	if (sum == 64 * (data->id % 10 + 1))
+	{
+		(*data->checks_cnt)++;
+	}
+	/* the threadpool accesses the variable on the shared stack */
+	a = data->id;
+	ff_core_threadpool_execute(shared_stack_threadpool_func, &a);
+	if (a == data->id + 1)
+	{
+		(*data->checks_cnt)++;
+	}
+}
+
+static void test_fiber_shared_stack(void)
+{
+	struct ff_fiber *fibers[50];
+	struct shared_stack_fiber_data data[50];
+	int checks_cnt = 0;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	for (i = 0; i < 50; i++)
+	{
+		data[i].id = i;
+		data[i].checks_cnt = &checks_cnt;
+		fibers[i] = ff_fiber_create(shared_stack_fiber_func, FF_FIBER_SHARED_STACK);
+		ff_fiber_start(fibers[i], &data[i]);
+	}
+	for (i = 0; i < 50; i++)
+	{
+		ff_fiber_join(fibers[i]);
+		ff_fiber_delete(fibers[i]);
+	}
+	ASSERT(checks_cnt == 100, "unexpected result");
+	ff_core_shutdown();
+}
+
+struct shared_stack_pinned_data
+{
+	struct ff_event *event;
+	volatile int is_released;
+	int woken_cnt;
+};
+
+static void shared_stack_pinned_threadpool_func(void *ctx)
+{
+	struct shared_stack_pinned_data *data;
+
+	data = (struct shared_stack_pinned_data *) ctx;
+	while (!data->is_released)
+	{
+		/* keep the stack of the owner fiber pinned until the main fiber releases it */
+	}
+}
+
+static void shared_stack_pinned_owner_func(void *ctx)
+{
+	ff_core_threadpool_execute(shared_stack_pinned_threadpool_func, ctx);
+}
+
+static void shared_stack_pinned_waiter_func(void *ctx)
+{
+	struct shared_stack_pinned_data *data;
+
+	data = (struct shared_stack_pinned_data *) ctx;
+	ff_event_wait(data->event);
+	data->woken_cnt++;
+}
+
+static void test_fiber_shared_stack_pinned(void)
+{
+	struct shared_stack_pinned_data data;
+	struct ff_fiber **waiters;
+	struct ff_fiber *owner;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.event = ff_event_create(FF_EVENT_MANUAL);
+	data.is_released = 0;
+	data.woken_cnt = 0;
+	waiters = (struct ff_fiber **) ff_calloc(10000, sizeof(waiters[0]));
+	for (i = 0; i < 10000; i++)
+	{
+		waiters[i] = ff_fiber_create(shared_stack_pinned_waiter_func, FF_FIBER_SHARED_STACK);
+		ff_fiber_start(waiters[i], &data);
+	}
+	/* the owner occupies the shared stack and pins it while the threadpool executes the call */
+	owner = ff_fiber_create(shared_stack_pinned_owner_func, FF_FIBER_SHARED_STACK);
+	ff_fiber_start(owner, &data);
+
+	/* all the waiters become runnable at once while the shared stack is pinned */
+	ff_event_set(data.event);
+	ff_core_sleep(10);
+	ASSERT(data.woken_cnt == 0, "waiters cannot run while the shared stack is pinned");
+
+	data.is_released = 1;
+	ff_fiber_join(owner);
+	ff_fiber_delete(owner);
+	for (i = 0; i < 10000; i++)
+	{
+		ff_fiber_join(waiters[i]);
+		ff_fiber_delete(waiters[i]);
+	}
+	ASSERT(data.woken_cnt == 10000, "all the waiters should run after the shared stack is unpinned");
+	ff_free(waiters);
+	ff_event_delete(data.event);
+	ff_core_shutdown();
+}
+
+#ifndef WIN32
+
+static int stack_overflow_recurse(int depth)
+{
+	volatile char buf[1024];
+
+	buf[0] = (char) depth;
+	if (depth > 0)
+	{
+		return stack_overflow_recurse(depth - 1) + buf[0];
+	}
+	return buf[0];
+}
+
+static void stack_overflow_fiber_func(void *ctx)
+{
+	int *a;
+
+	a = (int *) ctx;
+	/* the recursion needs much more memory than the fiber's stack has */
+	*a = stack_overflow_recurse(1000000);
+}
+
+static void test_fiber_stack_overflow(void)
+{
+	char output[256];
+	int fds[2];
+	pid_t pid;
+	int status;
+	int output_len;
+	int rv;
+
+	rv = pipe(fds);
+	ASSERT(rv == 0, "cannot create the pipe");
+	pid = fork();
+	ASSERT(pid != -1, "cannot fork the process");
+	if (pid == 0)
+	{
+		struct rlimit core_limit;
+		struct ff_fiber *fiber;
+		int a = 0;
+
+		/* the crash of the child process shouldn't leave the core dump */
+		core_limit.rlim_cur = 0;
+		core_limit.rlim_max = 0;
+		setrlimit(RLIMIT_CORE, &core_limit);
+		dup2(fds[1], STDERR_FILENO);
+		close(fds[0]);
+		ff_core_initialize(LOG_FILENAME);
+		fiber = ff_fiber_create(stack_overflow_fiber_func, 0x4000);
+		ff_fiber_start(fiber, &a);
+		ff_fiber_join(fiber);
+		_exit(0);
+	}
+	close(fds[1]);
+	output_len = 0;
+	for (;;)
+	{
+		ssize_t bytes_read;
+
+		bytes_read = read(fds[0], output + output_len, sizeof(output) - 1 - output_len);
+		if (bytes_read <= 0)
+		{
+			break;
+		}
+		output_len += (int) bytes_read;
+	}
+	output[output_len] = '\0';
+	close(fds[0]);
+	pid = waitpid(pid, &status, 0);
+	ASSERT(pid != -1, "cannot wait for the child process");
+	ASSERT(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV, "the stack overflow should terminate the process with SIGSEGV");
+	ASSERT(strstr(output, "fatal error: fiber stack overflow") != NULL, "the stack overflow should be reported to stderr");
+}
+
+#endif
+
+static int stack_profiler_recurse(int depth)
+{
+	volatile char buf[1024];
+
+	buf[0] = (char) depth;
+	if (depth > 0)
+	{
+		return stack_profiler_recurse(depth - 1) + buf[0];
+	}
+	return buf[0];
+}
+
+static void stack_profiler_fiber_func(void *ctx)
+{
+	int *a;
+
+	a = (int *) ctx;
+	*a = stack_profiler_recurse(10);
+}
+
+static void test_fiber_stack_profiler(void)
+{
+	struct ff_fiber_stack_usage stack_usages[10];
+	struct ff_fiber *fiber;
+	int stack_usages_cnt;
+	int a = 0;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	ff_fiber_enable_stack_profiler(1);
+	for (i = 0; i < 3; i++)
+	{
+		fiber = ff_fiber_create(stack_profiler_fiber_func, 0x10000);
+		ff_fiber_start(fiber, &a);
+		ff_fiber_join(fiber);
+		ff_fiber_delete(fiber);
+	}
+	ff_fiber_enable_stack_profiler(0);
+	ASSERT(a == 55, "unexpected result");
+	stack_usages_cnt = ff_fiber_get_stack_usages(stack_usages, 10);
+	/* the stack profiler isn't supported on some platforms */
+	ASSERT(stack_usages_cnt <= 1, "unexpected stack usages count");
+	if (stack_usages_cnt == 1)
+	{
+		ASSERT(stack_usages[0].fiber_func == stack_profiler_fiber_func, "unexpected fiber_func");
+		ASSERT(stack_usages[0].fibers_cnt == 3, "unexpected fibers count");
+		ASSERT(stack_usages[0].max_stack_usage >= 11 * 1024, "too small stack usage");
+		ASSERT(stack_usages[0].max_stack_usage < stack_usages[0].max_stack_size, "too big stack usage");
+		ASSERT(stack_usages[0].max_stack_size >= 0x10000, "unexpected stack size");
+	}
+	ff_fiber_log_stack_usages();
+	ff_core_shutdown();
+}
+
+struct fiber_switch_to_data
+{
+	struct ff_event *event;
+	int a;
+};
+
+static void fiber_switch_to_func(void *ctx)
+{
+	struct fiber_switch_to_data *data;
+
+	data = (struct fiber_switch_to_data *) ctx;
+	data->a++;
+	ff_event_wait(data->event);
+	data->a++;
+}
+
+static void test_fiber_switch_to(void)
+{
+	struct fiber_switch_to_data data1, data2;
+	struct ff_fiber *fiber1, *fiber2;
+
+	ff_core_initialize(LOG_FILENAME);
+	data1.event = ff_event_create(FF_EVENT_AUTO);
+	data1.a = 0;
+	data2.event = ff_event_create(FF_EVENT_AUTO);
+	data2.a = 0;
+	fiber1 = ff_fiber_create(fiber_switch_to_func, 0);
+	fiber2 = ff_fiber_create(fiber_switch_to_func, 0);
+	ff_fiber_start(fiber1, &data1);
+	ff_fiber_switch_to(fiber1);
+	ASSERT(data1.a == 1, "the started fiber should run immediately");
+	ff_fiber_start(fiber2, &data2);
+	ff_event_set(data1.event);
+	ff_fiber_switch_to(fiber2);
+	ASSERT(data2.a == 0, "the fiber, which isn't the most recently woken, shouldn't run");
+	ff_fiber_switch_to(fiber1);
+	ASSERT(data1.a == 2, "the woken fiber should run immediately");
+	ff_fiber_join(fiber1);
+	ff_event_set(data2.event);
+	ff_fiber_join(fiber2);
+	ASSERT(data2.a == 2, "the fiber should be finished");
+	ff_fiber_delete(fiber1);
+	ff_fiber_delete(fiber2);
+	ff_event_delete(data1.event);
+	ff_event_delete(data2.event);
+	ff_core_shutdown();
+}
+
+static void test_fiber_all(void)
+{
+	test_fiber_create_delete();
+	test_fiber_start_join();
+	test_fiber_start_multiple();
+	test_fiber_reuse();
+	test_fiber_shared_stack();
+	test_fiber_shared_stack_pinned();
+#ifndef WIN32
+	test_fiber_stack_overflow();
+#endif
+	test_fiber_stack_profiler();
+	test_fiber_switch_to();
+}
+
+/* end of ff_fiber tests */
+
+/* start of ff_event tests */
+
+static void test_event_manual_create_delete(void)
+{
+	struct ff_event *event;
+
+	ff_core_initialize(LOG_FILENAME);
+
+	event = ff_event_create(FF_EVENT_MANUAL);
+	ASSERT(event != NULL, "unexpected result");
+	ff_event_delete(event);
+
+	ff_core_shutdown();
+}
+
+static void test_event_auto_create_delete(void)
+{
+	struct ff_event *event;
+
+	ff_core_initialize(LOG_FILENAME);
 
 	event = ff_event_create(FF_EVENT_AUTO);
 	ASSERT(event != NULL, "unexpected result");
@@ -624,49 +1531,404 @@ static void test_event_auto_multiple(void)
 {
 	struct ff_event *event, *done_event;
 	int i;
-	int a = 0;
-	void *data[3];
+	int a = 0;
+	void *data[3];
+
+	ff_core_initialize(LOG_FILENAME);
+	event = ff_event_create(FF_EVENT_AUTO);
+	done_event = ff_event_create(FF_EVENT_MANUAL);
+	data[0] = event;
+	data[1] = done_event;
+	data[2] = &a;
+	for (i = 0; i < 15; i++)
+	{
+		ff_core_fiberpool_execute_async(fiberpool_event_func, data);
+	}
+	ASSERT(a == 0, "a shouldn't change while event isn't set");
+	for (i = 0; i < 14; i++)
+	{
+		enum ff_result result;
+
+		ff_event_set(event);
+		result = ff_event_wait_with_timeout(done_event, 1);
+		ASSERT(result != FF_SUCCESS, "done_event should remain 'not set'");
+	}
+	ff_event_set(event);
+	ff_event_wait(done_event);
+	ASSERT(a == 15, "a should have value 15 after done_event set");
+	ff_event_delete(done_event);
+	ff_event_delete(event);
+	ff_core_shutdown();
+}
+
+static void test_event_set_and_switch(void)
+{
+	struct fiber_switch_to_data data;
+	struct ff_fiber *fiber;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.event = ff_event_create(FF_EVENT_AUTO);
+	data.a = 0;
+	fiber = ff_fiber_create(fiber_switch_to_func, 0);
+	ff_fiber_start(fiber, &data);
+	ff_fiber_switch_to(fiber);
+	ASSERT(data.a == 1, "the fiber should wait for the event");
+	ff_event_set_and_switch(data.event);
+	ASSERT(data.a == 2, "the woken fiber should run immediately");
+	ASSERT(!ff_event_is_set(data.event), "the auto-reset event should be reset after waking up the fiber");
+	ff_event_set_and_switch(data.event);
+	ASSERT(ff_event_is_set(data.event), "the event without waiters should remain set");
+	ff_fiber_join(fiber);
+	ff_fiber_delete(fiber);
+	ff_event_delete(data.event);
+	ff_core_shutdown();
+}
+
+static void test_event_all(void)
+{
+	test_event_manual_create_delete();
+	test_event_auto_create_delete();
+	test_event_manual_basic();
+	test_event_auto_basic();
+	test_event_manual_timeout();
+	test_event_auto_timeout();
+	test_event_manual_multiple();
+	test_event_auto_multiple();
+	test_event_set_and_switch();
+}
+
+/* end of ff_event tests */
+
+/* start of ff_timer tests */
+
+static void timer_counter_func(void *ctx)
+{
+	int *counter;
+
+	counter = (int *) ctx;
+	(*counter)++;
+}
+
+static void test_timer_create_delete(void)
+{
+	struct ff_timer *timer;
+	int counter = 0;
+
+	ff_core_initialize(LOG_FILENAME);
+	timer = ff_timer_create(FF_TIMER_INLINE, timer_counter_func, &counter);
+	ASSERT(!ff_timer_is_active(timer), "new timer should be stopped");
+	ff_timer_delete(timer);
+	ff_core_shutdown();
+}
+
+static void test_timer_oneshot(void)
+{
+	struct ff_timer *timer;
+	int counter = 0;
+
+	ff_core_initialize(LOG_FILENAME);
+	timer = ff_timer_create(FF_TIMER_INLINE, timer_counter_func, &counter);
+	ff_timer_start(timer, 10);
+	ASSERT(ff_timer_is_active(timer), "started timer should be active");
+	ff_core_sleep(50);
+	ASSERT(counter == 1, "one-shot timer should fire once");
+	ASSERT(!ff_timer_is_active(timer), "one-shot timer should be stopped after firing");
+	ff_timer_delete(timer);
+	ff_core_shutdown();
+}
+
+static void test_timer_stop(void)
+{
+	struct ff_timer *timer;
+	int counter = 0;
+
+	ff_core_initialize(LOG_FILENAME);
+	timer = ff_timer_create(FF_TIMER_INLINE, timer_counter_func, &counter);
+	ff_timer_start(timer, 10);
+	ff_timer_stop(timer);
+	ASSERT(!ff_timer_is_active(timer), "timer should be stopped");
+	ff_core_sleep(30);
+	ASSERT(counter == 0, "stopped timer shouldn't fire");
+	ff_timer_delete(timer);
+	ff_core_shutdown();
+}
+
+static void test_timer_restart(void)
+{
+	struct ff_timer *timer;
+	int counter = 0;
+
+	ff_core_initialize(LOG_FILENAME);
+	timer = ff_timer_create(FF_TIMER_INLINE, timer_counter_func, &counter);
+	ff_timer_start(timer, 10000);
+	ff_timer_start(timer, 10);
+	ff_core_sleep(50);
+	ASSERT(counter == 1, "re-armed timer should fire once");
+	ff_timer_delete(timer);
+	ff_core_shutdown();
+}
+
+struct timer_periodic_data
+{
+	struct ff_event *done_event;
+	int counter;
+};
+
+static void timer_periodic_func(void *ctx)
+{
+	struct timer_periodic_data *data;
+
+	data = (struct timer_periodic_data *) ctx;
+	data->counter++;
+	if (data->counter == 5)
+	{
+		ff_event_set(data->done_event);
+	}
+	/* the func runs in the fiberpool, so it can block */
+	ff_core_sleep(1);
+}
+
+static void test_timer_periodic(void)
+{
+	struct ff_timer *timer;
+	struct timer_periodic_data data;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.done_event = ff_event_create(FF_EVENT_MANUAL);
+	data.counter = 0;
+	timer = ff_timer_create(FF_TIMER_FIBERPOOL, timer_periodic_func, &data);
+	ff_timer_start_periodic(timer, 5);
+	ff_event_wait(data.done_event);
+	ASSERT(ff_timer_is_active(timer), "periodic timer should remain active");
+	ff_timer_stop(timer);
+	ff_timer_delete(timer);
+	ASSERT(data.counter >= 5, "periodic timer should fire multiple times");
+	ff_event_delete(data.done_event);
+	ff_core_shutdown();
+}
+
+static void test_timer_all(void)
+{
+	test_timer_create_delete();
+	test_timer_oneshot();
+	test_timer_stop();
+	test_timer_restart();
+	test_timer_periodic();
+}
+
+/* end of ff_timer tests */
+
+/* start of ff_fiber_group tests */
+
+static void test_fiber_group_create_delete(void)
+{
+	struct ff_fiber_group *group;
+
+	ff_core_initialize(LOG_FILENAME);
+	group = ff_fiber_group_create();
+	ASSERT(ff_fiber_group_get_completed_cnt(group) == 0, "new group shouldn't have completed children");
+	ff_fiber_group_wait(group);
+	ff_fiber_group_delete(group);
+	ff_core_shutdown();
+}
+
+static void fiber_group_counter_func(void *ctx)
+{
+	int *counter;
+
+	counter = (int *) ctx;
+	ff_core_sleep(1);
+	(*counter)++;
+}
+
+static void test_fiber_group_wait(void)
+{
+	struct ff_fiber_group *group;
+	int counter = 0;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	group = ff_fiber_group_create();
+	for (i = 0; i < 10; i++)
+	{
+		ff_fiber_group_spawn(group, fiber_group_counter_func, &counter);
+	}
+	ff_fiber_group_wait(group);
+	ASSERT(counter == 10, "all the children should be completed");
+	ASSERT(ff_fiber_group_get_completed_cnt(group) == 10, "unexpected number of completed children");
+
+	/* children of the group can be spawned again after the wait */
+	for (i = 0; i < 10; i++)
+	{
+		ff_fiber_group_spawn(group, fiber_group_counter_func, &counter);
+	}
+	ff_fiber_group_wait(group);
+	ASSERT(counter == 20, "all the children should be completed");
+	ASSERT(ff_fiber_group_get_completed_cnt(group) == 20, "unexpected number of completed children");
+	ff_fiber_group_delete(group);
+	ff_core_shutdown();
+}
+
+struct fiber_group_cancel_data
+{
+	struct ff_event *event;
+	int fast_cnt;
+	int cancelled_cnt;
+};
+
+static void fiber_group_fast_func(void *ctx)
+{
+	struct fiber_group_cancel_data *data;
+
+	data = (struct fiber_group_cancel_data *) ctx;
+	ff_core_sleep(1);
+	ASSERT(!ff_fiber_is_cancelled(ff_fiber_get_current()), "fast child shouldn't be cancelled");
+	data->fast_cnt++;
+}
+
+static void fiber_group_sleep_func(void *ctx)
+{
+	struct fiber_group_cancel_data *data;
+
+	data = (struct fiber_group_cancel_data *) ctx;
+	ff_core_sleep(100000);
+	ASSERT(ff_fiber_is_cancelled(ff_fiber_get_current()), "the sleep should be interrupted by the cancellation");
+	data->cancelled_cnt++;
+}
+
+static void fiber_group_event_func(void *ctx)
+{
+	struct fiber_group_cancel_data *data;
+	enum ff_result result;
+
+	data = (struct fiber_group_cancel_data *) ctx;
+	result = ff_event_wait_with_timeout(data->event, 100000);
+	ASSERT(result == FF_FAILURE, "the wait should be aborted by the cancellation");
+	ASSERT(!ff_event_is_set(data->event), "the event shouldn't be set");
+	data->cancelled_cnt++;
+}
+
+static void test_fiber_group_wait_first(void)
+{
+	struct ff_fiber_group *group;
+	struct fiber_group_cancel_data data;
+	enum ff_result result;
+	int i;
 
 	ff_core_initialize(LOG_FILENAME);
-	event = ff_event_create(FF_EVENT_AUTO);
-	done_event = ff_event_create(FF_EVENT_MANUAL);
-	data[0] = event;
-	data[1] = done_event;
-	data[2] = &a;
-	for (i = 0; i < 15; i++)
+	data.event = ff_event_create(FF_EVENT_AUTO);
+	data.fast_cnt = 0;
+	data.cancelled_cnt = 0;
+	group = ff_fiber_group_create();
+	for (i = 0; i < 5; i++)
 	{
-		ff_core_fiberpool_execute_async(fiberpool_event_func, data);
+		ff_fiber_group_spawn(group, fiber_group_sleep_func, &data);
 	}
-	ASSERT(a == 0, "a shouldn't change while event isn't set");
-	for (i = 0; i < 14; i++)
+	ff_fiber_group_spawn(group, fiber_group_event_func, &data);
+	for (i = 0; i < 3; i++)
 	{
-		enum ff_result result;
-
-		ff_event_set(event);
-		result = ff_event_wait_with_timeout(done_event, 1);
-		ASSERT(result != FF_SUCCESS, "done_event should remain 'not set'");
+		ff_fiber_group_spawn(group, fiber_group_fast_func, &data);
 	}
-	ff_event_set(event);
-	ff_event_wait(done_event);
-	ASSERT(a == 15, "a should have value 15 after done_event set");
-	ff_event_delete(done_event);
-	ff_event_delete(event);
+	result = ff_fiber_group_wait_first_with_timeout(group, 4, 10);
+	ASSERT(result == FF_FAILURE, "only fast children can complete during the timeout");
+	ff_fiber_group_wait_first(group, 3);
+	ASSERT(data.fast_cnt == 3, "fast children should be completed");
+	ASSERT(ff_fiber_group_get_completed_cnt(group) == 3, "only fast children should be completed");
+	ff_fiber_group_cancel(group);
+	ff_fiber_group_wait(group);
+	ASSERT(data.cancelled_cnt == 6, "slow children should be cancelled");
+
+	/* children spawned after the cancellation are started in the cancelled state */
+	ff_fiber_group_spawn(group, fiber_group_sleep_func, &data);
+	ff_fiber_group_wait(group);
+	ASSERT(data.cancelled_cnt == 7, "the child of the cancelled group should be cancelled");
+	ff_fiber_group_delete(group);
+	ff_event_delete(data.event);
 	ff_core_shutdown();
 }
 
-static void test_event_all(void)
+struct fiber_group_tcp_data
 {
-	test_event_manual_create_delete();
-	test_event_auto_create_delete();
-	test_event_manual_basic();
-	test_event_auto_basic();
-	test_event_manual_timeout();
-	test_event_auto_timeout();
-	test_event_manual_multiple();
-	test_event_auto_multiple();
+	struct ff_tcp *tcp_server;
+	struct ff_tcp *tcp_accepted;
+	int is_read_aborted;
+};
+
+static void fiber_group_tcp_read_func(void *ctx)
+{
+	struct fiber_group_tcp_data *data;
+	struct ff_arch_net_addr *client_addr;
+	uint8_t buf[4];
+	enum ff_result result;
+
+	data = (struct fiber_group_tcp_data *) ctx;
+	client_addr = ff_arch_net_addr_create();
+	data->tcp_accepted = ff_tcp_accept(data->tcp_server, client_addr);
+	ASSERT(data->tcp_accepted != NULL, "ff_tcp_accept() should return valid tcp");
+	result = ff_tcp_read(data->tcp_accepted, buf, 4);
+	ASSERT(result == FF_FAILURE, "the read should be aborted by the cancellation");
+	data->is_read_aborted = 1;
+	ff_arch_net_addr_delete(client_addr);
 }
 
-/* end of ff_event tests */
+static void test_fiber_group_cancel_tcp(void)
+{
+	struct ff_fiber_group *group;
+	struct fiber_group_tcp_data data;
+	struct ff_arch_net_addr *addr;
+	struct ff_tcp *tcp_client;
+	enum ff_result result;
+	int is_equal;
+	uint8_t buf[4];
+
+	ff_core_initialize(LOG_FILENAME);
+	addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(addr, L"127.0.0.1", 43213);
+	ASSERT(result == FF_SUCCESS, "localhost address should be resolved successfully");
+	data.tcp_server = ff_tcp_create();
+	result = ff_tcp_bind(data.tcp_server, addr, FF_TCP_SERVER);
+	ASSERT(result == FF_SUCCESS, "server should be bound to local address");
+	data.tcp_accepted = NULL;
+	data.is_read_aborted = 0;
+	group = ff_fiber_group_create();
+	ff_fiber_group_spawn(group, fiber_group_tcp_read_func, &data);
+
+	tcp_client = ff_tcp_create();
+	result = ff_tcp_connect(tcp_client, addr);
+	ASSERT(result == FF_SUCCESS, "client should connect to the server");
+	result = ff_fiber_group_wait_first_with_timeout(group, 1, 10);
+	ASSERT(result == FF_FAILURE, "the child should be blocked in the read");
+	ff_fiber_group_cancel(group);
+	ff_fiber_group_wait(group);
+	ASSERT(data.is_read_aborted, "the read should be aborted");
+
+	/* the cancellation mustn't disconnect the socket */
+	result = ff_tcp_write(tcp_client, "test", 4);
+	ASSERT(result == FF_SUCCESS, "cannot write data to the tcp");
+	result = ff_tcp_flush(tcp_client);
+	ASSERT(result == FF_SUCCESS, "cannot flush the tcp");
+	result = ff_tcp_read(data.tcp_accepted, buf, 4);
+	ASSERT(result == FF_SUCCESS, "the tcp should remain connected after the cancellation");
+	is_equal = (memcmp(buf, "test", 4) == 0);
+	ASSERT(is_equal, "wrong data received from the client");
+
+	ff_fiber_group_delete(group);
+	ff_tcp_delete(data.tcp_accepted);
+	ff_tcp_delete(tcp_client);
+	ff_tcp_delete(data.tcp_server);
+	ff_arch_net_addr_delete(addr);
+	ff_core_shutdown();
+}
+
+static void test_fiber_group_all(void)
+{
+	test_fiber_group_create_delete();
+	test_fiber_group_wait();
+	test_fiber_group_wait_first();
+	test_fiber_group_cancel_tcp();
+}
+
+/* end of ff_fiber_group tests */
 
 /* start of ff_mutex tests */
 
@@ -727,10 +1989,68 @@ static void test_mutex_basic(void)
 	ff_core_shutdown();
 }
 
+struct mutex_fifo_data
+{
+	struct ff_mutex *mutex;
+	struct ff_event *done_event;
+	int arrivals_cnt;
+	int owners_cnt;
+	int is_fifo;
+};
+
+static void fiberpool_mutex_fifo_func(void *ctx)
+{
+	struct mutex_fifo_data *data;
+	int arrival_index;
+
+	data = (struct mutex_fifo_data *) ctx;
+	arrival_index = data->arrivals_cnt;
+	data->arrivals_cnt++;
+	ff_mutex_lock(data->mutex);
+	if (arrival_index != data->owners_cnt)
+	{
+		data->is_fifo = 0;
+	}
+	data->owners_cnt++;
+	ff_mutex_unlock(data->mutex);
+	if (data->owners_cnt == 10)
+	{
+		ff_event_set(data->done_event);
+	}
+}
+
+static void test_mutex_fifo(void)
+{
+	struct mutex_fifo_data data;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.mutex = ff_mutex_create();
+	data.done_event = ff_event_create(FF_EVENT_MANUAL);
+	data.arrivals_cnt = 0;
+	data.owners_cnt = 0;
+	data.is_fifo = 1;
+	ff_mutex_lock(data.mutex);
+	for (i = 0; i < 10; i++)
+	{
+		ff_core_fiberpool_execute_async(fiberpool_mutex_fifo_func, &data);
+	}
+	ff_core_sleep(10);
+	ASSERT(data.arrivals_cnt == 10, "all the fibers should wait for the mutex");
+	ff_mutex_unlock(data.mutex);
+	ff_event_wait(data.done_event);
+	ASSERT(data.is_fifo, "fibers should acquire the mutex in the order they were blocked");
+
+	ff_event_delete(data.done_event);
+	ff_mutex_delete(data.mutex);
+	ff_core_shutdown();
+}
+
 static void test_mutex_all(void)
 {
 	test_mutex_create_delete();
 	test_mutex_basic();
+	test_mutex_fifo();
 }
 
 /* end of ff_mutex tests */
@@ -774,10 +2094,72 @@ static void test_semaphore_basic(void)
 	ff_core_shutdown();
 }
 
+struct semaphore_timeouts_data
+{
+	struct ff_semaphore *semaphore;
+	struct ff_event *done_event;
+	int waiters_cnt;
+	int completed_cnt;
+	int failures_cnt;
+};
+
+static void fiberpool_semaphore_timeouts_func(void *ctx)
+{
+	struct semaphore_timeouts_data *data;
+	enum ff_result result;
+	int timeout;
+
+	data = (struct semaphore_timeouts_data *) ctx;
+	/* every other waiter expires, so expired waiters are removed from the middle of the wait queue */
+	timeout = (data->waiters_cnt % 2 == 0) ? 1 : 10000;
+	data->waiters_cnt++;
+	result = ff_semaphore_down_with_timeout(data->semaphore, timeout);
+	if (result != FF_SUCCESS)
+	{
+		ASSERT(timeout == 1, "only waiters with short timeout should fail");
+		data->failures_cnt++;
+	}
+	data->completed_cnt++;
+	if (data->completed_cnt == 100)
+	{
+		ff_event_set(data->done_event);
+	}
+}
+
+static void test_semaphore_timeouts(void)
+{
+	struct semaphore_timeouts_data data;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.semaphore = ff_semaphore_create(0);
+	data.done_event = ff_event_create(FF_EVENT_MANUAL);
+	data.waiters_cnt = 0;
+	data.completed_cnt = 0;
+	data.failures_cnt = 0;
+	for (i = 0; i < 100; i++)
+	{
+		ff_core_fiberpool_execute_async(fiberpool_semaphore_timeouts_func, &data);
+	}
+	ff_core_sleep(100);
+	ASSERT(data.failures_cnt == 50, "waiters with short timeout should fail");
+	for (i = 0; i < 50; i++)
+	{
+		ff_semaphore_up(data.semaphore);
+	}
+	ff_event_wait(data.done_event);
+	ASSERT(data.failures_cnt == 50, "waiters with long timeout should succeed");
+
+	ff_event_delete(data.done_event);
+	ff_semaphore_delete(data.semaphore);
+	ff_core_shutdown();
+}
+
 static void test_semaphore_all(void)
 {
 	test_semaphore_create_delete();
 	test_semaphore_basic();
+	test_semaphore_timeouts();
 }
 
 /* end of ff_semaphore tests */
@@ -939,6 +2321,257 @@ static void test_blocking_stack_all(void)
 
 /* end of ff_blocking_stack tests */
 
+/* start of ff_channel tests */
+
+static void test_channel_create_delete(void)
+{
+	struct ff_channel *channel;
+
+	ff_core_initialize(LOG_FILENAME);
+	channel = ff_channel_create(sizeof(int64_t), 10);
+	ASSERT(channel != NULL, "channel should be initialized");
+	ASSERT(ff_channel_get_size(channel) == 0, "new channel should be empty");
+	ff_channel_delete(channel);
+	ff_core_shutdown();
+}
+
+static void test_channel_basic(void)
+{
+	struct ff_channel *channel;
+	enum ff_result result;
+	int64_t data;
+	int64_t i;
+
+	ff_core_initialize(LOG_FILENAME);
+	channel = ff_channel_create(sizeof(int64_t), 10);
+	for (i = 0; i < 10; i++)
+	{
+		result = ff_channel_send(channel, &i);
+		ASSERT(result == FF_SUCCESS, "the value should be sent to the channel");
+	}
+	ASSERT(ff_channel_get_size(channel) == 10, "the channel should be full");
+	data = 123;
+	result = ff_channel_send_with_timeout(channel, &data, 1);
+	ASSERT(result != FF_SUCCESS, "the channel should be full");
+	for (i = 0; i < 10; i++)
+	{
+		result = ff_channel_receive(channel, &data);
+		ASSERT(result == FF_SUCCESS, "the value should be received from the channel");
+		ASSERT(data == i, "wrong value received from the channel");
+	}
+	ASSERT(ff_channel_get_size(channel) == 0, "the channel should be empty");
+	result = ff_channel_receive_with_timeout(channel, &data, 1);
+	ASSERT(result != FF_SUCCESS, "the channel should be empty");
+	ff_channel_delete(channel);
+	ff_core_shutdown();
+}
+
+struct channel_unbuffered_data
+{
+	struct ff_channel *values_channel;
+	struct ff_channel *sum_channel;
+};
+
+static void fiberpool_channel_sum_func(void *ctx)
+{
+	struct channel_unbuffered_data *data;
+	enum ff_result result;
+	int64_t value;
+	int64_t sum = 0;
+
+	data = (struct channel_unbuffered_data *) ctx;
+	for (;;)
+	{
+		result = ff_channel_receive(data->values_channel, &value);
+		if (result != FF_SUCCESS)
+		{
+			/* the channel has been closed */
+			break;
+		}
+		sum += value;
+	}
+	result = ff_channel_send(data->sum_channel, &sum);
+	ASSERT(result == FF_SUCCESS, "the sum should be sent to the channel");
+}
+
+static void test_channel_unbuffered(void)
+{
+	struct channel_unbuffered_data data;
+	enum ff_result result;
+	int64_t sum;
+	int64_t i;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.values_channel = ff_channel_create(sizeof(int64_t), 0);
+	data.sum_channel = ff_channel_create(sizeof(int64_t), 0);
+	i = 1;
+	result = ff_channel_send_with_timeout(data.values_channel, &i, 1);
+	ASSERT(result != FF_SUCCESS, "the unbuffered channel shouldn't accept values without receivers");
+	ff_core_fiberpool_execute_async(fiberpool_channel_sum_func, &data);
+	for (i = 1; i <= 100; i++)
+	{
+		result = ff_channel_send(data.values_channel, &i);
+		ASSERT(result == FF_SUCCESS, "the value should be handed to the receiver");
+		ASSERT(ff_channel_get_size(data.values_channel) == 0, "the unbuffered channel shouldn't hold values");
+	}
+	ff_channel_close(data.values_channel);
+	result = ff_channel_receive(data.sum_channel, &sum);
+	ASSERT(result == FF_SUCCESS, "the sum should be received");
+	ASSERT(sum == 5050, "wrong sum of values");
+	result = ff_channel_send(data.values_channel, &i);
+	ASSERT(result != FF_SUCCESS, "values cannot be sent to the closed channel");
+	ff_channel_delete(data.sum_channel);
+	ff_channel_delete(data.values_channel);
+	ff_core_shutdown();
+}
+
+static void test_channel_close(void)
+{
+	struct ff_channel *channel;
+	enum ff_result result;
+	int data;
+
+	ff_core_initialize(LOG_FILENAME);
+	channel = ff_channel_create(sizeof(int), 5);
+	data = 1;
+	ff_channel_send(channel, &data);
+	data = 2;
+	ff_channel_send(channel, &data);
+	ff_channel_close(channel);
+	result = ff_channel_send(channel, &data);
+	ASSERT(result != FF_SUCCESS, "values cannot be sent to the closed channel");
+	result = ff_channel_receive(channel, &data);
+	ASSERT(result == FF_SUCCESS && data == 1, "remaining values should be received from the closed channel");
+	result = ff_channel_receive(channel, &data);
+	ASSERT(result == FF_SUCCESS && data == 2, "remaining values should be received from the closed channel");
+	result = ff_channel_receive(channel, &data);
+	ASSERT(result != FF_SUCCESS, "the closed channel has no more values");
+	ff_channel_delete(channel);
+	ff_core_shutdown();
+}
+
+static void fiberpool_channel_reply_func(void *ctx)
+{
+	struct ff_channel *channel;
+	int reply = 42;
+
+	channel = (struct ff_channel *) ctx;
+	ff_core_sleep(20);
+	ff_channel_send(channel, &reply);
+}
+
+static void test_channel_select(void)
+{
+	struct ff_channel *reply_channel, *cancel_channel, *out_channel;
+	struct ff_channel_select_case cases[3];
+	int reply, cancel, out;
+	int case_index;
+
+	ff_core_initialize(LOG_FILENAME);
+	reply_channel = ff_channel_create(sizeof(int), 0);
+	cancel_channel = ff_channel_create(sizeof(int), 1);
+	out_channel = ff_channel_create(sizeof(int), 1);
+	cases[0].channel = reply_channel;
+	cases[0].operation = FF_CHANNEL_RECEIVE;
+	cases[0].value = &reply;
+	cases[1].channel = cancel_channel;
+	cases[1].operation = FF_CHANNEL_RECEIVE;
+	cases[1].value = &cancel;
+
+	case_index = ff_channel_select_with_timeout(cases, 2, 1);
+	ASSERT(case_index == -1, "none of the cases should be selected");
+	ff_core_fiberpool_execute_async(fiberpool_channel_reply_func, reply_channel);
+	case_index = ff_channel_select(cases, 2);
+	ASSERT(case_index == 0, "the reply should be selected");
+	ASSERT(cases[0].result == FF_SUCCESS && reply == 42, "wrong reply received");
+
+	cancel = 1;
+	ff_channel_send(cancel_channel, &cancel);
+	cancel = 0;
+	case_index = ff_channel_select_with_timeout(cases, 2, 1000);
+	ASSERT(case_index == 1, "the cancellation should be selected");
+	ASSERT(cases[1].result == FF_SUCCESS && cancel == 1, "wrong cancellation received");
+
+	/* the send case is selected while the out_channel has free space */
+	out = 5;
+	cases[2].channel = out_channel;
+	cases[2].operation = FF_CHANNEL_SEND;
+	cases[2].value = &out;
+	case_index = ff_channel_select_with_timeout(cases, 3, 1000);
+	ASSERT(case_index == 2, "the send case should be selected");
+	case_index = ff_channel_select_with_timeout(cases, 3, 1);
+	ASSERT(case_index == -1, "none of the cases should be selected after the out_channel becomes full");
+	ff_channel_close(reply_channel);
+	case_index = ff_channel_select(cases, 3);
+	ASSERT(case_index == 0 && cases[0].result == FF_FAILURE, "the receive case on the closed channel should fail");
+
+	ff_channel_delete(out_channel);
+	ff_channel_delete(cancel_channel);
+	ff_channel_delete(reply_channel);
+	ff_core_shutdown();
+}
+
+static void fiberpool_channel_handoff_func(void *ctx)
+{
+	struct channel_unbuffered_data *data;
+	enum ff_result result;
+	int64_t value;
+
+	data = (struct channel_unbuffered_data *) ctx;
+	for (;;)
+	{
+		result = ff_channel_receive(data->values_channel, &value);
+		if (result != FF_SUCCESS)
+		{
+			break;
+		}
+		result = ff_channel_send_with_timeout(data->sum_channel, &value, 1000);
+		ASSERT(result == FF_SUCCESS, "the value should be sent to the buffered channel");
+	}
+	ff_channel_close(data->sum_channel);
+}
+
+static void test_channel_unbuffered_handoff(void)
+{
+	struct channel_unbuffered_data data;
+	enum ff_result result;
+	int64_t value;
+	int64_t i;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.values_channel = ff_channel_create(sizeof(int64_t), 0);
+	data.sum_channel = ff_channel_create(sizeof(int64_t), 1);
+	ff_core_fiberpool_execute_async(fiberpool_channel_handoff_func, &data);
+	for (i = 0; i < 10; i++)
+	{
+		result = ff_channel_send(data.values_channel, &i);
+		ASSERT(result == FF_SUCCESS, "the value should be sent to the channel");
+		/* the receiver must run immediately after the value has been handed to it */
+		ASSERT(ff_channel_get_size(data.sum_channel) == 1, "the receiver should forward the value immediately");
+		result = ff_channel_receive(data.sum_channel, &value);
+		ASSERT(result == FF_SUCCESS, "the value should be received from the channel");
+		ASSERT(value == i, "wrong value received from the channel");
+	}
+	ff_channel_close(data.values_channel);
+	result = ff_channel_receive(data.sum_channel, &value);
+	ASSERT(result == FF_FAILURE, "the receiver should close the channel");
+	ff_channel_delete(data.values_channel);
+	ff_channel_delete(data.sum_channel);
+	ff_core_shutdown();
+}
+
+static void test_channel_all(void)
+{
+	test_channel_create_delete();
+	test_channel_basic();
+	test_channel_unbuffered();
+	test_channel_unbuffered_handoff();
+	test_channel_close();
+	test_channel_select();
+}
+
+/* end of ff_channel tests */
+
 /* start of ff_pool tests */
 
 static int pool_entries_cnt = 0;
@@ -1353,11 +2986,101 @@ static void test_pipe_short(void)
 	ff_core_shutdown();
 }
 
+static void pipe_wrap_around_fiberpool_func(void *ctx)
+{
+	struct ff_pipe *pipe;
+	char buf[10];
+	int is_equal;
+	enum ff_result result;
+
+	pipe = (struct ff_pipe *) ctx;
+	result = ff_pipe_read(pipe, buf, 10);
+	ASSERT(result == FF_SUCCESS, "cannot read from the pipe");
+	is_equal = (memcmp(buf, "0123456789", 10) == 0);
+	ASSERT(is_equal, "wrong value received");
+	ff_pipe_disconnect(pipe);
+}
+
+static void test_pipe_wrap_around(void)
+{
+	struct ff_pipe *pipe1, *pipe2;
+	char buf[1];
+	enum ff_result result;
+
+	ff_core_initialize(LOG_FILENAME);
+	ff_pipe_create_pair(10, &pipe1, &pipe2);
+	/* the second write reaches the end of the buffer, while nothing has been read yet */
+	result = ff_pipe_write(pipe1, "0123", 4);
+	ASSERT(result == FF_SUCCESS, "cannot write to the pipe");
+	ff_core_fiberpool_execute_async(pipe_wrap_around_fiberpool_func, pipe2);
+	result = ff_pipe_write(pipe1, "456789", 6);
+	ASSERT(result == FF_SUCCESS, "cannot write to the pipe");
+	result = ff_pipe_read(pipe1, buf, 1);
+	ASSERT(result == FF_FAILURE, "the pipe must be disconnected");
+	ff_pipe_delete(pipe2);
+	ff_pipe_delete(pipe1);
+	ff_core_shutdown();
+}
+
+struct pipe_flush_data
+{
+	struct ff_pipe *pipe;
+	int is_read;
+};
+
+static void pipe_flush_func(void *ctx)
+{
+	struct pipe_flush_data *data;
+	char buf[4];
+	enum ff_result result;
+	int is_equal;
+
+	data = (struct pipe_flush_data *) ctx;
+	result = ff_pipe_read(data->pipe, buf, 4);
+	ASSERT(result == FF_SUCCESS, "cannot read from the pipe");
+	is_equal = (memcmp(buf, "abcd", 4) == 0);
+	ASSERT(is_equal, "wrong value received");
+	data->is_read = 1;
+}
+
+static void test_pipe_flush(void)
+{
+	struct ff_pipe *pipe1, *pipe2;
+	struct pipe_flush_data data;
+	struct ff_fiber *fiber;
+	enum ff_result result;
+
+	ff_core_initialize(LOG_FILENAME);
+	ff_pipe_create_pair(10, &pipe1, &pipe2);
+	data.pipe = pipe2;
+	data.is_read = 0;
+	fiber = ff_fiber_create(pipe_flush_func, 0);
+	ff_fiber_start(fiber, &data);
+	ff_fiber_switch_to(fiber);
+	ASSERT(data.is_read == 0, "the reader should wait for data");
+	result = ff_pipe_write(pipe1, "ab", 2);
+	ASSERT(result == FF_SUCCESS, "cannot write to the pipe");
+	result = ff_pipe_write(pipe1, "cd", 2);
+	ASSERT(result == FF_SUCCESS, "cannot write to the pipe");
+	ASSERT(data.is_read == 0, "the reader shouldn't run until the pipe is flushed");
+	ff_pipe_flush(pipe1);
+	ASSERT(data.is_read == 1, "the reader should process the data immediately after the flush");
+	/* the flush without the waiting reader is no-op */
+	ff_pipe_flush(pipe1);
+	ff_fiber_join(fiber);
+	ff_fiber_delete(fiber);
+	ff_pipe_delete(pipe2);
+	ff_pipe_delete(pipe1);
+	ff_core_shutdown();
+}
+
 static void test_pipe_all(void)
 {
 	test_pipe_create_delete();
 	test_pipe_basic();
 	test_pipe_short();
+	test_pipe_wrap_around();
+	test_pipe_flush();
 }
 
 /* end of ff_pipe tests */
@@ -1754,11 +3477,105 @@ static void test_tcp_server_shutdown(void)
 	ff_core_shutdown();
 }
 
+#ifndef WIN32
+
+struct tcp_shared_stack_data
+{
+	struct ff_tcp *tcp;
+	struct ff_event *event;
+	int is_read;
+};
+
+static void tcp_shared_stack_reader_func(void *ctx)
+{
+	struct tcp_shared_stack_data *data;
+	uint8_t buf[1];
+	enum ff_result result;
+
+	data = (struct tcp_shared_stack_data *) ctx;
+	/* the buffer is located on the shared stack, while the reader waits for the data */
+	result = ff_tcp_read(data->tcp, buf, 1);
+	ASSERT(result == FF_SUCCESS, "ff_tcp_read() failed");
+	ASSERT(buf[0] == 'x', "wrong data received");
+	data->is_read = 1;
+}
+
+static void tcp_shared_stack_worker_func(void *ctx)
+{
+	struct tcp_shared_stack_data *data;
+
+	data = (struct tcp_shared_stack_data *) ctx;
+	ff_event_set(data->event);
+}
+
+static void test_tcp_shared_stack_idle_reader(void)
+{
+	struct tcp_shared_stack_data data;
+	struct ff_tcp *tcp_server, *tcp_client, *tcp_accepted;
+	struct ff_arch_net_addr *addr, *client_addr;
+	struct ff_fiber *reader, *worker;
+	char *prev_backend;
+	enum ff_result result;
+
+	prev_backend = set_env_var("FF_IO_BACKEND", "io_uring");
+	ff_core_initialize(LOG_FILENAME);
+	addr = ff_arch_net_addr_create();
+	client_addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(addr, L"127.0.0.1", 43213);
+	ASSERT(result == FF_SUCCESS, "localhost address should be resolved successfully");
+	tcp_server = ff_tcp_create();
+	result = ff_tcp_bind(tcp_server, addr, FF_TCP_SERVER);
+	ASSERT(result == FF_SUCCESS, "server should be bound to local address");
+	tcp_client = ff_tcp_create();
+	result = ff_tcp_connect(tcp_client, addr);
+	ASSERT(result == FF_SUCCESS, "client should connect to the server");
+	tcp_accepted = ff_tcp_accept(tcp_server, client_addr);
+	ASSERT(tcp_accepted != NULL, "ff_tcp_accept() should return valid tcp");
+
+	data.tcp = tcp_accepted;
+	data.event = ff_event_create(FF_EVENT_AUTO);
+	data.is_read = 0;
+	reader = ff_fiber_create(tcp_shared_stack_reader_func, FF_FIBER_SHARED_STACK);
+	ff_fiber_start(reader, &data);
+	ff_core_sleep(10);
+	ASSERT(data.is_read == 0, "the reader should wait for the data");
+
+	/* the idle reader mustn't occupy the shared stack, so other fibers on it run without delay */
+	worker = ff_fiber_create(tcp_shared_stack_worker_func, FF_FIBER_SHARED_STACK);
+	ff_fiber_start(worker, &data);
+	result = ff_event_wait_with_timeout(data.event, 1000);
+	ASSERT(result == FF_SUCCESS, "the fiber on the shared stack shouldn't wait for the idle reader");
+	ff_fiber_join(worker);
+	ff_fiber_delete(worker);
+
+	result = ff_tcp_write(tcp_client, "x", 1);
+	ASSERT(result == FF_SUCCESS, "cannot write data to the tcp");
+	result = ff_tcp_flush(tcp_client);
+	ASSERT(result == FF_SUCCESS, "cannot flush the tcp");
+	ff_fiber_join(reader);
+	ff_fiber_delete(reader);
+	ASSERT(data.is_read == 1, "the reader should receive the data");
+
+	ff_event_delete(data.event);
+	ff_tcp_delete(tcp_accepted);
+	ff_tcp_delete(tcp_client);
+	ff_tcp_delete(tcp_server);
+	ff_arch_net_addr_delete(client_addr);
+	ff_arch_net_addr_delete(addr);
+	ff_core_shutdown();
+	restore_env_var("FF_IO_BACKEND", prev_backend);
+}
+
+#endif
+
 static void test_tcp_all(void)
 {
 	test_tcp_create_delete();
 	test_tcp_basic();
 	test_tcp_server_shutdown();
+#ifndef WIN32
+	test_tcp_shared_stack_idle_reader();
+#endif
 }
 
 /* end of ff_tcp tests */
@@ -2306,6 +4123,490 @@ static void test_udp_all(void)
 
 /* end of ff_udp tests */
 
+/* start of io backends tests */
+
+#ifndef WIN32
+
+#define IO_BACKENDS_CNT 2
+
+static const char *io_backends[IO_BACKENDS_CNT] = {"epoll", "io_uring"};
+
+struct io_backend_reader_data
+{
+	struct ff_tcp *tcp;
+	struct ff_udp *udp;
+	enum ff_result result;
+	int len;
+};
+
+static void tcp_io_backend_reader_func(void *ctx)
+{
+	struct io_backend_reader_data *data;
+	uint8_t buf[1];
+
+	data = (struct io_backend_reader_data *) ctx;
+	data->result = ff_tcp_read(data->tcp, buf, 1);
+}
+
+static void udp_io_backend_reader_func(void *ctx)
+{
+	struct io_backend_reader_data *data;
+	struct ff_arch_net_addr *peer_addr;
+	uint8_t buf[1];
+
+	data = (struct io_backend_reader_data *) ctx;
+	peer_addr = ff_arch_net_addr_create();
+	data->len = ff_udp_read(data->udp, peer_addr, buf, 1);
+	ff_arch_net_addr_delete(peer_addr);
+}
+
+static void check_file_io(void)
+{
+	struct ff_file *file;
+	const wchar_t *tmp_file_path;
+	uint8_t *data;
+	uint8_t *buf;
+	int64_t size;
+	int is_equal;
+	int i;
+	enum ff_result result;
+
+	data = (uint8_t *) ff_malloc(200000);
+	buf = (uint8_t *) ff_malloc(200000);
+	for (i = 0; i < 200000; i++)
+	{
+		data[i] = (uint8_t) (i * 7);
+	}
+	tmp_file_path = create_tmp_unique_file_path();
+
+	/* chunks exceed the buffer of the ff_file, so each chunk is written at the current file position */
+	file = ff_file_open(tmp_file_path, FF_FILE_WRITE);
+	ASSERT(file != NULL, "cannot create the file");
+	result = ff_file_write(file, data, 50000);
+	ASSERT(result == FF_SUCCESS, "cannot write to the file");
+	result = ff_file_write(file, data + 50000, 150000);
+	ASSERT(result == FF_SUCCESS, "cannot write to the file");
+	result = ff_file_flush(file);
+	ASSERT(result == FF_SUCCESS, "cannot flush the file");
+	ff_file_close(file);
+
+	file = ff_file_open(tmp_file_path, FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the file");
+	size = ff_file_get_size(file);
+	ASSERT(size == 200000, "wrong file size");
+	result = ff_file_read(file, buf, 70000);
+	ASSERT(result == FF_SUCCESS, "cannot read from the file");
+	result = ff_file_read(file, buf + 70000, 130000);
+	ASSERT(result == FF_SUCCESS, "cannot read from the file");
+	is_equal = (memcmp(data, buf, 200000) == 0);
+	ASSERT(is_equal, "wrong data read from the file");
+	result = ff_file_read(file, buf, 1);
+	ASSERT(result != FF_SUCCESS, "the file shouldn't contain data after the end");
+	ff_file_close(file);
+
+	result = ff_file_erase(tmp_file_path);
+	ASSERT(result == FF_SUCCESS, "cannot erase the file");
+	delete_tmp_unique_file_path(tmp_file_path);
+	ff_free(buf);
+	ff_free(data);
+}
+
+static void check_tcp_io(void)
+{
+	struct io_backend_reader_data data;
+	struct ff_tcp *tcp_server, *tcp_client, *tcp_accepted;
+	struct ff_arch_net_addr *addr, *client_addr;
+	struct ff_fiber *reader;
+	uint8_t buf[4];
+	int is_equal;
+	enum ff_result result;
+
+	addr = ff_arch_net_addr_create();
+	client_addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(addr, L"127.0.0.1", 43214);
+	ASSERT(result == FF_SUCCESS, "localhost address should be resolved successfully");
+	tcp_server = ff_tcp_create();
+	result = ff_tcp_bind(tcp_server, addr, FF_TCP_SERVER);
+	ASSERT(result == FF_SUCCESS, "server should be bound to local address");
+	tcp_client = ff_tcp_create();
+	result = ff_tcp_connect(tcp_client, addr);
+	ASSERT(result == FF_SUCCESS, "client should connect to the server");
+	tcp_accepted = ff_tcp_accept(tcp_server, client_addr);
+	ASSERT(tcp_accepted != NULL, "ff_tcp_accept() should return valid tcp");
+
+	result = ff_tcp_write_with_timeout(tcp_client, "ping", 4, 1000);
+	ASSERT(result == FF_SUCCESS, "cannot write to the tcp");
+	result = ff_tcp_flush_with_timeout(tcp_client, 1000);
+	ASSERT(result == FF_SUCCESS, "cannot flush the tcp");
+	result = ff_tcp_read(tcp_accepted, buf, 4);
+	ASSERT(result == FF_SUCCESS, "cannot read from the tcp");
+	is_equal = (memcmp(buf, "ping", 4) == 0);
+	ASSERT(is_equal, "wrong data received by the server");
+	result = ff_tcp_write(tcp_accepted, "pong", 4);
+	ASSERT(result == FF_SUCCESS, "cannot write to the tcp");
+	result = ff_tcp_flush(tcp_accepted);
+	ASSERT(result == FF_SUCCESS, "cannot flush the tcp");
+	result = ff_tcp_read_with_timeout(tcp_client, buf, 4, 1000);
+	ASSERT(result == FF_SUCCESS, "cannot read from the tcp");
+	is_equal = (memcmp(buf, "pong", 4) == 0);
+	ASSERT(is_equal, "wrong data received by the client");
+
+	/* the cancelled reader must be woken up, while its operation is pending */
+	data.tcp = tcp_accepted;
+	data.result = FF_SUCCESS;
+	reader = ff_fiber_create(tcp_io_backend_reader_func, 0);
+	ff_fiber_start(reader, &data);
+	ff_core_sleep(10);
+	ff_fiber_cancel(reader);
+	ff_fiber_join(reader);
+	ff_fiber_delete(reader);
+	ASSERT(data.result == FF_FAILURE, "the cancelled read should fail");
+
+	result = ff_tcp_read_with_timeout(tcp_client, buf, 1, 10);
+	ASSERT(result == FF_FAILURE, "the read without data should time out");
+
+	ff_tcp_delete(tcp_accepted);
+	ff_tcp_delete(tcp_client);
+	ff_tcp_delete(tcp_server);
+	ff_arch_net_addr_delete(client_addr);
+	ff_arch_net_addr_delete(addr);
+}
+
+static void check_udp_io(void)
+{
+	struct io_backend_reader_data data;
+	struct ff_udp *udp1, *udp2;
+	struct ff_arch_net_addr *addr1, *addr2, *peer_addr;
+	struct ff_fiber *reader;
+	uint8_t buf[10];
+	int len;
+	int is_equal;
+	enum ff_result result;
+
+	addr1 = ff_arch_net_addr_create();
+	addr2 = ff_arch_net_addr_create();
+	peer_addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(addr1, L"127.0.0.1", 43215);
+	ASSERT(result == FF_SUCCESS, "localhost address should be resolved successfully");
+	result = ff_arch_net_addr_resolve(addr2, L"127.0.0.1", 43216);
+	ASSERT(result == FF_SUCCESS, "localhost address should be resolved successfully");
+	udp1 = ff_udp_create(FF_UDP_UNICAST);
+	result = ff_udp_bind(udp1, addr1);
+	ASSERT(result == FF_SUCCESS, "cannot bind the udp to local address");
+	udp2 = ff_udp_create(FF_UDP_UNICAST);
+	result = ff_udp_bind(udp2, addr2);
+	ASSERT(result == FF_SUCCESS, "cannot bind the udp to local address");
+
+	len = ff_udp_write_with_timeout(udp1, addr2, "test", 4, 1000);
+	ASSERT(len == 4, "ff_udp_write() should write 4 bytes");
+	len = ff_udp_read_with_timeout(udp2, peer_addr, buf, 10, 1000);
+	ASSERT(len == 4, "ff_udp_read() should read 4 bytes");
+	is_equal = (memcmp(buf, "test", 4) == 0);
+	ASSERT(is_equal, "wrong data received");
+	is_equal = ff_arch_net_addr_is_equal(peer_addr, addr1);
+	ASSERT(is_equal, "wrong peer address");
+
+	/* the cancelled reader must be woken up, while its operation is pending */
+	data.udp = udp2;
+	data.len = 0;
+	reader = ff_fiber_create(udp_io_backend_reader_func, 0);
+	ff_fiber_start(reader, &data);
+	ff_core_sleep(10);
+	ff_fiber_cancel(reader);
+	ff_fiber_join(reader);
+	ff_fiber_delete(reader);
+	ASSERT(data.len == -1, "the cancelled read should fail");
+
+	/* the timeout disconnects the udp, which cancels the pending read */
+	len = ff_udp_read_with_timeout(udp2, peer_addr, buf, 10, 10);
+	ASSERT(len == -1, "the read without data should time out");
+
+	ff_udp_delete(udp2);
+	ff_udp_delete(udp1);
+	ff_arch_net_addr_delete(peer_addr);
+	ff_arch_net_addr_delete(addr2);
+	ff_arch_net_addr_delete(addr1);
+}
+
+static void test_io_backends_file(void)
+{
+	char *prev_backend;
+	int i;
+
+	for (i = 0; i < IO_BACKENDS_CNT; i++)
+	{
+		prev_backend = set_env_var("FF_IO_BACKEND", io_backends[i]);
+		ff_core_initialize(LOG_FILENAME);
+		check_file_io();
+		ff_core_shutdown();
+		restore_env_var("FF_IO_BACKEND", prev_backend);
+	}
+}
+
+static void test_io_backends_tcp(void)
+{
+	char *prev_backend;
+	int i;
+
+	for (i = 0; i < IO_BACKENDS_CNT; i++)
+	{
+		prev_backend = set_env_var("FF_IO_BACKEND", io_backends[i]);
+		ff_core_initialize(LOG_FILENAME);
+		check_tcp_io();
+		ff_core_shutdown();
+		restore_env_var("FF_IO_BACKEND", prev_backend);
+	}
+}
+
+static void test_io_backends_udp(void)
+{
+	char *prev_backend;
+	int i;
+
+	for (i = 0; i < IO_BACKENDS_CNT; i++)
+	{
+		prev_backend = set_env_var("FF_IO_BACKEND", io_backends[i]);
+		ff_core_initialize(LOG_FILENAME);
+		check_udp_io();
+		ff_core_shutdown();
+		restore_env_var("FF_IO_BACKEND", prev_backend);
+	}
+}
+
+/**
+ * installs the seccomp filter for the current process. The filter cannot be removed,
+ * so it must be installed only in child processes.
+ */
+static void install_seccomp_filter(struct sock_filter *filter, int filter_len)
+{
+	struct sock_fprog program;
+	int rv;
+
+	program.len = (unsigned short) filter_len;
+	program.filter = filter;
+	rv = prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
+	ASSERT(rv == 0, "cannot set no_new_privs");
+	rv = prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program);
+	ASSERT(rv == 0, "cannot install the seccomp filter");
+}
+
+/**
+ * makes the io_uring_setup() syscall fail with ENOSYS in the current process,
+ * as on kernels without the io_uring support.
+ */
+static void disable_io_uring(void)
+{
+	struct sock_filter filter[] =
+	{
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_io_uring_setup, 0, 1),
+		BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | ENOSYS),
+		BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+	};
+	int rv;
+
+	install_seccomp_filter(filter, sizeof(filter) / sizeof(filter[0]));
+	rv = (int) syscall(__NR_io_uring_setup, 1, NULL);
+	ASSERT(rv == -1 && errno == ENOSYS, "the io_uring should be unavailable");
+}
+
+static void test_io_backends_fallback(void)
+{
+	pid_t pid;
+	int status;
+
+	/* the filter cannot be removed, so it is installed in the child process */
+	pid = fork();
+	ASSERT(pid != -1, "cannot fork the process");
+	if (pid == 0)
+	{
+		disable_io_uring();
+		set_env_var("FF_IO_BACKEND", "io_uring");
+		ff_core_initialize(LOG_FILENAME);
+		check_file_io();
+		check_tcp_io();
+		check_udp_io();
+		ff_core_shutdown();
+		_exit(0);
+	}
+	pid = waitpid(pid, &status, 0);
+	ASSERT(pid != -1, "cannot wait for the child process");
+	ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "the epoll fallback should work when the io_uring is unavailable");
+}
+
+#endif
+
+static void test_io_backends_all(void)
+{
+#ifndef WIN32
+	test_io_backends_file();
+	test_io_backends_tcp();
+	test_io_backends_udp();
+	test_io_backends_fallback();
+#endif
+}
+
+/* end of io backends tests */
+
+/* start of busy poll tests */
+
+#ifndef WIN32
+
+/* SO_BUSY_POLL is missing in sys/socket.h of old glibc versions */
+#ifndef SO_BUSY_POLL
+#	define SO_BUSY_POLL 46
+#endif
+
+static void busy_poll_threadpool_func(void *ctx)
+{
+	int *a;
+
+	a = (int *) ctx;
+	(*a)++;
+}
+
+static void busy_poll_fiberpool_func(void *ctx)
+{
+	struct ff_event *event;
+
+	event = (struct ff_event *) ctx;
+	ff_event_set(event);
+}
+
+static int64_t get_thread_cpu_time_ms(void)
+{
+	struct timespec ts;
+	int rv;
+
+	rv = clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	ASSERT(rv == 0, "cannot obtain the thread cpu time");
+	return ((int64_t) ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void test_busy_poll_completions(void)
+{
+	struct ff_event *event;
+	char *prev_busy_poll, *prev_so_busy_poll, *prev_backend;
+	int a;
+	int i, j;
+
+	prev_busy_poll = set_env_var("FF_BUSY_POLL", "1000");
+	prev_so_busy_poll = set_env_var("FF_SO_BUSY_POLL", "50");
+	for (i = 0; i < IO_BACKENDS_CNT; i++)
+	{
+		prev_backend = set_env_var("FF_IO_BACKEND", io_backends[i]);
+		ff_core_initialize(LOG_FILENAME);
+		/* events of all kinds must be delivered while the scheduler spins */
+		check_tcp_io();
+		check_udp_io();
+		a = 0;
+		for (j = 0; j < 10; j++)
+		{
+			ff_core_threadpool_execute(busy_poll_threadpool_func, &a);
+		}
+		ASSERT(a == 10, "threadpool completions should be delivered");
+		event = ff_event_create(FF_EVENT_AUTO);
+		for (j = 0; j < 10; j++)
+		{
+			ff_core_fiberpool_execute_async(busy_poll_fiberpool_func, event);
+			ff_event_wait(event);
+			ff_core_sleep(1);
+		}
+		ff_event_delete(event);
+		ff_core_shutdown();
+		restore_env_var("FF_IO_BACKEND", prev_backend);
+	}
+	restore_env_var("FF_SO_BUSY_POLL", prev_so_busy_poll);
+	restore_env_var("FF_BUSY_POLL", prev_busy_poll);
+}
+
+static void test_busy_poll_idle_decay(void)
+{
+	char *prev_busy_poll;
+	int64_t cpu_time;
+	int i;
+
+	/* the scheduler spins up to 20ms waiting for each timer, which expires after 50ms */
+	prev_busy_poll = set_env_var("FF_BUSY_POLL", "20000");
+	ff_core_initialize(LOG_FILENAME);
+	cpu_time = get_thread_cpu_time_ms();
+	for (i = 0; i < 20; i++)
+	{
+		ff_core_sleep(50);
+	}
+	cpu_time = get_thread_cpu_time_ms() - cpu_time;
+	/* the scheduler would burn 400ms of cpu time if the spin time didn't decay */
+	ASSERT(cpu_time < 200, "the idle scheduler should stop spinning");
+	ff_core_shutdown();
+	restore_env_var("FF_BUSY_POLL", prev_busy_poll);
+}
+
+/**
+ * makes the setsockopt(SO_BUSY_POLL) fail with EPERM in the current process,
+ * as for values above the net.core.busy_read without the CAP_NET_ADMIN.
+ */
+static void reject_busy_poll_socket_option(void)
+{
+	struct sock_filter filter[] =
+	{
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_setsockopt, 0, 3),
+		/* the lower half of the optname argument on little-endian architectures */
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, args[2])),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SO_BUSY_POLL, 0, 1),
+		BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM),
+		BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+	};
+	int busy_poll;
+	int sd;
+	int rv;
+
+	install_seccomp_filter(filter, sizeof(filter) / sizeof(filter[0]));
+	sd = socket(PF_INET, SOCK_STREAM, 0);
+	ASSERT(sd != -1, "cannot create the socket");
+	busy_poll = 50;
+	rv = setsockopt(sd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll));
+	ASSERT(rv == -1 && errno == EPERM, "the SO_BUSY_POLL should be rejected");
+	close(sd);
+}
+
+static void test_busy_poll_socket_option_failure(void)
+{
+	pid_t pid;
+	int status;
+
+	/* the filter cannot be removed, so it is installed in the child process */
+	pid = fork();
+	ASSERT(pid != -1, "cannot fork the process");
+	if (pid == 0)
+	{
+		reject_busy_poll_socket_option();
+		/* sockets must work without the SO_BUSY_POLL, which cannot be set */
+		set_env_var("FF_SO_BUSY_POLL", "50");
+		ff_core_initialize(LOG_FILENAME);
+		check_tcp_io();
+		check_udp_io();
+		ff_core_shutdown();
+		_exit(0);
+	}
+	pid = waitpid(pid, &status, 0);
+	ASSERT(pid != -1, "cannot wait for the child process");
+	ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "sockets should work when the SO_BUSY_POLL cannot be set");
+}
+
+#endif
+
+static void test_busy_poll_all(void)
+{
+#ifndef WIN32
+	test_busy_poll_completions();
+	test_busy_poll_idle_decay();
+	test_busy_poll_socket_option_failure();
+#endif
+}
+
+/* end of busy poll tests */
+
 static void test_all(void)
 {
 	test_malloc_all();
@@ -2314,10 +4615,13 @@ static void test_all(void)
 	test_arch_misc_all();
 	test_fiber_all();
 	test_event_all();
+	test_timer_all();
+	test_fiber_group_all();
 	test_mutex_all();
 	test_semaphore_all();
 	test_blocking_queue_all();
 	test_blocking_stack_all();
+	test_channel_all();
 	test_pool_all();
 	test_dictionary_all();
 	test_pipe_all();
@@ -2328,6 +4632,8 @@ static void test_all(void)
 	test_stream_acceptor_tcp_all();
 	test_stream_connector_tcp_all();
 	test_udp_all();
+	test_io_backends_all();
+	test_busy_poll_all();
 }
 
 int main(void)